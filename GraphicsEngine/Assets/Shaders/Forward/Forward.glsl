@@ -1,4 +1,7 @@
-#ifdef FORWARD_ALBEDO_SPECULAR
+#ifdef FORWARD
+
+// Features: ALBEDO_MAP, SPECULAR_MAP, IRRADIANCE, REFLECTION, REFRACTION
+// Blocks: GlobalParameters, LocalParameters (declared by the engine, see ShaderParameters.h)
 
 #if defined(VERTEX) ///////////////////////////////////////////////////
 
@@ -8,26 +11,6 @@ layout(location = 2) in vec2 aTexCoord;
 layout(location = 3) in vec3 aTangent;
 layout(location = 4) in vec3 aBitangent;
 
-struct Light
-{
-	vec4 lightVector; // XYZ for position/direction and W for type
-	vec3 color;
-	float constant;
-};
-
-layout(binding = 0, std140) uniform GlobalParameters
-{
-	vec3 uViewPos;
-	unsigned int uNumLights;
-	Light uLights[16];
-};
-
-layout(binding = 1, std140) uniform LocalParameters
-{
-	mat4 uModel;
-	mat4 uMVP;
-};
-
 out VS_OUT
 {
 	vec2 TexCoord;
@@ -50,24 +33,18 @@ void main()
 
 layout(location = 0) out vec4 FragColor;
 
-struct Light
-{
-	vec4 lightVector; // XYZ for position/direction and W for type
-	vec3 color;
-	float constant;
-};
-
-layout(binding = 0, std140) uniform GlobalParameters
-{
-	vec3 uViewPos;
-	unsigned int uNumLights;
-	Light uLights[16];
-};
-
 struct Material
 {
+#ifdef ALBEDO_MAP
 	sampler2D albedo;
+#else
+	vec3 albedo;
+#endif
+#ifdef SPECULAR_MAP
 	sampler2D specular;
+#else
+	vec3 specular;
+#endif
 	vec3 reflective;
 	float shininess;
 };
@@ -84,25 +61,26 @@ in VS_OUT
 uniform samplerCube uEnvironmentMap;
 uniform samplerCube uIrradianceMap;
 
-struct RendererOptions
-{
-	bool uActiveIrradiance;
-	bool uActiveReflection;
-	bool uActiveRefraction;
-};
-uniform RendererOptions uRendererOptions;
-
 vec3 ComputeDirLight(Light light, vec3 albedo, vec3 specular, vec3 normal, vec3 viewDir);
 vec3 ComputePointLight(Light light, vec3 albedo, vec3 specular, vec3 normal, vec3 fragPos, vec3 viewDir);
 
 void main()
 {
-	vec3 albedo = texture(uMaterial.albedo, fs_in.TexCoord).rgb;
-	vec3 specularC = texture(uMaterial.specular, fs_in.TexCoord).rgb;
-	
+#ifdef ALBEDO_MAP
+	vec3 albedo = texture(uMaterial.albedo, fs_in.TexCoord, uLODBias).rgb;
+#else
+	vec3 albedo = uMaterial.albedo;
+#endif
+#ifdef SPECULAR_MAP
+	vec3 specularC = texture(uMaterial.specular, fs_in.TexCoord, uLODBias).rgb;
+#else
+	vec3 specularC = uMaterial.specular;
+#endif
+
 	vec3 irradiance = vec3(0.0);
-	if(uRendererOptions.uActiveIrradiance)
-		irradiance = texture(uIrradianceMap, fs_in.Normal).rgb;
+#ifdef IRRADIANCE
+	irradiance = texture(uIrradianceMap, fs_in.Normal).rgb;
+#endif
 
 	// Ambient
 	vec3 result = albedo * irradiance;
@@ -115,17 +93,15 @@ void main()
 			result += ComputePointLight(uLights[i], albedo, specularC, fs_in.Normal, fs_in.FragPos, fs_in.ViewDir);
 	}
 
-	if(uRendererOptions.uActiveReflection)
-	{
-		vec3 specularReflection = reflect(-fs_in.ViewDir, fs_in.Normal);
-		result += texture(uEnvironmentMap, specularReflection).rgb * uMaterial.reflective;
-	}
+#ifdef REFLECTION
+	vec3 specularReflection = reflect(-fs_in.ViewDir, fs_in.Normal);
+	result += texture(uEnvironmentMap, specularReflection).rgb * uMaterial.reflective;
+#endif
 
-	if(uRendererOptions.uActiveRefraction)
-	{
-		vec3 refraction = refract(-fs_in.ViewDir, fs_in.Normal, 1.00/1.52);
-		result += texture(uEnvironmentMap, refraction).rgb;
-	}
+#ifdef REFRACTION
+	vec3 refraction = refract(-fs_in.ViewDir, fs_in.Normal, 1.00/1.52);
+	result += texture(uEnvironmentMap, refraction).rgb;
+#endif
 
 	FragColor = vec4(result, 1.0);
 }
@@ -1,4 +1,7 @@
-#ifdef DEFERRED_GEOMETRY_ALBEDO
+#ifdef DEFERRED_GEOMETRY
+
+// Features: ALBEDO_MAP, SPECULAR_MAP
+// Blocks: GlobalParameters, LocalParameters (declared by the engine, see ShaderParameters.h)
 
 #if defined(VERTEX) ///////////////////////////////////////////////////
 
@@ -8,26 +11,25 @@ layout(location = 2) in vec2 aTexCoord;
 layout(location = 3) in vec3 aTangent;
 layout(location = 4) in vec3 aBitangent;
 
-layout(binding = 1, std140) uniform LocalParameters
-{
-	mat4 uModel;
-	mat4 uMVP;
-};
-
 out VS_OUT
 {
-	vec2 TexCoord;
 	vec3 FragPos;
 	vec3 Normal;
+	vec2 TexCoord;
+	vec4 CurrentClipPos;
+	vec4 PreviousClipPos;
 } vs_out;
 
 void main()
 {
-	vs_out.TexCoord = aTexCoord;
 	vs_out.FragPos = vec3(uModel * vec4(aPosition, 1.0));
 	vs_out.Normal = normalize(vec3(uModel * vec4(aNormal, 0.0))); // As we will not perform non-uniform scale, we don't need a normal matrix for now
+	vs_out.TexCoord = aTexCoord;
 
 	gl_Position = uMVP * vec4(aPosition, 1.0);
+
+	vs_out.CurrentClipPos = gl_Position;
+	vs_out.PreviousClipPos = uPrevMVP * vec4(aPosition, 1.0);
 }
 
 #elif defined(FRAGMENT) ///////////////////////////////////////////////
@@ -37,11 +39,20 @@ layout(location = 1) out vec4 gBufNormal;
 layout(location = 2) out vec4 gBufAlbedo;
 layout(location = 3) out vec4 gBufSpecular;
 layout(location = 4) out vec4 gBufReflShini;
+layout(location = 5) out vec2 gBufVelocity;
 
 struct Material
 {
+#ifdef ALBEDO_MAP
 	sampler2D albedo;
+#else
+	vec3 albedo;
+#endif
+#ifdef SPECULAR_MAP
+	sampler2D specular;
+#else
 	vec3 specular;
+#endif
 	vec3 reflective;
 	float shininess;
 };
@@ -49,22 +60,37 @@ uniform Material uMaterial;
 
 in VS_OUT
 {
-	vec2 TexCoord;
 	vec3 FragPos;
 	vec3 Normal;
+	vec2 TexCoord;
+	vec4 CurrentClipPos;
+	vec4 PreviousClipPos;
 } fs_in;
 
 void main()
 {
 	gBufPosition = vec4(fs_in.FragPos, 1.0);
-	
+
 	gBufNormal = vec4(fs_in.Normal, 1.0);
 
-	gBufAlbedo = texture(uMaterial.albedo, fs_in.TexCoord);
+#ifdef ALBEDO_MAP
+	gBufAlbedo = texture(uMaterial.albedo, fs_in.TexCoord, uLODBias);
+#else
+	gBufAlbedo = vec4(uMaterial.albedo, 1.0);
+#endif
 
+#ifdef SPECULAR_MAP
+	gBufSpecular = texture(uMaterial.specular, fs_in.TexCoord, uLODBias);
+#else
 	gBufSpecular = vec4(uMaterial.specular, 1.0);
+#endif
 
 	gBufReflShini = vec4(uMaterial.reflective, uMaterial.shininess);
+
+	// Screen-space motion since the previous frame, in UV units. The jitter is removed so still geometry has none.
+	vec2 currentPos = fs_in.CurrentClipPos.xy / fs_in.CurrentClipPos.w - uJitter;
+	vec2 previousPos = fs_in.PreviousClipPos.xy / fs_in.PreviousClipPos.w;
+	gBufVelocity = (currentPos - previousPos) * 0.5;
 }
 
 #endif /////////////////////////////////////////////////////////////////
@@ -1,17 +1,13 @@
 #ifdef LIGHT_CASTER
 
+// Blocks: LocalParameters (declared by the engine, see ShaderParameters.h)
+
 #if defined(VERTEX) ///////////////////////////////////////////////////
 
 layout(location = 0) in vec3 aPosition;
 layout(location = 1) in vec3 aNormal;
 layout(location = 2) in vec2 aTexCoord;
 
-layout(binding = 1, std140) uniform Matrices
-{
-	mat4 uModel;
-	mat4 uMVP;
-};
-
 void main()
 {
 	gl_Position = uMVP * vec4(aPosition, 1.0);
@@ -1,5 +1,8 @@
 #ifdef DEFERRED_LIGHTING_PASS
 
+// Features: IRRADIANCE, REFLECTION, REFRACTION, SSAO, SHADOWS
+// Blocks: GlobalParameters, ShadowParameters (declared by the engine, see ShaderParameters.h)
+
 #if defined(VERTEX) ///////////////////////////////////////////////////
 
 layout(location = 0) in vec2 aPosition;
@@ -18,20 +21,6 @@ void main()
 
 layout(location = 0) out vec4 FinalColor;
 
-struct Light
-{
-	vec4 lightVector; // XYZ for position/direction and W for type
-	vec3 color;
-	float constant;
-};
-
-layout(binding = 0, std140) uniform GlobalParameters
-{
-	vec3 uViewPos;
-	unsigned int uNumLights;
-	Light uLights[16];
-};
-
 in vec2 vTexCoord;
 
 uniform sampler2D gBufPosition;
@@ -44,14 +33,12 @@ uniform samplerCube uEnvironmentMap;
 uniform samplerCube uIrradianceMap;
 uniform sampler2D uSSAOColor;
 
-struct RendererOptions
-{
-	bool uActiveIrradiance;
-	bool uActiveReflection;
-	bool uActiveRefraction;
-	bool uActiveSSAO;
-};
-uniform RendererOptions uRendererOptions;
+#ifdef SHADOWS
+uniform sampler2DArrayShadow uCascadeShadowMap;
+uniform samplerCubeArrayShadow uPointShadowMap;
+
+float LightShadow(int lightIndex, vec3 fragPos, vec3 normal);
+#endif
 
 vec3 ComputeDirLight(Light light, vec3 albedo, float specularC, float shininess, vec3 normal, vec3 viewDir);
 vec3 ComputePointLight(Light light, vec3 albedo, float specularC,  float shininess, vec3 normal, vec3 fragPos, vec3 viewDir);
@@ -72,12 +59,14 @@ void main()
 	float shininess = reflectiveShininess.a * 256.0;
 
 	vec3 irradiance = vec3(0.0);
-	if(uRendererOptions.uActiveIrradiance)
-		irradiance = texture(uIrradianceMap, normal).rgb;
+#ifdef IRRADIANCE
+	irradiance = texture(uIrradianceMap, normal).rgb;
+#endif
 
 	float ambientOcclusion = 1.0;
-	if(uRendererOptions.uActiveSSAO)
-		ambientOcclusion = texture(uSSAOColor, vTexCoord).r;
+#ifdef SSAO
+	ambientOcclusion = texture(uSSAOColor, vTexCoord).r;
+#endif
 
 	vec3 viewDir = normalize(uViewPos - fragPos);
 
@@ -86,23 +75,26 @@ void main()
 	
 	for(int i = 0; i < uNumLights; ++i)
 	{
+		float shadow = 1.0;
+#ifdef SHADOWS
+		shadow = LightShadow(i, fragPos, normal);
+#endif
+
 		if(uLights[i].lightVector.w == 0.0)
-			result += ComputeDirLight(uLights[i], albedo, specularC, shininess, normal, viewDir);
+			result += ComputeDirLight(uLights[i], albedo, specularC, shininess, normal, viewDir) * shadow;
 		else if(uLights[i].lightVector.w == 1.0)
-			result += ComputePointLight(uLights[i], albedo, specularC, shininess, normal, fragPos, viewDir);
+			result += ComputePointLight(uLights[i], albedo, specularC, shininess, normal, fragPos, viewDir) * shadow;
 	}
 
-	if(uRendererOptions.uActiveReflection)
-	{
-		vec3 specularReflection = reflect(-viewDir, normal);
-		result += texture(uEnvironmentMap, specularReflection).rgb * reflective;
-	}
+#ifdef REFLECTION
+	vec3 specularReflection = reflect(-viewDir, normal);
+	result += texture(uEnvironmentMap, specularReflection).rgb * reflective;
+#endif
 
-	if(uRendererOptions.uActiveRefraction)
-	{
-		vec3 refraction = refract(-viewDir, normal, 1.00/1.52);
-		result += texture(uEnvironmentMap, refraction).rgb;
-	}
+#ifdef REFRACTION
+	vec3 refraction = refract(-viewDir, normal, 1.00/1.52);
+	result += texture(uEnvironmentMap, refraction).rgb;
+#endif
 
 	// Final Lighting Color write to G-Buffer
 	FinalColor = vec4(result, 1.0);
@@ -146,6 +138,50 @@ vec3 ComputePointLight(Light light, vec3 albedo, float specularC, float shinines
 	return (diffuse + specular);
 }
 
+#ifdef SHADOWS
+float CascadeShadow(vec3 fragPos, vec3 normal)
+{
+	// The first cascade that contains the fragment, they're sorted from the camera outwards
+	for(int c = 0; c < uShadows.uCascadeMatrices.length(); ++c)
+	{
+		float texelSize = uShadows.uCascadeTexelSizes[c];
+		if(texelSize == 0.0)
+			continue;
+
+		// Normal offset, scaled to the texels of the cascade so the far ones don't acne
+		vec3 offsetPos = fragPos + normal * uShadows.uCascadeBias * texelSize;
+		vec4 lightPos = uShadows.uCascadeMatrices[c] * vec4(offsetPos, 1.0);
+		vec3 coords = lightPos.xyz / lightPos.w * 0.5 + 0.5;
+
+		if(all(greaterThanEqual(coords, vec3(0.0))) && all(lessThanEqual(coords, vec3(1.0))))
+			return texture(uCascadeShadowMap, vec4(coords.xy, float(c), coords.z));
+	}
+
+	return 1.0;
+}
+
+float PointShadow(int lightIndex, vec3 fragPos, vec3 normal)
+{
+	int slot = uShadows.uPointShadowSlots[lightIndex].x;
+	if(slot < 0)
+		return 1.0;
+
+	// Sampled from where the cube was rendered, which lags behind a moving light until its faces are done
+	vec4 cube = uShadows.uPointShadows[slot];
+	vec3 toFrag = fragPos + normal * uShadows.uPointBias - cube.xyz;
+	return texture(uPointShadowMap, vec4(toFrag, float(slot)), length(toFrag) / cube.w);
+}
+
+float LightShadow(int lightIndex, vec3 fragPos, vec3 normal)
+{
+	if(lightIndex == uShadows.uCascadeLight)
+		return CascadeShadow(fragPos, normal);
+	else if(uLights[lightIndex].lightVector.w == 1.0)
+		return PointShadow(lightIndex, fragPos, normal);
+	return 1.0;
+}
+#endif
+
 #endif /////////////////////////////////////////////////////////////////
 
 #endif
\ No newline at end of file
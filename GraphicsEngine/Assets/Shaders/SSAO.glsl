@@ -1,5 +1,8 @@
 #ifdef SSAO
 
+// Features: RANGE_CHECK
+// Blocks: SSAOParameters as uSSAOptions (declared by the engine, see ShaderParameters.h)
+
 #if defined(VERTEX) ///////////////////////////////////////////////////
 
 layout(location = 0) in vec2 aPosition;
@@ -25,37 +28,23 @@ uniform sampler2D gBufNormal;
 uniform sampler2D gBufDepth;
 
 uniform sampler2D uNoiseTexture;
-uniform vec3 uSamples[64];
-uniform mat4 uProjection;
-uniform mat4 uView;
-uniform vec2 uDisplaySize;
-
-struct SSAOptions
-{
-    bool uRangeCheck;
-    float uRadius;
-    float uBias;
-    float uPower;
-    int uKernelSize;
-};
-uniform SSAOptions uSSAOptions;
 
 vec3 ReconstructPixelPos(float depth)
 {
-    float xndc = gl_FragCoord.x / uDisplaySize.x * 2.0 - 1.0;
-    float yndc = gl_FragCoord.y / uDisplaySize.y * 2.0 - 1.0;
+    float xndc = gl_FragCoord.x / uSSAOptions.uDisplaySize.x * 2.0 - 1.0;
+    float yndc = gl_FragCoord.y / uSSAOptions.uDisplaySize.y * 2.0 - 1.0;
     float zndc = depth * 2.0 - 1.0;
     vec4 posNDC = vec4(xndc, yndc, zndc, 1.0);
-    vec4 posView = inverse(uProjection) * posNDC;
+    vec4 posView = uSSAOptions.uInverseProjection * posNDC;
     return posView.xyz / posView.w;
 }
 
 void main()
 {
-    vec2 noiseScale = uDisplaySize / textureSize(uNoiseTexture, 0);
+    vec2 noiseScale = uSSAOptions.uDisplaySize / textureSize(uNoiseTexture, 0);
 
-    vec4 fragPosView = uView * vec4(texture(gBufPosition, vTexCoord).rgb, 1.0);
-    vec3 normalView = mat3(uView) * texture(gBufNormal, vTexCoord).rgb;
+    vec4 fragPosView = uSSAOptions.uView * vec4(texture(gBufPosition, vTexCoord).rgb, 1.0);
+    vec3 normalView = mat3(uSSAOptions.uView) * texture(gBufNormal, vTexCoord).rgb;
     vec3 noise = texture(uNoiseTexture, vTexCoord * noiseScale).rgb;
 
     vec3 tangent = normalize(noise - normalView * dot(noise, normalView));
@@ -66,10 +55,10 @@ void main()
     float occlusion = 0.0;
     for(int i = 0; i < uSSAOptions.uKernelSize; ++i)
     {
-        vec3 offsetView = TBN * uSamples[i];
+        vec3 offsetView = TBN * uSSAOptions.uSamples[i].xyz;
         vec3 samplePosView = fragPosView.xyz + offsetView * uSSAOptions.uRadius;
 
-        vec4 sampleTexCoord = uProjection * vec4(samplePosView, 1.0);
+        vec4 sampleTexCoord = uSSAOptions.uProjection * vec4(samplePosView, 1.0);
         sampleTexCoord.xyz /= sampleTexCoord.w;
         sampleTexCoord.xyz = sampleTexCoord.xyz * 0.5 + 0.5;
 
@@ -77,11 +66,10 @@ void main()
         vec3 sampledPosView = ReconstructPixelPos(sampledDepth);
 
         float rangeCheck = 1.0;
-        if(uSSAOptions.uRangeCheck)
-        {
-            rangeCheck = smoothstep(0.0, 1.0, uSSAOptions.uRadius / abs(samplePosView.z - sampledPosView.z));
-            rangeCheck *= rangeCheck;
-        }
+#ifdef RANGE_CHECK
+        rangeCheck = smoothstep(0.0, 1.0, uSSAOptions.uRadius / abs(samplePosView.z - sampledPosView.z));
+        rangeCheck *= rangeCheck;
+#endif
 
         occlusion += (samplePosView.z < sampledPosView.z - uSSAOptions.uBias ? 1.0 : 0.0) * rangeCheck;
     }
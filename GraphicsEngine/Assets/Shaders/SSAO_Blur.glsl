@@ -22,6 +22,7 @@ in vec2 vTexCoord;
 
 uniform sampler2D uSSAOColor;
 uniform int uNoiseSize;
+uniform vec2 uDirection; // (1, 0) or (0, 1), the box blur is separable
 
 void main()
 {
@@ -30,15 +31,12 @@ void main()
     int arraySize = int(sqrt(float(uNoiseSize))/2);
 
     float result = 0.0;
-    for(int x = -arraySize; x < arraySize; ++x)
+    for(int i = -arraySize; i < arraySize; ++i)
     {
-        for(int y = -arraySize; y < arraySize; ++y)
-        {
-            vec2 offset = vec2(float(x), float(y)) * texelSize;
-            result += texture(uSSAOColor, vTexCoord + offset).r;
-        }
+        vec2 offset = uDirection * float(i) * texelSize;
+        result += texture(uSSAOColor, vTexCoord + offset).r;
     }
-    FragColor = result / float(uNoiseSize);
+    FragColor = result / float(2 * arraySize);
 }
 #endif /////////////////////////////////////////////////////////////////
 
@@ -0,0 +1,39 @@
+#ifdef SHADOW_DEPTH
+
+// Blocks: LocalParameters (declared by the engine, see ShaderParameters.h)
+
+#if defined(VERTEX) ///////////////////////////////////////////////////
+
+layout(location = 0) in vec3 aPosition;
+
+uniform mat4 uLightMatrix;
+
+out vec3 vWorldPos;
+
+void main()
+{
+	vec4 worldPos = uModel * vec4(aPosition, 1.0);
+	vWorldPos = worldPos.xyz;
+
+	gl_Position = uLightMatrix * worldPos;
+}
+
+#elif defined(FRAGMENT) ///////////////////////////////////////////////
+
+in vec3 vWorldPos;
+
+// Position and far plane of a point light, w is 0 for the cascades
+uniform vec4 uPointLight;
+
+void main()
+{
+	// The cube maps store the distance to the light, so the lighting doesn't need the matrix of each face
+	if(uPointLight.w > 0.0)
+		gl_FragDepth = length(vWorldPos - uPointLight.xyz) / uPointLight.w;
+	else
+		gl_FragDepth = gl_FragCoord.z;
+}
+
+#endif /////////////////////////////////////////////////////////////////
+
+#endif
\ No newline at end of file
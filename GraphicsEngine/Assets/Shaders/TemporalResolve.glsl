@@ -0,0 +1,125 @@
+#ifdef TEMPORAL_RESOLVE
+
+// Blocks: GlobalParameters (declared by the engine, see ShaderParameters.h)
+
+#if defined(VERTEX) ///////////////////////////////////////////////////
+
+layout(location = 0) in vec2 aPosition;
+layout(location = 1) in vec2 aTexCoord;
+
+out vec2 vTexCoord;
+
+void main()
+{
+	vTexCoord = aTexCoord;
+
+	gl_Position = vec4(aPosition, 0.0, 1.0);
+}
+
+#elif defined(FRAGMENT) ///////////////////////////////////////////////
+
+layout(location = 0) out vec4 FragColor;
+
+in vec2 vTexCoord;
+
+uniform sampler2D uCurrentColor; // Render resolution, jittered
+uniform sampler2D uVelocity;
+uniform sampler2D uDepth;
+uniform sampler2D uHistory;      // Display resolution, last frame's output
+uniform int uHistoryValid;
+
+// The neighbourhood box fits the colours tighter in YCoCg than in RGB
+vec3 RGBToYCoCg(vec3 c)
+{
+	return vec3(0.25 * c.r + 0.5 * c.g + 0.25 * c.b, 0.5 * c.r - 0.5 * c.b, -0.25 * c.r + 0.5 * c.g - 0.25 * c.b);
+}
+
+vec3 YCoCgToRGB(vec3 c)
+{
+	return vec3(c.x + c.y - c.z, c.x + c.z, c.x - c.y - c.z);
+}
+
+// Moves the history towards the centre of the box instead of clamping each axis, which keeps its hue
+vec3 ClipToBox(vec3 history, vec3 boxMin, vec3 boxMax)
+{
+	vec3 center = 0.5 * (boxMax + boxMin);
+	vec3 extents = 0.5 * (boxMax - boxMin) + 0.0001;
+	vec3 offset = history - center;
+	vec3 units = abs(offset / extents);
+	float maxUnit = max(units.x, max(units.y, units.z));
+	return maxUnit > 1.0 ? center + offset / maxUnit : history;
+}
+
+void main()
+{
+	ivec2 renderSize = textureSize(uCurrentColor, 0);
+
+	// Where this output pixel falls in the jittered render target, in its texels
+	vec2 renderPos = (vTexCoord + uJitter * 0.5) * vec2(renderSize);
+	ivec2 centerTexel = ivec2(floor(renderPos));
+
+	// 3x3 neighbourhood: reconstruction of the current colour, its mean and deviation for the clip box,
+	// and the closest depth, whose motion vector is used so edges are reprojected with the foreground
+	vec3 currentColor = vec3(0.0);
+	float totalWeight = 0.0;
+	float closestSampleWeight = 0.0;
+	vec3 moment1 = vec3(0.0);
+	vec3 moment2 = vec3(0.0);
+	float closestDepth = 1.0;
+	ivec2 closestTexel = centerTexel;
+	for (int y = -1; y <= 1; ++y)
+	{
+		for (int x = -1; x <= 1; ++x)
+		{
+			ivec2 texel = clamp(centerTexel + ivec2(x, y), ivec2(0), renderSize - 1);
+			vec3 color = RGBToYCoCg(texelFetch(uCurrentColor, texel, 0).rgb);
+
+			vec2 distanceToSample = vec2(texel) + 0.5 - renderPos;
+			float weight = exp(-2.29 * dot(distanceToSample, distanceToSample));
+			currentColor += color * weight;
+			totalWeight += weight;
+			closestSampleWeight = max(closestSampleWeight, weight);
+
+			moment1 += color;
+			moment2 += color * color;
+
+			float depth = texelFetch(uDepth, texel, 0).r;
+			if (depth < closestDepth)
+			{
+				closestDepth = depth;
+				closestTexel = texel;
+			}
+		}
+	}
+	currentColor /= totalWeight;
+
+	vec3 mean = moment1 / 9.0;
+	vec3 deviation = sqrt(max(moment2 / 9.0 - mean * mean, vec3(0.0)));
+	vec3 boxMin = mean - 1.25 * deviation;
+	vec3 boxMax = mean + 1.25 * deviation;
+
+	vec2 velocity = texelFetch(uVelocity, closestTexel, 0).rg;
+	vec2 historyTexCoord = vTexCoord - velocity;
+
+	// History rejection: nothing accumulated yet, or the point wasn't on screen in the previous frame
+	if (uHistoryValid == 0 || any(lessThan(historyTexCoord, vec2(0.0))) || any(greaterThan(historyTexCoord, vec2(1.0))))
+	{
+		FragColor = vec4(YCoCgToRGB(currentColor), 1.0);
+		return;
+	}
+
+	vec3 history = RGBToYCoCg(texture(uHistory, historyTexCoord).rgb);
+	vec3 clippedHistory = ClipToBox(history, boxMin, boxMax);
+
+	// The current frame weighs more when one of its samples lands close to this pixel,
+	// and when the history had to be clipped far, which usually means it shows something disoccluded
+	float blend = mix(0.04, 0.2, closestSampleWeight);
+	float clipDistance = length(history - clippedHistory) / (clippedHistory.x + 0.1);
+	blend = mix(blend, 1.0, clamp(clipDistance, 0.0, 0.8));
+
+	FragColor = vec4(YCoCgToRGB(mix(clippedHistory, currentColor, blend)), 1.0);
+}
+
+#endif /////////////////////////////////////////////////////////////////
+
+#endif
\ No newline at end of file
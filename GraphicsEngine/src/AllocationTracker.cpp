@@ -0,0 +1,246 @@
+#include "AllocationTracker.h"
+
+#include "imgui-docking/imgui.h"
+
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#include <crtdbg.h>
+#endif
+
+static const char* AllocationSubsystemNames[ALLOCATION_SUBSYSTEM_COUNT] =
+{
+    "Other", "ImGui", "Update", "Simulation", "Render", "Loading"
+};
+
+// Constant initialized, operator new can run before any constructor
+static std::atomic<u64> GlobalAllocationCounts[ALLOCATION_SUBSYSTEM_COUNT];
+static std::atomic<u64> GlobalAllocationBytes[ALLOCATION_SUBSYSTEM_COUNT];
+
+static thread_local u32 LocalAllocationSubsystem = ALLOCATION_SUBSYSTEM_OTHER;
+static thread_local bool LocalInsideOperatorNew = false; // So the CRT hook doesn't count the malloc of a tracked block again
+
+static u64 GlobalFrameStartCounts[ALLOCATION_SUBSYSTEM_COUNT];
+static u64 GlobalFrameStartBytes[ALLOCATION_SUBSYSTEM_COUNT];
+static AllocationFrameStats GlobalAllocationFrameStats;
+
+static void CountHeapAllocation(u64 size)
+{
+    u32 subsystem = LocalAllocationSubsystem;
+    GlobalAllocationCounts[subsystem].fetch_add(1, std::memory_order_relaxed);
+    GlobalAllocationBytes[subsystem].fetch_add(size, std::memory_order_relaxed);
+}
+
+AllocationSubsystem GetAllocationSubsystem()
+{
+    return AllocationSubsystem(LocalAllocationSubsystem);
+}
+
+AllocationScope::AllocationScope(AllocationSubsystem subsystem)
+{
+    previous = AllocationSubsystem(LocalAllocationSubsystem);
+    LocalAllocationSubsystem = subsystem;
+}
+
+AllocationScope::~AllocationScope()
+{
+    LocalAllocationSubsystem = previous;
+}
+
+// ------------------------------------------------------------------------------------------------
+// HOOKS //
+// ------------------------------------------------------------------------------------------------
+
+static void* AllocateTracked(size_t size)
+{
+    LocalInsideOperatorNew = true;
+    void* block = malloc(size ? size : 1);
+    LocalInsideOperatorNew = false;
+
+    CountHeapAllocation(size);
+    return block;
+}
+
+void* AllocateTrackedBlock(u64 size)
+{
+    return AllocateTracked(size);
+}
+
+void* operator new(size_t size)
+{
+    void* block = AllocateTracked(size);
+    if (!block)
+        throw std::bad_alloc();
+    return block;
+}
+
+void* operator new[](size_t size)
+{
+    void* block = AllocateTracked(size);
+    if (!block)
+        throw std::bad_alloc();
+    return block;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return AllocateTracked(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return AllocateTracked(size); }
+
+void operator delete(void* block) noexcept { free(block); }
+void operator delete[](void* block) noexcept { free(block); }
+void operator delete(void* block, size_t) noexcept { free(block); }
+void operator delete[](void* block, size_t) noexcept { free(block); }
+void operator delete(void* block, const std::nothrow_t&) noexcept { free(block); }
+void operator delete[](void* block, const std::nothrow_t&) noexcept { free(block); }
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+static int CRTAllocationHook(int type, void* block, size_t size, int blockType, long request, const unsigned char* filename, int line)
+{
+    if ((type == _HOOK_ALLOC || type == _HOOK_REALLOC) && blockType != _CRT_BLOCK && !LocalInsideOperatorNew)
+        CountHeapAllocation(size);
+    return TRUE;
+}
+#endif
+
+void InitAllocationTracker()
+{
+#if defined(_MSC_VER) && defined(_DEBUG)
+    _CrtSetAllocHook(CRTAllocationHook);
+#endif
+
+    for (u32 i = 0; i < ALLOCATION_SUBSYSTEM_COUNT; ++i)
+    {
+        GlobalFrameStartCounts[i] = GlobalAllocationCounts[i].load(std::memory_order_relaxed);
+        GlobalFrameStartBytes[i] = GlobalAllocationBytes[i].load(std::memory_order_relaxed);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+// FRAME STATS //
+// ------------------------------------------------------------------------------------------------
+
+void EndAllocationFrame()
+{
+    AllocationFrameStats& stats = GlobalAllocationFrameStats;
+    stats.totalAllocations = 0;
+
+    for (u32 i = 0; i < ALLOCATION_SUBSYSTEM_COUNT; ++i)
+    {
+        u64 count = GlobalAllocationCounts[i].load(std::memory_order_relaxed);
+        u64 bytes = GlobalAllocationBytes[i].load(std::memory_order_relaxed);
+
+        stats.allocations[i] = count - GlobalFrameStartCounts[i];
+        stats.bytes[i] = bytes - GlobalFrameStartBytes[i];
+        stats.totalAllocations += stats.allocations[i];
+
+        GlobalFrameStartCounts[i] = count;
+        GlobalFrameStartBytes[i] = bytes;
+    }
+}
+
+const AllocationFrameStats& GetAllocationFrameStats()
+{
+    return GlobalAllocationFrameStats;
+}
+
+void DrawAllocationTrackerImGui()
+{
+    const AllocationFrameStats& stats = GlobalAllocationFrameStats;
+    ImGui::Text("Heap allocations last frame: %llu", stats.totalAllocations);
+
+    if (!ImGui::BeginTable("Heap Allocations", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp))
+        return;
+
+    ImGui::TableSetupColumn("Subsystem");
+    ImGui::TableSetupColumn("Allocs / Frame");
+    ImGui::TableSetupColumn("KB / Frame");
+    ImGui::TableSetupColumn("Total Allocs");
+    ImGui::TableHeadersRow();
+
+    for (u32 i = 0; i < ALLOCATION_SUBSYSTEM_COUNT; ++i)
+    {
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(AllocationSubsystemNames[i]);
+        ImGui::TableNextColumn();
+        ImGui::Text("%llu", stats.allocations[i]);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.1f", stats.bytes[i] / 1024.0f);
+        ImGui::TableNextColumn();
+        ImGui::Text("%llu", GlobalAllocationCounts[i].load(std::memory_order_relaxed));
+    }
+
+    ImGui::EndTable();
+}
+
+// ------------------------------------------------------------------------------------------------
+// ALLOCATION TEST //
+// ------------------------------------------------------------------------------------------------
+
+struct AllocationTest
+{
+    bool isRunning;
+    u32 frameCount; // Checked after the warm-up
+    u32 frame;
+    u32 failedFrames;
+};
+
+static AllocationTest GlobalAllocationTest;
+
+void BeginAllocationTest(u32 frameCount)
+{
+    GlobalAllocationTest.isRunning = true;
+    GlobalAllocationTest.frameCount = frameCount;
+    GlobalAllocationTest.frame = 0;
+    GlobalAllocationTest.failedFrames = 0;
+
+    ILOG("Allocation test: %u frames after %u frames of warm-up\n", frameCount, ALLOCATION_TEST_WARMUP_FRAMES);
+}
+
+bool IsAllocationTestRunning()
+{
+    return GlobalAllocationTest.isRunning;
+}
+
+bool UpdateAllocationTest(bool& passed)
+{
+    AllocationTest& test = GlobalAllocationTest;
+    passed = test.failedFrames == 0;
+    if (!test.isRunning)
+        return false;
+
+    u32 frame = test.frame++;
+    if (frame < ALLOCATION_TEST_WARMUP_FRAMES)
+        return true;
+
+    const AllocationFrameStats& stats = GlobalAllocationFrameStats;
+    if (stats.totalAllocations > 0)
+    {
+        if (test.failedFrames < ALLOCATION_TEST_REPORTED_FRAMES)
+        {
+            ELOG("Allocation test: frame %u made %llu heap allocations\n", frame, stats.totalAllocations);
+            for (u32 i = 0; i < ALLOCATION_SUBSYSTEM_COUNT; ++i)
+            {
+                if (stats.allocations[i] > 0)
+                    ELOG("    %s: %llu allocations, %llu bytes\n", AllocationSubsystemNames[i], stats.allocations[i], stats.bytes[i]);
+            }
+        }
+        test.failedFrames++;
+    }
+
+    passed = test.failedFrames == 0;
+    if (frame + 1 < ALLOCATION_TEST_WARMUP_FRAMES + test.frameCount)
+        return true;
+
+    test.isRunning = false;
+    if (passed)
+    {
+        ILOG("Allocation test passed: no heap allocations in %u frames\n", test.frameCount);
+    }
+    else
+    {
+        ELOG("Allocation test failed: %u of %u frames allocated\n", test.failedFrames, test.frameCount);
+    }
+    return false;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "platform.h"
+
+// Counts every heap allocation of the process. The global operator new and delete are replaced, which covers the
+// containers, strings and make_unique of the engine. On the MSVC debug runtime, malloc is counted as well through the
+// CRT allocation hook, which catches C libraries like stb_image. Release builds elsewhere only see operator new.
+
+// What the calling thread is working on, the allocations are charged to it. Jobs take the subsystem of the thread
+// that queued them.
+enum AllocationSubsystem
+{
+    ALLOCATION_SUBSYSTEM_OTHER,      // Outside any scope: the platform layer, job workers idling, third party threads
+    ALLOCATION_SUBSYSTEM_IMGUI,
+    ALLOCATION_SUBSYSTEM_UPDATE,
+    ALLOCATION_SUBSYSTEM_SIMULATION,
+    ALLOCATION_SUBSYSTEM_RENDER,
+    ALLOCATION_SUBSYSTEM_LOADING,    // Loader threads of the hot reload and the world streaming
+    ALLOCATION_SUBSYSTEM_COUNT
+};
+
+AllocationSubsystem GetAllocationSubsystem();
+
+// malloc counted exactly once on every build, for the heap fallbacks of the custom allocators. Freed with free.
+void* AllocateTrackedBlock(u64 size);
+
+// Charges the allocations of the calling thread to a subsystem until the end of the scope
+struct AllocationScope
+{
+    AllocationSubsystem previous;
+
+    AllocationScope(AllocationSubsystem subsystem);
+    ~AllocationScope();
+};
+
+struct AllocationFrameStats
+{
+    u64 allocations[ALLOCATION_SUBSYSTEM_COUNT];
+    u64 bytes[ALLOCATION_SUBSYSTEM_COUNT];
+    u64 totalAllocations;
+};
+
+void InitAllocationTracker();
+
+// Closes the counts of the frame, called by the main loop at the end of the frame
+void EndAllocationFrame();
+const AllocationFrameStats& GetAllocationFrameStats();
+
+void DrawAllocationTrackerImGui();
+
+// ------------------------------------------------------------------------------------------------
+// ALLOCATION TEST //
+// ------------------------------------------------------------------------------------------------
+
+#define ALLOCATION_TEST_WARMUP_FRAMES 120 // Caches, pools and containers reach their steady state size
+#define ALLOCATION_TEST_REPORTED_FRAMES 8 // Frames that allocated logged with their breakdown, the rest are only counted
+
+// Runs the scene for frameCount frames after the warm-up and fails if any of them allocates from the heap.
+// Enabled from the command line with --allocation-test <frames>.
+void BeginAllocationTest(u32 frameCount);
+bool IsAllocationTestRunning();
+// Checks the frame that just ended. False once the test is over, with passed telling the result.
+bool UpdateAllocationTest(bool& passed);
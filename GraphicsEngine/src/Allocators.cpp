@@ -0,0 +1,382 @@
+#include "Allocators.h"
+#include "AllocationTracker.h"
+
+#include "imgui-docking/imgui.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static AllocatorStats* GlobalAllocatorStats[MAX_ALLOCATOR_STATS];
+static u32 GlobalAllocatorStatsCount = 0;
+
+static AllocatorStats GlobalFrameArenaStats;
+static AllocatorStats GlobalScratchStackStats;
+
+static std::atomic<u64> GlobalFrameIndex(0);
+
+static u64 AlignUp(u64 value, u64 alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static void CountAllocation(AllocatorStats* stats, u64 size)
+{
+    if (!stats)
+        return;
+
+    stats->allocationCount.fetch_add(1, std::memory_order_relaxed);
+    stats->allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+// Only called when an allocator goes over its own peak, which is rare once it's warm
+static void UpdatePeak(AllocatorStats* stats, u64 used)
+{
+    if (!stats)
+        return;
+
+    u64 peak = stats->peakUsedBytes.load(std::memory_order_relaxed);
+    while (used > peak && !stats->peakUsedBytes.compare_exchange_weak(peak, used, std::memory_order_relaxed));
+}
+
+void RegisterAllocatorStats(AllocatorStats& stats, const char* name)
+{
+    stats.name = name;
+    stats.allocationCount = 0;
+    stats.allocatedBytes = 0;
+    stats.heapFallbackCount = 0;
+    stats.peakUsedBytes = 0;
+    stats.frameStartAllocations = 0;
+    stats.frameStartBytes = 0;
+    stats.frameAllocations = 0;
+    stats.frameBytes = 0;
+
+    ASSERT(GlobalAllocatorStatsCount < MAX_ALLOCATOR_STATS, "Too many allocator stats registered");
+    GlobalAllocatorStats[GlobalAllocatorStatsCount++] = &stats;
+}
+
+// ------------------------------------------------------------------------------------------------
+// LINEAR //
+// ------------------------------------------------------------------------------------------------
+
+void InitLinearAllocator(LinearAllocator& allocator, u64 capacity, AllocatorStats* stats)
+{
+    allocator.memory = (u8*)malloc(capacity);
+    allocator.capacity = capacity;
+    allocator.head = 0;
+    allocator.peak = 0;
+    allocator.stats = stats;
+}
+
+void DestroyLinearAllocator(LinearAllocator& allocator)
+{
+    free(allocator.memory);
+    allocator.memory = nullptr;
+    allocator.capacity = 0;
+    allocator.head = 0;
+}
+
+void* PushLinear(LinearAllocator& allocator, u64 size, u64 alignment)
+{
+    u64 offset = AlignUp(allocator.head, alignment);
+    if (offset + size > allocator.capacity)
+        return nullptr;
+
+    allocator.head = offset + size;
+    CountAllocation(allocator.stats, size);
+    if (allocator.head > allocator.peak)
+    {
+        allocator.peak = allocator.head;
+        UpdatePeak(allocator.stats, allocator.peak);
+    }
+
+    return allocator.memory + offset;
+}
+
+void ResetLinear(LinearAllocator& allocator)
+{
+    allocator.head = 0;
+}
+
+// ------------------------------------------------------------------------------------------------
+// STACK //
+// ------------------------------------------------------------------------------------------------
+
+void InitStackAllocator(StackAllocator& allocator, u64 capacity, AllocatorStats* stats)
+{
+    allocator.memory = (u8*)malloc(capacity);
+    allocator.capacity = capacity;
+    allocator.head = 0;
+    allocator.peak = 0;
+    allocator.stats = stats;
+}
+
+void DestroyStackAllocator(StackAllocator& allocator)
+{
+    free(allocator.memory);
+    allocator.memory = nullptr;
+    allocator.capacity = 0;
+    allocator.head = 0;
+}
+
+void* PushStack(StackAllocator& allocator, u64 size, u64 alignment)
+{
+    u64 offset = AlignUp(allocator.head, alignment);
+    if (offset + size > allocator.capacity)
+        return nullptr;
+
+    allocator.head = offset + size;
+    CountAllocation(allocator.stats, size);
+    if (allocator.head > allocator.peak)
+    {
+        allocator.peak = allocator.head;
+        UpdatePeak(allocator.stats, allocator.peak);
+    }
+
+    return allocator.memory + offset;
+}
+
+void PopStack(StackAllocator& allocator, void* block, u64 size)
+{
+    // The alignment padding below the block stays until the marker
+    if ((u8*)block + size == allocator.memory + allocator.head)
+        allocator.head = (u8*)block - allocator.memory;
+}
+
+void FreeToStackMarker(StackAllocator& allocator, StackMarker marker)
+{
+    ASSERT(marker <= allocator.head, "The stack was already freed below the marker");
+    allocator.head = marker;
+}
+
+// ------------------------------------------------------------------------------------------------
+// POOL //
+// ------------------------------------------------------------------------------------------------
+
+void InitPoolAllocator(PoolAllocator& allocator, u32 blockSize, u32 blockCount, AllocatorStats* stats)
+{
+    blockSize = (u32)AlignUp(glm::max(blockSize, (u32)sizeof(void*)), DEFAULT_ALIGNMENT);
+
+    allocator.memory = (u8*)malloc(u64(blockSize) * blockCount);
+    allocator.blockSize = blockSize;
+    allocator.blockCount = blockCount;
+    allocator.usedCount = 0;
+    allocator.peak = 0;
+    allocator.stats = stats;
+
+    // Every free block stores the next one in its first bytes
+    allocator.freeList = nullptr;
+    for (u32 i = blockCount; i > 0; --i)
+    {
+        void* block = allocator.memory + u64(i - 1) * blockSize;
+        *(void**)block = allocator.freeList;
+        allocator.freeList = block;
+    }
+}
+
+void DestroyPoolAllocator(PoolAllocator& allocator)
+{
+    free(allocator.memory);
+    allocator.memory = nullptr;
+    allocator.freeList = nullptr;
+    allocator.blockCount = 0;
+    allocator.usedCount = 0;
+}
+
+void* AllocatePoolBlock(PoolAllocator& allocator)
+{
+    void* block = allocator.freeList;
+    if (!block)
+        return nullptr;
+
+    allocator.freeList = *(void**)block;
+    allocator.usedCount++;
+    CountAllocation(allocator.stats, allocator.blockSize);
+    if (allocator.usedCount > allocator.peak)
+    {
+        allocator.peak = allocator.usedCount;
+        UpdatePeak(allocator.stats, u64(allocator.peak) * allocator.blockSize);
+    }
+
+    return block;
+}
+
+void FreePoolBlock(PoolAllocator& allocator, void* block)
+{
+    ASSERT((u8*)block >= allocator.memory && (u8*)block < allocator.memory + u64(allocator.blockSize) * allocator.blockCount, "The block doesn't belong to the pool");
+
+    *(void**)block = allocator.freeList;
+    allocator.freeList = block;
+    allocator.usedCount--;
+}
+
+// ------------------------------------------------------------------------------------------------
+// THREAD ALLOCATORS //
+// ------------------------------------------------------------------------------------------------
+
+// Created on the first use from each thread, the threads that never ask for them don't pay for the memory
+struct ThreadAllocators
+{
+    LinearAllocator frameArenas[2];
+    u64 frameIndex;
+    StackAllocator scratchStack;
+
+    ~ThreadAllocators()
+    {
+        DestroyLinearAllocator(frameArenas[0]);
+        DestroyLinearAllocator(frameArenas[1]);
+        DestroyStackAllocator(scratchStack);
+    }
+};
+
+static thread_local ThreadAllocators GlobalThreadAllocators;
+
+LinearAllocator& GetFrameArena()
+{
+    ThreadAllocators& allocators = GlobalThreadAllocators;
+    if (!allocators.frameArenas[0].memory)
+    {
+        InitLinearAllocator(allocators.frameArenas[0], FRAME_ARENA_SIZE, &GlobalFrameArenaStats);
+        InitLinearAllocator(allocators.frameArenas[1], FRAME_ARENA_SIZE, &GlobalFrameArenaStats);
+        allocators.frameIndex = GlobalFrameIndex.load(std::memory_order_relaxed);
+    }
+
+    // The buffer of this frame was last used two or more frames ago, the other one may hold the previous frame
+    u64 frameIndex = GlobalFrameIndex.load(std::memory_order_relaxed);
+    LinearAllocator& arena = allocators.frameArenas[frameIndex & 1];
+    if (allocators.frameIndex != frameIndex)
+    {
+        ResetLinear(arena);
+        allocators.frameIndex = frameIndex;
+    }
+
+    return arena;
+}
+
+StackAllocator& GetScratchStack()
+{
+    ThreadAllocators& allocators = GlobalThreadAllocators;
+    if (!allocators.scratchStack.memory)
+        InitStackAllocator(allocators.scratchStack, SCRATCH_STACK_SIZE, &GlobalScratchStackStats);
+
+    return allocators.scratchStack;
+}
+
+void InitAllocators()
+{
+    RegisterAllocatorStats(GlobalFrameArenaStats, "Frame Arenas");
+    RegisterAllocatorStats(GlobalScratchStackStats, "Scratch Stacks");
+}
+
+void AdvanceFrameArenas()
+{
+    GlobalFrameIndex.fetch_add(1, std::memory_order_relaxed);
+}
+
+// ------------------------------------------------------------------------------------------------
+// STL //
+// ------------------------------------------------------------------------------------------------
+
+static void* AllocateFromHeap(AllocatorStats* stats, u64 size)
+{
+    if (stats)
+        stats->heapFallbackCount.fetch_add(1, std::memory_order_relaxed);
+
+    // Counted by the allocation tracker too, release builds don't see malloc otherwise
+    return AllocateTrackedBlock(size);
+}
+
+static bool IsInside(const u8* memory, u64 capacity, const void* block)
+{
+    return (const u8*)block >= memory && (const u8*)block < memory + capacity;
+}
+
+void* AllocateBlock(LinearAllocator& allocator, u64 size, u64 alignment)
+{
+    void* block = PushLinear(allocator, size, glm::max(alignment, (u64)DEFAULT_ALIGNMENT));
+    return block ? block : AllocateFromHeap(allocator.stats, size);
+}
+
+void* AllocateBlock(StackAllocator& allocator, u64 size, u64 alignment)
+{
+    void* block = PushStack(allocator, size, glm::max(alignment, (u64)DEFAULT_ALIGNMENT));
+    return block ? block : AllocateFromHeap(allocator.stats, size);
+}
+
+void* AllocateBlock(PoolAllocator& allocator, u64 size, u64 alignment)
+{
+    void* block = size <= allocator.blockSize && alignment <= DEFAULT_ALIGNMENT ? AllocatePoolBlock(allocator) : nullptr;
+    return block ? block : AllocateFromHeap(allocator.stats, size);
+}
+
+void FreeBlock(LinearAllocator& allocator, void* block, u64)
+{
+    if (!IsInside(allocator.memory, allocator.capacity, block))
+        free(block);
+}
+
+void FreeBlock(StackAllocator& allocator, void* block, u64 size)
+{
+    // A vector growing frees its old buffer right below the new one, only the top block is given back
+    if (IsInside(allocator.memory, allocator.capacity, block))
+        PopStack(allocator, block, size);
+    else
+        free(block);
+}
+
+void FreeBlock(PoolAllocator& allocator, void* block, u64)
+{
+    if (IsInside(allocator.memory, u64(allocator.blockSize) * allocator.blockCount, block))
+        FreePoolBlock(allocator, block);
+    else
+        free(block);
+}
+
+// ------------------------------------------------------------------------------------------------
+// STATS //
+// ------------------------------------------------------------------------------------------------
+
+void UpdateAllocatorStats()
+{
+    for (u32 i = 0; i < GlobalAllocatorStatsCount; ++i)
+    {
+        AllocatorStats& stats = *GlobalAllocatorStats[i];
+        u64 allocations = stats.allocationCount.load(std::memory_order_relaxed);
+        u64 bytes = stats.allocatedBytes.load(std::memory_order_relaxed);
+
+        stats.frameAllocations = allocations - stats.frameStartAllocations;
+        stats.frameBytes = bytes - stats.frameStartBytes;
+        stats.frameStartAllocations = allocations;
+        stats.frameStartBytes = bytes;
+    }
+}
+
+void DrawAllocatorsImGui()
+{
+    if (!ImGui::BeginTable("Allocators", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp))
+        return;
+
+    ImGui::TableSetupColumn("Allocator");
+    ImGui::TableSetupColumn("Allocs / Frame");
+    ImGui::TableSetupColumn("KB / Frame");
+    ImGui::TableSetupColumn("Peak (KB)");
+    ImGui::TableSetupColumn("Heap Fallbacks");
+    ImGui::TableHeadersRow();
+
+    for (u32 i = 0; i < GlobalAllocatorStatsCount; ++i)
+    {
+        const AllocatorStats& stats = *GlobalAllocatorStats[i];
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(stats.name);
+        ImGui::TableNextColumn();
+        ImGui::Text("%llu", stats.frameAllocations);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.1f", stats.frameBytes / 1024.0f);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.1f", stats.peakUsedBytes.load(std::memory_order_relaxed) / 1024.0f);
+        ImGui::TableNextColumn();
+        ImGui::Text("%llu", stats.heapFallbackCount.load(std::memory_order_relaxed));
+    }
+
+    ImGui::EndTable();
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "platform.h"
+
+#include <atomic>
+
+#define FRAME_ARENA_SIZE MB(8)    // Per thread and per buffer, the thread's allocations live for two frames
+#define SCRATCH_STACK_SIZE MB(16) // Per thread
+#define DEFAULT_ALIGNMENT 16
+
+#define MAX_ALLOCATOR_STATS 16
+
+// Shared by every allocator of a kind, e.g. the frame arenas of all the threads, so the counters are atomic
+struct AllocatorStats
+{
+    const char* name;
+
+    std::atomic<u64> allocationCount;
+    std::atomic<u64> allocatedBytes;
+    std::atomic<u64> heapFallbackCount; // Requests that didn't fit and were served by malloc
+    std::atomic<u64> peakUsedBytes;     // Of a single allocator of the kind
+
+    // Rates of the last frame, updated by the main thread
+    u64 frameStartAllocations;
+    u64 frameStartBytes;
+    u64 frameAllocations;
+    u64 frameBytes;
+};
+
+// Zeroes the counters and adds the stats to the Performance window
+void RegisterAllocatorStats(AllocatorStats& stats, const char* name);
+
+// ------------------------------------------------------------------------------------------------
+// LINEAR //
+// ------------------------------------------------------------------------------------------------
+
+// Bump allocator: no individual frees, everything goes at once on reset
+struct LinearAllocator
+{
+    u8* memory;
+    u64 capacity;
+    u64 head;
+    u64 peak;
+    AllocatorStats* stats;
+};
+
+void InitLinearAllocator(LinearAllocator& allocator, u64 capacity, AllocatorStats* stats);
+void DestroyLinearAllocator(LinearAllocator& allocator);
+// nullptr if it doesn't fit
+void* PushLinear(LinearAllocator& allocator, u64 size, u64 alignment = DEFAULT_ALIGNMENT);
+void ResetLinear(LinearAllocator& allocator);
+
+// ------------------------------------------------------------------------------------------------
+// STACK //
+// ------------------------------------------------------------------------------------------------
+
+// Linear allocator that is rolled back to a marker, and whose top block can be freed on its own
+struct StackAllocator
+{
+    u8* memory;
+    u64 capacity;
+    u64 head;
+    u64 peak;
+    AllocatorStats* stats;
+};
+
+typedef u64 StackMarker;
+
+void InitStackAllocator(StackAllocator& allocator, u64 capacity, AllocatorStats* stats);
+void DestroyStackAllocator(StackAllocator& allocator);
+// nullptr if it doesn't fit
+void* PushStack(StackAllocator& allocator, u64 size, u64 alignment = DEFAULT_ALIGNMENT);
+// Only gives the memory back if the block is the top one, the rest waits for the marker
+void PopStack(StackAllocator& allocator, void* block, u64 size);
+inline StackMarker GetStackMarker(const StackAllocator& allocator) { return allocator.head; }
+void FreeToStackMarker(StackAllocator& allocator, StackMarker marker);
+
+// ------------------------------------------------------------------------------------------------
+// POOL //
+// ------------------------------------------------------------------------------------------------
+
+// Fixed size blocks, allocated and freed in O(1) through an intrusive free list
+struct PoolAllocator
+{
+    u8* memory;
+    u32 blockSize;
+    u32 blockCount;
+    u32 usedCount;
+    u32 peak;
+    void* freeList;
+    AllocatorStats* stats;
+};
+
+// The block size is rounded up to DEFAULT_ALIGNMENT, and to hold the free list pointer
+void InitPoolAllocator(PoolAllocator& allocator, u32 blockSize, u32 blockCount, AllocatorStats* stats);
+void DestroyPoolAllocator(PoolAllocator& allocator);
+// nullptr if the pool is exhausted
+void* AllocatePoolBlock(PoolAllocator& allocator);
+void FreePoolBlock(PoolAllocator& allocator, void* block);
+
+// ------------------------------------------------------------------------------------------------
+// THREAD ALLOCATORS //
+// ------------------------------------------------------------------------------------------------
+
+// This thread's frame arena. Two buffers per thread are flipped as frames go by, so what any thread allocates in a
+// frame is still valid during the next one, e.g. for the snapshot the simulation worker hands to the renderer.
+LinearAllocator& GetFrameArena();
+// This thread's scratch, for temporaries that are freed in the same scope. See ScratchScope.
+StackAllocator& GetScratchStack();
+
+// Registers the stats of the thread allocators, before anything allocates from them
+void InitAllocators();
+
+// Starts the next frame of every frame arena, called by the main loop at the end of the frame
+void AdvanceFrameArenas();
+
+// Frees everything pushed to this thread's scratch stack during the scope, declare it before the containers using it
+struct ScratchScope
+{
+    StackMarker marker;
+
+    ScratchScope() : marker(GetStackMarker(GetScratchStack())) {}
+    ~ScratchScope() { FreeToStackMarker(GetScratchStack(), marker); }
+};
+
+// ------------------------------------------------------------------------------------------------
+// STL //
+// ------------------------------------------------------------------------------------------------
+
+// Requests the allocator can't serve go to the heap and are counted as fallbacks, they're recognized on free
+void* AllocateBlock(LinearAllocator& allocator, u64 size, u64 alignment);
+void* AllocateBlock(StackAllocator& allocator, u64 size, u64 alignment);
+void* AllocateBlock(PoolAllocator& allocator, u64 size, u64 alignment);
+void FreeBlock(LinearAllocator& allocator, void* block, u64 size);
+void FreeBlock(StackAllocator& allocator, void* block, u64 size);
+void FreeBlock(PoolAllocator& allocator, void* block, u64 size);
+
+// Any of the allocators above behind the std::allocator interface, e.g. std::vector<T, STLAllocator<T, LinearAllocator>>
+template <typename T, typename Allocator>
+struct STLAllocator
+{
+    typedef T value_type;
+
+    template <typename U>
+    struct rebind { typedef STLAllocator<U, Allocator> other; };
+
+    Allocator* allocator;
+
+    STLAllocator(Allocator* allocator) : allocator(allocator) {}
+    template <typename U>
+    STLAllocator(const STLAllocator<U, Allocator>& other) : allocator(other.allocator) {}
+
+    T* allocate(size_t count) { return (T*)AllocateBlock(*allocator, count * sizeof(T), alignof(T)); }
+    void deallocate(T* block, size_t count) { FreeBlock(*allocator, block, count * sizeof(T)); }
+};
+
+template <typename T, typename U, typename Allocator>
+inline bool operator==(const STLAllocator<T, Allocator>& a, const STLAllocator<U, Allocator>& b) { return a.allocator == b.allocator; }
+template <typename T, typename U, typename Allocator>
+inline bool operator!=(const STLAllocator<T, Allocator>& a, const STLAllocator<U, Allocator>& b) { return a.allocator != b.allocator; }
+
+// Containers of this thread's frame arena and scratch stack
+template <typename T>
+using FrameVector = std::vector<T, STLAllocator<T, LinearAllocator>>;
+template <typename T>
+using ScratchVector = std::vector<T, STLAllocator<T, StackAllocator>>;
+
+template <typename T>
+inline STLAllocator<T, LinearAllocator> GetFrameAllocator() { return STLAllocator<T, LinearAllocator>(&GetFrameArena()); }
+template <typename T>
+inline STLAllocator<T, StackAllocator> GetScratchAllocator() { return STLAllocator<T, StackAllocator>(&GetScratchStack()); }
+
+// ------------------------------------------------------------------------------------------------
+// STATS //
+// ------------------------------------------------------------------------------------------------
+
+// Turns the counters into per frame rates, called by the main loop at the end of the frame
+void UpdateAllocatorStats();
+
+void DrawAllocatorsImGui();
@@ -2,8 +2,10 @@
 
 #include "Layouts.h"
 #include "Texture.h"
+#include "Profiler.h"
 
 #include <memory>
+#include <string.h>
 
 void ProcessAssimpMaterial(App* app, aiMaterial* material, Material& myMaterial, String directory, bool flipTextures)
 {
@@ -73,32 +75,35 @@ void ProcessAssimpMesh(const aiScene* scene, aiMesh* mesh, Model& myModel, u32 b
 {
     Mesh myMesh = {};
 
-    bool hasTexCoords = false;
-    bool hasTangentSpace = false;
+    bool hasTexCoords = mesh->mTextureCoords[0] != nullptr; // Does the mesh contain texture coordinates?
+    bool hasTangentSpace = mesh->mTangents != nullptr && mesh->mBitangents;
+
+    // Sized once up front and written in place, instead of growing one float at a time
+    u32 floatsPerVertex = 6 + (hasTexCoords ? 2 : 0) + (hasTangentSpace ? 6 : 0);
+    myMesh.vertices.resize(u64(mesh->mNumVertices) * floatsPerVertex);
 
     // Process vertices
+    float* vertex = myMesh.vertices.data();
     for (unsigned int i = 0; i < mesh->mNumVertices; i++)
     {
-        myMesh.vertices.push_back(mesh->mVertices[i].x);
-        myMesh.vertices.push_back(mesh->mVertices[i].y);
-        myMesh.vertices.push_back(mesh->mVertices[i].z);
-        myMesh.vertices.push_back(mesh->mNormals[i].x);
-        myMesh.vertices.push_back(mesh->mNormals[i].y);
-        myMesh.vertices.push_back(mesh->mNormals[i].z);
-
-        if (mesh->mTextureCoords[0]) // Does the mesh contain texture coordinates?
+        *vertex++ = mesh->mVertices[i].x;
+        *vertex++ = mesh->mVertices[i].y;
+        *vertex++ = mesh->mVertices[i].z;
+        *vertex++ = mesh->mNormals[i].x;
+        *vertex++ = mesh->mNormals[i].y;
+        *vertex++ = mesh->mNormals[i].z;
+
+        if (hasTexCoords)
         {
-            hasTexCoords = true;
-            myMesh.vertices.push_back(mesh->mTextureCoords[0][i].x);
-            myMesh.vertices.push_back(mesh->mTextureCoords[0][i].y);
+            *vertex++ = mesh->mTextureCoords[0][i].x;
+            *vertex++ = mesh->mTextureCoords[0][i].y;
         }
 
-        if (mesh->mTangents != nullptr && mesh->mBitangents)
+        if (hasTangentSpace)
         {
-            hasTangentSpace = true;
-            myMesh.vertices.push_back(mesh->mTangents[i].x);
-            myMesh.vertices.push_back(mesh->mTangents[i].y);
-            myMesh.vertices.push_back(mesh->mTangents[i].z);
+            *vertex++ = mesh->mTangents[i].x;
+            *vertex++ = mesh->mTangents[i].y;
+            *vertex++ = mesh->mTangents[i].z;
 
             // For some reason ASSIMP gives me the bitangents flipped.
             // Maybe it's my fault, but when I generate my own geometry
@@ -108,20 +113,24 @@ void ProcessAssimpMesh(const aiScene* scene, aiMesh* mesh, Model& myModel, u32 b
             // I think that (even if the documentation says the opposite)
             // it returns a left-handed tangent space matrix.
             // SOLUTION: I invert the components of the bitangent here.
-            myMesh.vertices.push_back(-mesh->mBitangents[i].x);
-            myMesh.vertices.push_back(-mesh->mBitangents[i].y);
-            myMesh.vertices.push_back(-mesh->mBitangents[i].z);
+            *vertex++ = -mesh->mBitangents[i].x;
+            *vertex++ = -mesh->mBitangents[i].y;
+            *vertex++ = -mesh->mBitangents[i].z;
         }
     }
 
     // Process indices
+    u32 indexCount = 0;
+    for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+        indexCount += mesh->mFaces[i].mNumIndices;
+    myMesh.indices.resize(indexCount);
+
+    u32* index = myMesh.indices.data();
     for (unsigned int i = 0; i < mesh->mNumFaces; i++)
     {
-        aiFace face = mesh->mFaces[i];
-        for (unsigned int j = 0; j < face.mNumIndices; j++)
-        {
-            myMesh.indices.push_back(face.mIndices[j]);
-        }
+        const aiFace& face = mesh->mFaces[i];
+        memcpy(index, face.mIndices, face.mNumIndices * sizeof(u32));
+        index += face.mNumIndices;
     }
 
     // Store the proper (previously proceessed) material for this mesh
@@ -147,7 +156,7 @@ void ProcessAssimpMesh(const aiScene* scene, aiMesh* mesh, Model& myModel, u32 b
     }
 
     // add the mesh into the model
-    myModel.meshes.push_back(myMesh);
+    myModel.meshes.push_back(std::move(myMesh));
 }
 
 void ProcessAssimpNode(const aiScene* scene, aiNode* node, Model& myModel, u32 baseMeshMaterialIndex, std::vector<u32>& modelMaterialIndices)
@@ -166,29 +175,100 @@ void ProcessAssimpNode(const aiScene* scene, aiNode* node, Model& myModel, u32 b
     }
 }
 
-Model* LoadModel(App* app, const char* filename, bool flipTextures)
+static const aiScene* ImportScene(const char* filename)
 {
-    app->models.push_back(std::make_unique<Model>());
-    Model* model = app->models.back().get();
-
     const aiScene* scene = aiImportFile(filename,
         aiProcess_Triangulate |
         aiProcess_GenSmoothNormals |
         aiProcess_CalcTangentSpace |
         aiProcess_JoinIdenticalVertices |
         aiProcess_PreTransformVertices |
-        aiProcess_ImproveCacheLocality |
         aiProcess_OptimizeMeshes |
         aiProcess_SortByPType);
 
     if (!scene)
-    {
         ELOG("Error loading mesh %s: %s\n", filename, aiGetErrorString());
-        return nullptr;
+
+    return scene;
+}
+
+// Decodes the textures of every material across the job system and uploads them, so ProcessAssimpMaterial
+// finds them already loaded. GL is only touched on this thread.
+static void DecodeMaterialTextures(App* app, const aiScene* scene, String directory, bool flipTextures)
+{
+    PROFILE_FUNCTION();
+
+    static const aiTextureType textureTypes[] = { aiTextureType_DIFFUSE, aiTextureType_EMISSIVE, aiTextureType_SPECULAR, aiTextureType_NORMALS, aiTextureType_HEIGHT };
+
+    std::vector<std::string> filepaths;
+    for (u32 i = 0; i < scene->mNumMaterials; ++i)
+    {
+        for (u32 t = 0; t < ARRAY_COUNT(textureTypes); ++t)
+        {
+            aiString aiFilename;
+            if (scene->mMaterials[i]->GetTextureCount(textureTypes[t]) == 0)
+                continue;
+            scene->mMaterials[i]->GetTexture(textureTypes[t], 0, &aiFilename);
+
+            String filepath = MakePath(directory, MakeString(aiFilename.C_Str()));
+            bool isLoaded = false;
+            for (u32 texIdx = 0; texIdx < app->textures.size() && !isLoaded; ++texIdx)
+                isLoaded = app->textures[texIdx].filepath == filepath.str;
+            for (u32 p = 0; p < filepaths.size() && !isLoaded; ++p)
+                isLoaded = filepaths[p] == filepath.str;
+
+            if (!isLoaded)
+                filepaths.push_back(filepath.str);
+        }
+    }
+
+    std::vector<Image> images;
+    DecodeImages(filepaths, flipTextures, images);
+
+    // The ones that failed are tried again, and reported, by ProcessAssimpMaterial
+    for (u32 i = 0; i < images.size(); ++i)
+    {
+        if (!images[i].pixels)
+            continue;
+        AddTexture2D(app->textures, filepaths[i].c_str(), flipTextures, images[i]);
+        FreeImage(images[i]);
+    }
+}
+
+static void OptimizeModelMeshes(Model& model, const char* filename)
+{
+    // Reorder the geometry for the vertex cache, overdraw and vertex fetch
+    for (u32 i = 0; i < model.meshes.size(); ++i)
+    {
+        Mesh& mesh = model.meshes[i];
+        OptimizeMesh(mesh, mesh.optimizationReport);
+
+        const MeshOptimizationStats& before = mesh.optimizationReport.before;
+        const MeshOptimizationStats& after = mesh.optimizationReport.after;
+        ILOG("%s mesh %u optimized:\n"
+            "  ACMR      %.3f -> %.3f\n"
+            "  ATVR      %.3f -> %.3f\n"
+            "  Overdraw  %.3f -> %.3f\n"
+            "  Overfetch %.3f -> %.3f",
+            filename, i, before.acmr, after.acmr, before.atvr, after.atvr, before.overdraw, after.overdraw, before.overfetch, after.overfetch);
     }
+}
+
+Model* LoadModel(App* app, const char* filename, bool flipTextures)
+{
+    PROFILE_FUNCTION();
+
+    app->models.push_back(std::make_unique<Model>());
+    Model* model = app->models.back().get();
+
+    const aiScene* scene = ImportScene(filename);
+    if (!scene)
+        return nullptr;
 
     String directory = GetDirectoryPart(MakeString(filename));
 
+    DecodeMaterialTextures(app, scene, directory, flipTextures);
+
     // Create a list of materials
     u32 baseMeshMaterialIndex = (u32)app->materials.size();
     for (unsigned int i = 0; i < scene->mNumMaterials; ++i)
@@ -198,47 +278,54 @@ Model* LoadModel(App* app, const char* filename, bool flipTextures)
         ProcessAssimpMaterial(app, scene->mMaterials[i], material, directory, flipTextures);
     }
 
+    model->filepath = filename;
+    model->baseMaterialIndex = baseMeshMaterialIndex;
+    model->flipTextures = flipTextures;
+
     ProcessAssimpNode(scene, scene->mRootNode, *model, baseMeshMaterialIndex, (*model).materialIDs);
 
     aiReleaseImport(scene);
 
-    u32 vertexBufferSize = 0;
-    u32 indexBufferSize = 0;
+    OptimizeModelMeshes(*model, filename);
 
     for (u32 i = 0; i < model->meshes.size(); ++i)
-    {
-        vertexBufferSize += model->meshes[i].vertices.size() * sizeof(float);
-        indexBufferSize += model->meshes[i].indices.size() * sizeof(u32);
-    }
+        AllocateMesh(app->geometryArena, model->meshes[i]);
+    ComputeModelBounds(*model);
 
-    glGenBuffers(1, &model->VBHandle);
-    glBindBuffer(GL_ARRAY_BUFFER, model->VBHandle);
-    glBufferData(GL_ARRAY_BUFFER, vertexBufferSize, NULL, GL_STATIC_DRAW);
+    return model;
+}
 
-    glGenBuffers(1, &model->EBHandle);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, model->EBHandle);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBufferSize, NULL, GL_STATIC_DRAW);
+bool ImportModelGeometry(const char* filename, Model& model, u32 baseMeshMaterialIndex)
+{
+    const aiScene* scene = ImportScene(filename);
+    if (!scene)
+        return false;
 
-    u32 indicesOffset = 0;
-    u32 verticesOffset = 0;
+    model.filepath = filename;
+    model.baseMaterialIndex = baseMeshMaterialIndex;
 
-    for (u32 i = 0; i < model->meshes.size(); ++i)
-    {
-        const void* verticesData = model->meshes[i].vertices.data();
-        const u32 verticesSize = model->meshes[i].vertices.size() * sizeof(float);
-        glBufferSubData(GL_ARRAY_BUFFER, verticesOffset, verticesSize, verticesData);
-        model->meshes[i].vertexOffset = verticesOffset;
-        verticesOffset += verticesSize;
+    ProcessAssimpNode(scene, scene->mRootNode, model, baseMeshMaterialIndex, model.materialIDs);
 
-        const void* indicesData = model->meshes[i].indices.data();
-        const u32 indicesSize = model->meshes[i].indices.size() * sizeof(u32);
-        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, indicesOffset, indicesSize, indicesData);
-        model->meshes[i].indexOffset = indicesOffset;
-        indicesOffset += indicesSize;
-    }
+    aiReleaseImport(scene);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    OptimizeModelMeshes(model, filename);
 
-    return model;
+    return true;
+}
+
+void UnloadModel(App* app, Model* model)
+{
+    UnwatchModel(app, model);
+
+    for (u32 i = 0; i < model->meshes.size(); ++i)
+        FreeMesh(app->geometryArena, model->meshes[i]);
+
+    for (u32 i = 0; i < app->models.size(); ++i)
+    {
+        if (app->models[i].get() == model)
+        {
+            app->models.erase(app->models.begin() + i);
+            break;
+        }
+    }
 }
\ No newline at end of file
@@ -12,4 +12,11 @@ void ProcessAssimpMesh(const aiScene* scene, aiMesh* mesh, Model& myModel, u32 b
 
 void ProcessAssimpNode(const aiScene* scene, aiNode* node, Model& myModel, u32 baseMeshMaterialIndex, std::vector<u32>& submeshMaterialIndices);
 
-Model* LoadModel(App* app, const char* filename, bool flipTextures = true);
\ No newline at end of file
+Model* LoadModel(App* app, const char* filename, bool flipTextures = true);
+
+// Imports only the meshes of a model, without touching the App. Materials are expected to already exist at baseMeshMaterialIndex.
+// The geometry is not uploaded, so it can be called from a background thread.
+bool ImportModelGeometry(const char* filename, Model& model, u32 baseMeshMaterialIndex);
+
+// Releases the model geometry from the arena. Entities must not reference the model anymore.
+void UnloadModel(App* app, Model* model);
\ No newline at end of file
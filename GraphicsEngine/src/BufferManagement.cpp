@@ -1,6 +1,8 @@
 #include "BufferManagement.h"
 
 #include "platform.h"
+#include "RenderStats.h"
+#include "GPUMemory.h"
 #include "glad/glad.h"
 
 Buffer CreateBuffer(u32 size, GLenum type, GLenum usage)
@@ -14,9 +16,32 @@ Buffer CreateBuffer(u32 size, GLenum type, GLenum usage)
     glBufferData(type, buffer.size, NULL, usage);
     glBindBuffer(type, 0);
 
+    switch (type)
+    {
+    case GL_UNIFORM_BUFFER:
+        TrackGPUAllocation(GPUResourceKind::BUFFER, buffer.handle, size, GPU_MEMORY_UNIFORM_BUFFERS, "Uniform Buffer");
+        break;
+    case GL_ARRAY_BUFFER:
+        TrackGPUAllocation(GPUResourceKind::BUFFER, buffer.handle, size, GPU_MEMORY_GEOMETRY, "Vertex Buffer");
+        break;
+    case GL_ELEMENT_ARRAY_BUFFER:
+        TrackGPUAllocation(GPUResourceKind::BUFFER, buffer.handle, size, GPU_MEMORY_GEOMETRY, "Index Buffer");
+        break;
+    default:
+        TrackGPUAllocation(GPUResourceKind::BUFFER, buffer.handle, size, GPU_MEMORY_OTHER, "Buffer");
+        break;
+    }
+
     return buffer;
 }
 
+void DeleteBuffer(Buffer& buffer)
+{
+    UntrackGPUAllocation(GPUResourceKind::BUFFER, buffer.handle);
+    glDeleteBuffers(1, &buffer.handle);
+    buffer = {};
+}
+
 void BindBuffer(const Buffer& buffer)
 {
     glBindBuffer(buffer.type, buffer.handle);
@@ -31,6 +56,8 @@ void MapBuffer(Buffer& buffer, GLenum access)
 
 void UnmapBuffer(Buffer& buffer)
 {
+    // Everything pushed since the buffer was mapped
+    CountRenderStat(RENDER_COUNTER_BYTES_UPLOADED, buffer.head);
     glUnmapBuffer(buffer.type);
     glBindBuffer(buffer.type, 0);
 }
@@ -57,4 +84,14 @@ void PushAlignedData(Buffer& buffer, const void* data, u32 size, u32 alignment)
     AlignHead(buffer, alignment);
     memcpy((u8*)buffer.data + buffer.head, data, size);
     buffer.head += size;
+}
+
+void* PushAlignedBlock(Buffer& buffer, u32 size, u32 alignment)
+{
+    ASSERT(buffer.data != NULL, "The buffer must be mapped first");
+    AlignHead(buffer, alignment);
+    ASSERT(buffer.head + size <= buffer.size, "The buffer is full");
+    void* block = (u8*)buffer.data + buffer.head;
+    buffer.head += size;
+    return block;
 }
\ No newline at end of file
@@ -15,6 +15,8 @@ struct Buffer
 
 Buffer CreateBuffer(u32 size, GLenum type, GLenum usage);
 
+void DeleteBuffer(Buffer& buffer);
+
 void BindBuffer(const Buffer& buffer);
 
 void MapBuffer(Buffer& buffer, GLenum access);
@@ -29,6 +31,24 @@ void AlignHead(Buffer& buffer, u32 alignment);
 
 void PushAlignedData(Buffer& buffer, const void* data, u32 size, u32 alignment);
 
+// Reserves size bytes in a mapped buffer and returns them to be written in place
+void* PushAlignedBlock(Buffer& buffer, u32 size, u32 alignment);
+
+// Parameter blocks (see ParameterBlocks.h) already have the GLSL layout, so they are filled directly in the mapped buffer
+template <typename Block>
+Block* PushParameterBlock(Buffer& buffer, u32 alignment)
+{
+    return (Block*)PushAlignedBlock(buffer, sizeof(Block), alignment);
+}
+
+// Reserves count consecutive blocks, each one aligned, and returns the first. Block i is at i * stride bytes from it.
+template <typename Block>
+Block* PushParameterBlocks(Buffer& buffer, u32 count, u32 alignment, u32& stride)
+{
+    stride = Align(sizeof(Block), alignment);
+    return (Block*)PushAlignedBlock(buffer, stride * count, alignment);
+}
+
 #define CreateConstantBuffer(size) CreateBuffer(size, GL_UNIFORM_BUFFER, GL_STREAM_DRAW)
 #define CreateStaticVertexBuffer(size) CreateBuffer(size, GL_ARRAY_BUFFER, GL_STATIC_DRAW)
 #define CreateStaticIndexBuffer(size) CreateBuffer(size, GL_ELEMENT_ARRAY_BUFFER, GL_STATIC_DRAW)
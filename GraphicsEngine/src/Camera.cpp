@@ -3,7 +3,8 @@
 Camera::Camera(float speed) :
 	position(glm::vec3(0.0f)), m_Front(glm::vec3(0.0f, 0.0f, -1.0f)), m_Up(glm::vec3(0.0f)), m_Right(glm::vec3(0.0f)), m_WorldUp(glm::vec3(0.0f, 1.0f, 0.0f)),
 	speed(speed), defaultSpeed(speed), m_Sensitivity(0.1f), m_Yaw(-90.0f), m_Pitch(0.0f),
-	FOV(45.0f), m_DefaultFOV(45.0f), m_NearPlane(0.1f), m_FarPlane(100.0f), freeCamera(true), m_Radius(20.0f), autoRotate(true), m_RotationSpeed(0.5f)
+	FOV(45.0f), m_DefaultFOV(45.0f), m_NearPlane(0.1f), m_FarPlane(100.0f), freeCamera(true), m_Radius(20.0f), autoRotate(true), m_RotationSpeed(0.5f),
+	m_View(1.0f), m_Projection(1.0f), m_JitteredProjection(1.0f), m_PreviousViewProjection(1.0f), m_Jitter(0.0f)
 {
 	UpdateVectors();
 }
@@ -11,13 +12,17 @@ Camera::Camera(float speed) :
 Camera::Camera(glm::vec3 position, float FOV, float nearPlane, float farPlane, float speed, bool freeCam) :
 	position(position), m_Front(glm::vec3(0.0f, 0.0f, -1.0f)), m_Up(glm::vec3(0.0f)), m_Right(glm::vec3(0.0f)), m_WorldUp(glm::vec3(0.0f, 1.0f, 0.0f)),
 	speed(speed), defaultSpeed(speed), m_Sensitivity(0.1f), m_Yaw(-90.0f), m_Pitch(0.0f),
-	FOV(FOV), m_DefaultFOV(FOV), m_NearPlane(nearPlane), m_FarPlane(farPlane), freeCamera(freeCam), m_Radius(20.0f), autoRotate(true), m_RotationSpeed(0.5f)
+	FOV(FOV), m_DefaultFOV(FOV), m_NearPlane(nearPlane), m_FarPlane(farPlane), freeCamera(freeCam), m_Radius(20.0f), autoRotate(true), m_RotationSpeed(0.5f),
+	m_View(1.0f), m_Projection(1.0f), m_JitteredProjection(1.0f), m_PreviousViewProjection(1.0f), m_Jitter(0.0f)
 {
 	UpdateVectors();
 }
 
 void Camera::Update(const Input& input, const glm::ivec2& displaySize, float deltaTime, float currentTime)
 {
+	// Motion vectors are the difference with where the geometry was in the previous frame
+	m_PreviousViewProjection = m_Projection * m_View;
+
 	if (freeCamera)
 	{
 		if (input.keys[K_LSHIFT] == BUTTON_PRESS)
@@ -71,6 +76,38 @@ void Camera::Update(const Input& input, const glm::ivec2& displaySize, float del
 	}
 }
 
+// Radical inverse of index in the given base, the low-discrepancy sequence samples cover the pixel evenly
+static float Halton(u32 index, u32 base)
+{
+	float result = 0.0f;
+	float fraction = 1.0f;
+	while (index > 0)
+	{
+		fraction /= float(base);
+		result += fraction * float(index % base);
+		index /= base;
+	}
+	return result;
+}
+
+void Camera::UpdateJitter(bool enabled, const glm::ivec2& renderSize, u32 frameIndex)
+{
+	if (!enabled)
+	{
+		m_Jitter = glm::vec2(0.0f);
+		m_JitteredProjection = m_Projection;
+		return;
+	}
+
+	// Halton(2, 3) starting at 1, as index 0 would be the pixel corner in both axes
+	u32 phase = frameIndex % CAMERA_JITTER_PHASES;
+	glm::vec2 jitterPixels(Halton(phase + 1, 2) - 0.5f, Halton(phase + 1, 3) - 0.5f);
+	m_Jitter = jitterPixels * 2.0f / glm::vec2(renderSize);
+
+	// Translating in clip space after the projection moves every vertex by the same amount in NDC
+	m_JitteredProjection = glm::translate(glm::mat4(1.0f), glm::vec3(m_Jitter, 0.0f)) * m_Projection;
+}
+
 void Camera::ProcessKeyboard(CameraDirection direction, float dt)
 {
 	// Camera Movement (Walk Around)
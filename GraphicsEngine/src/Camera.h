@@ -3,6 +3,7 @@
 #include "platform.h"
 
 #define CAMERA_DEFAULT_SPEED 3.0f
+#define CAMERA_JITTER_PHASES 16
 
 enum class CameraDirection
 {
@@ -26,6 +27,15 @@ public:
 
     inline const glm::mat4& GetViewMatrix(const glm::ivec2& displaySize) const { return m_View; }
     inline const glm::mat4& GetProjectionMatrix(const glm::ivec2& displaySize) const { return m_Projection; }
+    inline float GetNearPlane() const { return m_NearPlane; }
+    inline float GetFarPlane() const { return m_FarPlane; }
+
+    // Temporal upsampling: the projection is offset by a different sub-pixel amount every frame.
+    // The phase comes from the frame index, as the render thread works on a copy of the camera.
+    void UpdateJitter(bool enabled, const glm::ivec2& renderSize, u32 frameIndex);
+    inline const glm::mat4& GetJitteredProjectionMatrix() const { return m_JitteredProjection; }
+    inline const glm::vec2& GetJitter() const { return m_Jitter; } // In NDC
+    inline const glm::mat4& GetPreviousViewProjectionMatrix() const { return m_PreviousViewProjection; } // Not jittered
 
 public:
     glm::vec3 position;
@@ -53,6 +63,11 @@ private:
     // Matrices
     glm::mat4 m_View;
     glm::mat4 m_Projection;
+    glm::mat4 m_JitteredProjection;
+    glm::mat4 m_PreviousViewProjection;
+
+    // Jitter
+    glm::vec2 m_Jitter;
 
     // Direction Vectors
     glm::vec3 m_Front;
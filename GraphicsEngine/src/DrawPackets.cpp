@@ -0,0 +1,241 @@
+#include "DrawPackets.h"
+
+#include "engine.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+#include "Timer.h"
+#include "JobSystem.h"
+
+#include "imgui-docking/imgui.h"
+
+static void BuildRangePackets(const DrawPacketFrame& frame, u32 range, DrawPacketBuffer& buffer)
+{
+    buffer.packets.clear();
+
+    const EntityArchetypeStorage& entities = *frame.entities;
+    u32 first = range * DRAW_PACKET_RANGE_SIZE;
+    u32 last = glm::min(first + DRAW_PACKET_RANGE_SIZE, entities.count);
+    for (u32 i = first; i < last; ++i)
+    {
+        if (!entities.visibility[i])
+            continue;
+
+        const Model* model = entities.models[i];
+        u32 shaderID = frame.drawShaderIDs[entities.shaderIDs[i]];
+
+        u32 numMeshes = model->meshes.size();
+        for (u32 meshIndex = 0; meshIndex < numMeshes; ++meshIndex)
+        {
+            const Mesh& mesh = model->meshes[meshIndex];
+            const VertexPool& pool = frame.arena->vertexPools[mesh.vertexPoolIndex];
+            u32 materialID = model->materialIDs[meshIndex];
+            const Material& material = frame.materials[materialID];
+
+            DrawPacket packet;
+            packet.program = frame.programs[shaderID];
+            packet.materialSlot = frame.materialSlots[shaderID];
+            packet.uniformsIndex = shaderID;
+
+            packet.VAO = frame.arena->vertexFormats[mesh.vertexFormatIndex].VAO;
+            packet.vertexBuffer = pool.buffer.handle;
+            packet.vertexStride = pool.stride;
+            packet.firstIndex = mesh.firstIndex;
+            packet.indexCount = mesh.indexCount;
+            packet.baseVertex = mesh.baseVertex;
+
+            packet.localParamOffset = entities.localParamOffsets[i];
+            packet.localParamSize = sizeof(LocalParameters);
+
+            packet.materialID = materialID;
+            packet.textures[0] = packet.materialSlot >= DRAW_PACKET_MATERIAL_TEXTURED_ALBEDO ? frame.textures[material.albedoTextureID].handle : 0;
+            packet.textures[1] = packet.materialSlot == DRAW_PACKET_MATERIAL_TEXTURED_ALB_SPEC ? frame.textures[material.specularTextureID].handle : 0;
+
+            buffer.packets.push_back(packet);
+        }
+    }
+}
+
+static void BuildPacketsJob(void* data, u32 begin, u32 end)
+{
+    PROFILE_SCOPE("Build Draw Packets");
+
+    DrawPacketGenerator& generator = *(DrawPacketGenerator*)data;
+    for (u32 range = begin; range < end; ++range)
+        BuildRangePackets(generator.frame, range, generator.buffers[range]);
+}
+
+void GenerateDrawPackets(App* app, DrawPacketGenerator& generator, const EntityArchetypeStorage& entities, u32 fallbackShaderID)
+{
+    PROFILE_FUNCTION();
+
+    Timer timer(&generator.generationTime);
+
+    // GL is only queried here, the jobs read the results
+    app->shaderPrograms[fallbackShaderID].FinishCompilation();
+
+    DrawPacketFrame& frame = generator.frame;
+    frame.entities = &entities;
+    frame.arena = &app->geometryArena;
+    frame.materials = app->materials.data();
+    frame.textures = app->textures.data();
+
+    u32 shaderCount = app->shaderPrograms.size();
+    frame.drawShaderIDs.resize(shaderCount);
+    frame.programs.resize(shaderCount);
+    frame.materialSlots.resize(shaderCount);
+    frame.uniforms.resize(shaderCount);
+    for (u32 i = 0; i < shaderCount; ++i)
+    {
+        Shader& shader = app->shaderPrograms[i];
+
+        // Only the programs entities are drawn with get their uniforms resolved
+        bool isMaterialShader = shader.type == ShaderType::DEFAULT || shader.type == ShaderType::TEXTURED_ALBEDO || shader.type == ShaderType::TEXTURED_ALB_SPEC;
+        if (!isMaterialShader)
+        {
+            frame.drawShaderIDs[i] = i;
+            frame.programs[i] = shader.handle;
+            frame.materialSlots[i] = DRAW_PACKET_MATERIAL_NONE;
+            continue;
+        }
+
+        frame.programs[i] = shader.handle;
+
+        // Entities are drawn with the fallback until their own program finishes compiling
+        if (!shader.IsReady())
+        {
+            frame.drawShaderIDs[i] = fallbackShaderID;
+            continue;
+        }
+        frame.drawShaderIDs[i] = i;
+
+        MaterialUniformLocations& uniforms = frame.uniforms[i];
+        switch (shader.type)
+        {
+        case ShaderType::DEFAULT:
+            frame.materialSlots[i] = DRAW_PACKET_MATERIAL_DEFAULT;
+            uniforms.albedo = shader.GetUniformLocation("uMaterial.albedo");
+            uniforms.specular = shader.GetUniformLocation("uMaterial.specular");
+            break;
+        case ShaderType::TEXTURED_ALBEDO:
+            frame.materialSlots[i] = DRAW_PACKET_MATERIAL_TEXTURED_ALBEDO;
+            uniforms.specular = shader.GetUniformLocation("uMaterial.specular");
+            break;
+        default:
+            frame.materialSlots[i] = DRAW_PACKET_MATERIAL_TEXTURED_ALB_SPEC;
+            break;
+        }
+        uniforms.reflective = shader.GetUniformLocation("uMaterial.reflective");
+        uniforms.shininess = shader.GetUniformLocation("uMaterial.shininess");
+    }
+
+    generator.rangeCount = (entities.count + DRAW_PACKET_RANGE_SIZE - 1) / DRAW_PACKET_RANGE_SIZE;
+    if (generator.buffers.size() < generator.rangeCount)
+        generator.buffers.resize(generator.rangeCount);
+
+    ParallelFor(generator.rangeCount, 1, BuildPacketsJob, &generator);
+
+    generator.packetCount = 0;
+    for (u32 range = 0; range < generator.rangeCount; ++range)
+        generator.packetCount += generator.buffers[range].packets.size();
+}
+
+void ReplayDrawPackets(const DrawPacketGenerator& generator, u32 uniformBuffer)
+{
+    PROFILE_FUNCTION();
+
+    const DrawPacketFrame& frame = generator.frame;
+
+    u32 program = 0;
+    u32 VAO = 0;
+    u32 vertexBuffer = 0;
+    u32 localParamOffset = 0xFFFFFFFF;
+    u32 textures[2] = {};
+    for (u32 range = 0; range < generator.rangeCount; ++range)
+    {
+        const std::vector<DrawPacket>& packets = generator.buffers[range].packets;
+        for (u32 i = 0; i < packets.size(); ++i)
+        {
+            const DrawPacket& packet = packets[i];
+
+            if (packet.program != program)
+            {
+                glUseProgram(packet.program);
+                CountRenderStat(RENDER_COUNTER_PROGRAM_BINDS);
+                program = packet.program;
+            }
+
+            if (packet.VAO != VAO)
+            {
+                glBindVertexArray(packet.VAO);
+                CountRenderStat(RENDER_COUNTER_VAO_BINDS);
+                VAO = packet.VAO;
+                vertexBuffer = 0;
+            }
+
+            // The base vertex of the draw call selects the mesh inside the pool
+            if (packet.vertexBuffer != vertexBuffer)
+            {
+                glBindVertexBuffer(0, packet.vertexBuffer, 0, packet.vertexStride);
+                vertexBuffer = packet.vertexBuffer;
+            }
+
+            if (packet.localParamOffset != localParamOffset)
+            {
+                glBindBufferRange(GL_UNIFORM_BUFFER, LOCAL_PARAMETERS_BINDING, uniformBuffer, packet.localParamOffset, packet.localParamSize);
+                localParamOffset = packet.localParamOffset;
+            }
+
+            for (u32 t = 0; t < 2; ++t)
+            {
+                if (packet.textures[t] && packet.textures[t] != textures[t])
+                {
+                    glActiveTexture(GL_TEXTURE0 + t);
+                    glBindTexture(GL_TEXTURE_2D, packet.textures[t]);
+                    CountRenderStat(RENDER_COUNTER_TEXTURE_BINDS);
+                    textures[t] = packet.textures[t];
+                }
+            }
+
+            const Material& material = frame.materials[packet.materialID];
+            const MaterialUniformLocations& uniforms = frame.uniforms[packet.uniformsIndex];
+            switch (packet.materialSlot)
+            {
+            case DRAW_PACKET_MATERIAL_DEFAULT:
+                glUniform3fv(uniforms.albedo, 1, &material.albedo[0]);
+                glUniform3fv(uniforms.specular, 1, &material.specular[0]);
+                glUniform3fv(uniforms.reflective, 1, &material.reflective[0]);
+                glUniform1f(uniforms.shininess, material.shininess);
+                CountRenderStat(RENDER_COUNTER_UNIFORM_SETS, 4);
+                break;
+            case DRAW_PACKET_MATERIAL_TEXTURED_ALBEDO:
+                glUniform3fv(uniforms.specular, 1, &material.specular[0]);
+                glUniform3fv(uniforms.reflective, 1, &material.reflective[0]);
+                glUniform1f(uniforms.shininess, material.shininess);
+                CountRenderStat(RENDER_COUNTER_UNIFORM_SETS, 3);
+                break;
+            case DRAW_PACKET_MATERIAL_TEXTURED_ALB_SPEC:
+                glUniform3fv(uniforms.reflective, 1, &material.reflective[0]);
+                glUniform1f(uniforms.shininess, material.shininess);
+                CountRenderStat(RENDER_COUNTER_UNIFORM_SETS, 2);
+                break;
+            }
+
+            glDrawElementsBaseVertex(GL_TRIANGLES, packet.indexCount, GL_UNSIGNED_INT, (void*)(u64)(packet.firstIndex * sizeof(u32)), packet.baseVertex);
+
+            CountDrawCall(packet.indexCount);
+        }
+    }
+
+    glBindVertexArray(0);
+    glUseProgram(0);
+}
+
+// ------------------------------------------------------------------------------------------------
+// IMGUI //
+// ------------------------------------------------------------------------------------------------
+
+void DrawDrawPacketsImGui(DrawPacketGenerator& generator)
+{
+    ImGui::Text("Draw Packets: %u in %u ranges of %u entities", generator.packetCount, generator.rangeCount, DRAW_PACKET_RANGE_SIZE);
+    ImGui::Text("Generation (ms): %.3f", generator.generationTime);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "platform.h"
+
+struct App;
+struct EntityArchetypeStorage;
+struct GeometryArena;
+struct Material;
+struct Texture;
+
+#define DRAW_PACKET_RANGE_SIZE 512 // Entities per range, the unit of work of the job system
+
+enum DrawPacketMaterial
+{
+    DRAW_PACKET_MATERIAL_NONE,
+    DRAW_PACKET_MATERIAL_DEFAULT,         // Albedo, specular, reflective and shininess constants
+    DRAW_PACKET_MATERIAL_TEXTURED_ALBEDO, // Albedo map
+    DRAW_PACKET_MATERIAL_TEXTURED_ALB_SPEC // Albedo and specular maps
+};
+
+// Uniform locations of the material constants of a program, resolved by the main thread before the packets are built
+struct MaterialUniformLocations
+{
+    int albedo;
+    int specular;
+    int reflective;
+    int shininess;
+};
+
+// Everything needed to issue one draw, without touching the entity, model or shader again.
+// Built by any thread, only the main thread replays them against GL.
+struct DrawPacket
+{
+    u32 program;
+    u32 materialSlot;   // DrawPacketMaterial, selects the constants set from the uniforms below
+    u32 uniformsIndex;  // Into DrawPacketFrame::uniforms
+
+    u32 VAO;
+    u32 vertexBuffer;
+    u32 vertexStride;
+    u32 firstIndex;
+    u32 indexCount;
+    u32 baseVertex;
+
+    u32 localParamOffset;
+    u32 localParamSize;
+
+    u32 materialID;
+    u32 textures[2]; // Albedo and specular maps, 0 when the material slot doesn't use them
+};
+
+// Per frame inputs of the jobs, everything read-only while they run
+struct DrawPacketFrame
+{
+    const EntityArchetypeStorage* entities;
+
+    const GeometryArena* arena;
+    const Material* materials;
+    const Texture* textures;
+
+    // Indexed by the shader ID of the entities
+    std::vector<u32> drawShaderIDs; // The fallback while a program compiles
+    std::vector<u32> programs;
+    std::vector<u32> materialSlots;
+    std::vector<MaterialUniformLocations> uniforms;
+};
+
+// Command buffer of one entity range, replayed in range order so the draw order doesn't depend on the threads
+struct DrawPacketBuffer
+{
+    std::vector<DrawPacket> packets;
+};
+
+struct DrawPacketGenerator
+{
+    DrawPacketFrame frame;
+    std::vector<DrawPacketBuffer> buffers;
+    u32 rangeCount = 0;
+
+    // Last frame, shown in ImGui
+    u32 packetCount = 0;
+    f64 generationTime = 0.0; // ms
+};
+
+// Resolves the programs, fallbacks and uniform locations of the shaders on the main thread, then builds
+// the packets of the visible rows of a renderable archetype, one job per range
+void GenerateDrawPackets(App* app, DrawPacketGenerator& generator, const EntityArchetypeStorage& entities, u32 fallbackShaderID);
+
+// Issues the packets built by the last GenerateDrawPackets, binding only what changes between them
+void ReplayDrawPackets(const DrawPacketGenerator& generator, u32 uniformBuffer);
+
+void DrawDrawPacketsImGui(DrawPacketGenerator& generator);
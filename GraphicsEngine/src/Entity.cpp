@@ -1,35 +1,41 @@
 #include "Entity.h"
 
-Entity::Entity() : position(glm::vec3(0.0f)), modelMatrix(glm::mat4(1.0f)), localParamOffset(0), localParamSize(0), model(nullptr), shaderID(0)
-{
-	Translate(position);
-}
+#include <cfloat>
 
-Entity::Entity(u32 shaderID, const glm::vec3& newPosition) : position(newPosition), modelMatrix(glm::mat4(1.0f)), localParamOffset(0), localParamSize(0), model(nullptr), shaderID(shaderID)
+// Positions are the first attribute of every vertex layout
+void ComputeModelBounds(Model& model)
 {
-	Translate(position);
-}
+	glm::vec3 minPosition = glm::vec3(FLT_MAX);
+	glm::vec3 maxPosition = glm::vec3(-FLT_MAX);
+	for (u32 i = 0; i < model.meshes.size(); ++i)
+	{
+		const Mesh& mesh = model.meshes[i];
+		u32 stride = mesh.VBLayout.stride / sizeof(float);
+		for (u32 v = 0; v + 2 < mesh.vertices.size(); v += stride)
+		{
+			glm::vec3 position = glm::vec3(mesh.vertices[v], mesh.vertices[v + 1], mesh.vertices[v + 2]);
+			minPosition = glm::min(minPosition, position);
+			maxPosition = glm::max(maxPosition, position);
+		}
+	}
 
-Entity::Entity(u32 shaderID, const glm::vec3& newPosition, Model* model) : position(newPosition), modelMatrix(glm::mat4(1.0f)), localParamOffset(0), localParamSize(0), model(model), shaderID(shaderID)
-{
-	Translate(position);
-}
+	if (minPosition.x > maxPosition.x)
+	{
+		model.boundingSphere = glm::vec4(0.0f);
+		return;
+	}
 
-Entity::~Entity()
-{
-}
-
-void Entity::Translate(const glm::vec3& newPosition)
-{
-	modelMatrix = glm::translate(modelMatrix, position);
-}
-
-void Entity::Rotate(float newRotation, const glm::vec3& axis)
-{
-	modelMatrix = glm::rotate(modelMatrix, glm::radians(newRotation), axis);
-}
-
-void Entity::Scale(float newScale)
-{
-	modelMatrix = glm::scale(modelMatrix, glm::vec3(newScale));
+	glm::vec3 center = (minPosition + maxPosition) * 0.5f;
+	float radiusSq = 0.0f;
+	for (u32 i = 0; i < model.meshes.size(); ++i)
+	{
+		const Mesh& mesh = model.meshes[i];
+		u32 stride = mesh.VBLayout.stride / sizeof(float);
+		for (u32 v = 0; v + 2 < mesh.vertices.size(); v += stride)
+		{
+			glm::vec3 position = glm::vec3(mesh.vertices[v], mesh.vertices[v + 1], mesh.vertices[v + 2]);
+			radiusSq = glm::max(radiusSq, glm::dot(position - center, position - center));
+		}
+	}
+	model.boundingSphere = glm::vec4(center, glm::sqrt(radiusSq));
 }
\ No newline at end of file
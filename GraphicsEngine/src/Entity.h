@@ -2,25 +2,26 @@
 
 #include "platform.h"
 #include "Layouts.h"
+#include "MeshOptimizer.h"
 
 class Shader;
 struct Texture;
 
-struct VAO
-{
-    u32 handle;
-    u32 shaderProgramHandle;
-};
-
 struct Mesh
 {
     VertexBufferLayout VBLayout;
     std::vector<float> vertices;
     std::vector<u32> indices;
-    u32 vertexOffset;
-    u32 indexOffset;
 
-    std::vector<VAO> VAOs;
+    // Location inside the geometry arena
+    u32 vertexFormatIndex;
+    u32 vertexPoolIndex;
+    u32 baseVertex;
+    u32 vertexCount;
+    u32 firstIndex;
+    u32 indexCount;
+
+    MeshOptimizationReport optimizationReport;
 };
 
 struct Model
@@ -28,10 +29,21 @@ struct Model
     std::vector<Mesh> meshes;
     std::vector<u32> materialIDs;
 
-    u32 VBHandle = 0;
-    u32 EBHandle = 0;
+    std::string filepath; // Empty for primitives
+    u32 baseMaterialIndex = 0;
+
+    // How the model was created, for the scene writer
+    bool flipTextures = true;            // Of loaded models
+    u32 primitiveType = 0;               // PrimitiveType of primitives
+    u32 primitiveSegments[2] = { 0, 0 };
+
+    glm::vec4 boundingSphere = glm::vec4(0.0f); // Center and radius in model space, for the culling
+    bool isResident = true;                     // False while the world streamer has its geometry evicted, its entities are culled
 };
 
+// Bounding sphere of the vertices of all the meshes, computed again whenever the geometry changes
+void ComputeModelBounds(Model& model);
+
 struct Material
 {
     std::string name;
@@ -47,31 +59,4 @@ struct Material
     u32 specularTextureID;
     u32 normalsTextureID;
     u32 bumpTextureID;
-};
-
-class Entity
-{
-public:
-    Entity();
-    Entity(u32 shaderID, const glm::vec3& newPosition);
-    Entity(u32 shaderID, const glm::vec3& newPosition, Model* model);
-    ~Entity();
-
-    void Translate(const glm::vec3& newPosition);
-    void Rotate(float newRotation, const glm::vec3& axis);
-    void Scale(float newScale);
-
-    inline const glm::mat4& GetModelMatrix() const { return modelMatrix; }
-
-public:
-    glm::vec3 position;
-
-    u32 localParamOffset;
-    u32 localParamSize;
-
-    Model* model;
-    u32 shaderID;
-
-private:
-    glm::mat4 modelMatrix;
 };
\ No newline at end of file
@@ -0,0 +1,161 @@
+#include "EntityStore.h"
+
+static const u32 ArchetypeComponents[ENTITY_ARCHETYPE_COUNT] =
+{
+    ENTITY_COMPONENT_TRANSFORM | ENTITY_COMPONENT_RENDERABLE,
+    ENTITY_COMPONENT_TRANSFORM | ENTITY_COMPONENT_RENDERABLE | ENTITY_COMPONENT_LIGHT
+};
+
+EntityHandle AddEntity(EntityStore& store, EntityArchetype archetype)
+{
+    EntityArchetypeStorage& storage = store.archetypes[archetype];
+    storage.components = ArchetypeComponents[archetype];
+
+    // Slots of removed entities are reused, their generation already tells the old handles apart
+    u32 slotIndex;
+    if (!store.freeSlots.empty())
+    {
+        slotIndex = store.freeSlots.back();
+        store.freeSlots.pop_back();
+    }
+    else
+    {
+        slotIndex = store.slots.size();
+        EntitySlot slot = { 1, 0, 0 };
+        store.slots.push_back(slot);
+    }
+
+    EntitySlot& slot = store.slots[slotIndex];
+    slot.archetype = archetype;
+    slot.row = storage.count++;
+
+    if (storage.components & ENTITY_COMPONENT_TRANSFORM)
+    {
+        storage.modelMatrices.push_back(glm::mat4(1.0f));
+        storage.previousModelMatrices.push_back(glm::mat4(1.0f));
+        storage.sceneNodes.push_back(SCENE_NODE_NONE);
+    }
+    if (storage.components & ENTITY_COMPONENT_RENDERABLE)
+    {
+        storage.models.push_back(nullptr);
+        storage.shaderIDs.push_back(0);
+        storage.localParamOffsets.push_back(0);
+        storage.visibility.push_back(1);
+    }
+    if (storage.components & ENTITY_COMPONENT_LIGHT)
+    {
+        Light light = {};
+        storage.lights.push_back(light);
+    }
+    storage.slots.push_back(slotIndex);
+
+    store.version++;
+
+    EntityHandle handle = { slotIndex, slot.generation };
+    return handle;
+}
+
+void ReserveEntities(EntityStore& store, EntityArchetype archetype, u32 count)
+{
+    EntityArchetypeStorage& storage = store.archetypes[archetype];
+    u32 components = ArchetypeComponents[archetype];
+    u32 capacity = storage.count + count;
+
+    if (components & ENTITY_COMPONENT_TRANSFORM)
+    {
+        storage.modelMatrices.reserve(capacity);
+        storage.previousModelMatrices.reserve(capacity);
+        storage.sceneNodes.reserve(capacity);
+    }
+    if (components & ENTITY_COMPONENT_RENDERABLE)
+    {
+        storage.models.reserve(capacity);
+        storage.shaderIDs.reserve(capacity);
+        storage.localParamOffsets.reserve(capacity);
+        storage.visibility.reserve(capacity);
+    }
+    if (components & ENTITY_COMPONENT_LIGHT)
+        storage.lights.reserve(capacity);
+    storage.slots.reserve(capacity);
+
+    store.slots.reserve(store.slots.size() + count);
+}
+
+// Moves the last element into the removed one, the same for every array so the rows stay aligned
+template <typename T>
+static void SwapRemove(std::vector<T>& components, u32 row)
+{
+    if (components.empty())
+        return;
+
+    components[row] = components.back();
+    components.pop_back();
+}
+
+void RemoveEntity(EntityStore& store, EntityHandle handle)
+{
+    if (!IsEntityAlive(store, handle))
+        return;
+
+    EntitySlot& slot = store.slots[handle.slot];
+    EntityArchetypeStorage& storage = store.archetypes[slot.archetype];
+    u32 row = slot.row;
+
+    SwapRemove(storage.modelMatrices, row);
+    SwapRemove(storage.previousModelMatrices, row);
+    SwapRemove(storage.sceneNodes, row);
+    SwapRemove(storage.models, row);
+    SwapRemove(storage.shaderIDs, row);
+    SwapRemove(storage.localParamOffsets, row);
+    SwapRemove(storage.visibility, row);
+    SwapRemove(storage.lights, row);
+    SwapRemove(storage.slots, row);
+    storage.count--;
+
+    // The entity that was in the last row now lives in the removed one
+    if (row < storage.count)
+        store.slots[storage.slots[row]].row = row;
+
+    slot.generation++;
+    store.freeSlots.push_back(handle.slot);
+
+    store.version++;
+}
+
+bool IsEntityAlive(const EntityStore& store, EntityHandle handle)
+{
+    return handle.slot < store.slots.size() && handle.generation != 0 && store.slots[handle.slot].generation == handle.generation;
+}
+
+EntityArchetypeStorage& GetEntityArchetype(EntityStore& store, EntityHandle handle, u32& row)
+{
+    ASSERT(IsEntityAlive(store, handle), "The entity handle is stale");
+
+    const EntitySlot& slot = store.slots[handle.slot];
+    row = slot.row;
+    return store.archetypes[slot.archetype];
+}
+
+u32 FindEntityRow(const EntityStore& store, EntityHandle handle, EntityArchetype archetype)
+{
+    if (!IsEntityAlive(store, handle))
+        return ENTITY_ROW_NONE;
+
+    const EntitySlot& slot = store.slots[handle.slot];
+    return slot.archetype == (u32)archetype ? slot.row : ENTITY_ROW_NONE;
+}
+
+u32 GetEntityCount(const EntityStore& store)
+{
+    u32 count = 0;
+    for (u32 i = 0; i < ENTITY_ARCHETYPE_COUNT; ++i)
+        count += store.archetypes[i].count;
+    return count;
+}
+
+u32 GetEntitySceneNode(EntityStore& store, EntityHandle handle)
+{
+    u32 row;
+    EntityArchetypeStorage& storage = GetEntityArchetype(store, handle, row);
+    return storage.sceneNodes[row];
+}
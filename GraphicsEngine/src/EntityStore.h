@@ -0,0 +1,92 @@
+#pragma once
+
+#include "platform.h"
+#include "ShaderParameters.h"
+
+struct Model;
+
+#define SCENE_NODE_NONE 0xFFFFFFFF
+#define ENTITY_ROW_NONE 0xFFFFFFFF
+
+enum EntityComponent
+{
+    ENTITY_COMPONENT_TRANSFORM  = 1 << 0, // Model matrix, the one of the previous frame for the motion vectors and the scene node
+    ENTITY_COMPONENT_RENDERABLE = 1 << 1, // Model, shader, constant buffer block and visibility
+    ENTITY_COMPONENT_LIGHT      = 1 << 2  // The light the entity is the caster of
+};
+
+// Every archetype is a fixed set of components, an entity never changes archetype
+enum EntityArchetype
+{
+    ENTITY_ARCHETYPE_MESH,         // Transform and renderable
+    ENTITY_ARCHETYPE_LIGHT_CASTER, // Transform, renderable and light
+    ENTITY_ARCHETYPE_COUNT
+};
+
+// The component arrays of one archetype in SoA layout: the entity in row i owns element i of every array of its components.
+// Rows are kept packed, so the systems iterate them as contiguous arrays. Removing an entity moves the last row into its place.
+struct EntityArchetypeStorage
+{
+    u32 components = 0; // EntityComponent flags, the arrays of the others stay empty
+    u32 count = 0;
+
+    // Transform
+    std::vector<glm::mat4> modelMatrices;
+    std::vector<glm::mat4> previousModelMatrices;
+    std::vector<u32> sceneNodes; // Driving the model matrix, SCENE_NODE_NONE if it's set directly
+
+    // Renderable
+    std::vector<Model*> models;
+    std::vector<u32> shaderIDs;
+    std::vector<u32> localParamOffsets; // Of the LocalParameters block in the uniform buffer, written every frame
+    std::vector<u8> visibility;         // Inside the camera frustum, written every frame
+
+    // Light
+    std::vector<Light> lights;
+
+    std::vector<u32> slots; // Handle slot of each row, fixed up when the row moves
+};
+
+// Stays valid while rows move, and stops resolving once the entity it refers to is removed.
+// A zero initialized handle never refers to an entity.
+struct EntityHandle
+{
+    u32 slot;
+    u32 generation;
+};
+
+struct EntitySlot
+{
+    u32 generation; // Incremented when the entity is removed, so the handles to it stop matching
+    u32 archetype;
+    u32 row;
+};
+
+struct EntityStore
+{
+    EntityArchetypeStorage archetypes[ENTITY_ARCHETYPE_COUNT];
+
+    std::vector<EntitySlot> slots;
+    std::vector<u32> freeSlots;
+
+    u32 version = 0; // Incremented by every add and remove, rows read before a change may have moved
+};
+
+// O(1), the components of the new row are default initialized: identity transforms without a scene node, visible and no model
+EntityHandle AddEntity(EntityStore& store, EntityArchetype archetype);
+// Makes room for count more entities of an archetype, so adding them doesn't allocate
+void ReserveEntities(EntityStore& store, EntityArchetype archetype, u32 count);
+// O(1), does nothing for a stale handle
+void RemoveEntity(EntityStore& store, EntityHandle handle);
+bool IsEntityAlive(const EntityStore& store, EntityHandle handle);
+
+inline EntityArchetypeStorage& GetArchetype(EntityStore& store, EntityArchetype archetype) { return store.archetypes[archetype]; }
+
+// The archetype and row the entity lives in right now, valid until the next add or remove
+EntityArchetypeStorage& GetEntityArchetype(EntityStore& store, EntityHandle handle, u32& row);
+// Same for an entity expected in one archetype, ENTITY_ROW_NONE if the handle is stale or the entity lives in another
+u32 FindEntityRow(const EntityStore& store, EntityHandle handle, EntityArchetype archetype);
+
+u32 GetEntityCount(const EntityStore& store);
+
+u32 GetEntitySceneNode(EntityStore& store, EntityHandle handle);
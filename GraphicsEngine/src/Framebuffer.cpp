@@ -1,4 +1,6 @@
 #include "Framebuffer.h"
+#include "RenderStats.h"
+#include "GPUMemory.h"
 
 #include "glad/glad.h"
 
@@ -9,6 +11,18 @@ void Framebuffer::Generate()
 
 void Framebuffer::Delete()
 {
+	for (u32 i = 0; i < colorAttachmentHandles.size(); ++i)
+		UntrackGPUAllocation(GPUResourceKind::TEXTURE, colorAttachmentHandles[i]);
+	glDeleteTextures(colorAttachmentHandles.size(), colorAttachmentHandles.data());
+	colorAttachmentHandles.clear();
+
+	if (depthAttachment)
+	{
+		UntrackGPUAllocation(GPUResourceKind::TEXTURE, depthAttachment);
+		glDeleteTextures(1, &depthAttachment);
+		depthAttachment = 0;
+	}
+
 	glDeleteFramebuffers(1, &handle);
 }
 
@@ -16,6 +30,7 @@ void Framebuffer::Bind()
 {
 	// All following read and write framebuffer operations will affect the currently bound framebuffer
 	glBindFramebuffer(GL_FRAMEBUFFER, handle);
+	CountRenderStat(RENDER_COUNTER_FRAMEBUFFER_SWITCHES);
 }
 
 void Framebuffer::CheckStatus()
@@ -60,6 +75,9 @@ void Framebuffer::AttachColorTexture(FBAttachmentType attachmentType, const glm:
 	case FBAttachmentType::COLOR_R:
 		textureHandle = CreateAttachment(GL_COLOR_ATTACHMENT0 + numAttachments, GL_RED, GL_RED, GL_FLOAT, size, clamp);
 		break;
+	case FBAttachmentType::COLOR_RG_FLOAT:
+		textureHandle = CreateAttachment(GL_COLOR_ATTACHMENT0 + numAttachments, GL_RG16F, GL_RG, GL_FLOAT, size, clamp);
+		break;
 	}
 	colorAttachmentHandles.push_back(textureHandle);
 }
@@ -85,18 +103,21 @@ u32 Framebuffer::CreateAttachment(GLenum target, GLint internalFormat, GLenum da
 
 	glFramebufferTexture(GL_FRAMEBUFFER, target, attachmentHandle, 0);
 
+	const char* label = target == GL_DEPTH_ATTACHMENT ? "Depth Attachment" : "Color Attachment";
+	TrackGPUAllocation(GPUResourceKind::TEXTURE, attachmentHandle, GetTextureMemorySize(internalFormat, size.x, size.y), GPU_MEMORY_RENDER_TARGETS, label);
+
 	return attachmentHandle;
 }
 
 void Framebuffer::SetColorBuffers()
 {
-	std::vector<GLuint> buffers;
-	buffers.reserve(colorAttachmentHandles.size());
+	ASSERT(colorAttachmentHandles.size() <= FRAMEBUFFER_MAX_COLOR_ATTACHMENTS, "Too many color attachments");
 
+	GLenum buffers[FRAMEBUFFER_MAX_COLOR_ATTACHMENTS];
 	for (u32 i = 0; i < colorAttachmentHandles.size(); ++i)
-		buffers.emplace_back(GL_COLOR_ATTACHMENT0 + i);
+		buffers[i] = GL_COLOR_ATTACHMENT0 + i;
 
-	glDrawBuffers(colorAttachmentHandles.size(), buffers.data());
+	glDrawBuffers(colorAttachmentHandles.size(), buffers);
 
 	CheckStatus();
 }
\ No newline at end of file
@@ -5,11 +5,14 @@
 typedef int GLint;
 typedef unsigned int GLenum;
 
+#define FRAMEBUFFER_MAX_COLOR_ATTACHMENTS 8 // The minimum GL_MAX_DRAW_BUFFERS
+
 enum class FBAttachmentType
 {
     COLOR_BYTE,
     COLOR_FLOAT,
     COLOR_R,
+    COLOR_RG_FLOAT,
     DEPTH
 };
 
@@ -0,0 +1,216 @@
+#include "GPUMemory.h"
+
+#include "glad/glad.h"
+#include "imgui-docking/imgui.h"
+
+#include <mutex>
+#include <unordered_map>
+
+struct GPUAllocation
+{
+    u64 bytes;
+    GPUMemoryCategory category;
+    std::string label;
+};
+
+struct GPUMemoryTracker
+{
+    std::mutex mutex;
+    std::unordered_map<u64, GPUAllocation> allocations; // Keyed by GetAllocationKey
+    u64 allocated[GPU_MEMORY_CATEGORY_COUNT];
+    i64 used[GPU_MEMORY_CATEGORY_COUNT];
+
+    u64 budget = GPU_MEMORY_DEFAULT_BUDGET;
+    bool overBudget;
+
+    bool hasNVXMemoryInfo;
+    bool hasATIMemInfo;
+};
+
+static GPUMemoryTracker GlobalGPUMemory;
+
+static const char* GPUMemoryCategoryNames[GPU_MEMORY_CATEGORY_COUNT] =
+{
+    "Render Targets",
+    "Textures",
+    "Cubemaps",
+    "Geometry",
+    "Uniform Buffers",
+    "Other"
+};
+
+static u64 GetAllocationKey(GPUResourceKind kind, u32 handle)
+{
+    return (u64(kind) << 32) | handle;
+}
+
+void TrackGPUAllocation(GPUResourceKind kind, u32 handle, u64 bytes, GPUMemoryCategory category, const char* label)
+{
+    std::lock_guard<std::mutex> lock(GlobalGPUMemory.mutex);
+
+    GPUAllocation& allocation = GlobalGPUMemory.allocations[GetAllocationKey(kind, handle)];
+    GlobalGPUMemory.allocated[allocation.category] -= allocation.bytes;
+
+    allocation.bytes = bytes;
+    allocation.category = category;
+    allocation.label = label;
+    GlobalGPUMemory.allocated[category] += bytes;
+}
+
+void UntrackGPUAllocation(GPUResourceKind kind, u32 handle)
+{
+    std::lock_guard<std::mutex> lock(GlobalGPUMemory.mutex);
+
+    auto it = GlobalGPUMemory.allocations.find(GetAllocationKey(kind, handle));
+    if (it == GlobalGPUMemory.allocations.end())
+        return;
+
+    GlobalGPUMemory.allocated[it->second.category] -= it->second.bytes;
+    GlobalGPUMemory.allocations.erase(it);
+}
+
+void AddGPUMemoryUsage(GPUMemoryCategory category, i64 bytes)
+{
+    std::lock_guard<std::mutex> lock(GlobalGPUMemory.mutex);
+    GlobalGPUMemory.used[category] += bytes;
+}
+
+static u32 GetBytesPerPixel(GLenum internalFormat)
+{
+    switch (internalFormat)
+    {
+    case GL_RED:
+    case GL_R8:                 return 1;
+    case GL_RG8:                return 2;
+    case GL_RG16F:
+    case GL_RGB:
+    case GL_RGB8:
+    case GL_RGBA:
+    case GL_RGBA8:
+    case GL_DEPTH_COMPONENT24:
+    case GL_DEPTH_COMPONENT32F:
+    case GL_R32F:               return 4;
+    case GL_RGB16F:
+    case GL_RGBA16F:            return 8;
+    case GL_RGB32F:
+    case GL_RGBA32F:            return 16;
+    default:
+        ELOG("GetTextureMemorySize() - Unknown internal format 0x%X, assuming 4 bytes per pixel\n", internalFormat);
+        return 4;
+    }
+}
+
+u64 GetTextureMemorySize(GLenum internalFormat, u32 width, u32 height, u32 layers, bool mipmaps)
+{
+    u64 bytesPerPixel = GetBytesPerPixel(internalFormat);
+    u64 bytes = 0;
+    do
+    {
+        bytes += u64(width) * height * bytesPerPixel;
+        width = glm::max(width / 2, 1u);
+        height = glm::max(height / 2, 1u);
+    } while (mipmaps && (width > 1 || height > 1));
+
+    // The 1x1 level
+    if (mipmaps)
+        bytes += bytesPerPixel;
+
+    return bytes * layers;
+}
+
+u64 GetGPUMemoryAllocated(GPUMemoryCategory category)
+{
+    std::lock_guard<std::mutex> lock(GlobalGPUMemory.mutex);
+    return GlobalGPUMemory.allocated[category];
+}
+
+u64 GetGPUMemoryAllocated()
+{
+    std::lock_guard<std::mutex> lock(GlobalGPUMemory.mutex);
+    u64 total = 0;
+    for (u32 i = 0; i < GPU_MEMORY_CATEGORY_COUNT; ++i)
+        total += GlobalGPUMemory.allocated[i];
+    return total;
+}
+
+void SetGPUMemoryBudget(u64 bytes)
+{
+    GlobalGPUMemory.budget = bytes;
+    GlobalGPUMemory.overBudget = false;
+}
+
+void InitGPUMemoryTracker(const std::vector<std::string>& extensions)
+{
+    for (u32 i = 0; i < extensions.size(); ++i)
+    {
+        if (extensions[i] == "GL_NVX_gpu_memory_info")
+            GlobalGPUMemory.hasNVXMemoryInfo = true;
+        else if (extensions[i] == "GL_ATI_meminfo")
+            GlobalGPUMemory.hasATIMemInfo = true;
+    }
+}
+
+void CheckGPUMemoryBudget()
+{
+    u64 total = GetGPUMemoryAllocated();
+    bool overBudget = total > GlobalGPUMemory.budget;
+    if (overBudget && !GlobalGPUMemory.overBudget)
+        ELOG("GPU memory budget exceeded: %.2f MB allocated of %.2f MB\n", f64(total) / MB(1), f64(GlobalGPUMemory.budget) / MB(1));
+    GlobalGPUMemory.overBudget = overBudget;
+}
+
+// ------------------------------------------------------------------------------------------------
+// IMGUI //
+// ------------------------------------------------------------------------------------------------
+
+void DrawGPUMemoryImGui()
+{
+    GPUMemoryTracker& tracker = GlobalGPUMemory;
+    const f64 toMB = 1.0 / MB(1);
+
+    u64 total = GetGPUMemoryAllocated();
+    ImVec4 totalColor = tracker.overBudget ? ImVec4(1.0f, 0.3f, 0.3f, 1.0f) : ImVec4(1.0f, 1.0f, 1.0f, 1.0f);
+    ImGui::TextColored(totalColor, "Tracked: %.2f MB of %.2f MB budget", f64(total) * toMB, f64(tracker.budget) * toMB);
+
+    int budgetMB = int(tracker.budget / MB(1));
+    if (ImGui::DragInt("Budget (MB)", &budgetMB, 16.0f, 64, 65536))
+        SetGPUMemoryBudget(u64(budgetMB) * MB(1));
+
+    // Totals reported by the driver, including memory the engine doesn't allocate itself
+    if (tracker.hasNVXMemoryInfo)
+    {
+        GLint dedicatedKB = 0, availableKB = 0;
+        glGetIntegerv(GL_GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX, &dedicatedKB);
+        glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &availableKB);
+        ImGui::Text("Driver (NVX): %.2f MB used of %.2f MB", f64(dedicatedKB - availableKB) / 1024.0, f64(dedicatedKB) / 1024.0);
+    }
+    else if (tracker.hasATIMemInfo)
+    {
+        GLint freeKB[4] = {};
+        glGetIntegerv(GL_TEXTURE_FREE_MEMORY_ATI, freeKB);
+        ImGui::Text("Driver (ATI): %.2f MB free for textures", f64(freeKB[0]) / 1024.0);
+    }
+    else
+        ImGui::TextDisabled("No driver memory query extension available");
+
+    std::lock_guard<std::mutex> lock(tracker.mutex);
+    for (u32 category = 0; category < GPU_MEMORY_CATEGORY_COUNT; ++category)
+    {
+        char header[128];
+        if (tracker.used[category])
+            sprintf(header, "%s: %.2f MB (%.2f MB used)###%s", GPUMemoryCategoryNames[category], f64(tracker.allocated[category]) * toMB, f64(tracker.used[category]) * toMB, GPUMemoryCategoryNames[category]);
+        else
+            sprintf(header, "%s: %.2f MB###%s", GPUMemoryCategoryNames[category], f64(tracker.allocated[category]) * toMB, GPUMemoryCategoryNames[category]);
+
+        if (ImGui::TreeNode(header))
+        {
+            for (auto it = tracker.allocations.begin(); it != tracker.allocations.end(); ++it)
+            {
+                const GPUAllocation& allocation = it->second;
+                if (allocation.category == category)
+                    ImGui::Text("%8.2f MB  %s", f64(allocation.bytes) * toMB, allocation.label.c_str());
+            }
+            ImGui::TreePop();
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "platform.h"
+
+// Driver memory queries, neither extension is part of the generated loader
+#define GL_GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX         0x9047
+#define GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX   0x9048
+#define GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX 0x9049
+#define GL_TEXTURE_FREE_MEMORY_ATI                      0x87FC
+
+#define GPU_MEMORY_DEFAULT_BUDGET MB(512)
+
+typedef unsigned int GLenum;
+
+enum GPUMemoryCategory
+{
+    GPU_MEMORY_RENDER_TARGETS,  // Render graph textures and the temporal history
+    GPU_MEMORY_TEXTURES,
+    GPU_MEMORY_CUBEMAPS,
+    GPU_MEMORY_GEOMETRY,        // Vertex and index pools of the geometry arena
+    GPU_MEMORY_UNIFORM_BUFFERS,
+    GPU_MEMORY_OTHER,
+    GPU_MEMORY_CATEGORY_COUNT
+};
+
+enum class GPUResourceKind
+{
+    BUFFER,
+    TEXTURE,
+    RENDERBUFFER
+};
+
+// Registers the bytes a GL object owns. Tracking the same object again replaces its previous entry.
+// Thread safe, textures are also created by the hot reload thread.
+void TrackGPUAllocation(GPUResourceKind kind, u32 handle, u64 bytes, GPUMemoryCategory category, const char* label);
+void UntrackGPUAllocation(GPUResourceKind kind, u32 handle);
+
+// Bytes sub-allocated inside a category's own allocations, e.g. the models inside the geometry arena pools
+void AddGPUMemoryUsage(GPUMemoryCategory category, i64 bytes);
+
+// Estimated size of a texture level chain. Formats with 3 components are padded to 4, as drivers do.
+u64 GetTextureMemorySize(GLenum internalFormat, u32 width, u32 height, u32 layers = 1, bool mipmaps = false);
+
+u64 GetGPUMemoryAllocated(GPUMemoryCategory category);
+u64 GetGPUMemoryAllocated();
+
+void SetGPUMemoryBudget(u64 bytes);
+
+// Detects the driver memory query extensions
+void InitGPUMemoryTracker(const std::vector<std::string>& extensions);
+
+// Logs once every time the tracked total goes over the budget
+void CheckGPUMemoryBudget();
+
+void DrawGPUMemoryImGui();
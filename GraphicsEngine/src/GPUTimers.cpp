@@ -0,0 +1,262 @@
+#include "GPUTimers.h"
+#include "RenderStats.h"
+
+#include "glad/glad.h"
+#include "imgui-docking/imgui.h"
+
+static const char* GPUPassNames[GPU_PASS_COUNT] =
+{
+    "Geometry",
+    "SSAO",
+    "SSAO Blur X",
+    "SSAO Blur Y",
+    "Lighting",
+    "Temporal Resolve",
+    "Screen Quad",
+    "Light Casters",
+    "Skybox",
+    "Cascade Shadows",
+    "Point Shadows"
+};
+
+static const ImU32 GPUPassColors[GPU_PASS_COUNT] =
+{
+    IM_COL32(230, 100,  80, 255),
+    IM_COL32(240, 190,  70, 255),
+    IM_COL32(180, 200,  80, 255),
+    IM_COL32(150, 190, 100, 255),
+    IM_COL32( 90, 180, 230, 255),
+    IM_COL32( 70, 120, 200, 255),
+    IM_COL32(150, 120, 220, 255),
+    IM_COL32(230, 130, 200, 255),
+    IM_COL32(120, 200, 170, 255),
+    IM_COL32(200, 160, 110, 255),
+    IM_COL32(160, 140, 100, 255)
+};
+
+const char* GetGPUPassName(GPUPass pass)
+{
+    return GPUPassNames[pass];
+}
+
+void InitGPUTimers(GPUTimers& timers)
+{
+    timers = {};
+    glGenQueries(GPU_TIMER_FRAMES * GPU_PASS_COUNT * 2, &timers.queries[0][0][0]);
+}
+
+void DestroyGPUTimers(GPUTimers& timers)
+{
+    glDeleteQueries(GPU_TIMER_FRAMES * GPU_PASS_COUNT * 2, &timers.queries[0][0][0]);
+}
+
+// Reads the timestamps of a frame in flight without waiting. Returns false if the GPU hasn't reached them yet.
+static bool ReadGPUFrame(GPUTimers& timers, u32 slot, float* passTimes)
+{
+    for (u32 pass = 0; pass < GPU_PASS_COUNT; ++pass)
+    {
+        if (!timers.issued[slot][pass])
+            continue;
+
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(timers.queries[slot][pass][1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return false;
+    }
+
+    for (u32 pass = 0; pass < GPU_PASS_COUNT; ++pass)
+    {
+        passTimes[pass] = 0.0f;
+        if (!timers.issued[slot][pass])
+            continue;
+
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(timers.queries[slot][pass][0], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(timers.queries[slot][pass][1], GL_QUERY_RESULT, &end);
+        passTimes[pass] = float(f64(end - begin) * 1e-6);
+    }
+    return true;
+}
+
+static void PushGPUFrame(GPUTimers& timers, const float* passTimes)
+{
+    memcpy(timers.history[timers.historyHead], passTimes, sizeof(timers.history[0]));
+    memcpy(timers.last, passTimes, sizeof(timers.last));
+    timers.historyHead = (timers.historyHead + 1) % GPU_TIMER_HISTORY;
+    if (timers.historyCount < GPU_TIMER_HISTORY)
+        timers.historyCount++;
+
+    for (u32 pass = 0; pass < GPU_PASS_COUNT; ++pass)
+    {
+        float sum = 0.0f;
+        for (u32 i = 0; i < timers.historyCount; ++i)
+            sum += timers.history[i][pass];
+        timers.average[pass] = sum / float(timers.historyCount);
+    }
+}
+
+void BeginGPUFrame(GPUTimers& timers)
+{
+    BeginRenderStatsFrame();
+
+    u32 slot = timers.frameIndex;
+    if (timers.frameIssued[slot])
+    {
+        float passTimes[GPU_PASS_COUNT];
+        if (ReadGPUFrame(timers, slot, passTimes))
+            PushGPUFrame(timers, passTimes);
+        else
+            timers.droppedFrames++;
+    }
+
+    timers.frameIssued[slot] = false;
+    for (u32 pass = 0; pass < GPU_PASS_COUNT; ++pass)
+        timers.issued[slot][pass] = false;
+}
+
+void EndGPUFrame(GPUTimers& timers)
+{
+    EndRenderStatsFrame();
+
+    timers.frameIssued[timers.frameIndex] = true;
+    timers.frameIndex = (timers.frameIndex + 1) % GPU_TIMER_FRAMES;
+}
+
+// Timestamps rather than GL_TIME_ELAPSED, which can't be nested or overlapped
+void BeginGPUPass(GPUTimers& timers, GPUPass pass)
+{
+    glQueryCounter(timers.queries[timers.frameIndex][pass][0], GL_TIMESTAMP);
+    BeginRenderStatsPass(pass);
+}
+
+void EndGPUPass(GPUTimers& timers, GPUPass pass)
+{
+    EndRenderStatsPass(pass);
+    glQueryCounter(timers.queries[timers.frameIndex][pass][1], GL_TIMESTAMP);
+    timers.issued[timers.frameIndex][pass] = true;
+}
+
+float GetGPUFrameAverage(const GPUTimers& timers)
+{
+    float total = 0.0f;
+    for (u32 pass = 0; pass < GPU_PASS_COUNT; ++pass)
+        total += timers.average[pass];
+    return total;
+}
+
+// ------------------------------------------------------------------------------------------------
+// IMGUI //
+// ------------------------------------------------------------------------------------------------
+
+void DrawGPUTimersImGui(GPUTimers& timers)
+{
+    ImGui::Text("GPU Frame (ms): %.3f (avg of %u frames, %u dropped)", GetGPUFrameAverage(timers), timers.historyCount, timers.droppedFrames);
+
+    for (u32 pass = 0; pass < GPU_PASS_COUNT; ++pass)
+    {
+        ImGui::ColorButton(GPUPassNames[pass], ImGui::ColorConvertU32ToFloat4(GPUPassColors[pass]), ImGuiColorEditFlags_NoTooltip, ImVec2(10.0f, 10.0f));
+        ImGui::SameLine();
+        ImGui::Text("%-16s %7.3f avg %7.3f last", GPUPassNames[pass], timers.average[pass], timers.last[pass]);
+    }
+
+    // Stacked graph, oldest frame on the left
+    float maxTotal = 0.001f;
+    for (u32 i = 0; i < timers.historyCount; ++i)
+    {
+        float total = 0.0f;
+        for (u32 pass = 0; pass < GPU_PASS_COUNT; ++pass)
+            total += timers.history[i][pass];
+        maxTotal = glm::max(maxTotal, total);
+    }
+
+    ImVec2 size(ImGui::GetContentRegionAvail().x, 100.0f);
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    drawList->AddRectFilled(origin, ImVec2(origin.x + size.x, origin.y + size.y), IM_COL32(30, 30, 30, 255));
+
+    float barWidth = size.x / float(GPU_TIMER_HISTORY);
+    u32 oldest = (timers.historyHead + GPU_TIMER_HISTORY - timers.historyCount) % GPU_TIMER_HISTORY;
+    for (u32 i = 0; i < timers.historyCount; ++i)
+    {
+        const float* passTimes = timers.history[(oldest + i) % GPU_TIMER_HISTORY];
+        float x = origin.x + float(GPU_TIMER_HISTORY - timers.historyCount + i) * barWidth;
+        float y = origin.y + size.y;
+        for (u32 pass = 0; pass < GPU_PASS_COUNT; ++pass)
+        {
+            float height = passTimes[pass] / maxTotal * size.y;
+            drawList->AddRectFilled(ImVec2(x, y - height), ImVec2(x + barWidth, y), GPUPassColors[pass]);
+            y -= height;
+        }
+    }
+    ImGui::Dummy(size);
+    ImGui::Text("Scale: %.3f ms", maxTotal);
+
+    if (ImGui::Button("Export CSV"))
+        ExportGPUTimersCSV(timers, "GPUTimings.csv");
+    ImGui::SameLine();
+    if (ImGui::Button("Export JSON"))
+        ExportGPUTimersJSON(timers, "GPUTimings.json");
+}
+
+// ------------------------------------------------------------------------------------------------
+// EXPORT //
+// ------------------------------------------------------------------------------------------------
+
+bool ExportGPUTimersCSV(const GPUTimers& timers, const char* filepath)
+{
+    FILE* file = fopen(filepath, "w");
+    if (!file)
+    {
+        ELOG("Couldn't open %s to export the GPU timings", filepath);
+        return false;
+    }
+
+    fprintf(file, "frame");
+    for (u32 pass = 0; pass < GPU_PASS_COUNT; ++pass)
+        fprintf(file, ",%s", GPUPassNames[pass]);
+    fprintf(file, "\n");
+
+    u32 oldest = (timers.historyHead + GPU_TIMER_HISTORY - timers.historyCount) % GPU_TIMER_HISTORY;
+    for (u32 i = 0; i < timers.historyCount; ++i)
+    {
+        const float* passTimes = timers.history[(oldest + i) % GPU_TIMER_HISTORY];
+        fprintf(file, "%u", i);
+        for (u32 pass = 0; pass < GPU_PASS_COUNT; ++pass)
+            fprintf(file, ",%f", passTimes[pass]);
+        fprintf(file, "\n");
+    }
+
+    fclose(file);
+    ILOG("GPU timings exported to %s", filepath);
+    return true;
+}
+
+bool ExportGPUTimersJSON(const GPUTimers& timers, const char* filepath)
+{
+    FILE* file = fopen(filepath, "w");
+    if (!file)
+    {
+        ELOG("Couldn't open %s to export the GPU timings", filepath);
+        return false;
+    }
+
+    fprintf(file, "{\n\t\"unit\": \"ms\",\n\t\"average\": {");
+    for (u32 pass = 0; pass < GPU_PASS_COUNT; ++pass)
+        fprintf(file, "%s\"%s\": %f", pass ? ", " : " ", GPUPassNames[pass], timers.average[pass]);
+    fprintf(file, " },\n\t\"frames\": [\n");
+
+    u32 oldest = (timers.historyHead + GPU_TIMER_HISTORY - timers.historyCount) % GPU_TIMER_HISTORY;
+    for (u32 i = 0; i < timers.historyCount; ++i)
+    {
+        const float* passTimes = timers.history[(oldest + i) % GPU_TIMER_HISTORY];
+        fprintf(file, "\t\t{");
+        for (u32 pass = 0; pass < GPU_PASS_COUNT; ++pass)
+            fprintf(file, "%s\"%s\": %f", pass ? ", " : " ", GPUPassNames[pass], passTimes[pass]);
+        fprintf(file, " }%s\n", i + 1 < timers.historyCount ? "," : "");
+    }
+    fprintf(file, "\t]\n}\n");
+
+    fclose(file);
+    ILOG("GPU timings exported to %s", filepath);
+    return true;
+}
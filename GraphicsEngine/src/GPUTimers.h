@@ -0,0 +1,82 @@
+#pragma once
+
+#include "platform.h"
+
+// Frames of queries in flight. Results are read GPU_TIMER_FRAMES - 1 frames after they were issued,
+// by then the GPU has normally finished them and reading back never stalls the pipeline.
+#define GPU_TIMER_FRAMES 3
+#define GPU_TIMER_HISTORY 120 // Frames kept for the rolling averages and the graph
+
+enum GPUPass
+{
+    GPU_PASS_GEOMETRY,
+    GPU_PASS_SSAO,
+    GPU_PASS_SSAO_BLUR_X, // Separable, one pass per axis
+    GPU_PASS_SSAO_BLUR_Y,
+    GPU_PASS_LIGHTING,
+    GPU_PASS_TEMPORAL_RESOLVE,
+    GPU_PASS_SCREEN_QUAD,
+    GPU_PASS_LIGHT_CASTERS,
+    GPU_PASS_SKYBOX,
+    GPU_PASS_CASCADE_SHADOWS,
+    GPU_PASS_POINT_SHADOWS,
+    GPU_PASS_COUNT
+};
+
+struct GPUTimers
+{
+    // GL_TIMESTAMP queries at the start and end of every pass, for each frame in flight
+    u32 queries[GPU_TIMER_FRAMES][GPU_PASS_COUNT][2];
+    bool issued[GPU_TIMER_FRAMES][GPU_PASS_COUNT];
+    bool frameIssued[GPU_TIMER_FRAMES];
+    u32 frameIndex;
+
+    // Milliseconds per pass, 0 when the pass didn't run that frame
+    float history[GPU_TIMER_HISTORY][GPU_PASS_COUNT];
+    u32 historyHead; // Next entry to write
+    u32 historyCount;
+    u32 droppedFrames; // Results that weren't available in time and were skipped
+
+    float last[GPU_PASS_COUNT];
+    float average[GPU_PASS_COUNT];
+};
+
+const char* GetGPUPassName(GPUPass pass);
+
+void InitGPUTimers(GPUTimers& timers);
+void DestroyGPUTimers(GPUTimers& timers);
+
+// Collects the results of the oldest frame in flight, then starts recording into its queries
+void BeginGPUFrame(GPUTimers& timers);
+void EndGPUFrame(GPUTimers& timers);
+
+void BeginGPUPass(GPUTimers& timers, GPUPass pass);
+void EndGPUPass(GPUTimers& timers, GPUPass pass);
+
+// Sum of the pass averages
+float GetGPUFrameAverage(const GPUTimers& timers);
+
+// Rolling averages per pass and a stacked graph of the history
+void DrawGPUTimersImGui(GPUTimers& timers);
+
+// The whole history, oldest frame first
+bool ExportGPUTimersCSV(const GPUTimers& timers, const char* filepath);
+bool ExportGPUTimersJSON(const GPUTimers& timers, const char* filepath);
+
+class GPUPassScope
+{
+public:
+    GPUPassScope(GPUTimers& timers, GPUPass pass) : m_Timers(timers), m_Pass(pass)
+    {
+        BeginGPUPass(m_Timers, m_Pass);
+    }
+
+    ~GPUPassScope()
+    {
+        EndGPUPass(m_Timers, m_Pass);
+    }
+
+private:
+    GPUTimers& m_Timers;
+    GPUPass m_Pass;
+};
@@ -0,0 +1,318 @@
+#include "GeometryArena.h"
+
+#include "Entity.h"
+#include "RenderStats.h"
+#include "GPUMemory.h"
+
+#include "glad/glad.h"
+
+#include <algorithm>
+
+// ------------------------------------------------------------------------------------------------
+// FREE-LIST ALLOCATOR //
+// ------------------------------------------------------------------------------------------------
+
+void InitArenaAllocator(ArenaAllocator& allocator, u32 capacity)
+{
+    allocator.capacity = capacity;
+    allocator.freeBlocks.clear();
+    allocator.freeBlocks.push_back({ 0, capacity });
+}
+
+bool AllocateArenaBlock(ArenaAllocator& allocator, u32 size, u32& offset)
+{
+    // First fit keeps the allocations packed at the start of the buffer
+    for (u32 i = 0; i < allocator.freeBlocks.size(); ++i)
+    {
+        ArenaBlock& block = allocator.freeBlocks[i];
+        if (block.size < size)
+            continue;
+
+        offset = block.offset;
+        block.offset += size;
+        block.size -= size;
+
+        if (block.size == 0)
+            allocator.freeBlocks.erase(allocator.freeBlocks.begin() + i);
+
+        return true;
+    }
+    return false;
+}
+
+void FreeArenaBlock(ArenaAllocator& allocator, u32 offset, u32 size)
+{
+    if (size == 0)
+        return;
+
+    std::vector<ArenaBlock>& blocks = allocator.freeBlocks;
+    auto it = std::lower_bound(blocks.begin(), blocks.end(), offset, [](const ArenaBlock& block, u32 value) { return block.offset < value; });
+    it = blocks.insert(it, { offset, size });
+
+    // Merge with the next block
+    auto next = it + 1;
+    if (next != blocks.end() && it->offset + it->size == next->offset)
+    {
+        it->size += next->size;
+        blocks.erase(next);
+    }
+
+    // Merge with the previous block
+    if (it != blocks.begin())
+    {
+        auto prev = it - 1;
+        if (prev->offset + prev->size == it->offset)
+        {
+            prev->size += it->size;
+            blocks.erase(it);
+        }
+    }
+}
+
+// Grows the allocator to newCapacity, the new space is appended to the free list
+static void GrowArenaAllocator(ArenaAllocator& allocator, u32 newCapacity)
+{
+    u32 oldCapacity = allocator.capacity;
+    allocator.capacity = newCapacity;
+    FreeArenaBlock(allocator, oldCapacity, newCapacity - oldCapacity);
+}
+
+// ------------------------------------------------------------------------------------------------
+// GEOMETRY ARENA //
+// ------------------------------------------------------------------------------------------------
+
+static void CopyBufferData(u32 readHandle, u32 writeHandle, u32 readOffset, u32 writeOffset, u32 size)
+{
+    glBindBuffer(GL_COPY_READ_BUFFER, readHandle);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, writeHandle);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, readOffset, writeOffset, size);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+static void GrowBuffer(Buffer& buffer, u32 newSize)
+{
+    Buffer newBuffer = CreateBuffer(newSize, buffer.type, GL_STATIC_DRAW);
+    CopyBufferData(buffer.handle, newBuffer.handle, 0, 0, buffer.size);
+    DeleteBuffer(buffer);
+    buffer = newBuffer;
+}
+
+static bool SameVertexLayout(const VertexBufferLayout& a, const VertexBufferLayout& b)
+{
+    if (a.stride != b.stride || a.attributes.size() != b.attributes.size())
+        return false;
+
+    for (u32 i = 0; i < a.attributes.size(); ++i)
+    {
+        const VertexBufferAttribute& attributeA = a.attributes[i];
+        const VertexBufferAttribute& attributeB = b.attributes[i];
+        if (attributeA.location != attributeB.location || attributeA.componentCount != attributeB.componentCount || attributeA.offset != attributeB.offset)
+            return false;
+    }
+    return true;
+}
+
+static u32 FindVertexFormat(GeometryArena& arena, const VertexBufferLayout& layout)
+{
+    for (u32 i = 0; i < arena.vertexFormats.size(); ++i)
+        if (SameVertexLayout(arena.vertexFormats[i].layout, layout))
+            return i;
+
+    // --- If the format wasn't found, create a new VAO describing it
+    VertexFormat format = {};
+    format.layout = layout;
+
+    glGenVertexArrays(1, &format.VAO);
+    glBindVertexArray(format.VAO);
+
+    for (u32 i = 0; i < layout.attributes.size(); ++i)
+    {
+        const VertexBufferAttribute& attribute = layout.attributes[i];
+        glEnableVertexAttribArray(attribute.location);
+        glVertexAttribFormat(attribute.location, attribute.componentCount, GL_FLOAT, GL_FALSE, attribute.offset);
+        glVertexAttribBinding(attribute.location, 0);
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena.indexBuffer.handle);
+
+    glBindVertexArray(0);
+
+    arena.vertexFormats.push_back(format);
+
+    return arena.vertexFormats.size() - 1;
+}
+
+static u32 FindVertexPool(GeometryArena& arena, u32 stride)
+{
+    for (u32 i = 0; i < arena.vertexPools.size(); ++i)
+        if (arena.vertexPools[i].stride == stride)
+            return i;
+
+    VertexPool pool = {};
+    pool.stride = stride;
+    pool.buffer = CreateStaticVertexBuffer(GEOMETRY_ARENA_VERTEX_POOL_SIZE);
+    InitArenaAllocator(pool.allocator, GEOMETRY_ARENA_VERTEX_POOL_SIZE / stride);
+    arena.vertexPools.push_back(pool);
+
+    return arena.vertexPools.size() - 1;
+}
+
+void InitGeometryArena(GeometryArena& arena)
+{
+    arena.indexBuffer = CreateStaticIndexBuffer(GEOMETRY_ARENA_INDEX_BUFFER_SIZE);
+    InitArenaAllocator(arena.indexAllocator, GEOMETRY_ARENA_INDEX_BUFFER_SIZE / sizeof(u32));
+    arena.fragmented = false;
+}
+
+void AllocateMesh(GeometryArena& arena, Mesh& mesh)
+{
+    const u32 stride = mesh.VBLayout.stride;
+
+    mesh.vertexFormatIndex = FindVertexFormat(arena, mesh.VBLayout);
+    mesh.vertexPoolIndex = FindVertexPool(arena, stride);
+    mesh.vertexCount = mesh.vertices.size() * sizeof(float) / stride;
+    mesh.indexCount = mesh.indices.size();
+
+    // Vertices
+    VertexPool& pool = arena.vertexPools[mesh.vertexPoolIndex];
+    while (!AllocateArenaBlock(pool.allocator, mesh.vertexCount, mesh.baseVertex))
+    {
+        u32 newCapacity = pool.allocator.capacity * 2;
+        GrowBuffer(pool.buffer, newCapacity * stride);
+        GrowArenaAllocator(pool.allocator, newCapacity);
+    }
+    pool.meshes.push_back(&mesh);
+
+    glBindBuffer(GL_ARRAY_BUFFER, pool.buffer.handle);
+    glBufferSubData(GL_ARRAY_BUFFER, mesh.baseVertex * stride, mesh.vertexCount * stride, mesh.vertices.data());
+    CountRenderStat(RENDER_COUNTER_BYTES_UPLOADED, mesh.vertexCount * stride);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // Indices
+    while (!AllocateArenaBlock(arena.indexAllocator, mesh.indexCount, mesh.firstIndex))
+    {
+        u32 newCapacity = arena.indexAllocator.capacity * 2;
+        GrowBuffer(arena.indexBuffer, newCapacity * sizeof(u32));
+        GrowArenaAllocator(arena.indexAllocator, newCapacity);
+
+        // The element buffer is part of the VAO state
+        for (u32 i = 0; i < arena.vertexFormats.size(); ++i)
+        {
+            glBindVertexArray(arena.vertexFormats[i].VAO);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena.indexBuffer.handle);
+        }
+        glBindVertexArray(0);
+    }
+    arena.meshes.push_back(&mesh);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, arena.indexBuffer.handle);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, mesh.firstIndex * sizeof(u32), mesh.indexCount * sizeof(u32), mesh.indices.data());
+    CountRenderStat(RENDER_COUNTER_BYTES_UPLOADED, mesh.indexCount * sizeof(u32));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    AddGPUMemoryUsage(GPU_MEMORY_GEOMETRY, i64(mesh.vertexCount) * stride + i64(mesh.indexCount) * sizeof(u32));
+}
+
+void FreeMesh(GeometryArena& arena, Mesh& mesh)
+{
+    VertexPool& pool = arena.vertexPools[mesh.vertexPoolIndex];
+    FreeArenaBlock(pool.allocator, mesh.baseVertex, mesh.vertexCount);
+    pool.meshes.erase(std::find(pool.meshes.begin(), pool.meshes.end(), &mesh));
+
+    FreeArenaBlock(arena.indexAllocator, mesh.firstIndex, mesh.indexCount);
+    arena.meshes.erase(std::find(arena.meshes.begin(), arena.meshes.end(), &mesh));
+
+    AddGPUMemoryUsage(GPU_MEMORY_GEOMETRY, -(i64(mesh.vertexCount) * pool.stride + i64(mesh.indexCount) * sizeof(u32)));
+
+    arena.fragmented = true;
+}
+
+void BindMeshGeometry(const GeometryArena& arena, const Mesh& mesh, GeometryBindState& bindState)
+{
+    const VertexFormat& format = arena.vertexFormats[mesh.vertexFormatIndex];
+    if (bindState.VAO != format.VAO)
+    {
+        glBindVertexArray(format.VAO);
+        CountRenderStat(RENDER_COUNTER_VAO_BINDS);
+        bindState.VAO = format.VAO;
+        bindState.vertexBuffer = 0;
+    }
+
+    // The base vertex of the draw call selects the mesh inside the pool, so the binding offset is always 0
+    const VertexPool& pool = arena.vertexPools[mesh.vertexPoolIndex];
+    if (bindState.vertexBuffer != pool.buffer.handle)
+    {
+        glBindVertexBuffer(0, pool.buffer.handle, 0, pool.stride);
+        bindState.vertexBuffer = pool.buffer.handle;
+    }
+}
+
+// Relocates the highest allocation that fits into a lower hole. Returns the bytes moved, or 0 if nothing could be moved.
+static u32 CompactOnce(ArenaAllocator& allocator, std::vector<Mesh*>& meshes, u32 Mesh::* offsetMember, u32 Mesh::* sizeMember, u32 bufferHandle, u32 elementSize)
+{
+    Mesh* candidate = nullptr;
+    for (u32 i = 0; i < meshes.size(); ++i)
+    {
+        Mesh* mesh = meshes[i];
+        if (candidate && mesh->*offsetMember < candidate->*offsetMember)
+            continue;
+
+        for (u32 j = 0; j < allocator.freeBlocks.size(); ++j)
+        {
+            const ArenaBlock& block = allocator.freeBlocks[j];
+            if (block.offset >= mesh->*offsetMember)
+                break;
+            if (block.size >= mesh->*sizeMember)
+            {
+                candidate = mesh;
+                break;
+            }
+        }
+    }
+
+    if (!candidate)
+        return 0;
+
+    u32 oldOffset = candidate->*offsetMember;
+    u32 size = candidate->*sizeMember;
+
+    // First fit picks the lowest hole, which lies entirely below the old range so the copy never overlaps
+    u32 newOffset = 0;
+    AllocateArenaBlock(allocator, size, newOffset);
+    ASSERT(newOffset < oldOffset, "The allocation should have moved down");
+
+    CopyBufferData(bufferHandle, bufferHandle, oldOffset * elementSize, newOffset * elementSize, size * elementSize);
+    FreeArenaBlock(allocator, oldOffset, size);
+    candidate->*offsetMember = newOffset;
+
+    return size * elementSize;
+}
+
+void DefragmentGeometryArena(GeometryArena& arena, u32 maxBytes)
+{
+    if (!arena.fragmented)
+        return;
+
+    u32 bytesMoved = 0;
+    bool moved = true;
+    while (moved && bytesMoved < maxBytes)
+    {
+        moved = false;
+
+        for (u32 i = 0; i < arena.vertexPools.size(); ++i)
+        {
+            VertexPool& pool = arena.vertexPools[i];
+            u32 bytes = CompactOnce(pool.allocator, pool.meshes, &Mesh::baseVertex, &Mesh::vertexCount, pool.buffer.handle, pool.stride);
+            bytesMoved += bytes;
+            moved |= bytes > 0;
+        }
+
+        u32 bytes = CompactOnce(arena.indexAllocator, arena.meshes, &Mesh::firstIndex, &Mesh::indexCount, arena.indexBuffer.handle, sizeof(u32));
+        bytesMoved += bytes;
+        moved |= bytes > 0;
+    }
+
+    // Nothing left to move: every pool is packed as much as first fit allows
+    if (!moved)
+        arena.fragmented = false;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "platform.h"
+#include "BufferManagement.h"
+#include "Layouts.h"
+
+#define GEOMETRY_ARENA_VERTEX_POOL_SIZE MB(16)
+#define GEOMETRY_ARENA_INDEX_BUFFER_SIZE MB(8)
+#define GEOMETRY_ARENA_DEFRAG_BUDGET KB(256) // Bytes moved per frame while the arena is fragmented
+
+struct Mesh;
+
+struct ArenaBlock
+{
+    u32 offset;
+    u32 size;
+};
+
+// Free-list sub-allocator. Offsets and sizes are in elements (vertices or indices), not bytes.
+struct ArenaAllocator
+{
+    u32 capacity;
+    std::vector<ArenaBlock> freeBlocks; // Sorted by offset, adjacent blocks are always merged
+};
+
+// One VAO per vertex layout, shared by every mesh with that layout and independent of the shader program.
+// The attributes are read from binding point 0, which is pointed to the mesh vertex pool at draw time.
+struct VertexFormat
+{
+    VertexBufferLayout layout;
+    u32 VAO;
+};
+
+// All vertices with the same stride live in the same vertex buffer, so a mesh is addressed by its base vertex
+struct VertexPool
+{
+    u32 stride;
+    Buffer buffer;
+    ArenaAllocator allocator;
+    std::vector<Mesh*> meshes;
+};
+
+struct GeometryArena
+{
+    std::vector<VertexFormat> vertexFormats;
+    std::vector<VertexPool> vertexPools;
+
+    Buffer indexBuffer;
+    ArenaAllocator indexAllocator;
+    std::vector<Mesh*> meshes;
+
+    bool fragmented;
+};
+
+// Currently bound geometry, reset it to zero whenever something else binds a VAO
+struct GeometryBindState
+{
+    u32 VAO;
+    u32 vertexBuffer;
+};
+
+void InitArenaAllocator(ArenaAllocator& allocator, u32 capacity);
+bool AllocateArenaBlock(ArenaAllocator& allocator, u32 size, u32& offset);
+void FreeArenaBlock(ArenaAllocator& allocator, u32 offset, u32 size);
+
+void InitGeometryArena(GeometryArena& arena);
+
+// Uploads the mesh vertices and indices, filling its vertex pool, base vertex and first index
+void AllocateMesh(GeometryArena& arena, Mesh& mesh);
+void FreeMesh(GeometryArena& arena, Mesh& mesh);
+
+// Binds the VAO of the mesh vertex format and points its vertex buffer binding to the mesh pool.
+// Nothing is rebound when the previous mesh shared the same format and pool.
+void BindMeshGeometry(const GeometryArena& arena, const Mesh& mesh, GeometryBindState& bindState);
+
+// Moves allocations down into the holes left by freed meshes, up to maxBytes per call
+void DefragmentGeometryArena(GeometryArena& arena, u32 maxBytes = GEOMETRY_ARENA_DEFRAG_BUDGET);
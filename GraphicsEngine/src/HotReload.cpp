@@ -0,0 +1,301 @@
+#include "HotReload.h"
+
+#include "engine.h"
+#include "Shader.h"
+#include "AssimpLoading.h"
+#include "Profiler.h"
+#include "GPUMemory.h"
+#include "AllocationTracker.h"
+
+#include "glad/glad.h"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+static std::string NormalizePath(const std::string& filepath)
+{
+    std::string path = filepath;
+    std::replace(path.begin(), path.end(), '\\', '/');
+    return path;
+}
+
+static void WatchResource(HotReloader& reloader, HotReloadResource& resource)
+{
+    resource.filepath = NormalizePath(resource.filepath);
+    WatchFile(resource.filepath.c_str());
+
+    std::lock_guard<std::mutex> lock(reloader.mutex);
+    reloader.resources.push_back(resource);
+}
+
+// ------------------------------------------------------------------------------------------------
+// LOADER THREAD //
+// ------------------------------------------------------------------------------------------------
+
+// ReadTextFile allocates from the frame arena, recycled two frames later, and a shader build can take longer than that
+static bool ReadWholeFile(const char* filepath, std::string& text)
+{
+    std::ifstream file(filepath, std::ios::in | std::ios::binary);
+    if (!file)
+    {
+        ELOG("Hot reload: could not open file %s\n", filepath);
+        return false;
+    }
+
+    std::stringstream stream;
+    stream << file.rdbuf();
+    text = stream.str();
+    return true;
+}
+
+// Rebuilds every variant of the shader. Returns false, keeping the old programs running, if any of them is broken.
+static bool ReloadShaderProgram(const HotReloadResource& resource, HotReloadResult& result)
+{
+    if (!ReadWholeFile(resource.filepath.c_str(), result.shaderSource))
+        return false;
+
+    String programSource = { &result.shaderSource[0], (u32)result.shaderSource.size() };
+
+    // Submit every variant before waiting on any of them
+    std::vector<ShaderProgramBuild> builds;
+    for (u32 i = 0; i < resource.variantFeatures.size(); ++i)
+        builds.push_back(BeginShaderProgram(programSource, resource.programName.c_str(), resource.variantFeatures[i]));
+
+    bool success = true;
+    for (u32 i = 0; i < builds.size(); ++i)
+    {
+        u32 programHandle = FinishShaderProgram(builds[i]);
+
+        GLint linked;
+        glGetProgramiv(programHandle, GL_LINK_STATUS, &linked);
+        success &= linked == GL_TRUE;
+
+        result.variantFeatures.push_back(resource.variantFeatures[i]);
+        result.variantHandles.push_back(programHandle);
+    }
+
+    if (!success)
+    {
+        for (u32 i = 0; i < result.variantHandles.size(); ++i)
+            glDeleteProgram(result.variantHandles[i]);
+    }
+
+    return success;
+}
+
+static void ReloadResource(HotReloader& reloader, const HotReloadResource& resource)
+{
+    PROFILE_FUNCTION();
+
+    HotReloadResult result = {};
+    result.type = resource.type;
+    result.index = resource.index;
+    result.model = resource.model;
+
+    switch (resource.type)
+    {
+    case HotReloadType::SHADER:
+        if (!ReloadShaderProgram(resource, result))
+            return;
+        break;
+    case HotReloadType::TEXTURE:
+        result.handle = CreateTexture2DFromFile(resource.filepath.c_str(), resource.isFlipped);
+        if (!result.handle)
+            return;
+        break;
+    case HotReloadType::MODEL:
+        result.reloadedModel = std::make_unique<Model>();
+        if (!ImportModelGeometry(resource.filepath.c_str(), *result.reloadedModel, resource.baseMaterialIndex))
+            return;
+        break;
+    }
+
+    // The main context must see the finished objects before using them
+    glFinish();
+
+    std::lock_guard<std::mutex> lock(reloader.mutex);
+    reloader.completed.push_back(std::move(result));
+}
+
+static void HotReloadThread(HotReloader* reloader)
+{
+    SetProfilerThreadName("Hot Reload");
+    AllocationScope allocationScope(ALLOCATION_SUBSYSTEM_LOADING);
+    MakeLoaderContextCurrent();
+
+    std::string filepath;
+    while (WaitForFileChange(filepath))
+    {
+        std::vector<HotReloadResource> changed;
+        {
+            std::lock_guard<std::mutex> lock(reloader->mutex);
+            for (u32 i = 0; i < reloader->resources.size(); ++i)
+                if (reloader->resources[i].filepath == filepath)
+                    changed.push_back(reloader->resources[i]);
+        }
+
+        for (u32 i = 0; i < changed.size(); ++i)
+        {
+            ILOG("Hot reloading %s\n", filepath.c_str());
+            ReloadResource(*reloader, changed[i]);
+        }
+    }
+
+    ReleaseLoaderContext();
+}
+
+// ------------------------------------------------------------------------------------------------
+// MAIN THREAD //
+// ------------------------------------------------------------------------------------------------
+
+void InitHotReload(App* app)
+{
+    HotReloader& reloader = app->hotReloader;
+
+    for (u32 i = 0; i < app->shaderPrograms.size(); ++i)
+    {
+        HotReloadResource resource = {};
+        resource.filepath = app->shaderPrograms[i].filepath;
+        resource.type = HotReloadType::SHADER;
+        resource.index = i;
+        resource.programName = app->shaderPrograms[i].programName;
+        app->shaderPrograms[i].GetVariantFeatures(resource.variantFeatures);
+        WatchResource(reloader, resource);
+    }
+
+    for (u32 i = 0; i < app->textures.size(); ++i)
+    {
+        HotReloadResource resource = {};
+        resource.filepath = app->textures[i].filepath;
+        resource.type = HotReloadType::TEXTURE;
+        resource.index = i;
+        resource.isFlipped = app->textures[i].isFlipped;
+        WatchResource(reloader, resource);
+    }
+
+    for (u32 i = 0; i < app->models.size(); ++i)
+    {
+        Model* model = app->models[i].get();
+        if (model->filepath.empty())
+            continue;
+
+        HotReloadResource resource = {};
+        resource.filepath = model->filepath;
+        resource.type = HotReloadType::MODEL;
+        resource.model = model;
+        resource.baseMaterialIndex = model->baseMaterialIndex;
+        WatchResource(reloader, resource);
+    }
+
+    reloader.worker = std::thread(HotReloadThread, &reloader);
+}
+
+static bool IsModelLoaded(App* app, Model* model)
+{
+    for (u32 i = 0; i < app->models.size(); ++i)
+        if (app->models[i].get() == model)
+            return true;
+    return false;
+}
+
+void ApplyHotReloads(App* app)
+{
+    HotReloader& reloader = app->hotReloader;
+
+    std::vector<HotReloadResult> completed;
+    {
+        std::lock_guard<std::mutex> lock(reloader.mutex);
+
+        // Variants are only ever added, so a count mismatch is enough to detect new ones
+        for (u32 i = 0; i < reloader.resources.size(); ++i)
+        {
+            HotReloadResource& resource = reloader.resources[i];
+            if (resource.type != HotReloadType::SHADER)
+                continue;
+
+            const Shader& shader = app->shaderPrograms[resource.index];
+            if (resource.variantFeatures.size() != shader.GetVariantCount())
+                shader.GetVariantFeatures(resource.variantFeatures);
+        }
+
+        if (reloader.completed.empty())
+            return;
+        completed.swap(reloader.completed);
+    }
+
+    for (u32 i = 0; i < completed.size(); ++i)
+    {
+        HotReloadResult& result = completed[i];
+        switch (result.type)
+        {
+        case HotReloadType::SHADER:
+            app->shaderPrograms[result.index].Reload(result.shaderSource, result.variantFeatures, result.variantHandles);
+            break;
+        case HotReloadType::TEXTURE:
+        {
+            Texture& texture = app->textures[result.index];
+            UntrackGPUAllocation(GPUResourceKind::TEXTURE, texture.handle);
+            glDeleteTextures(1, &texture.handle);
+            texture.handle = result.handle;
+            break;
+        }
+        case HotReloadType::MODEL:
+        {
+            // The model may have been unloaded while it was being imported. An evicted one is imported again when streamed in.
+            if (!IsModelLoaded(app, result.model) || !result.model->isResident)
+                break;
+
+            Model& model = *result.model;
+            for (u32 j = 0; j < model.meshes.size(); ++j)
+                FreeMesh(app->geometryArena, model.meshes[j]);
+
+            model.meshes = std::move(result.reloadedModel->meshes);
+            model.materialIDs = std::move(result.reloadedModel->materialIDs);
+
+            for (u32 j = 0; j < model.meshes.size(); ++j)
+                AllocateMesh(app->geometryArena, model.meshes[j]);
+            ComputeModelBounds(model);
+            break;
+        }
+        }
+    }
+}
+
+void UnwatchModel(App* app, Model* model)
+{
+    HotReloader& reloader = app->hotReloader;
+    std::lock_guard<std::mutex> lock(reloader.mutex);
+
+    reloader.resources.erase(std::remove_if(reloader.resources.begin(), reloader.resources.end(),
+        [model](const HotReloadResource& resource) { return resource.model == model; }), reloader.resources.end());
+
+    reloader.completed.erase(std::remove_if(reloader.completed.begin(), reloader.completed.end(),
+        [model](const HotReloadResult& result) { return result.model == model; }), reloader.completed.end());
+}
+
+void ShutdownHotReload(App* app)
+{
+    HotReloader& reloader = app->hotReloader;
+
+    StopFileWatcher();
+    if (reloader.worker.joinable())
+        reloader.worker.join();
+
+    // Objects finished after the last frame are never swapped in
+    for (u32 i = 0; i < reloader.completed.size(); ++i)
+    {
+        HotReloadResult& result = reloader.completed[i];
+        if (result.type == HotReloadType::SHADER)
+        {
+            for (u32 j = 0; j < result.variantHandles.size(); ++j)
+                glDeleteProgram(result.variantHandles[j]);
+        }
+        else if (result.type == HotReloadType::TEXTURE)
+        {
+            UntrackGPUAllocation(GPUResourceKind::TEXTURE, result.handle);
+            glDeleteTextures(1, &result.handle);
+        }
+    }
+    reloader.completed.clear();
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "platform.h"
+
+#include <memory>
+#include <mutex>
+#include <thread>
+
+struct App;
+struct Model;
+
+enum class HotReloadType
+{
+    SHADER,
+    TEXTURE,
+    MODEL
+};
+
+struct HotReloadResource
+{
+    std::string filepath; // Normalized with '/' separators, as reported by the file watcher
+    HotReloadType type;
+
+    u32 index;    // Shader program or texture index
+    Model* model;
+
+    // Everything the loader thread needs to rebuild the resource without touching the App
+    std::string programName;
+    std::vector<u32> variantFeatures; // Kept in sync with the shader variants by the main thread
+    bool isFlipped;
+    u32 baseMaterialIndex;
+};
+
+// Resource rebuilt in the loader context, waiting to be swapped in by the main thread
+struct HotReloadResult
+{
+    HotReloadType type;
+    u32 index;
+    Model* model;
+
+    u32 handle;
+    std::unique_ptr<Model> reloadedModel;
+
+    std::string shaderSource;
+    std::vector<u32> variantFeatures;
+    std::vector<u32> variantHandles;
+};
+
+struct HotReloader
+{
+    std::mutex mutex;
+    std::vector<HotReloadResource> resources;
+    std::vector<HotReloadResult> completed;
+
+    std::thread worker;
+};
+
+// Registers the loaded shaders, textures and models and starts the loader thread
+void InitHotReload(App* app);
+
+// Swaps the resources finished by the loader thread, called once per frame from the main thread
+void ApplyHotReloads(App* app);
+
+// Stops watching a model before it is destroyed
+void UnwatchModel(App* app, Model* model);
+
+void ShutdownHotReload(App* app);
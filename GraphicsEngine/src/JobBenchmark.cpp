@@ -0,0 +1,241 @@
+#include "JobBenchmark.h"
+
+#include "engine.h"
+#include "JobSystem.h"
+#include "SphericalHarmonics.h"
+#include "Profiler.h"
+#include "Timer.h"
+
+#include "imgui-docking/imgui.h"
+
+#include <thread>
+
+// Cheap workloads are repeated so the timings are above the timer resolution
+static const u32 JobWorkloadIterations[JOB_WORKLOAD_COUNT] = { 16, 16, 1, 2 };
+
+static const char* JobWorkloadNames[JOB_WORKLOAD_COUNT] =
+{
+    "Transforms + Constants",
+    "Culling",
+    "Decoding",
+    "SH Irradiance"
+};
+
+struct JobBenchmarkResult
+{
+    u32 workerCount;
+    f64 times[JOB_WORKLOAD_COUNT]; // ms per iteration, 0 if the workload had no input
+};
+
+struct JobBenchmark
+{
+    std::vector<JobBenchmarkResult> results;
+    u32 entityCount;
+    u32 imageCount;
+};
+
+static JobBenchmark GlobalJobBenchmark;
+
+// Inputs shared by every run, so only the worker count changes between them
+struct JobBenchmarkInputs
+{
+    EntityStore entities;
+    std::vector<u8> blocks;
+    u32 blockStride;
+    glm::mat4 VPMatrix;
+    glm::mat4 previousVPMatrix;
+
+    std::vector<std::string> imagePaths;
+    std::vector<bool> imageFlips;
+    Image environment;
+};
+
+static void RunWorkload(JobBenchmarkWorkload workload, JobBenchmarkInputs& inputs)
+{
+    switch (workload)
+    {
+    case JOB_WORKLOAD_TRANSFORMS:
+    {
+        EntityArchetypeStorage& meshes = GetArchetype(inputs.entities, ENTITY_ARCHETYPE_MESH);
+        WriteLocalParameters(meshes, meshes.modelMatrices.data(), inputs.blocks.data(), inputs.blockStride, 0, inputs.VPMatrix, inputs.previousVPMatrix);
+        break;
+    }
+    case JOB_WORKLOAD_CULLING:
+    {
+        EntityArchetypeStorage& meshes = GetArchetype(inputs.entities, ENTITY_ARCHETYPE_MESH);
+        CullEntities(meshes, meshes.modelMatrices.data(), inputs.VPMatrix);
+        break;
+    }
+    case JOB_WORKLOAD_DECODING:
+    {
+        // Flipped and not flipped images are decoded in two batches, as models do
+        for (u32 flip = 0; flip < 2; ++flip)
+        {
+            std::vector<std::string> paths;
+            for (u32 i = 0; i < inputs.imagePaths.size(); ++i)
+                if (inputs.imageFlips[i] == (flip == 1))
+                    paths.push_back(inputs.imagePaths[i]);
+
+            std::vector<Image> images;
+            DecodeImages(paths, flip == 1, images);
+            for (u32 i = 0; i < images.size(); ++i)
+                FreeImage(images[i]);
+        }
+        break;
+    }
+    case JOB_WORKLOAD_SH_IRRADIANCE:
+    {
+        SH9Color sh = ProjectEquirectangularToSH9(inputs.environment);
+        std::vector<float> pixels(6 * 32 * 32 * 3);
+        ComputeIrradianceCubemap(sh, 32, pixels.data());
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+static bool HasWorkloadInput(JobBenchmarkWorkload workload, const JobBenchmarkInputs& inputs)
+{
+    switch (workload)
+    {
+    case JOB_WORKLOAD_DECODING:      return !inputs.imagePaths.empty();
+    case JOB_WORKLOAD_SH_IRRADIANCE: return inputs.environment.pixels != nullptr;
+    default:                         return GetEntityCount(inputs.entities) > 0;
+    }
+}
+
+void RunJobBenchmark(App* app)
+{
+    PROFILE_FUNCTION();
+
+    JobBenchmark& benchmark = GlobalJobBenchmark;
+    JobBenchmarkInputs inputs = {};
+
+    // Copies of the scene entities spread on a grid, the scene itself is never touched
+    const EntityArchetypeStorage& sceneMeshes = GetArchetype(app->entities, ENTITY_ARCHETYPE_MESH);
+    if (sceneMeshes.count > 0)
+    {
+        EntityArchetypeStorage& meshes = GetArchetype(inputs.entities, ENTITY_ARCHETYPE_MESH);
+        for (u32 i = 0; i < JOB_BENCHMARK_ENTITY_COUNT; ++i)
+        {
+            u32 source = i % sceneMeshes.count;
+            glm::vec3 offset = glm::vec3(float(i % 256) - 128.0f, 0.0f, float(i / 256) - 128.0f) * 4.0f;
+
+            u32 row;
+            GetEntityArchetype(inputs.entities, AddEntity(inputs.entities, ENTITY_ARCHETYPE_MESH), row);
+            meshes.models[row] = sceneMeshes.models[source];
+            meshes.shaderIDs[row] = sceneMeshes.shaderIDs[source];
+            meshes.modelMatrices[row] = glm::translate(glm::mat4(1.0f), offset) * sceneMeshes.modelMatrices[source];
+        }
+    }
+    u32 entityCount = GetEntityCount(inputs.entities);
+
+    glm::mat4 projection = app->camera.GetJitteredProjectionMatrix();
+    inputs.VPMatrix = projection * app->camera.GetViewMatrix(app->displaySize);
+    inputs.previousVPMatrix = app->camera.GetPreviousViewProjectionMatrix();
+    inputs.blockStride = Align(sizeof(LocalParameters), app->uniformBufferOffsetAlignment);
+    inputs.blocks.resize(inputs.blockStride * entityCount);
+
+    for (u32 i = 0; i < app->textures.size(); ++i)
+    {
+        const Texture& texture = app->textures[i];
+        if (texture.filepath.empty())
+            continue;
+
+        // The environment is the only HDR image and goes to its own workload
+        bool isHDR = texture.filepath.size() > 4 && texture.filepath.compare(texture.filepath.size() - 4, 4, ".hdr") == 0;
+        if (isHDR && !inputs.environment.pixels)
+        {
+            inputs.environment = LoadImage(texture.filepath.c_str(), texture.isFlipped);
+            continue;
+        }
+
+        inputs.imagePaths.push_back(texture.filepath);
+        inputs.imageFlips.push_back(texture.isFlipped);
+    }
+
+    u32 previousWorkerCount = GetJobWorkerCount();
+    u32 maxWorkerCount = glm::clamp(std::thread::hardware_concurrency(), 1u, u32(JOB_SYSTEM_MAX_WORKERS));
+
+    benchmark.results.clear();
+    benchmark.entityCount = entityCount;
+    benchmark.imageCount = inputs.imagePaths.size();
+
+    for (u32 workerCount = 1; workerCount <= maxWorkerCount; ++workerCount)
+    {
+        SetJobWorkerCount(workerCount);
+
+        JobBenchmarkResult result = {};
+        result.workerCount = workerCount;
+        for (u32 workload = 0; workload < JOB_WORKLOAD_COUNT; ++workload)
+        {
+            if (!HasWorkloadInput(JobBenchmarkWorkload(workload), inputs))
+                continue;
+
+            f64 time = 0.0;
+            {
+                Timer timer(&time);
+                for (u32 iteration = 0; iteration < JobWorkloadIterations[workload]; ++iteration)
+                    RunWorkload(JobBenchmarkWorkload(workload), inputs);
+            }
+            result.times[workload] = time / JobWorkloadIterations[workload];
+        }
+        benchmark.results.push_back(result);
+
+        ILOG("Job benchmark, %u workers: transforms %.3f ms, culling %.3f ms, decoding %.3f ms, SH irradiance %.3f ms", workerCount,
+            result.times[JOB_WORKLOAD_TRANSFORMS], result.times[JOB_WORKLOAD_CULLING], result.times[JOB_WORKLOAD_DECODING], result.times[JOB_WORKLOAD_SH_IRRADIANCE]);
+    }
+
+    if (inputs.environment.pixels)
+        FreeImage(inputs.environment);
+
+    SetJobWorkerCount(previousWorkerCount);
+}
+
+// ------------------------------------------------------------------------------------------------
+// IMGUI //
+// ------------------------------------------------------------------------------------------------
+
+void DrawJobBenchmarkImGui(App* app)
+{
+    JobBenchmark& benchmark = GlobalJobBenchmark;
+
+    if (ImGui::Button("Run Benchmark"))
+        RunJobBenchmark(app);
+    ImGui::SameLine();
+    ImGui::TextDisabled("Stalls the app for a few seconds");
+
+    if (benchmark.results.empty())
+        return;
+
+    ImGui::Text("%u entities, %u images. Time per run in ms, speedup over 1 worker in brackets.", benchmark.entityCount, benchmark.imageCount);
+
+    const ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit;
+    if (ImGui::BeginTable("Job Benchmark", JOB_WORKLOAD_COUNT + 1, flags))
+    {
+        ImGui::TableSetupColumn("Workers");
+        for (u32 workload = 0; workload < JOB_WORKLOAD_COUNT; ++workload)
+            ImGui::TableSetupColumn(JobWorkloadNames[workload]);
+        ImGui::TableHeadersRow();
+
+        const JobBenchmarkResult& baseline = benchmark.results[0];
+        for (u32 i = 0; i < benchmark.results.size(); ++i)
+        {
+            const JobBenchmarkResult& result = benchmark.results[i];
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", result.workerCount);
+            for (u32 workload = 0; workload < JOB_WORKLOAD_COUNT; ++workload)
+            {
+                ImGui::TableNextColumn();
+                if (result.times[workload] > 0.0)
+                    ImGui::Text("%.3f (%.2fx)", result.times[workload], baseline.times[workload] / result.times[workload]);
+                else
+                    ImGui::TextDisabled("-");
+            }
+        }
+        ImGui::EndTable();
+    }
+}
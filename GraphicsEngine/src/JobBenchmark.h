@@ -0,0 +1,22 @@
+#pragma once
+
+#include "platform.h"
+
+struct App;
+
+#define JOB_BENCHMARK_ENTITY_COUNT 65536 // The scene entities are replicated up to this many
+
+enum JobBenchmarkWorkload
+{
+    JOB_WORKLOAD_TRANSFORMS,   // Model, MVP and previous MVP of every entity written as constant buffer blocks
+    JOB_WORKLOAD_CULLING,
+    JOB_WORKLOAD_DECODING,     // Every texture of the scene decoded again from disk
+    JOB_WORKLOAD_SH_IRRADIANCE, // SH projection of the environment and the irradiance cubemap
+    JOB_WORKLOAD_COUNT
+};
+
+// Runs each workload with 1 to N workers, N being the cores of the machine, then restores the worker count.
+// Stalls the app until it finishes.
+void RunJobBenchmark(App* app);
+
+void DrawJobBenchmarkImGui(App* app);
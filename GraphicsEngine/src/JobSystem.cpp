@@ -0,0 +1,303 @@
+#include "JobSystem.h"
+#include "Allocators.h"
+#include "AllocationTracker.h"
+
+#include "imgui-docking/imgui.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+struct Job
+{
+    JobFunction function;
+    void* data;
+    u32 begin;
+    u32 end;
+    JobCounter* counter;
+    AllocationSubsystem subsystem; // Of the thread that queued it
+};
+
+struct JobQueue
+{
+    std::mutex mutex;
+
+    // Ring buffer, a deque would allocate as it grows and shrinks. The owner works on the back, thieves take from the front.
+    Job jobs[JOB_QUEUE_CAPACITY];
+    u32 first;
+    u32 count;
+
+    // Since the job system started, shown in ImGui
+    std::atomic<u64> executed;
+    std::atomic<u64> stolen;
+};
+
+struct JobSystem
+{
+    JobQueue queues[JOB_SYSTEM_MAX_WORKERS];
+    std::vector<std::thread> threads;
+    u32 workerCount = 1;
+
+    // Idle threads sleep until a job is queued
+    std::mutex sleepMutex;
+    std::condition_variable wakeCondition;
+    std::atomic<u32> queuedJobs;
+    bool quit;
+};
+
+static JobSystem GlobalJobSystem;
+
+static thread_local u32 LocalWorkerIndex = 0;
+
+static bool PopJob(JobQueue& queue, Job& job)
+{
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.count == 0)
+        return false;
+
+    job = queue.jobs[(queue.first + --queue.count) % JOB_QUEUE_CAPACITY];
+    return true;
+}
+
+static bool StealJob(JobQueue& queue, Job& job)
+{
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.count == 0)
+        return false;
+
+    job = queue.jobs[queue.first];
+    queue.first = (queue.first + 1) % JOB_QUEUE_CAPACITY;
+    queue.count--;
+    return true;
+}
+
+static void RunJobNow(const Job& job)
+{
+    AllocationScope allocationScope(job.subsystem);
+    job.function(job.data, job.begin, job.end);
+
+    if (job.counter)
+        job.counter->pending--;
+}
+
+// Runs a job from the worker's own queue or, if it's empty, one stolen from the others. False if there was none.
+static bool TryRunJob(u32 workerIndex)
+{
+    JobSystem& system = GlobalJobSystem;
+
+    Job job;
+    bool found = PopJob(system.queues[workerIndex], job);
+    for (u32 i = 1; !found && i < system.workerCount; ++i)
+    {
+        u32 victim = (workerIndex + i) % system.workerCount;
+        found = StealJob(system.queues[victim], job);
+        if (found)
+            system.queues[workerIndex].stolen++;
+    }
+    if (!found)
+        return false;
+
+    system.queuedJobs--;
+
+    RunJobNow(job);
+    system.queues[workerIndex].executed++;
+
+    return true;
+}
+
+static void JobWorker(u32 workerIndex)
+{
+    JobSystem& system = GlobalJobSystem;
+    LocalWorkerIndex = workerIndex;
+
+    for (;;)
+    {
+        if (TryRunJob(workerIndex))
+            continue;
+
+        std::unique_lock<std::mutex> lock(system.sleepMutex);
+        while (!system.quit && system.queuedJobs == 0)
+            system.wakeCondition.wait(lock);
+
+        // The queues are drained before quitting, nobody waits on a job that never runs
+        if (system.quit && system.queuedJobs == 0)
+            return;
+    }
+}
+
+// Counted before they are visible to the other threads, so a sleeping thread can't miss them.
+// The jobs that don't fit in a full queue are run right away by the calling thread.
+static void PushJobs(const Job* jobs, u32 jobCount)
+{
+    JobSystem& system = GlobalJobSystem;
+
+    u32 pushedCount;
+    {
+        JobQueue& queue = system.queues[LocalWorkerIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        pushedCount = glm::min(jobCount, JOB_QUEUE_CAPACITY - queue.count);
+        system.queuedJobs += pushedCount;
+        for (u32 i = 0; i < pushedCount; ++i)
+            queue.jobs[(queue.first + queue.count++) % JOB_QUEUE_CAPACITY] = jobs[i];
+    }
+
+    // Taking the lock orders the notification after a thread that saw no jobs has started waiting
+    {
+        std::lock_guard<std::mutex> lock(system.sleepMutex);
+    }
+    if (pushedCount > 1)
+        system.wakeCondition.notify_all();
+    else if (pushedCount == 1)
+        system.wakeCondition.notify_one();
+
+    for (u32 i = pushedCount; i < jobCount; ++i)
+        RunJobNow(jobs[i]);
+}
+
+void InitJobSystem(u32 workerCount)
+{
+    JobSystem& system = GlobalJobSystem;
+
+    system.workerCount = glm::clamp(workerCount, 1u, u32(JOB_SYSTEM_MAX_WORKERS));
+    system.queuedJobs = 0;
+    system.quit = false;
+
+    for (u32 i = 1; i < system.workerCount; ++i)
+        system.threads.emplace_back(JobWorker, i);
+
+    ILOG("Job system started with %u workers", system.workerCount);
+}
+
+void ShutdownJobSystem()
+{
+    JobSystem& system = GlobalJobSystem;
+
+    // Jobs left in the main thread's queue are run here when there are no threads to steal them
+    while (TryRunJob(0))
+        ;
+
+    {
+        std::lock_guard<std::mutex> lock(system.sleepMutex);
+        system.quit = true;
+    }
+    system.wakeCondition.notify_all();
+
+    for (u32 i = 0; i < system.threads.size(); ++i)
+        system.threads[i].join();
+    system.threads.clear();
+    system.workerCount = 1;
+}
+
+void SetJobWorkerCount(u32 workerCount)
+{
+    ASSERT(LocalWorkerIndex == 0, "The job system can only be restarted from the main thread");
+
+    ShutdownJobSystem();
+    InitJobSystem(workerCount);
+}
+
+u32 GetJobWorkerCount()
+{
+    return GlobalJobSystem.workerCount;
+}
+
+u32 GetJobWorkerIndex()
+{
+    return LocalWorkerIndex;
+}
+
+void RunJob(JobFunction function, void* data, u32 begin, u32 end, JobCounter* counter)
+{
+    if (counter)
+        counter->pending++;
+
+    Job job = { function, data, begin, end, counter, GetAllocationSubsystem() };
+    PushJobs(&job, 1);
+}
+
+void ParallelForAsync(u32 count, u32 granularity, JobFunction function, void* data, JobCounter& counter)
+{
+    if (count == 0)
+        return;
+
+    granularity = glm::max(granularity, 1u);
+    u32 jobCount = (count + granularity - 1) / granularity;
+
+    // Pushed from the last range to the first, so the owner, popping from the back, runs them in order
+    // while the thieves take the ranges furthest from it. The queues copy them, the array only lives for the call.
+    ScratchScope scratch;
+    ScratchVector<Job> jobs(jobCount, Job(), GetScratchAllocator<Job>());
+    for (u32 i = 0; i < jobCount; ++i)
+    {
+        u32 begin = (jobCount - 1 - i) * granularity;
+        jobs[i] = { function, data, begin, glm::min(begin + granularity, count), &counter, GetAllocationSubsystem() };
+    }
+
+    counter.pending += jobCount;
+    PushJobs(jobs.data(), jobCount);
+}
+
+void ParallelFor(u32 count, u32 granularity, JobFunction function, void* data)
+{
+    // Nothing to share, the items run right away
+    if (GlobalJobSystem.workerCount == 1 || count <= granularity)
+    {
+        if (count > 0)
+            function(data, 0, count);
+        return;
+    }
+
+    JobCounter counter;
+    ParallelForAsync(count, granularity, function, data, counter);
+    WaitForCounter(counter);
+}
+
+void WaitForCounter(JobCounter& counter)
+{
+    while (counter.pending > 0)
+    {
+        // Jobs may be running on other threads with nothing left to steal
+        if (!TryRunJob(LocalWorkerIndex))
+            std::this_thread::yield();
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+// IMGUI //
+// ------------------------------------------------------------------------------------------------
+
+void DrawJobSystemImGui()
+{
+    JobSystem& system = GlobalJobSystem;
+
+    ImGui::Text("Hardware Threads: %u", std::thread::hardware_concurrency());
+
+    int workerCount = system.workerCount;
+    if (ImGui::SliderInt("Workers", &workerCount, 1, JOB_SYSTEM_MAX_WORKERS))
+        SetJobWorkerCount(workerCount);
+
+    const ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit;
+    if (ImGui::BeginTable("Job Workers", 3, flags))
+    {
+        ImGui::TableSetupColumn("Worker");
+        ImGui::TableSetupColumn("Executed");
+        ImGui::TableSetupColumn("Stolen");
+        ImGui::TableHeadersRow();
+
+        for (u32 i = 0; i < system.workerCount; ++i)
+        {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            if (i == 0)
+                ImGui::Text("Main");
+            else
+                ImGui::Text("Thread %u", i);
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", (u64)system.queues[i].executed);
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", (u64)system.queues[i].stolen);
+        }
+        ImGui::EndTable();
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "platform.h"
+
+#include <atomic>
+
+// Work-stealing job system shared by every module. Each thread owns a queue: it pushes and pops its own jobs
+// from the back, most recent first, and when it runs out it steals the oldest jobs from the front of the others.
+// The main thread is worker 0 and runs jobs while it waits for them, the rest are background threads.
+
+#define JOB_SYSTEM_MAX_WORKERS 16 // Including the main thread
+#define JOB_QUEUE_CAPACITY 4096u  // Per worker, the jobs past it run on the thread that queues them
+
+// Runs the items [begin, end) of the data
+typedef void (*JobFunction)(void* data, u32 begin, u32 end);
+
+// Counts the jobs still pending, zero once all the jobs added with it have finished
+struct JobCounter
+{
+    std::atomic<u32> pending;
+
+    JobCounter() : pending(0) {}
+};
+
+// workerCount includes the main thread, 1 runs every job on the main thread
+void InitJobSystem(u32 workerCount);
+// Waits for the queued jobs to finish before stopping the threads
+void ShutdownJobSystem();
+
+// Restarts the threads. Only from the main thread, with no jobs in flight.
+void SetJobWorkerCount(u32 workerCount);
+u32 GetJobWorkerCount();
+
+// Worker the calling thread is, 0 for the main thread and any thread outside the job system
+u32 GetJobWorkerIndex();
+
+// Queues a job in the calling thread's queue, counter can be null
+void RunJob(JobFunction function, void* data, u32 begin, u32 end, JobCounter* counter);
+
+// Splits [0, count) in jobs of granularity items. The caller decides when to wait for the counter.
+void ParallelForAsync(u32 count, u32 granularity, JobFunction function, void* data, JobCounter& counter);
+// Same, returning once every item has been run. The calling thread runs jobs too.
+void ParallelFor(u32 count, u32 granularity, JobFunction function, void* data);
+
+// Runs queued jobs, own or stolen, until the counter reaches zero
+void WaitForCounter(JobCounter& counter);
+
+void DrawJobSystemImGui();
@@ -0,0 +1,530 @@
+#include "MeshOptimizer.h"
+
+#include "Entity.h"
+#include "Allocators.h"
+#include "AssimpLoading.h"
+
+#include <algorithm>
+#include <float.h>
+
+#define OVERDRAW_GRID_SIZE 256
+#define VERTEX_FETCH_LINE_SIZE 64
+#define VERTEX_FETCH_CACHE_LINES 64
+
+// FIFO cache simulation, returns true when the vertex was not in the cache
+static bool CacheAccess(ScratchVector<u32>& cache, u32& cacheHead, u32 value)
+{
+    for (u32 i = 0; i < cache.size(); ++i)
+        if (cache[i] == value)
+            return false;
+
+    cache[cacheHead] = value;
+    cacheHead = (cacheHead + 1) % cache.size();
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+// VERTEX CACHE (Tipsify) //
+// ------------------------------------------------------------------------------------------------
+
+static int SkipDeadEnd(const ScratchVector<u32>& liveTriangles, ScratchVector<u32>& deadEndStack, u32& cursor, u32 vertexCount)
+{
+    while (!deadEndStack.empty())
+    {
+        u32 vertex = deadEndStack.back();
+        deadEndStack.pop_back();
+        if (liveTriangles[vertex] > 0)
+            return (int)vertex;
+    }
+
+    while (cursor < vertexCount)
+    {
+        if (liveTriangles[cursor] > 0)
+            return (int)cursor;
+        cursor++;
+    }
+
+    return -1;
+}
+
+static int GetNextVertex(const ScratchVector<u32>& candidates, const ScratchVector<u32>& liveTriangles, const ScratchVector<u32>& cacheTimestamps, u32 timestamp, u32 cacheSize,
+    ScratchVector<u32>& deadEndStack, u32& cursor, u32 vertexCount)
+{
+    int bestVertex = -1;
+    int bestPriority = -1;
+
+    for (u32 i = 0; i < candidates.size(); ++i)
+    {
+        u32 vertex = candidates[i];
+        if (liveTriangles[vertex] == 0)
+            continue;
+
+        // Prefer vertices that will still be in the cache after emitting all their triangles
+        int priority = 0;
+        if (timestamp - cacheTimestamps[vertex] + 2 * liveTriangles[vertex] <= cacheSize)
+            priority = timestamp - cacheTimestamps[vertex];
+
+        if (priority > bestPriority)
+        {
+            bestPriority = priority;
+            bestVertex = (int)vertex;
+        }
+    }
+
+    if (bestVertex == -1)
+        bestVertex = SkipDeadEnd(liveTriangles, deadEndStack, cursor, vertexCount);
+
+    return bestVertex;
+}
+
+void OptimizeVertexCache(std::vector<u32>& indices, u32 vertexCount, u32 cacheSize)
+{
+    u32 triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // The temporaries come from the scratch stack of the importing thread, the result goes into the mesh
+    ScratchScope scratch;
+
+    // Vertex-triangle adjacency
+    ScratchVector<u32> liveTriangles(vertexCount, 0, GetScratchAllocator<u32>());
+    for (u32 i = 0; i < indices.size(); ++i)
+        liveTriangles[indices[i]]++;
+
+    ScratchVector<u32> adjacencyOffsets(vertexCount + 1, 0, GetScratchAllocator<u32>());
+    for (u32 i = 0; i < vertexCount; ++i)
+        adjacencyOffsets[i + 1] = adjacencyOffsets[i] + liveTriangles[i];
+
+    ScratchVector<u32> adjacency(indices.size(), 0, GetScratchAllocator<u32>());
+    ScratchVector<u32> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1, GetScratchAllocator<u32>());
+    for (u32 i = 0; i < indices.size(); ++i)
+        adjacency[adjacencyFill[indices[i]]++] = i / 3;
+
+    ScratchVector<u32> cacheTimestamps(vertexCount, 0, GetScratchAllocator<u32>());
+    ScratchVector<u8> emitted(triangleCount, 0, GetScratchAllocator<u8>());
+    ScratchVector<u32> deadEndStack(GetScratchAllocator<u32>());
+    ScratchVector<u32> candidates(GetScratchAllocator<u32>());
+    deadEndStack.reserve(indices.size());
+
+    std::vector<u32> result;
+    result.reserve(indices.size());
+
+    u32 timestamp = cacheSize + 1;
+    u32 cursor = 1;
+    int fanningVertex = 0;
+
+    while (fanningVertex >= 0)
+    {
+        candidates.clear();
+
+        for (u32 i = adjacencyOffsets[fanningVertex]; i < adjacencyOffsets[fanningVertex + 1]; ++i)
+        {
+            u32 triangle = adjacency[i];
+            if (emitted[triangle])
+                continue;
+
+            for (u32 j = 0; j < 3; ++j)
+            {
+                u32 vertex = indices[triangle * 3 + j];
+                result.push_back(vertex);
+                deadEndStack.push_back(vertex);
+                candidates.push_back(vertex);
+                liveTriangles[vertex]--;
+
+                if (timestamp - cacheTimestamps[vertex] > cacheSize)
+                    cacheTimestamps[vertex] = timestamp++;
+            }
+            emitted[triangle] = 1;
+        }
+
+        fanningVertex = GetNextVertex(candidates, liveTriangles, cacheTimestamps, timestamp, cacheSize, deadEndStack, cursor, vertexCount);
+    }
+
+    ASSERT(result.size() == indices.size(), "Every triangle should have been emitted");
+    indices.swap(result);
+}
+
+// ------------------------------------------------------------------------------------------------
+// OVERDRAW //
+// ------------------------------------------------------------------------------------------------
+
+static float ClusterACMR(const std::vector<u32>& indices, u32 firstTriangle, u32 lastTriangle, u32 cacheSize)
+{
+    ScratchScope scratch;
+    ScratchVector<u32> cache(cacheSize, UINT32_MAX, GetScratchAllocator<u32>());
+    u32 cacheHead = 0;
+    u32 misses = 0;
+
+    for (u32 i = firstTriangle * 3; i < lastTriangle * 3; ++i)
+        misses += CacheAccess(cache, cacheHead, indices[i]);
+
+    return float(misses) / float(lastTriangle - firstTriangle);
+}
+
+void OptimizeOverdraw(std::vector<u32>& indices, const std::vector<float>& vertices, u32 vertexStride, float threshold)
+{
+    u32 triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    const u32 floatStride = vertexStride / sizeof(float);
+
+    ScratchScope scratch;
+
+    // Hard boundaries: triangles where the whole cache was missed (Tipsify jumped to a dead end)
+    ScratchVector<u32> hardClusters(GetScratchAllocator<u32>());
+    hardClusters.reserve(triangleCount);
+    {
+        ScratchVector<u32> cache(VERTEX_CACHE_SIZE, UINT32_MAX, GetScratchAllocator<u32>());
+        u32 cacheHead = 0;
+        for (u32 t = 0; t < triangleCount; ++t)
+        {
+            u32 misses = 0;
+            for (u32 j = 0; j < 3; ++j)
+                misses += CacheAccess(cache, cacheHead, indices[t * 3 + j]);
+
+            if (t == 0 || misses == 3)
+                hardClusters.push_back(t);
+        }
+    }
+
+    // Soft boundaries: split the hard clusters where the ACMR so far is within the threshold of the cluster ACMR
+    ScratchVector<u32> clusters(GetScratchAllocator<u32>());
+    clusters.reserve(triangleCount);
+    ScratchVector<u32> cache(VERTEX_CACHE_SIZE, UINT32_MAX, GetScratchAllocator<u32>());
+    for (u32 c = 0; c < hardClusters.size(); ++c)
+    {
+        u32 start = hardClusters[c];
+        u32 end = c + 1 < hardClusters.size() ? hardClusters[c + 1] : triangleCount;
+
+        float clusterThreshold = ClusterACMR(indices, start, end, VERTEX_CACHE_SIZE) * threshold;
+
+        std::fill(cache.begin(), cache.end(), UINT32_MAX);
+        u32 cacheHead = 0;
+        u32 misses = 0;
+        u32 clusterStart = start;
+        clusters.push_back(start);
+
+        for (u32 t = start; t < end; ++t)
+        {
+            for (u32 j = 0; j < 3; ++j)
+                misses += CacheAccess(cache, cacheHead, indices[t * 3 + j]);
+
+            float runningACMR = float(misses) / float(t - clusterStart + 1);
+            if (t + 1 < end && runningACMR <= clusterThreshold)
+            {
+                clusters.push_back(t + 1);
+                clusterStart = t + 1;
+                misses = 0;
+                std::fill(cache.begin(), cache.end(), UINT32_MAX);
+                cacheHead = 0;
+            }
+        }
+    }
+
+    // Mesh centroid
+    glm::vec3 meshCentroid = glm::vec3(0.0f);
+    for (u32 i = 0; i < indices.size(); ++i)
+        meshCentroid += glm::make_vec3(&vertices[indices[i] * floatStride]);
+    meshCentroid /= float(indices.size());
+
+    // Sort key per cluster: how much the cluster faces away from the centre of the mesh
+    ScratchVector<float> clusterKeys(clusters.size(), 0.0f, GetScratchAllocator<float>());
+    for (u32 c = 0; c < clusters.size(); ++c)
+    {
+        u32 start = clusters[c];
+        u32 end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+        glm::vec3 clusterCentroid = glm::vec3(0.0f);
+        glm::vec3 clusterNormal = glm::vec3(0.0f);
+        float clusterArea = 0.0f;
+
+        for (u32 t = start; t < end; ++t)
+        {
+            glm::vec3 p0 = glm::make_vec3(&vertices[indices[t * 3 + 0] * floatStride]);
+            glm::vec3 p1 = glm::make_vec3(&vertices[indices[t * 3 + 1] * floatStride]);
+            glm::vec3 p2 = glm::make_vec3(&vertices[indices[t * 3 + 2] * floatStride]);
+
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(normal);
+
+            clusterCentroid += (p0 + p1 + p2) * (area / 3.0f);
+            clusterNormal += normal;
+            clusterArea += area;
+        }
+
+        if (clusterArea > 0.0f)
+            clusterCentroid /= clusterArea;
+
+        float normalLength = glm::length(clusterNormal);
+        if (normalLength > 0.0f)
+            clusterNormal /= normalLength;
+
+        clusterKeys[c] = glm::dot(clusterCentroid - meshCentroid, clusterNormal);
+    }
+
+    ScratchVector<u32> clusterOrder(clusters.size(), 0, GetScratchAllocator<u32>());
+    for (u32 c = 0; c < clusters.size(); ++c)
+        clusterOrder[c] = c;
+
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&clusterKeys](u32 a, u32 b) { return clusterKeys[a] > clusterKeys[b]; });
+
+    std::vector<u32> result;
+    result.reserve(indices.size());
+    for (u32 i = 0; i < clusterOrder.size(); ++i)
+    {
+        u32 c = clusterOrder[i];
+        u32 start = clusters[c];
+        u32 end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+        result.insert(result.end(), indices.begin() + start * 3, indices.begin() + end * 3);
+    }
+
+    indices.swap(result);
+}
+
+// ------------------------------------------------------------------------------------------------
+// VERTEX FETCH //
+// ------------------------------------------------------------------------------------------------
+
+void OptimizeVertexFetch(std::vector<float>& vertices, std::vector<u32>& indices, u32 vertexStride)
+{
+    const u32 floatStride = vertexStride / sizeof(float);
+    const u32 vertexCount = vertices.size() / floatStride;
+
+    ScratchScope scratch;
+    ScratchVector<u32> remap(vertexCount, UINT32_MAX, GetScratchAllocator<u32>());
+    std::vector<float> result;
+    result.reserve(vertices.size());
+
+    u32 nextVertex = 0;
+    for (u32 i = 0; i < indices.size(); ++i)
+    {
+        u32 vertex = indices[i];
+        if (remap[vertex] == UINT32_MAX)
+        {
+            remap[vertex] = nextVertex++;
+            result.insert(result.end(), vertices.begin() + vertex * floatStride, vertices.begin() + (vertex + 1) * floatStride);
+        }
+        indices[i] = remap[vertex];
+    }
+
+    vertices.swap(result);
+}
+
+// ------------------------------------------------------------------------------------------------
+// ANALYSIS //
+// ------------------------------------------------------------------------------------------------
+
+// Rasterizes the mesh from the 6 axis-aligned directions with back-face culling and returns the
+// ratio between the fragments that passed the depth test and the pixels finally covered
+static float AnalyzeOverdraw(const std::vector<float>& vertices, const std::vector<u32>& indices, u32 floatStride)
+{
+    const u32 vertexCount = vertices.size() / floatStride;
+
+    glm::vec3 minBounds = glm::vec3(FLT_MAX);
+    glm::vec3 maxBounds = glm::vec3(-FLT_MAX);
+    for (u32 i = 0; i < vertexCount; ++i)
+    {
+        glm::vec3 position = glm::make_vec3(&vertices[i * floatStride]);
+        minBounds = glm::min(minBounds, position);
+        maxBounds = glm::max(maxBounds, position);
+    }
+
+    glm::vec3 extent = maxBounds - minBounds;
+    float maxExtent = glm::max(extent.x, glm::max(extent.y, extent.z));
+    if (maxExtent <= 0.0f)
+        return 0.0f;
+
+    float scale = float(OVERDRAW_GRID_SIZE - 1) / maxExtent;
+
+    ScratchScope scratch;
+    ScratchVector<float> depthBuffer(OVERDRAW_GRID_SIZE * OVERDRAW_GRID_SIZE, 0.0f, GetScratchAllocator<float>());
+    u64 fragmentsShaded = 0;
+    u64 pixelsCovered = 0;
+
+    for (u32 axis = 0; axis < 3; ++axis)
+    {
+        for (u32 side = 0; side < 2; ++side)
+        {
+            std::fill(depthBuffer.begin(), depthBuffer.end(), FLT_MAX);
+
+            for (u32 t = 0; t < indices.size() / 3; ++t)
+            {
+                glm::vec3 screen[3];
+                for (u32 j = 0; j < 3; ++j)
+                {
+                    glm::vec3 p = (glm::make_vec3(&vertices[indices[t * 3 + j] * floatStride]) - minBounds) * scale;
+                    float u = p[(axis + 1) % 3];
+                    float v = p[(axis + 2) % 3];
+                    float w = p[axis];
+
+                    // The view basis is a cyclic permutation of XYZ looking down -w, or its 180 degree rotation looking down +w
+                    screen[j] = side == 0 ? glm::vec3(u, v, -w) : glm::vec3(float(OVERDRAW_GRID_SIZE - 1) - u, v, w);
+                }
+
+                glm::vec2 e1 = glm::vec2(screen[1] - screen[0]);
+                glm::vec2 e2 = glm::vec2(screen[2] - screen[0]);
+                float area = e1.x * e2.y - e1.y * e2.x;
+                if (area <= 0.0f)
+                    continue;
+
+                int minX = glm::max(0, (int)glm::floor(glm::min(screen[0].x, glm::min(screen[1].x, screen[2].x))));
+                int minY = glm::max(0, (int)glm::floor(glm::min(screen[0].y, glm::min(screen[1].y, screen[2].y))));
+                int maxX = glm::min(OVERDRAW_GRID_SIZE - 1, (int)glm::ceil(glm::max(screen[0].x, glm::max(screen[1].x, screen[2].x))));
+                int maxY = glm::min(OVERDRAW_GRID_SIZE - 1, (int)glm::ceil(glm::max(screen[0].y, glm::max(screen[1].y, screen[2].y))));
+
+                for (int y = minY; y <= maxY; ++y)
+                {
+                    for (int x = minX; x <= maxX; ++x)
+                    {
+                        glm::vec2 p = glm::vec2(x + 0.5f, y + 0.5f);
+
+                        float w0 = (screen[2].x - screen[1].x) * (p.y - screen[1].y) - (screen[2].y - screen[1].y) * (p.x - screen[1].x);
+                        float w1 = (screen[0].x - screen[2].x) * (p.y - screen[2].y) - (screen[0].y - screen[2].y) * (p.x - screen[2].x);
+                        float w2 = (screen[1].x - screen[0].x) * (p.y - screen[0].y) - (screen[1].y - screen[0].y) * (p.x - screen[0].x);
+                        if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+                            continue;
+
+                        float depth = (w0 * screen[0].z + w1 * screen[1].z + w2 * screen[2].z) / area;
+                        float& storedDepth = depthBuffer[y * OVERDRAW_GRID_SIZE + x];
+                        if (depth < storedDepth)
+                        {
+                            storedDepth = depth;
+                            fragmentsShaded++;
+                        }
+                    }
+                }
+            }
+
+            for (u32 i = 0; i < depthBuffer.size(); ++i)
+                pixelsCovered += depthBuffer[i] != FLT_MAX;
+        }
+    }
+
+    return pixelsCovered > 0 ? float(fragmentsShaded) / float(pixelsCovered) : 0.0f;
+}
+
+MeshOptimizationStats AnalyzeMesh(const std::vector<float>& vertices, const std::vector<u32>& indices, u32 vertexStride)
+{
+    MeshOptimizationStats stats = {};
+
+    const u32 floatStride = vertexStride / sizeof(float);
+    const u32 vertexCount = vertices.size() / floatStride;
+    const u32 triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || vertexCount == 0)
+        return stats;
+
+    ScratchScope scratch;
+    ScratchVector<u32> vertexCache(VERTEX_CACHE_SIZE, UINT32_MAX, GetScratchAllocator<u32>());
+    u32 vertexCacheHead = 0;
+    ScratchVector<u32> lineCache(VERTEX_FETCH_CACHE_LINES, UINT32_MAX, GetScratchAllocator<u32>());
+    u32 lineCacheHead = 0;
+
+    u32 transformedVertices = 0;
+    u64 bytesFetched = 0;
+
+    for (u32 i = 0; i < indices.size(); ++i)
+    {
+        if (!CacheAccess(vertexCache, vertexCacheHead, indices[i]))
+            continue;
+
+        transformedVertices++;
+
+        // The vertex is only fetched when it misses the post-transform cache
+        u32 firstLine = (indices[i] * vertexStride) / VERTEX_FETCH_LINE_SIZE;
+        u32 lastLine = ((indices[i] + 1) * vertexStride - 1) / VERTEX_FETCH_LINE_SIZE;
+        for (u32 line = firstLine; line <= lastLine; ++line)
+            if (CacheAccess(lineCache, lineCacheHead, line))
+                bytesFetched += VERTEX_FETCH_LINE_SIZE;
+    }
+
+    stats.acmr = float(transformedVertices) / float(triangleCount);
+    stats.atvr = float(transformedVertices) / float(vertexCount);
+    stats.overfetch = float(bytesFetched) / float(vertexCount * vertexStride);
+    stats.overdraw = AnalyzeOverdraw(vertices, indices, floatStride);
+
+    return stats;
+}
+
+void OptimizeMesh(Mesh& mesh, MeshOptimizationReport& report)
+{
+    const u32 vertexStride = mesh.VBLayout.stride;
+    const u32 vertexCount = mesh.vertices.size() / (vertexStride / sizeof(float));
+
+    report.before = AnalyzeMesh(mesh.vertices, mesh.indices, vertexStride);
+
+    OptimizeVertexCache(mesh.indices, vertexCount);
+    OptimizeOverdraw(mesh.indices, mesh.vertices, vertexStride);
+    OptimizeVertexFetch(mesh.vertices, mesh.indices, vertexStride);
+
+    report.after = AnalyzeMesh(mesh.vertices, mesh.indices, vertexStride);
+}
+
+// ------------------------------------------------------------------------------------------------
+// MESH OPTIMIZER TEST //
+// ------------------------------------------------------------------------------------------------
+
+static bool CheckModelStat(const char* filename, const char* statName, float before, float after)
+{
+    if (after < before)
+        return true;
+
+    ELOG("Mesh optimizer test: %s %s didn't improve, %.3f -> %.3f\n", filename, statName, before, after);
+    return false;
+}
+
+bool RunMeshOptimizerTest()
+{
+    static const char* filenames[] =
+    {
+        "Assets/Models/Bunny/bunny.obj",
+        "Assets/Models/Patrick/patrick.obj",
+        "Assets/Models/Backpack/backpack.obj"
+    };
+
+    u32 failedModels = 0;
+    for (u32 i = 0; i < ARRAY_COUNT(filenames); ++i)
+    {
+        // Optimized and reported on import, the geometry is never uploaded
+        Model model;
+        if (!ImportModelGeometry(filenames[i], model, 0) || model.meshes.empty())
+        {
+            ELOG("Mesh optimizer test: %s couldn't be imported\n", filenames[i]);
+            failedModels++;
+            continue;
+        }
+
+        MeshOptimizationStats before = {};
+        MeshOptimizationStats after = {};
+        for (u32 m = 0; m < model.meshes.size(); ++m)
+        {
+            const MeshOptimizationReport& report = model.meshes[m].optimizationReport;
+            before.acmr += report.before.acmr;
+            before.atvr += report.before.atvr;
+            before.overdraw += report.before.overdraw;
+            before.overfetch += report.before.overfetch;
+            after.acmr += report.after.acmr;
+            after.atvr += report.after.atvr;
+            after.overdraw += report.after.overdraw;
+            after.overfetch += report.after.overfetch;
+        }
+
+        // Vertex cache, overdraw and vertex fetch steps in turn
+        bool improved = CheckModelStat(filenames[i], "ACMR", before.acmr, after.acmr);
+        improved &= CheckModelStat(filenames[i], "ATVR", before.atvr, after.atvr);
+        improved &= CheckModelStat(filenames[i], "overdraw", before.overdraw, after.overdraw);
+        improved &= CheckModelStat(filenames[i], "overfetch", before.overfetch, after.overfetch);
+
+        failedModels += !improved;
+    }
+
+    if (failedModels == 0)
+    {
+        ILOG("Mesh optimizer test passed: every metric of the %u models improved\n", (u32)ARRAY_COUNT(filenames));
+    }
+    else
+    {
+        ELOG("Mesh optimizer test failed: %u of %u models didn't improve\n", failedModels, (u32)ARRAY_COUNT(filenames));
+    }
+    return failedModels == 0;
+}
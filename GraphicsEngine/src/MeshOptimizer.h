@@ -0,0 +1,46 @@
+#pragma once
+
+#include "platform.h"
+
+#define VERTEX_CACHE_SIZE 16
+#define OVERDRAW_THRESHOLD 1.05f
+
+struct Mesh;
+
+struct MeshOptimizationStats
+{
+    float acmr;      // Average cache miss ratio: transformed vertices per triangle
+    float atvr;      // Average transformed vertex ratio: transformed vertices per unique vertex
+    float overdraw;  // Shaded fragments per covered pixel, averaged over 6 axis views
+    float overfetch; // Bytes fetched from the vertex buffer per byte of the vertex buffer
+};
+
+struct MeshOptimizationReport
+{
+    MeshOptimizationStats before;
+    MeshOptimizationStats after;
+};
+
+// Reorders triangles for the post-transform vertex cache (Tipsify)
+void OptimizeVertexCache(std::vector<u32>& indices, u32 vertexCount, u32 cacheSize = VERTEX_CACHE_SIZE);
+
+// Reorders the clusters of a cache optimized index buffer so outward facing clusters are drawn first.
+// The threshold bounds how much the ACMR is allowed to degrade when splitting clusters.
+void OptimizeOverdraw(std::vector<u32>& indices, const std::vector<float>& vertices, u32 vertexStride, float threshold = OVERDRAW_THRESHOLD);
+
+// Reorders the vertex buffer in order of first use and remaps the indices. Unused vertices are dropped.
+void OptimizeVertexFetch(std::vector<float>& vertices, std::vector<u32>& indices, u32 vertexStride);
+
+MeshOptimizationStats AnalyzeMesh(const std::vector<float>& vertices, const std::vector<u32>& indices, u32 vertexStride);
+
+// Runs the vertex cache, overdraw and vertex fetch optimizations over the mesh and fills the report
+void OptimizeMesh(Mesh& mesh, MeshOptimizationReport& report);
+
+// ------------------------------------------------------------------------------------------------
+// MESH OPTIMIZER TEST //
+// ------------------------------------------------------------------------------------------------
+
+// Imports the bundled models without a GL context and checks that the optimization improved the ACMR, ATVR, overdraw
+// and overfetch of each of them, summed over its meshes since a single mesh can already be optimal for one of them.
+// Logs the report of each mesh. Enabled from the command line with --mesh-optimizer-test.
+bool RunMeshOptimizerTest();
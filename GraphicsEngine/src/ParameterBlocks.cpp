@@ -0,0 +1,45 @@
+#include "ParameterBlocks.h"
+
+static void AppendGLSLFields(std::string& glsl, const BlockDeclaration& declaration)
+{
+    glsl += "{\n";
+    for (u32 i = 0; i < declaration.fieldCount; ++i)
+    {
+        const BlockFieldDeclaration& field = declaration.fields[i];
+        glsl += "\t";
+        glsl += field.glslType;
+        glsl += " ";
+        glsl += field.name;
+        if (field.arrayCount > 0)
+            glsl += "[" + std::to_string(field.arrayCount) + "]";
+        glsl += ";\n";
+    }
+    glsl += "}";
+}
+
+std::string GenerateGLSLStruct(const BlockDeclaration& declaration)
+{
+    std::string glsl = "struct ";
+    glsl += declaration.name;
+    glsl += "\n";
+    AppendGLSLFields(glsl, declaration);
+    glsl += ";\n\n";
+    return glsl;
+}
+
+std::string GenerateGLSLBlock(const BlockDeclaration& declaration, u32 binding, bool storageBuffer, const char* instanceName)
+{
+    std::string glsl = "layout(binding = " + std::to_string(binding);
+    glsl += declaration.layout == BlockLayout::STD140 ? ", std140) " : ", std430) ";
+    glsl += storageBuffer ? "buffer " : "uniform ";
+    glsl += declaration.name;
+    glsl += "\n";
+    AppendGLSLFields(glsl, declaration);
+    if (instanceName)
+    {
+        glsl += " ";
+        glsl += instanceName;
+    }
+    glsl += ";\n\n";
+    return glsl;
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include "platform.h"
+
+#include <cstddef>
+
+// Typed uniform/storage block layouts. A block is described once as a list of fields, and from that list we get:
+//   - the C++ struct, with every member aligned as the GLSL layout requires
+//   - static_asserts checking each member offset against the std140/std430 rules
+//   - the matching GLSL declaration, so the shaders never declare the block by hand
+//
+// The field list is an X-macro taking FIELD(type, name) and ARRAY(type, name, count):
+/*
+     #define MY_BLOCK_FIELDS(FIELD, ARRAY) \
+         FIELD(glm::mat4, uView)           \
+         FIELD(float, uRadius)             \
+         ARRAY(glm::vec4, uSamples, 64)
+
+     DECLARE_PARAMETER_BLOCK(MyBlock, MY_BLOCK_FIELDS, BlockLayout::STD140)
+*/
+// Array elements must already have the stride of the layout (vec4 instead of vec3 or float in std140),
+// otherwise the declaration fails to compile.
+
+enum class BlockLayout
+{
+    STD140,
+    STD430
+};
+
+// --- Alignment and size of the types that can be used as fields (OpenGL 4.3, section 7.6.2.2)
+template <typename T>
+struct BlockFieldType;
+
+#define DECLARE_BLOCK_FIELD_TYPE(cppType, glslName, fieldAlignment, fieldSize) \
+    template <> struct BlockFieldType<cppType> \
+    { \
+        enum : u32 { alignment = fieldAlignment, size = fieldSize }; \
+        static const char* GLSLName() { return glslName; } \
+    };
+
+DECLARE_BLOCK_FIELD_TYPE(float,      "float", 4,  4)
+DECLARE_BLOCK_FIELD_TYPE(int,        "int",   4,  4)
+DECLARE_BLOCK_FIELD_TYPE(u32,        "uint",  4,  4)
+DECLARE_BLOCK_FIELD_TYPE(glm::vec2,  "vec2",  8,  8)
+DECLARE_BLOCK_FIELD_TYPE(glm::vec3,  "vec3",  16, 12)
+DECLARE_BLOCK_FIELD_TYPE(glm::vec4,  "vec4",  16, 16)
+DECLARE_BLOCK_FIELD_TYPE(glm::ivec2, "ivec2", 8,  8)
+DECLARE_BLOCK_FIELD_TYPE(glm::ivec4, "ivec4", 16, 16)
+DECLARE_BLOCK_FIELD_TYPE(glm::mat4,  "mat4",  16, 64)
+
+struct BlockFieldInfo
+{
+    u32 alignment;
+    u32 size;       // Whole array for array fields
+    u32 arrayCount; // 0 if the field isn't an array
+};
+
+constexpr u32 AlignBlockOffset(u32 offset, u32 alignment)
+{
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+// std140 rounds the alignment of arrays and structs up to a vec4, std430 doesn't
+constexpr u32 BlockAggregateAlignment(BlockLayout layout, u32 alignment)
+{
+    return layout == BlockLayout::STD140 ? AlignBlockOffset(alignment, 16) : alignment;
+}
+
+constexpr u32 BlockArrayStride(BlockLayout layout, u32 alignment, u32 size)
+{
+    return AlignBlockOffset(size, BlockAggregateAlignment(layout, alignment));
+}
+
+template <u32 N>
+constexpr u32 BlockFieldOffset(const BlockFieldInfo (&fields)[N], u32 index)
+{
+    u32 offset = 0;
+    for (u32 i = 0; i < index; ++i)
+        offset = AlignBlockOffset(offset, fields[i].alignment) + fields[i].size;
+    return AlignBlockOffset(offset, fields[index].alignment);
+}
+
+template <u32 N>
+constexpr u32 BlockBaseAlignment(const BlockFieldInfo (&fields)[N])
+{
+    u32 alignment = 1;
+    for (u32 i = 0; i < N; ++i)
+        alignment = fields[i].alignment > alignment ? fields[i].alignment : alignment;
+    return alignment;
+}
+
+template <u32 N>
+constexpr u32 BlockDataSize(const BlockFieldInfo (&fields)[N])
+{
+    return BlockFieldOffset(fields, N - 1) + fields[N - 1].size;
+}
+
+// Runtime description used to generate the GLSL declaration
+struct BlockFieldDeclaration
+{
+    const char* glslType;
+    const char* name;
+    u32 arrayCount;
+};
+
+struct BlockDeclaration
+{
+    const char* name;
+    BlockLayout layout;
+    const BlockFieldDeclaration* fields;
+    u32 fieldCount;
+};
+
+template <typename Block>
+struct ParameterBlock;
+
+// --- Declaration macros
+
+#define BLOCK_MEMBER_FIELD(type, name) alignas(BlockFieldType<type>::alignment) type name;
+#define BLOCK_MEMBER_ARRAY(type, name, count) alignas(BlockAggregateAlignment(Layout, BlockFieldType<type>::alignment)) type name[count];
+
+#define BLOCK_INFO_FIELD(type, name) { BlockFieldType<type>::alignment, BlockFieldType<type>::size, 0 },
+#define BLOCK_INFO_ARRAY(type, name, count) { BlockAggregateAlignment(Layout, BlockFieldType<type>::alignment), BlockArrayStride(Layout, BlockFieldType<type>::alignment, BlockFieldType<type>::size) * count, count },
+
+#define BLOCK_INDEX_FIELD(type, name) name,
+#define BLOCK_INDEX_ARRAY(type, name, count) name,
+
+#define BLOCK_DECLARATION_FIELD(type, name) { BlockFieldType<type>::GLSLName(), #name, 0 },
+#define BLOCK_DECLARATION_ARRAY(type, name, count) { BlockFieldType<type>::GLSLName(), #name, count },
+
+#define BLOCK_CHECK_FIELD(type, name) \
+    static_assert(offsetof(BlockStruct, name) == BlockFieldOffset(Fields, FieldIndex::name), "Field " #name " doesn't follow the block layout");
+#define BLOCK_CHECK_ARRAY(type, name, count) \
+    static_assert(offsetof(BlockStruct, name) == BlockFieldOffset(Fields, FieldIndex::name), "Field " #name " doesn't follow the block layout"); \
+    static_assert(sizeof(type) == BlockArrayStride(Layout, BlockFieldType<type>::alignment, BlockFieldType<type>::size), "Elements of " #name " don't have the array stride of the block layout");
+
+// Declares the struct, checks its layout and registers it as a field type, so it can be nested in other blocks.
+// The layout checks live in a namespace named after the block: <name>Layout::Fields, <name>Layout::FieldIndex.
+#define DECLARE_PARAMETER_BLOCK(blockName, FIELDS, blockLayout) \
+    namespace blockName##Layout \
+    { \
+        constexpr BlockLayout Layout = blockLayout; \
+        constexpr BlockFieldInfo Fields[] = { FIELDS(BLOCK_INFO_FIELD, BLOCK_INFO_ARRAY) }; \
+        struct FieldIndex { enum : u32 { FIELDS(BLOCK_INDEX_FIELD, BLOCK_INDEX_ARRAY) }; }; \
+    } \
+    struct alignas(BlockAggregateAlignment(blockLayout, BlockBaseAlignment(blockName##Layout::Fields))) blockName \
+    { \
+        static constexpr BlockLayout Layout = blockLayout; \
+        FIELDS(BLOCK_MEMBER_FIELD, BLOCK_MEMBER_ARRAY) \
+    }; \
+    namespace blockName##Layout \
+    { \
+        typedef blockName BlockStruct; \
+        FIELDS(BLOCK_CHECK_FIELD, BLOCK_CHECK_ARRAY) \
+        static_assert(sizeof(BlockStruct) == AlignBlockOffset(BlockDataSize(Fields), BlockAggregateAlignment(Layout, BlockBaseAlignment(Fields))), \
+            "Size of " #blockName " doesn't follow the block layout"); \
+    } \
+    template <> struct BlockFieldType<blockName> \
+    { \
+        enum : u32 { alignment = BlockAggregateAlignment(blockLayout, BlockBaseAlignment(blockName##Layout::Fields)), size = sizeof(blockName) }; \
+        static const char* GLSLName() { return #blockName; } \
+    }; \
+    template <> struct ParameterBlock<blockName> \
+    { \
+        static BlockDeclaration Declaration() \
+        { \
+            static const BlockFieldDeclaration fields[] = { FIELDS(BLOCK_DECLARATION_FIELD, BLOCK_DECLARATION_ARRAY) }; \
+            return { #blockName, blockLayout, fields, ARRAY_COUNT(fields) }; \
+        } \
+    };
+
+// --- GLSL generation
+
+// struct <name> { ... };
+std::string GenerateGLSLStruct(const BlockDeclaration& declaration);
+
+// layout(binding = <binding>, std140) <uniform|buffer> <name> { ... } <instanceName>;
+// Without an instance name the fields are visible at global scope in the shader.
+std::string GenerateGLSLBlock(const BlockDeclaration& declaration, u32 binding, bool storageBuffer = false, const char* instanceName = nullptr);
+
+template <typename Block>
+std::string GenerateGLSLStruct()
+{
+    return GenerateGLSLStruct(ParameterBlock<Block>::Declaration());
+}
+
+template <typename Block>
+std::string GenerateGLSLBlock(u32 binding, bool storageBuffer = false, const char* instanceName = nullptr)
+{
+    return GenerateGLSLBlock(ParameterBlock<Block>::Declaration(), binding, storageBuffer, instanceName);
+}
@@ -1,4 +1,5 @@
 #include "Primitives.h"
+#include "GPUMemory.h"
 
 #include <memory>
 
@@ -32,10 +33,12 @@ u32 CreateQuad()
     glGenBuffers(1, &VBO);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), &vertices, GL_STATIC_DRAW);
+    TrackGPUAllocation(GPUResourceKind::BUFFER, VBO, sizeof(vertices), GPU_MEMORY_GEOMETRY, "Screen Quad Vertices");
 
     glGenBuffers(1, &EBO);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), &indices, GL_STATIC_DRAW);
+    TrackGPUAllocation(GPUResourceKind::BUFFER, EBO, sizeof(indices), GPU_MEMORY_GEOMETRY, "Screen Quad Indices");
 
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
@@ -57,6 +60,10 @@ Model* CreatePrimitive(App* app, PrimitiveType type, Material& material, u32 xNu
     model->materialIDs.push_back((u32)app->materials.size());
     app->materials.push_back(material);
 
+    model->primitiveType = (u32)type;
+    model->primitiveSegments[0] = xNumSegments;
+    model->primitiveSegments[1] = yNumSegments;
+
     Mesh mesh = {};
     switch (type)
     {
@@ -196,21 +203,9 @@ Model* CreatePrimitive(App* app, PrimitiveType type, Material& material, u32 xNu
     mesh.VBLayout.attributes.push_back(VertexBufferAttribute{ 2, 2, mesh.VBLayout.stride });
     mesh.VBLayout.stride += 2 * sizeof(float);
 
-    mesh.vertexOffset = 0;
-    mesh.indexOffset = 0;
-
-    glGenBuffers(1, &model->VBHandle);
-    glBindBuffer(GL_ARRAY_BUFFER, model->VBHandle);
-    glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(float), mesh.vertices.data(), GL_STATIC_DRAW);
-
-    glGenBuffers(1, &model->EBHandle);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, model->EBHandle);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(u32), mesh.indices.data(), GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
     model->meshes.push_back(mesh);
+    AllocateMesh(app->geometryArena, model->meshes.back());
+    ComputeModelBounds(*model);
 
     return model;
 }
@@ -268,6 +263,7 @@ u32 CreateSkyboxCube()
     glGenBuffers(1, &VBO);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
+    TrackGPUAllocation(GPUResourceKind::BUFFER, VBO, sizeof(skyboxVertices), GPU_MEMORY_GEOMETRY, "Skybox Cube Vertices");
 
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
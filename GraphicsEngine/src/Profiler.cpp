@@ -0,0 +1,250 @@
+#include "Profiler.h"
+#include "Allocators.h"
+
+#include "imgui-docking/imgui.h"
+
+#include <chrono>
+#include <mutex>
+
+// Zones closer than this to being overwritten are skipped by the readers, so a thread writing while we read
+// never hands us a zone that is half old and half new
+#define PROFILER_READ_MARGIN 1024
+
+std::atomic<bool> GlobalProfilerEnabled(true);
+
+static std::mutex GlobalProfilerThreadsMutex; // Only taken the first time a thread opens a zone
+static std::vector<ProfilerThread*> GlobalProfilerThreads;
+
+static std::atomic<u32> GlobalProfilerFrame(0);
+static u64 GlobalProfilerFrameStarts[PROFILER_FRAME_HISTORY];
+
+static thread_local ProfilerThread* LocalProfilerThread = nullptr;
+
+static u64 GetProfilerTime()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static ProfilerThread* GetProfilerThread()
+{
+    if (!LocalProfilerThread)
+    {
+        ProfilerThread* thread = new ProfilerThread();
+        thread->head = 0;
+        thread->depth = 0;
+
+        std::lock_guard<std::mutex> lock(GlobalProfilerThreadsMutex);
+        thread->id = GlobalProfilerThreads.size();
+        sprintf(thread->name, thread->id == 0 ? "Main" : "Thread %u", thread->id);
+        GlobalProfilerThreads.push_back(thread);
+
+        LocalProfilerThread = thread;
+    }
+    return LocalProfilerThread;
+}
+
+void SetProfilerEnabled(bool enabled)
+{
+    GlobalProfilerEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+void SetProfilerThreadName(const char* name)
+{
+    ProfilerThread* thread = GetProfilerThread();
+    strncpy(thread->name, name, sizeof(thread->name) - 1);
+}
+
+void ProfilerBeginFrame()
+{
+    u32 frame = GlobalProfilerFrame.load(std::memory_order_relaxed) + 1;
+    GlobalProfilerFrameStarts[frame % PROFILER_FRAME_HISTORY] = GetProfilerTime();
+    GlobalProfilerFrame.store(frame, std::memory_order_relaxed);
+}
+
+u32 GetProfilerFrame()
+{
+    return GlobalProfilerFrame.load(std::memory_order_relaxed);
+}
+
+u64 ProfilerBeginZone()
+{
+    GetProfilerThread()->depth++;
+    return GetProfilerTime();
+}
+
+void ProfilerEndZone(const char* name, u64 start)
+{
+    u64 end = GetProfilerTime();
+
+    ProfilerThread* thread = LocalProfilerThread;
+    thread->depth--;
+
+    u64 head = thread->head.load(std::memory_order_relaxed);
+    ProfileZone& zone = thread->zones[head % PROFILER_RING_SIZE];
+    zone.name = name;
+    zone.start = start;
+    zone.end = end;
+    zone.depth = thread->depth;
+    zone.frame = GlobalProfilerFrame.load(std::memory_order_relaxed);
+
+    // Publishes the zone to the readers
+    thread->head.store(head + 1, std::memory_order_release);
+}
+
+// Copies the zones of the frames [firstFrame, lastFrame] recorded by a thread
+static void CollectZones(ProfilerThread* thread, u32 firstFrame, u32 lastFrame, FrameVector<ProfileZone>& zones)
+{
+    u64 head = thread->head.load(std::memory_order_acquire);
+    u64 first = head > PROFILER_RING_SIZE - PROFILER_READ_MARGIN ? head - (PROFILER_RING_SIZE - PROFILER_READ_MARGIN) : 0;
+
+    for (u64 i = first; i < head; ++i)
+    {
+        const ProfileZone& zone = thread->zones[i % PROFILER_RING_SIZE];
+        if (zone.frame >= firstFrame && zone.frame <= lastFrame)
+            zones.push_back(zone);
+    }
+}
+
+// Copied into the frame arena, the profiler window reads them every frame
+static void GetProfilerThreads(FrameVector<ProfilerThread*>& threads)
+{
+    std::lock_guard<std::mutex> lock(GlobalProfilerThreadsMutex);
+    threads.assign(GlobalProfilerThreads.begin(), GlobalProfilerThreads.end());
+}
+
+// ------------------------------------------------------------------------------------------------
+// CHROME TRACE EXPORT //
+// ------------------------------------------------------------------------------------------------
+
+bool ExportChromeTrace(const char* filepath, u32 firstFrame, u32 lastFrame)
+{
+    FILE* file = fopen(filepath, "w");
+    if (!file)
+    {
+        ELOG("Couldn't open %s to export the profiler trace", filepath);
+        return false;
+    }
+
+    FrameVector<ProfilerThread*> threads(GetFrameAllocator<ProfilerThread*>());
+    GetProfilerThreads(threads);
+    FrameVector<ProfileZone> zones(GetFrameAllocator<ProfileZone>());
+
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    bool firstEvent = true;
+    for (u32 t = 0; t < threads.size(); ++t)
+    {
+        ProfilerThread* thread = threads[t];
+        fprintf(file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"%s\"}}", firstEvent ? "" : ",\n", thread->id, thread->name);
+        firstEvent = false;
+
+        zones.clear();
+        CollectZones(thread, firstFrame, lastFrame, zones);
+        for (u32 i = 0; i < zones.size(); ++i)
+        {
+            const ProfileZone& zone = zones[i];
+            fprintf(file, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f, \"args\": {\"frame\": %u}}",
+                zone.name, thread->id, f64(zone.start) * 1e-3, f64(zone.end - zone.start) * 1e-3, zone.frame);
+        }
+    }
+    fprintf(file, "\n]}\n");
+
+    fclose(file);
+    ILOG("Profiler trace of frames %u to %u exported to %s", firstFrame, lastFrame, filepath);
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+// IMGUI //
+// ------------------------------------------------------------------------------------------------
+
+static ImU32 GetZoneColor(const char* name)
+{
+    // Same name, same color across frames
+    u32 hash = 2166136261u;
+    for (const char* c = name; *c; ++c)
+        hash = (hash ^ u8(*c)) * 16777619u;
+    return IM_COL32(90 + hash % 140, 90 + (hash >> 8) % 140, 90 + (hash >> 16) % 140, 255);
+}
+
+void DrawProfilerImGui()
+{
+    static bool paused = false;
+    static u32 pausedFrame = 0;
+    static int frameRange[2] = { 0, 0 };
+
+    bool enabled = GlobalProfilerEnabled.load(std::memory_order_relaxed);
+    if (ImGui::Checkbox("Enabled", &enabled))
+        SetProfilerEnabled(enabled);
+    ImGui::SameLine();
+    if (ImGui::Checkbox("Pause", &paused))
+        pausedFrame = GetProfilerFrame() - 1;
+
+    // The current frame is still being recorded, the last complete one is shown
+    u32 currentFrame = GetProfilerFrame();
+    if (currentFrame < 2)
+        return;
+    u32 frame = paused ? pausedFrame : currentFrame - 1;
+    if (currentFrame - frame >= PROFILER_FRAME_HISTORY - 1)
+    {
+        ImGui::Text("The paused frame is no longer recorded");
+        return;
+    }
+
+    u64 frameStart = GlobalProfilerFrameStarts[frame % PROFILER_FRAME_HISTORY];
+    u64 frameEnd = GlobalProfilerFrameStarts[(frame + 1) % PROFILER_FRAME_HISTORY];
+    f64 frameDuration = f64(frameEnd - frameStart);
+    ImGui::Text("Frame %u: %.3f ms", frame, frameDuration * 1e-6);
+
+    // Flame view, one lane per thread and one row per depth
+    const float rowHeight = ImGui::GetTextLineHeight() + 4.0f;
+    float width = ImGui::GetContentRegionAvail().x;
+
+    FrameVector<ProfilerThread*> threads(GetFrameAllocator<ProfilerThread*>());
+    GetProfilerThreads(threads);
+    FrameVector<ProfileZone> zones(GetFrameAllocator<ProfileZone>());
+    for (u32 t = 0; t < threads.size(); ++t)
+    {
+        zones.clear();
+        CollectZones(threads[t], frame, frame, zones);
+
+        u32 maxDepth = 0;
+        for (u32 i = 0; i < zones.size(); ++i)
+            maxDepth = glm::max(maxDepth, zones[i].depth);
+
+        ImGui::Text("%s", threads[t]->name);
+        ImVec2 origin = ImGui::GetCursorScreenPos();
+        ImVec2 size(width, rowHeight * float(maxDepth + 1));
+        ImDrawList* drawList = ImGui::GetWindowDrawList();
+        drawList->AddRectFilled(origin, ImVec2(origin.x + size.x, origin.y + size.y), IM_COL32(30, 30, 30, 255));
+
+        for (u32 i = 0; i < zones.size(); ++i)
+        {
+            const ProfileZone& zone = zones[i];
+            float x0 = origin.x + float(f64(zone.start > frameStart ? zone.start - frameStart : 0) / frameDuration) * width;
+            float x1 = origin.x + float(f64(zone.end > frameStart ? zone.end - frameStart : 0) / frameDuration) * width;
+            x0 = glm::min(x0, origin.x + width);
+            x1 = glm::max(glm::min(x1, origin.x + width), x0 + 1.0f);
+            float y0 = origin.y + float(zone.depth) * rowHeight;
+            ImVec2 min(x0, y0);
+            ImVec2 max(x1, y0 + rowHeight - 1.0f);
+
+            drawList->AddRectFilled(min, max, GetZoneColor(zone.name));
+            if (ImGui::CalcTextSize(zone.name).x < x1 - x0 - 4.0f)
+                drawList->AddText(ImVec2(x0 + 2.0f, y0 + 2.0f), IM_COL32(0, 0, 0, 255), zone.name);
+
+            if (ImGui::IsMouseHoveringRect(min, max))
+                ImGui::SetTooltip("%s\n%.3f ms", zone.name, f64(zone.end - zone.start) * 1e-6);
+        }
+        ImGui::Dummy(size);
+    }
+
+    // Chrome trace export, open it in chrome://tracing or ui.perfetto.dev
+    if (frameRange[1] == 0)
+    {
+        frameRange[0] = glm::max(int(frame) - 59, 1);
+        frameRange[1] = int(frame);
+    }
+    ImGui::DragInt2("Frames", frameRange, 1.0f, 1, int(currentFrame - 1));
+    if (ImGui::Button("Export Chrome Trace"))
+        ExportChromeTrace("ProfilerTrace.json", u32(glm::min(frameRange[0], frameRange[1])), u32(glm::max(frameRange[0], frameRange[1])));
+}
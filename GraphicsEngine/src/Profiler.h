@@ -0,0 +1,84 @@
+#pragma once
+
+#include "platform.h"
+
+#include <atomic>
+
+// Compile the zones out entirely with PROFILER_ENABLED 0. When compiled in, a disabled profiler
+// costs one relaxed atomic load per zone.
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+#define PROFILER_RING_SIZE 16384    // Zones kept per thread, older ones are overwritten
+#define PROFILER_FRAME_HISTORY 256  // Frame start times kept to place the zones in their frame
+
+struct ProfileZone
+{
+    const char* name; // Must outlive the profiler, string literals only
+    u64 start;        // Nanoseconds
+    u64 end;
+    u32 depth;        // Zones open on the same thread when this one started
+    u32 frame;
+};
+
+// Ring buffer of the zones closed by one thread. Only the owning thread writes to it.
+struct ProfilerThread
+{
+    ProfileZone zones[PROFILER_RING_SIZE];
+    std::atomic<u64> head; // Zones written since the thread started, the next one goes to head % PROFILER_RING_SIZE
+    u32 depth;
+    u32 id;
+    char name[32];
+};
+
+extern std::atomic<bool> GlobalProfilerEnabled;
+
+void SetProfilerEnabled(bool enabled);
+
+// Name shown for the calling thread in the exported traces and the flame view
+void SetProfilerThreadName(const char* name);
+
+// Called by the platform at the start of every frame
+void ProfilerBeginFrame();
+u32 GetProfilerFrame();
+
+u64 ProfilerBeginZone();
+void ProfilerEndZone(const char* name, u64 start);
+
+// Writes the zones of the frames [firstFrame, lastFrame] in the Chrome trace event format, also read by Perfetto
+bool ExportChromeTrace(const char* filepath, u32 firstFrame, u32 lastFrame);
+
+// Flame graph of a recent frame for every thread, plus the trace export controls
+void DrawProfilerImGui();
+
+class ProfileScope
+{
+public:
+    ProfileScope(const char* name) : m_Name(name), m_Start(0)
+    {
+        if (GlobalProfilerEnabled.load(std::memory_order_relaxed))
+            m_Start = ProfilerBeginZone();
+    }
+
+    ~ProfileScope()
+    {
+        if (m_Start)
+            ProfilerEndZone(m_Name, m_Start);
+    }
+
+private:
+    const char* m_Name;
+    u64 m_Start;
+};
+
+#define PROFILE_CONCAT_INTERNAL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INTERNAL(a, b)
+
+#if PROFILER_ENABLED
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name)
+#endif
+
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
@@ -0,0 +1,226 @@
+#include "QualityGovernor.h"
+
+#include "engine.h"
+
+#include "imgui-docking/imgui.h"
+
+static const QualityLevel QualityLevels[] =
+{
+    // name      renderScale  ssaoKernelSize  ssaoBlur  lodBias
+    { "Ultra",   1.0f,        64,             true,     0.0f },
+    { "High",    1.0f,        32,             true,     0.0f },
+    { "Medium",  0.85f,       32,             true,     0.5f },
+    { "Low",     0.75f,       16,             true,     0.5f },
+    { "Lower",   0.75f,       16,             false,    1.0f },
+    { "Lowest",  0.5f,        8,              false,    1.5f }
+};
+
+u32 GetQualityLevelCount()
+{
+    return ARRAY_COUNT(QualityLevels);
+}
+
+const QualityLevel& GetQualityLevel(u32 level)
+{
+    ASSERT(level < GetQualityLevelCount(), "Invalid quality level");
+    return QualityLevels[level];
+}
+
+void InitQualityGovernor(QualityGovernor& governor, float targetFrameTime)
+{
+    governor = {};
+    governor.enabled = true;
+    governor.targetFrameTime = targetFrameTime;
+    governor.upgradeFrames = QUALITY_UPGRADE_FRAMES;
+    governor.framesSinceUpgrade = QUALITY_MAX_UPGRADE_FRAMES;
+    governor.cooldownFrames = QUALITY_COOLDOWN_FRAMES;
+}
+
+void ApplyQualityLevel(App* app, u32 level)
+{
+    const QualityLevel& quality = GetQualityLevel(level);
+    RendererOptions& options = app->rendererOptions;
+
+    // The render targets are resized by the next Render()
+    options.renderScale = quality.renderScale;
+    options.activeSSAOBlur = quality.ssaoBlur;
+    options.lodBias = quality.lodBias;
+    if (options.ssaoKernelSize != quality.ssaoKernelSize)
+    {
+        options.ssaoKernelSize = quality.ssaoKernelSize;
+        app->renderer.GenerateKernelSamples(options.ssaoKernelSize);
+    }
+
+    app->qualityGovernor.level = level;
+}
+
+static void StepQualityLevel(App* app, u32 level, const char* reason)
+{
+    QualityGovernor& governor = app->qualityGovernor;
+
+    QualityDecision& decision = governor.decisions[governor.decisionHead];
+    decision.time = app->currentTime;
+    decision.fromLevel = governor.level;
+    decision.toLevel = level;
+    decision.gpuTime = governor.smoothedGPUTime;
+    decision.cpuTime = governor.smoothedCPUTime;
+    governor.decisionHead = (governor.decisionHead + 1) % QUALITY_DECISION_HISTORY;
+    if (governor.decisionCount < QUALITY_DECISION_HISTORY)
+        governor.decisionCount++;
+
+    ILOG("Quality governor: %s -> %s, %s (GPU %.2f ms, CPU %.2f ms, target %.2f ms)", GetQualityLevel(governor.level).name, GetQualityLevel(level).name, reason,
+        governor.smoothedGPUTime, governor.smoothedCPUTime, governor.targetFrameTime);
+
+    ApplyQualityLevel(app, level);
+
+    governor.framesOverBudget = 0;
+    governor.framesUnderBudget = 0;
+    governor.cooldownFrames = QUALITY_COOLDOWN_FRAMES;
+}
+
+void UpdateQualityGovernor(App* app)
+{
+    QualityGovernor& governor = app->qualityGovernor;
+    const GPUTimers& timers = app->renderer.gpuTimers;
+
+    // Timings are smoothed even while disabled, so enabling the governor acts on meaningful values
+    if (timers.historyHead != governor.lastGPUHistoryHead)
+    {
+        float gpuTime = 0.0f;
+        for (u32 pass = 0; pass < GPU_PASS_COUNT; ++pass)
+            gpuTime += timers.last[pass];
+
+        governor.smoothedGPUTime = governor.smoothedGPUTime > 0.0f ? glm::mix(governor.smoothedGPUTime, gpuTime, QUALITY_SMOOTHING) : gpuTime;
+        governor.lastGPUHistoryHead = timers.historyHead;
+    }
+
+    float cpuTime = float(app->cpuFrameTime);
+    governor.smoothedCPUTime = governor.smoothedCPUTime > 0.0f ? glm::mix(governor.smoothedCPUTime, cpuTime, QUALITY_SMOOTHING) : cpuTime;
+
+    if (!governor.enabled)
+        return;
+
+    governor.framesSinceUpgrade++;
+    if (governor.cooldownFrames > 0)
+    {
+        governor.cooldownFrames--;
+        return;
+    }
+
+    float gpuLoad = governor.smoothedGPUTime / governor.targetFrameTime;
+    float cpuLoad = governor.smoothedCPUTime / governor.targetFrameTime;
+
+    bool cpuBound = cpuLoad > QUALITY_DOWNGRADE_THRESHOLD && gpuLoad <= QUALITY_DOWNGRADE_THRESHOLD;
+    if (cpuBound != governor.cpuBound)
+    {
+        if (cpuBound)
+        {
+            ILOG("Quality governor: CPU bound (CPU %.2f ms, GPU %.2f ms), keeping %s", governor.smoothedCPUTime, governor.smoothedGPUTime, GetQualityLevel(governor.level).name);
+        }
+        else
+        {
+            ILOG("Quality governor: no longer CPU bound (CPU %.2f ms)", governor.smoothedCPUTime);
+        }
+        governor.cpuBound = cpuBound;
+    }
+
+    // Between the two thresholds the level is kept, and the counters restart
+    if (gpuLoad > QUALITY_DOWNGRADE_THRESHOLD)
+    {
+        governor.framesOverBudget++;
+        governor.framesUnderBudget = 0;
+    }
+    else if (gpuLoad < QUALITY_UPGRADE_THRESHOLD && cpuLoad < 1.0f)
+    {
+        governor.framesUnderBudget++;
+        governor.framesOverBudget = 0;
+    }
+    else
+    {
+        governor.framesOverBudget = 0;
+        governor.framesUnderBudget = 0;
+    }
+
+    if (governor.framesOverBudget >= QUALITY_DOWNGRADE_FRAMES && governor.level + 1 < GetQualityLevelCount())
+    {
+        // The last upgrade didn't hold, wait longer before trying it again
+        if (governor.framesSinceUpgrade < governor.upgradeFrames)
+        {
+            governor.upgradeFrames = glm::min(governor.upgradeFrames * 2, u32(QUALITY_MAX_UPGRADE_FRAMES));
+            ILOG("Quality governor: upgrade undone, next one after %u frames under budget", governor.upgradeFrames);
+        }
+        StepQualityLevel(app, governor.level + 1, "over budget");
+    }
+    else if (governor.framesUnderBudget >= governor.upgradeFrames && governor.level > 0)
+    {
+        StepQualityLevel(app, governor.level - 1, "under budget");
+        governor.framesSinceUpgrade = 0;
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+// IMGUI //
+// ------------------------------------------------------------------------------------------------
+
+void DrawQualityGovernorImGui(App* app)
+{
+    QualityGovernor& governor = app->qualityGovernor;
+    RendererOptions& options = app->rendererOptions;
+
+    ImGui::Text("Quality Governor");
+    if (ImGui::Checkbox("Adapt To Frame Budget", &governor.enabled))
+    {
+        ILOG("Quality governor %s at %s", governor.enabled ? "enabled" : "disabled", GetQualityLevel(governor.level).name);
+        if (governor.enabled)
+        {
+            ApplyQualityLevel(app, governor.level);
+            governor.framesOverBudget = 0;
+            governor.framesUnderBudget = 0;
+            governor.cooldownFrames = QUALITY_COOLDOWN_FRAMES;
+        }
+    }
+
+    int targetRate = int(glm::round(1000.0f / governor.targetFrameTime));
+    if (ImGui::SliderInt("Target (Hz)", &targetRate, 30, 144))
+        governor.targetFrameTime = 1000.0f / float(targetRate);
+
+    float gpuLoad = governor.smoothedGPUTime / governor.targetFrameTime;
+    float cpuLoad = governor.smoothedCPUTime / governor.targetFrameTime;
+    char overlay[32];
+    sprintf(overlay, "GPU %.2f ms", governor.smoothedGPUTime);
+    ImGui::ProgressBar(glm::min(gpuLoad, 1.0f), ImVec2(-1.0f, 0.0f), overlay);
+    sprintf(overlay, "CPU %.2f ms", governor.smoothedCPUTime);
+    ImGui::ProgressBar(glm::min(cpuLoad, 1.0f), ImVec2(-1.0f, 0.0f), overlay);
+
+    if (governor.enabled)
+    {
+        const QualityLevel& quality = GetQualityLevel(governor.level);
+        ImGui::Text("Level: %s (%u/%u)", quality.name, governor.level + 1, GetQualityLevelCount());
+        ImGui::Text("Render Scale: %.2f  Kernel: %d  Blur: %s  LOD Bias: %.1f", quality.renderScale, quality.ssaoKernelSize, quality.ssaoBlur ? "on" : "off", quality.lodBias);
+        if (governor.cpuBound)
+            ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.2f, 1.0f), "CPU bound, lowering the GPU quality wouldn't help");
+        else if (governor.cooldownFrames > 0)
+            ImGui::TextDisabled("Waiting for the last change to settle (%u frames)", governor.cooldownFrames);
+        else
+            ImGui::TextDisabled("Over budget %u/%u frames, under budget %u/%u frames", governor.framesOverBudget, QUALITY_DOWNGRADE_FRAMES, governor.framesUnderBudget, governor.upgradeFrames);
+    }
+    else
+    {
+        ImGui::SliderFloat("Render Scale", &options.renderScale, 0.25f, 1.0f, "%.2f");
+        ImGui::SliderFloat("Texture LOD Bias", &options.lodBias, 0.0f, 4.0f, "%.1f");
+    }
+
+    if (options.forwardRendering)
+        ImGui::TextDisabled("The render scale only applies to deferred rendering");
+
+    if (governor.decisionCount > 0 && ImGui::TreeNode("Decisions"))
+    {
+        // Newest first
+        for (u32 i = 0; i < governor.decisionCount; ++i)
+        {
+            const QualityDecision& decision = governor.decisions[(governor.decisionHead + QUALITY_DECISION_HISTORY - 1 - i) % QUALITY_DECISION_HISTORY];
+            ImGui::Text("%8.1f s  %s -> %s  GPU %.2f ms  CPU %.2f ms", decision.time, GetQualityLevel(decision.fromLevel).name, GetQualityLevel(decision.toLevel).name, decision.gpuTime, decision.cpuTime);
+        }
+        ImGui::TreePop();
+    }
+}
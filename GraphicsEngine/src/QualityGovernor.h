@@ -0,0 +1,74 @@
+#pragma once
+
+#include "platform.h"
+
+struct App;
+
+#define QUALITY_TARGET_FRAME_TIME (1000.0f / 60.0f) // ms
+
+#define QUALITY_SMOOTHING 0.05f          // Weight of the newest frame in the moving averages
+#define QUALITY_DOWNGRADE_THRESHOLD 0.9f // Fractions of the target frame time
+#define QUALITY_UPGRADE_THRESHOLD 0.7f
+#define QUALITY_DOWNGRADE_FRAMES 20      // Consecutive frames over/under the thresholds before stepping
+#define QUALITY_UPGRADE_FRAMES 120
+#define QUALITY_MAX_UPGRADE_FRAMES 3840
+#define QUALITY_COOLDOWN_FRAMES 30       // Ignored after a step, until the timings reflect it
+#define QUALITY_DECISION_HISTORY 8
+
+// Steps from the highest quality (0) down. Each one is cheaper on the GPU than the previous.
+struct QualityLevel
+{
+    const char* name;
+    float renderScale; // G-buffer, SSAO and lighting targets relative to the display
+    int ssaoKernelSize;
+    bool ssaoBlur;
+    float lodBias;     // Added to the mip level of the material textures
+};
+
+struct QualityDecision
+{
+    f64 time;
+    u32 fromLevel;
+    u32 toLevel;
+    float gpuTime;
+    float cpuTime;
+};
+
+struct QualityGovernor
+{
+    bool enabled;
+    float targetFrameTime;
+
+    // Exponential moving averages, in ms
+    float smoothedGPUTime;
+    float smoothedCPUTime;
+    u32 lastGPUHistoryHead; // New GPU timings are only sampled once they are read back
+
+    u32 level;
+    u32 framesOverBudget;
+    u32 framesUnderBudget;
+    u32 cooldownFrames;
+
+    // Doubled every time an upgrade has to be undone, so a level right at the limit isn't toggled forever
+    u32 upgradeFrames;
+    u32 framesSinceUpgrade;
+
+    bool cpuBound; // Over budget with the GPU idle enough, none of the knobs would help
+
+    QualityDecision decisions[QUALITY_DECISION_HISTORY];
+    u32 decisionHead;
+    u32 decisionCount;
+};
+
+u32 GetQualityLevelCount();
+const QualityLevel& GetQualityLevel(u32 level);
+
+void InitQualityGovernor(QualityGovernor& governor, float targetFrameTime = QUALITY_TARGET_FRAME_TIME);
+
+// Writes the knobs of a level into the renderer options
+void ApplyQualityLevel(App* app, u32 level);
+
+// Samples the frame timings and steps the quality level when needed. Called once per frame.
+void UpdateQualityGovernor(App* app);
+
+void DrawQualityGovernorImGui(App* app);
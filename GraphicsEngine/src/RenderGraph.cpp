@@ -0,0 +1,450 @@
+#include "RenderGraph.h"
+
+#include "engine.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+#include "GPUMemory.h"
+#include "Allocators.h"
+
+#include "imgui-docking/imgui.h"
+
+bool operator==(const RenderGraphTextureDesc& a, const RenderGraphTextureDesc& b)
+{
+    return a.size == b.size && a.internalFormat == b.internalFormat && a.dataFormat == b.dataFormat && a.dataType == b.dataType &&
+        a.linear == b.linear && a.clamp == b.clamp;
+}
+
+void BeginRenderGraph(RenderGraph& graph)
+{
+    graph.resources.clear();
+    graph.passes.clear();
+    graph.frameIndex++;
+}
+
+static RenderGraphResource AddResourceNode(RenderGraph& graph, const char* name, const RenderGraphTextureDesc& desc, bool imported, u32 handle)
+{
+    RenderGraphResource resource = graph.resources.size();
+
+    RenderGraphResourceNode node = {};
+    node.name = name;
+    node.desc = desc;
+    node.root = resource;
+    node.producer = RENDER_GRAPH_NO_RESOURCE;
+    node.imported = imported;
+    node.handle = handle;
+    node.firstPass = RENDER_GRAPH_NO_RESOURCE;
+    graph.resources.push_back(node);
+
+    return resource;
+}
+
+RenderGraphResource CreateRenderGraphTexture(RenderGraph& graph, const char* name, const RenderGraphTextureDesc& desc)
+{
+    return AddResourceNode(graph, name, desc, false, 0);
+}
+
+RenderGraphResource ImportRenderGraphTexture(RenderGraph& graph, const char* name, u32 handle, const RenderGraphTextureDesc& desc)
+{
+    return AddResourceNode(graph, name, desc, true, handle);
+}
+
+RenderGraphResource ImportRenderGraphBackbuffer(RenderGraph& graph, const glm::ivec2& size)
+{
+    RenderGraphTextureDesc desc = {};
+    desc.size = size;
+    return AddResourceNode(graph, "Backbuffer", desc, true, 0);
+}
+
+void MarkRenderGraphOutput(RenderGraph& graph, RenderGraphResource resource)
+{
+    RenderGraphResourceNode& node = graph.resources[resource];
+    if (!node.output)
+    {
+        node.output = true;
+        node.refCount++;
+    }
+}
+
+u32 AddRenderGraphPass(RenderGraph& graph, const char* name, GPUPass gpuPass, RenderGraphExecute execute)
+{
+    RenderGraphPass pass = {};
+    pass.name = name;
+    pass.gpuPass = gpuPass;
+    pass.execute = execute;
+    pass.depthOutput = RENDER_GRAPH_NO_RESOURCE;
+    graph.passes.push_back(pass);
+
+    return graph.passes.size() - 1;
+}
+
+void ReadRenderGraphTexture(RenderGraph& graph, u32 pass, RenderGraphResource resource)
+{
+    ASSERT(graph.passes[pass].readCount < RENDER_GRAPH_MAX_READS, "Too many reads in a render graph pass");
+
+    RenderGraphPass& renderPass = graph.passes[pass];
+    renderPass.reads[renderPass.readCount++] = resource;
+    graph.resources[resource].refCount++;
+}
+
+static RenderGraphResource WriteResource(RenderGraph& graph, u32 pass, RenderGraphResource resource)
+{
+    // Contents written by an earlier pass are drawn over, not replaced
+    if (graph.resources[resource].producer != RENDER_GRAPH_NO_RESOURCE)
+        ReadRenderGraphTexture(graph, pass, resource);
+
+    RenderGraphResourceNode version = graph.resources[resource];
+    version.producer = pass;
+    version.refCount = 0;
+    version.output = false;
+    graph.resources.push_back(version);
+
+    graph.passes[pass].refCount++;
+
+    return graph.resources.size() - 1;
+}
+
+RenderGraphResource WriteRenderGraphColor(RenderGraph& graph, u32 pass, RenderGraphResource resource)
+{
+    ASSERT(graph.passes[pass].colorOutputCount < RENDER_GRAPH_MAX_COLOR_OUTPUTS, "Too many color outputs in a render graph pass");
+
+    RenderGraphResource version = WriteResource(graph, pass, resource);
+    RenderGraphPass& renderPass = graph.passes[pass];
+    renderPass.colorOutputs[renderPass.colorOutputCount++] = version;
+
+    return version;
+}
+
+RenderGraphResource WriteRenderGraphDepth(RenderGraph& graph, u32 pass, RenderGraphResource resource)
+{
+    ASSERT(graph.passes[pass].depthOutput == RENDER_GRAPH_NO_RESOURCE, "A render graph pass can only write one depth texture");
+
+    RenderGraphResource version = WriteResource(graph, pass, resource);
+    graph.passes[pass].depthOutput = version;
+
+    return version;
+}
+
+// ------------------------------------------------------------------------------------------------
+// COMPILE //
+// ------------------------------------------------------------------------------------------------
+
+static void CullPass(RenderGraph& graph, u32 passIndex, ScratchVector<RenderGraphResource>& unreferenced)
+{
+    RenderGraphPass& pass = graph.passes[passIndex];
+    pass.culled = true;
+    graph.culledPasses++;
+
+    for (u32 i = 0; i < pass.readCount; ++i)
+    {
+        RenderGraphResourceNode& node = graph.resources[pass.reads[i]];
+        if (--node.refCount == 0 && node.producer != RENDER_GRAPH_NO_RESOURCE)
+            unreferenced.push_back(pass.reads[i]);
+    }
+}
+
+static void CullPasses(RenderGraph& graph)
+{
+    graph.culledPasses = 0;
+
+    // Walking back from the versions no pass reads, a producer goes once none of the versions it writes is needed
+    ScratchScope scratch;
+    ScratchVector<RenderGraphResource> unreferenced(GetScratchAllocator<RenderGraphResource>());
+    unreferenced.reserve(graph.resources.size());
+    for (u32 i = 0; i < graph.resources.size(); ++i)
+        if (graph.resources[i].refCount == 0 && graph.resources[i].producer != RENDER_GRAPH_NO_RESOURCE)
+            unreferenced.push_back(i);
+
+    for (u32 i = 0; i < graph.passes.size(); ++i)
+        if (graph.passes[i].refCount == 0)
+            CullPass(graph, i, unreferenced);
+
+    while (!unreferenced.empty())
+    {
+        RenderGraphResource resource = unreferenced.back();
+        unreferenced.pop_back();
+
+        RenderGraphPass& producer = graph.passes[graph.resources[resource].producer];
+        if (!producer.culled && --producer.refCount == 0)
+            CullPass(graph, graph.resources[resource].producer, unreferenced);
+    }
+}
+
+static void ExtendLifetime(RenderGraph& graph, RenderGraphResource resource, u32 pass)
+{
+    RenderGraphResourceNode& root = graph.resources[graph.resources[resource].root];
+    if (root.firstPass == RENDER_GRAPH_NO_RESOURCE)
+        root.firstPass = pass;
+    root.lastPass = pass;
+}
+
+static u32 CreatePooledTexture(const RenderGraphTextureDesc& desc, const char* name)
+{
+    u32 handle;
+    glGenTextures(1, &handle);
+    glBindTexture(GL_TEXTURE_2D, handle);
+
+    glTexImage2D(GL_TEXTURE_2D, 0, desc.internalFormat, desc.size.x, desc.size.y, 0, desc.dataFormat, desc.dataType, NULL);
+
+    GLenum filter = desc.linear ? GL_LINEAR : GL_NEAREST;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+
+    if (desc.clamp)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    TrackGPUAllocation(GPUResourceKind::TEXTURE, handle, GetTextureMemorySize(desc.internalFormat, desc.size.x, desc.size.y), GPU_MEMORY_RENDER_TARGETS, name);
+
+    return handle;
+}
+
+static void DeletePooledTexture(RenderGraph& graph, u32 poolIndex)
+{
+    u32 handle = graph.texturePool[poolIndex].handle;
+
+    // The framebuffers it was attached to can't be reused either
+    for (u32 i = 0; i < graph.framebuffers.size();)
+    {
+        RenderGraphFramebuffer& framebuffer = graph.framebuffers[i];
+        bool attached = framebuffer.depth == handle;
+        for (u32 c = 0; c < framebuffer.colorCount; ++c)
+            attached |= framebuffer.colors[c] == handle;
+
+        if (attached)
+        {
+            glDeleteFramebuffers(1, &framebuffer.handle);
+            graph.framebuffers[i] = graph.framebuffers.back();
+            graph.framebuffers.pop_back();
+        }
+        else
+            ++i;
+    }
+
+    UntrackGPUAllocation(GPUResourceKind::TEXTURE, handle);
+    glDeleteTextures(1, &handle);
+
+    graph.texturePool[poolIndex] = graph.texturePool.back();
+    graph.texturePool.pop_back();
+}
+
+static void AllocateTransientTextures(RenderGraph& graph)
+{
+    graph.transientTextures = 0;
+    graph.aliasedTextures = 0;
+
+    for (u32 i = 0; i < graph.texturePool.size(); ++i)
+        graph.texturePool[i].assigned = false;
+
+    // Roots in the order of their first pass, so a texture is only handed over once its previous resource is done
+    for (u32 passIndex = 0; passIndex < graph.passes.size(); ++passIndex)
+    {
+        for (u32 r = 0; r < graph.resources.size(); ++r)
+        {
+            RenderGraphResourceNode& node = graph.resources[r];
+            if (node.root != r || node.imported || node.firstPass != passIndex)
+                continue;
+
+            graph.transientTextures++;
+
+            u32 poolIndex = RENDER_GRAPH_NO_RESOURCE;
+            for (u32 i = 0; i < graph.texturePool.size(); ++i)
+            {
+                const RenderGraphPooledTexture& pooled = graph.texturePool[i];
+                bool available = !pooled.assigned || pooled.busyUntilPass < passIndex;
+                if (available && pooled.desc == node.desc)
+                {
+                    poolIndex = i;
+                    break;
+                }
+            }
+
+            if (poolIndex == RENDER_GRAPH_NO_RESOURCE)
+            {
+                RenderGraphPooledTexture pooled = {};
+                pooled.desc = node.desc;
+                pooled.handle = CreatePooledTexture(node.desc, node.name);
+                graph.texturePool.push_back(pooled);
+                poolIndex = graph.texturePool.size() - 1;
+            }
+
+            RenderGraphPooledTexture& pooled = graph.texturePool[poolIndex];
+            if (pooled.assigned)
+                graph.aliasedTextures++;
+            pooled.assigned = true;
+            pooled.busyUntilPass = node.lastPass;
+            pooled.lastUsedFrame = graph.frameIndex;
+            node.handle = pooled.handle;
+        }
+    }
+
+    for (u32 r = 0; r < graph.resources.size(); ++r)
+        graph.resources[r].handle = graph.resources[graph.resources[r].root].handle;
+
+    // Textures left from other sizes or options
+    for (u32 i = 0; i < graph.texturePool.size();)
+    {
+        if (graph.frameIndex - graph.texturePool[i].lastUsedFrame > RENDER_GRAPH_POOL_FRAMES)
+            DeletePooledTexture(graph, i);
+        else
+            ++i;
+    }
+}
+
+void CompileRenderGraph(RenderGraph& graph)
+{
+    PROFILE_FUNCTION();
+
+    CullPasses(graph);
+
+    for (u32 i = 0; i < graph.passes.size(); ++i)
+    {
+        const RenderGraphPass& pass = graph.passes[i];
+        if (pass.culled)
+            continue;
+
+        for (u32 r = 0; r < pass.readCount; ++r)
+            ExtendLifetime(graph, pass.reads[r], i);
+        for (u32 c = 0; c < pass.colorOutputCount; ++c)
+            ExtendLifetime(graph, pass.colorOutputs[c], i);
+        if (pass.depthOutput != RENDER_GRAPH_NO_RESOURCE)
+            ExtendLifetime(graph, pass.depthOutput, i);
+    }
+
+    AllocateTransientTextures(graph);
+}
+
+// ------------------------------------------------------------------------------------------------
+// EXECUTE //
+// ------------------------------------------------------------------------------------------------
+
+static u32 GetFramebuffer(RenderGraph& graph, const RenderGraphPass& pass)
+{
+    RenderGraphFramebuffer key = {};
+    key.colorCount = pass.colorOutputCount;
+    for (u32 c = 0; c < pass.colorOutputCount; ++c)
+        key.colors[c] = graph.resources[pass.colorOutputs[c]].handle;
+    key.depth = pass.depthOutput != RENDER_GRAPH_NO_RESOURCE ? graph.resources[pass.depthOutput].handle : 0;
+
+    // Passes drawing to the default framebuffer write nothing else
+    if (key.colorCount > 0 && key.colors[0] == 0)
+        return 0;
+
+    for (u32 i = 0; i < graph.framebuffers.size(); ++i)
+    {
+        const RenderGraphFramebuffer& framebuffer = graph.framebuffers[i];
+        if (framebuffer.colorCount == key.colorCount && framebuffer.depth == key.depth &&
+            memcmp(framebuffer.colors, key.colors, sizeof(u32) * key.colorCount) == 0)
+            return framebuffer.handle;
+    }
+
+    glGenFramebuffers(1, &key.handle);
+    glBindFramebuffer(GL_FRAMEBUFFER, key.handle);
+
+    GLenum drawBuffers[RENDER_GRAPH_MAX_COLOR_OUTPUTS];
+    for (u32 c = 0; c < key.colorCount; ++c)
+    {
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + c, key.colors[c], 0);
+        drawBuffers[c] = GL_COLOR_ATTACHMENT0 + c;
+    }
+    if (key.depth)
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, key.depth, 0);
+    glDrawBuffers(key.colorCount, drawBuffers);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        ELOG("Render graph framebuffer of pass %s is incomplete", pass.name);
+
+    graph.framebuffers.push_back(key);
+
+    return key.handle;
+}
+
+void ExecuteRenderGraph(RenderGraph& graph, App* app)
+{
+    PROFILE_FUNCTION();
+
+    for (u32 i = 0; i < graph.passes.size(); ++i)
+    {
+        const RenderGraphPass& pass = graph.passes[i];
+        if (pass.culled)
+            continue;
+
+        PROFILE_SCOPE(pass.name);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, GetFramebuffer(graph, pass));
+        CountRenderStat(RENDER_COUNTER_FRAMEBUFFER_SWITCHES);
+
+        RenderGraphResource target = pass.colorOutputCount > 0 ? pass.colorOutputs[0] : pass.depthOutput;
+        const glm::ivec2& size = graph.resources[target].desc.size;
+        glViewport(0, 0, size.x, size.y);
+
+        if (pass.gpuPass != RENDER_GRAPH_NO_GPU_PASS)
+            BeginGPUPass(app->renderer.gpuTimers, pass.gpuPass);
+
+        (app->renderer.*pass.execute)(app);
+
+        if (pass.gpuPass != RENDER_GRAPH_NO_GPU_PASS)
+            EndGPUPass(app->renderer.gpuTimers, pass.gpuPass);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+u32 GetRenderGraphTexture(const RenderGraph& graph, RenderGraphResource resource)
+{
+    return graph.resources[resource].handle;
+}
+
+bool IsRenderGraphPassCulled(const RenderGraph& graph, u32 pass)
+{
+    return graph.passes[pass].culled;
+}
+
+void DestroyRenderGraph(RenderGraph& graph)
+{
+    while (!graph.texturePool.empty())
+        DeletePooledTexture(graph, graph.texturePool.size() - 1);
+
+    for (u32 i = 0; i < graph.framebuffers.size(); ++i)
+        glDeleteFramebuffers(1, &graph.framebuffers[i].handle);
+    graph.framebuffers.clear();
+}
+
+// ------------------------------------------------------------------------------------------------
+// IMGUI //
+// ------------------------------------------------------------------------------------------------
+
+void DrawRenderGraphImGui(const RenderGraph& graph)
+{
+    u64 pooledBytes = 0;
+    for (u32 i = 0; i < graph.texturePool.size(); ++i)
+    {
+        const RenderGraphTextureDesc& desc = graph.texturePool[i].desc;
+        pooledBytes += GetTextureMemorySize(desc.internalFormat, desc.size.x, desc.size.y);
+    }
+
+    ImGui::Text("Passes: %u (%u culled)", u32(graph.passes.size()), graph.culledPasses);
+    ImGui::Text("Transient Textures: %u (%u aliased)", graph.transientTextures, graph.aliasedTextures);
+    ImGui::Text("Pooled Textures: %u, %.2f MB  Framebuffers: %u", u32(graph.texturePool.size()), f64(pooledBytes) / f64(MB(1)), u32(graph.framebuffers.size()));
+
+    for (u32 i = 0; i < graph.passes.size(); ++i)
+    {
+        const RenderGraphPass& pass = graph.passes[i];
+        if (pass.culled)
+        {
+            ImGui::TextDisabled("  %s (culled)", pass.name);
+            continue;
+        }
+
+        ImGui::Text("  %s", pass.name);
+        for (u32 c = 0; c < pass.colorOutputCount; ++c)
+        {
+            const RenderGraphResourceNode& node = graph.resources[pass.colorOutputs[c]];
+            ImGui::SameLine();
+            ImGui::TextDisabled(node.imported ? "[%s]" : "%s #%u", node.name, node.handle);
+        }
+    }
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "platform.h"
+#include "GPUTimers.h"
+
+typedef unsigned int GLenum;
+
+struct App;
+class Renderer;
+
+#define RENDER_GRAPH_MAX_COLOR_OUTPUTS 8
+#define RENDER_GRAPH_MAX_READS 16
+#define RENDER_GRAPH_NO_RESOURCE 0xFFFFFFFF
+#define RENDER_GRAPH_NO_GPU_PASS GPU_PASS_COUNT
+#define RENDER_GRAPH_POOL_FRAMES 60 // Pooled textures no pass used for this many frames are released
+
+typedef u32 RenderGraphResource;
+
+// Passes are Renderer members, they find their textures through the resources the graph was built with
+typedef void (Renderer::*RenderGraphExecute)(App* app);
+
+struct RenderGraphTextureDesc
+{
+    glm::ivec2 size;
+    GLenum internalFormat;
+    GLenum dataFormat;
+    GLenum dataType;
+    bool linear; // Filtering, sampled between texels when scaled
+    bool clamp;
+};
+
+bool operator==(const RenderGraphTextureDesc& a, const RenderGraphTextureDesc& b);
+
+// Every write makes a new version of a texture, so the passes writing it in turn are ordered and culled one by one.
+// All the versions of a texture share its root and the physical texture.
+struct RenderGraphResourceNode
+{
+    const char* name;
+    RenderGraphTextureDesc desc;
+    RenderGraphResource root;
+    u32 producer;      // Pass writing this version, RENDER_GRAPH_NO_RESOURCE for its first contents
+    u32 refCount;      // Passes reading this version, plus one when it's an output of the graph
+    bool imported;     // Owned outside the graph, e.g. the temporal history or the default framebuffer
+    bool output;
+    u32 handle;        // Texture once compiled, 0 for the default framebuffer
+
+    // Lifetime in passes, for the roots only
+    u32 firstPass;
+    u32 lastPass;
+};
+
+struct RenderGraphPass
+{
+    const char* name;
+    GPUPass gpuPass; // RENDER_GRAPH_NO_GPU_PASS when it isn't timed on its own
+    RenderGraphExecute execute;
+
+    RenderGraphResource reads[RENDER_GRAPH_MAX_READS]; // Fixed so rebuilding the graph every frame doesn't allocate
+    u32 readCount;
+    RenderGraphResource colorOutputs[RENDER_GRAPH_MAX_COLOR_OUTPUTS];
+    u32 colorOutputCount;
+    RenderGraphResource depthOutput;
+
+    u32 refCount; // Versions it writes that are still needed, culled at 0
+    bool culled;
+};
+
+struct RenderGraphPooledTexture
+{
+    RenderGraphTextureDesc desc;
+    u32 handle;
+    u32 lastUsedFrame;
+    u32 busyUntilPass; // Last pass of the resource it's assigned to in the frame being compiled
+    bool assigned;
+};
+
+struct RenderGraphFramebuffer
+{
+    u32 colors[RENDER_GRAPH_MAX_COLOR_OUTPUTS];
+    u32 colorCount;
+    u32 depth;
+    u32 handle;
+};
+
+struct RenderGraph
+{
+    // Declared every frame
+    std::vector<RenderGraphResourceNode> resources;
+    std::vector<RenderGraphPass> passes;
+
+    // Kept between frames
+    std::vector<RenderGraphPooledTexture> texturePool;
+    std::vector<RenderGraphFramebuffer> framebuffers;
+    u32 frameIndex;
+
+    // Last compile, shown in ImGui
+    u32 culledPasses;
+    u32 transientTextures;
+    u32 aliasedTextures; // Transient textures sharing a pooled texture with an earlier one
+};
+
+// Clears the passes and resources of the previous frame, the pooled textures and framebuffers are kept
+void BeginRenderGraph(RenderGraph& graph);
+
+RenderGraphResource CreateRenderGraphTexture(RenderGraph& graph, const char* name, const RenderGraphTextureDesc& desc);
+RenderGraphResource ImportRenderGraphTexture(RenderGraph& graph, const char* name, u32 handle, const RenderGraphTextureDesc& desc);
+RenderGraphResource ImportRenderGraphBackbuffer(RenderGraph& graph, const glm::ivec2& size);
+
+// The passes producing an output are never culled, nor the ones they depend on
+void MarkRenderGraphOutput(RenderGraph& graph, RenderGraphResource resource);
+
+u32 AddRenderGraphPass(RenderGraph& graph, const char* name, GPUPass gpuPass, RenderGraphExecute execute);
+void ReadRenderGraphTexture(RenderGraph& graph, u32 pass, RenderGraphResource resource);
+
+// Return the new version of the texture. Writing it also reads the previous version, its contents are kept.
+RenderGraphResource WriteRenderGraphColor(RenderGraph& graph, u32 pass, RenderGraphResource resource);
+RenderGraphResource WriteRenderGraphDepth(RenderGraph& graph, u32 pass, RenderGraphResource resource);
+
+// Culls the passes nothing needs and assigns pooled textures to the transient ones left
+void CompileRenderGraph(RenderGraph& graph);
+
+// Binds the framebuffer and viewport of every pass left and runs it
+void ExecuteRenderGraph(RenderGraph& graph, App* app);
+
+// Texture of any version of a resource, valid once compiled
+u32 GetRenderGraphTexture(const RenderGraph& graph, RenderGraphResource resource);
+bool IsRenderGraphPassCulled(const RenderGraph& graph, u32 pass);
+
+// Releases the pooled textures and framebuffers
+void DestroyRenderGraph(RenderGraph& graph);
+
+void DrawRenderGraphImGui(const RenderGraph& graph);
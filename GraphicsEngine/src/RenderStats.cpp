@@ -0,0 +1,205 @@
+#include "RenderStats.h"
+
+#include "glad/glad.h"
+#include "imgui-docking/imgui.h"
+
+RenderStats GlobalRenderStats = {};
+
+static const char* RenderCounterNames[RENDER_COUNTER_COUNT] =
+{
+    "Draw Calls",
+    "Instances",
+    "Triangles",
+    "Vertices",
+    "Program Binds",
+    "VAO Binds",
+    "Texture Binds",
+    "Uniform Sets",
+    "Bytes Uploaded",
+    "Framebuffer Switches"
+};
+
+static const char* PipelineStatisticNames[PIPELINE_STAT_COUNT] =
+{
+    "VS Invocations",
+    "FS Invocations",
+    "Clipping Input",
+    "Clipping Output"
+};
+
+static const GLenum PipelineStatisticTargets[PIPELINE_STAT_COUNT] =
+{
+    GL_VERTEX_SHADER_INVOCATIONS_ARB,
+    GL_FRAGMENT_SHADER_INVOCATIONS_ARB,
+    GL_CLIPPING_INPUT_PRIMITIVES_ARB,
+    GL_CLIPPING_OUTPUT_PRIMITIVES_ARB
+};
+
+const char* GetRenderCounterName(RenderCounter counter)
+{
+    return RenderCounterNames[counter];
+}
+
+const char* GetPipelineStatisticName(PipelineStatistic statistic)
+{
+    return PipelineStatisticNames[statistic];
+}
+
+void InitRenderStats(const std::vector<std::string>& extensions)
+{
+    RenderStats& stats = GlobalRenderStats;
+    stats.currentPass = RENDER_STATS_OTHER; // Outside any pass until the render begins one
+
+    for (u32 i = 0; i < extensions.size(); ++i)
+        if (extensions[i] == "GL_ARB_pipeline_statistics_query")
+            stats.pipelineStatsSupported = true;
+
+    if (stats.pipelineStatsSupported)
+        glGenQueries(GPU_TIMER_FRAMES * GPU_PASS_COUNT * PIPELINE_STAT_COUNT, &stats.queries[0][0][0]);
+    else
+        ILOG("GL_ARB_pipeline_statistics_query is not supported, only the CPU side counters are recorded");
+}
+
+void DestroyRenderStats()
+{
+    if (GlobalRenderStats.pipelineStatsSupported)
+        glDeleteQueries(GPU_TIMER_FRAMES * GPU_PASS_COUNT * PIPELINE_STAT_COUNT, &GlobalRenderStats.queries[0][0][0]);
+}
+
+void BeginRenderStatsPass(GPUPass pass)
+{
+    RenderStats& stats = GlobalRenderStats;
+    stats.currentPass = pass;
+
+    if (stats.pipelineStatsSupported)
+    {
+        for (u32 i = 0; i < PIPELINE_STAT_COUNT; ++i)
+            glBeginQuery(PipelineStatisticTargets[i], stats.queries[stats.frameIndex][pass][i]);
+    }
+}
+
+void EndRenderStatsPass(GPUPass pass)
+{
+    RenderStats& stats = GlobalRenderStats;
+    stats.currentPass = RENDER_STATS_OTHER;
+
+    if (stats.pipelineStatsSupported)
+    {
+        for (u32 i = 0; i < PIPELINE_STAT_COUNT; ++i)
+            glEndQuery(PipelineStatisticTargets[i]);
+        stats.issued[stats.frameIndex][pass] = true;
+    }
+}
+
+void BeginRenderStatsFrame()
+{
+    RenderStats& stats = GlobalRenderStats;
+    if (!stats.pipelineStatsSupported)
+        return;
+
+    // Passes whose results aren't ready keep the previous values instead of waiting for the GPU
+    u32 slot = stats.frameIndex;
+    for (u32 pass = 0; pass < GPU_PASS_COUNT; ++pass)
+    {
+        if (!stats.issued[slot][pass])
+            continue;
+
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(stats.queries[slot][pass][PIPELINE_STAT_COUNT - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available)
+        {
+            for (u32 i = 0; i < PIPELINE_STAT_COUNT; ++i)
+            {
+                GLuint64 result = 0;
+                glGetQueryObjectui64v(stats.queries[slot][pass][i], GL_QUERY_RESULT, &result);
+                stats.pipelineStats[pass][i] = result;
+            }
+        }
+        stats.issued[slot][pass] = false;
+    }
+}
+
+void EndRenderStatsFrame()
+{
+    RenderStats& stats = GlobalRenderStats;
+    memcpy(stats.lastCounters, stats.counters, sizeof(stats.counters));
+    memset(stats.counters, 0, sizeof(stats.counters));
+    stats.frameIndex = (stats.frameIndex + 1) % GPU_TIMER_FRAMES;
+}
+
+u64 GetRenderCounter(RenderCounter counter, u32 pass)
+{
+    return GlobalRenderStats.lastCounters[pass][counter];
+}
+
+u64 GetRenderCounter(RenderCounter counter)
+{
+    u64 total = 0;
+    for (u32 pass = 0; pass < RENDER_STATS_PASS_COUNT; ++pass)
+        total += GlobalRenderStats.lastCounters[pass][counter];
+    return total;
+}
+
+u64 GetPipelineStatistic(PipelineStatistic statistic, GPUPass pass)
+{
+    return GlobalRenderStats.pipelineStats[pass][statistic];
+}
+
+// ------------------------------------------------------------------------------------------------
+// IMGUI //
+// ------------------------------------------------------------------------------------------------
+
+void DrawRenderStatsImGui()
+{
+    const RenderStats& stats = GlobalRenderStats;
+
+    const ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollX | ImGuiTableFlags_SizingFixedFit;
+    if (ImGui::BeginTable("Render Counters", RENDER_STATS_PASS_COUNT + 2, flags))
+    {
+        ImGui::TableSetupColumn("Counter");
+        for (u32 pass = 0; pass < GPU_PASS_COUNT; ++pass)
+            ImGui::TableSetupColumn(GetGPUPassName(GPUPass(pass)));
+        ImGui::TableSetupColumn("Other");
+        ImGui::TableSetupColumn("Total");
+        ImGui::TableHeadersRow();
+
+        for (u32 counter = 0; counter < RENDER_COUNTER_COUNT; ++counter)
+        {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", RenderCounterNames[counter]);
+            for (u32 pass = 0; pass < RENDER_STATS_PASS_COUNT; ++pass)
+            {
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu", stats.lastCounters[pass][counter]);
+            }
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", GetRenderCounter(RenderCounter(counter)));
+        }
+
+        if (stats.pipelineStatsSupported)
+        {
+            for (u32 statistic = 0; statistic < PIPELINE_STAT_COUNT; ++statistic)
+            {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text("%s", PipelineStatisticNames[statistic]);
+                u64 total = 0;
+                for (u32 pass = 0; pass < GPU_PASS_COUNT; ++pass)
+                {
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%llu", stats.pipelineStats[pass][statistic]);
+                    total += stats.pipelineStats[pass][statistic];
+                }
+                ImGui::TableNextColumn();
+                ImGui::TextDisabled("-");
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu", total);
+            }
+        }
+        ImGui::EndTable();
+    }
+
+    if (!stats.pipelineStatsSupported)
+        ImGui::TextDisabled("Shader invocation counts need GL_ARB_pipeline_statistics_query");
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "platform.h"
+#include "GPUTimers.h"
+
+// ARB_pipeline_statistics_query is not part of the generated loader
+#ifndef GL_VERTEX_SHADER_INVOCATIONS_ARB
+#define GL_VERTEX_SHADER_INVOCATIONS_ARB   0x82F0
+#define GL_FRAGMENT_SHADER_INVOCATIONS_ARB 0x82F4
+#define GL_CLIPPING_INPUT_PRIMITIVES_ARB   0x82F6
+#define GL_CLIPPING_OUTPUT_PRIMITIVES_ARB  0x82F7
+#endif
+
+// Work outside of any pass (uploads in Update, ImGui...) is counted here
+#define RENDER_STATS_OTHER GPU_PASS_COUNT
+#define RENDER_STATS_PASS_COUNT (GPU_PASS_COUNT + 1)
+
+enum RenderCounter
+{
+    RENDER_COUNTER_DRAW_CALLS,
+    RENDER_COUNTER_INSTANCES,
+    RENDER_COUNTER_TRIANGLES,
+    RENDER_COUNTER_VERTICES,
+    RENDER_COUNTER_PROGRAM_BINDS,
+    RENDER_COUNTER_VAO_BINDS,
+    RENDER_COUNTER_TEXTURE_BINDS,
+    RENDER_COUNTER_UNIFORM_SETS,
+    RENDER_COUNTER_BYTES_UPLOADED,
+    RENDER_COUNTER_FRAMEBUFFER_SWITCHES,
+    RENDER_COUNTER_COUNT
+};
+
+enum PipelineStatistic
+{
+    PIPELINE_STAT_VERTEX_INVOCATIONS,
+    PIPELINE_STAT_FRAGMENT_INVOCATIONS,
+    PIPELINE_STAT_CLIPPING_INPUT,
+    PIPELINE_STAT_CLIPPING_OUTPUT,
+    PIPELINE_STAT_COUNT
+};
+
+struct RenderStats
+{
+    u32 currentPass;
+    u64 counters[RENDER_STATS_PASS_COUNT][RENDER_COUNTER_COUNT];     // Being recorded
+    u64 lastCounters[RENDER_STATS_PASS_COUNT][RENDER_COUNTER_COUNT]; // Last complete frame
+
+    // Pipeline statistics queries, buffered like the GPU timers so reading them back never stalls
+    bool pipelineStatsSupported;
+    u32 queries[GPU_TIMER_FRAMES][GPU_PASS_COUNT][PIPELINE_STAT_COUNT];
+    bool issued[GPU_TIMER_FRAMES][GPU_PASS_COUNT];
+    u32 frameIndex;
+    u64 pipelineStats[GPU_PASS_COUNT][PIPELINE_STAT_COUNT]; // Latest frame whose results were available
+};
+
+// Global so the shader, buffer and framebuffer wrappers can count without a reference to the renderer
+extern RenderStats GlobalRenderStats;
+
+inline void CountRenderStat(RenderCounter counter, u64 amount = 1)
+{
+    GlobalRenderStats.counters[GlobalRenderStats.currentPass][counter] += amount;
+}
+
+// Indexed triangle lists
+inline void CountDrawCall(u32 indexCount, u32 instanceCount = 1)
+{
+    CountRenderStat(RENDER_COUNTER_DRAW_CALLS);
+    CountRenderStat(RENDER_COUNTER_INSTANCES, instanceCount);
+    CountRenderStat(RENDER_COUNTER_TRIANGLES, u64(indexCount / 3) * instanceCount);
+    CountRenderStat(RENDER_COUNTER_VERTICES, u64(indexCount) * instanceCount);
+}
+
+const char* GetRenderCounterName(RenderCounter counter);
+const char* GetPipelineStatisticName(PipelineStatistic statistic);
+
+void InitRenderStats(const std::vector<std::string>& extensions);
+void DestroyRenderStats();
+
+// Called from BeginGPUPass/EndGPUPass, so every timed pass is also counted
+void BeginRenderStatsPass(GPUPass pass);
+void EndRenderStatsPass(GPUPass pass);
+
+// Called at the start of the frame's render to collect the pipeline statistics of the oldest frame in flight
+void BeginRenderStatsFrame();
+// Makes the counters of the frame available through GetRenderCounter and starts a new one
+void EndRenderStatsFrame();
+
+// Last complete frame, for a single pass or summed over all of them (including RENDER_STATS_OTHER)
+u64 GetRenderCounter(RenderCounter counter, u32 pass);
+u64 GetRenderCounter(RenderCounter counter);
+u64 GetPipelineStatistic(PipelineStatistic statistic, GPUPass pass);
+
+void DrawRenderStatsImGui();
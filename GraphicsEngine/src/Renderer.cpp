@@ -2,84 +2,85 @@
 
 #include "engine.h"
 #include "Entity.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+#include "GPUMemory.h"
 
 #include <random>
 
 void Renderer::Init(App* app)
 {
-    // SCREEN QUAD //
-    Shader& screenQuadShader = app->shaderPrograms[screenQuad.shaderID];
-    screenQuadShader.Bind();
-    screenQuadShader.SetUniform1i("uRenderTarget", 0);
+    InitGPUTimers(gpuTimers);
 
-    screenQuad.FBO.Generate();
-    screenQuad.FBO.Bind();
-    screenQuad.FBO.AttachColorTexture(FBAttachmentType::COLOR_BYTE, app->displaySize); // Final Color Buffer
-    screenQuad.FBO.SetColorBuffers(); // Set color buffers with glDrawBuffers
-    BindDefaultFramebuffer();
+    renderSize = app->displaySize;
+    screenQuad.currentRenderTarget = RENDER_TARGET_FINAL_COLOR;
+
+    // TEMPORAL UPSAMPLING //
+    for (u32 i = 0; i < 2; ++i)
+    {
+        temporalHistory[i].Generate();
+        temporalHistory[i].Bind();
+        temporalHistory[i].AttachColorTexture(FBAttachmentType::COLOR_FLOAT, app->displaySize, true);
+        temporalHistory[i].SetColorBuffers();
+        BindDefaultFramebuffer();
 
-    screenQuad.currentRenderTarget = screenQuad.FBO.colorAttachmentHandles[0];
+        // Reprojected history lands between texels
+        glBindTexture(GL_TEXTURE_2D, temporalHistory[i].colorAttachmentHandles[0]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    temporalHistoryIndex = 0;
+    temporalHistoryValid = false;
+
+    Shader& temporalResolveShader = app->shaderPrograms[temporalResolveShaderID];
+    temporalResolveShader.SetSamplerUnit("uCurrentColor", 0);
+    temporalResolveShader.SetSamplerUnit("uVelocity", 1);
+    temporalResolveShader.SetSamplerUnit("uDepth", 2);
+    temporalResolveShader.SetSamplerUnit("uHistory", 3);
+
+    // SCREEN QUAD //
+    Shader& screenQuadShader = app->shaderPrograms[screenQuad.shaderID];
+    screenQuadShader.SetSamplerUnit("uRenderTarget", 0);
 
     // SKYBOX //
     Shader& skyboxShader = app->shaderPrograms[skyboxShaderID];
-    skyboxShader.Bind();
-    skyboxShader.SetUniform1i("uEnvironmentMap", 0);
+    skyboxShader.SetSamplerUnit("uEnvironmentMap", 0);
 
     // DEFERRED RENDERING //
-    GBuffer.Generate();
-    GBuffer.Bind();
-    GBuffer.AttachColorTexture(FBAttachmentType::COLOR_FLOAT, app->displaySize, true); // Position Color Buffer
-    GBuffer.AttachColorTexture(FBAttachmentType::COLOR_FLOAT, app->displaySize);       // Normal Color Buffer
-    GBuffer.AttachColorTexture(FBAttachmentType::COLOR_BYTE, app->displaySize);        // Albedo Color Buffer
-    GBuffer.AttachColorTexture(FBAttachmentType::COLOR_BYTE, app->displaySize);        // Specular Color Buffer
-    GBuffer.AttachColorTexture(FBAttachmentType::COLOR_BYTE, app->displaySize);        // Reflective + Shininess Color Buffer
-    GBuffer.AttachDepthTexture(app->displaySize);                                      // Depth Attachment
-    GBuffer.SetColorBuffers(); // Set color buffers with glDrawBuffers
-    BindDefaultFramebuffer();
-
     Shader& lightingPassShader = app->shaderPrograms[lightingPassShaderID];
-    lightingPassShader.Bind();
-    lightingPassShader.SetUniform1i("gBufPosition", 0);
-    lightingPassShader.SetUniform1i("gBufNormal", 1);
-    lightingPassShader.SetUniform1i("gBufAlbedo", 2);
-    lightingPassShader.SetUniform1i("gBufSpecular", 3);
-    lightingPassShader.SetUniform1i("gBufReflShini", 4);
-    lightingPassShader.SetUniform1i("uEnvironmentMap", 5);
-    lightingPassShader.SetUniform1i("uIrradianceMap", 6);
-    lightingPassShader.SetUniform1i("uSSAOColor", 7);
+    lightingPassShader.SetSamplerUnit("gBufPosition", 0);
+    lightingPassShader.SetSamplerUnit("gBufNormal", 1);
+    lightingPassShader.SetSamplerUnit("gBufAlbedo", 2);
+    lightingPassShader.SetSamplerUnit("gBufSpecular", 3);
+    lightingPassShader.SetSamplerUnit("gBufReflShini", 4);
+    lightingPassShader.SetSamplerUnit("uEnvironmentMap", 5);
+    lightingPassShader.SetSamplerUnit("uIrradianceMap", 6);
+    lightingPassShader.SetSamplerUnit("uSSAOColor", 7);
+    lightingPassShader.SetSamplerUnit("uCascadeShadowMap", 8);
+    lightingPassShader.SetSamplerUnit("uPointShadowMap", 9);
 
     // SSAO //
-    ssaoBuffer.Generate();
-    ssaoBuffer.Bind();
-    ssaoBuffer.AttachColorTexture(FBAttachmentType::COLOR_R, app->displaySize, true);
-    ssaoBuffer.SetColorBuffers();
-    BindDefaultFramebuffer();
-
-    ssaoBlurBuffer.Generate();
-    ssaoBlurBuffer.Bind();
-    ssaoBlurBuffer.AttachColorTexture(FBAttachmentType::COLOR_R, app->displaySize, true);
-    ssaoBlurBuffer.SetColorBuffers();
-    BindDefaultFramebuffer();
-
-    GenerateKernelSamples(app->shaderPrograms[ssaoShaderID], app->rendererOptions.ssaoKernelSize);
+    GenerateKernelSamples(app->rendererOptions.ssaoKernelSize);
     GenerateKernelNoise(app->rendererOptions.ssaoNoiseSize);
 
     Shader& SSAOShader = app->shaderPrograms[ssaoShaderID];
-    SSAOShader.Bind();
-    SSAOShader.SetUniform1i("gBufPosition", 0);
-    SSAOShader.SetUniform1i("gBufNormal", 1);
-    SSAOShader.SetUniform1i("gBufDepth", 2);
-    SSAOShader.SetUniform1i("uNoiseTexture", 3);
-    for (u32 i = 0; i < 64; ++i)
-        SSAOShader.SetUniform3f("uSamples[" + std::to_string(i) + "]", ssaoKernel[i]);
+    SSAOShader.SetSamplerUnit("gBufPosition", 0);
+    SSAOShader.SetSamplerUnit("gBufNormal", 1);
+    SSAOShader.SetSamplerUnit("gBufDepth", 2);
+    SSAOShader.SetSamplerUnit("uNoiseTexture", 3);
 
     Shader& SSAOBlurShader = app->shaderPrograms[ssaoBlurShaderID];
-    SSAOBlurShader.Bind();
-    SSAOBlurShader.SetUniform1i("uSSAOColor", 0);
+    SSAOBlurShader.SetSamplerUnit("uSSAOColor", 0);
+
+    // SHADOWS //
+    InitShadowMaps(shadowMaps, shadowDepthShaderID);
 }
 
 void Renderer::ForwardRender(App* app)
 {
+    PROFILE_FUNCTION();
+
     BindDefaultFramebuffer();
 
 	glEnable(GL_DEPTH_TEST);
@@ -88,345 +89,517 @@ void Renderer::ForwardRender(App* app)
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    for (u32 i = 0; i < app->numEntities; ++i)
+    BeginGPUPass(gpuTimers, GPU_PASS_GEOMETRY);
+
+    // Light casters are drawn in the same loop as the meshes, but timed on their own
+    GeometryBindState bindState = {};
+    for (u32 archetypeIndex = 0; archetypeIndex < ENTITY_ARCHETYPE_COUNT; ++archetypeIndex)
     {
-        Entity& entity = app->entities[i];
-        Shader& shader = app->shaderPrograms[entity.shaderID];
-        Model* model = entity.model;
+        const EntityArchetypeStorage& archetype = app->entities.archetypes[archetypeIndex];
+        if (archetypeIndex == ENTITY_ARCHETYPE_LIGHT_CASTER)
+        {
+            EndGPUPass(gpuTimers, GPU_PASS_GEOMETRY);
+            BeginGPUPass(gpuTimers, GPU_PASS_LIGHT_CASTERS);
+        }
 
-        glBindBufferRange(GL_UNIFORM_BUFFER, 1, app->UBO.handle, entity.localParamOffset, entity.localParamSize);
+        for (u32 i = 0; i < archetype.count; ++i)
+        {
+            if (!archetype.visibility[i])
+                continue;
 
-        shader.Bind();
+            // Entities are drawn with the default shader until their own program finishes compiling
+            u32 entityShaderID = archetype.shaderIDs[i];
+            u32 shaderID = app->shaderPrograms[entityShaderID].IsReady() ? entityShaderID : forwardShadersID[0];
+            Shader& shader = app->shaderPrograms[shaderID];
+            Model* model = archetype.models[i];
 
-        u32 numMeshes = model->meshes.size();
-        for (u32 meshIndex = 0; meshIndex < numMeshes; ++meshIndex)
-        {
-            u32 vao = FindVAO(model, meshIndex, shader);
-            glBindVertexArray(vao);
+            glBindBufferRange(GL_UNIFORM_BUFFER, LOCAL_PARAMETERS_BINDING, app->UBO.handle, archetype.localParamOffsets[i], sizeof(LocalParameters));
 
-            u32 meshMaterialID = model->materialIDs[meshIndex];
-            Material& meshMaterial = app->materials[meshMaterialID];
+            shader.Bind();
 
-            // Uniforms
-            switch (shader.type)
-            {
-            case ShaderType::DEFAULT:
-            {
-                // Material
-                shader.SetUniform3f("uMaterial.albedo", meshMaterial.albedo);
-                shader.SetUniform3f("uMaterial.specular", meshMaterial.specular);
-                shader.SetUniform3f("uMaterial.reflective", meshMaterial.reflective);
-                shader.SetUniform1f("uMaterial.shininess", meshMaterial.shininess * 256.0f);
-
-                // Environment Map
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_CUBE_MAP, environmentMapHandle);
-
-                // Irradiance Map
-                glActiveTexture(GL_TEXTURE1);
-                glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMapHandle);
-
-                shader.SetUniform1i("uRendererOptions.uActiveIrradiance", app->rendererOptions.activeIrradiance);
-                shader.SetUniform1i("uRendererOptions.uActiveReflection", app->rendererOptions.activeReflection);
-                shader.SetUniform1i("uRendererOptions.uActiveRefraction", app->rendererOptions.activeRefraction);
-            }
-            break;
-            case ShaderType::TEXTURED_ALBEDO:
+            u32 numMeshes = model->meshes.size();
+            for (u32 meshIndex = 0; meshIndex < numMeshes; ++meshIndex)
             {
-                // Albedo Map
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, app->textures[meshMaterial.albedoTextureID].handle);
-
-                // Material
-                shader.SetUniform3f("uMaterial.specular", meshMaterial.specular);
-                shader.SetUniform3f("uMaterial.reflective", meshMaterial.reflective);
-                shader.SetUniform1f("uMaterial.shininess", meshMaterial.shininess * 256.0f);
-
-                // Environment Map
-                glActiveTexture(GL_TEXTURE1);
-                glBindTexture(GL_TEXTURE_CUBE_MAP, environmentMapHandle);
-
-                // Irradiance Map
-                glActiveTexture(GL_TEXTURE2);
-                glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMapHandle);
-
-                shader.SetUniform1i("uRendererOptions.uActiveIrradiance", app->rendererOptions.activeIrradiance);
-                shader.SetUniform1i("uRendererOptions.uActiveReflection", app->rendererOptions.activeReflection);
-                shader.SetUniform1i("uRendererOptions.uActiveRefraction", app->rendererOptions.activeRefraction);
-            }
-            break;
-            case ShaderType::TEXTURED_ALB_SPEC:
-            {
-                // Albedo Map
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, app->textures[meshMaterial.albedoTextureID].handle);
+                Mesh& mesh = model->meshes[meshIndex];
+                BindMeshGeometry(app->geometryArena, mesh, bindState);
+
+                u32 meshMaterialID = model->materialIDs[meshIndex];
+                Material& meshMaterial = app->materials[meshMaterialID];
+
+                // Uniforms
+                switch (shader.type)
+                {
+                case ShaderType::DEFAULT:
+                {
+                    // Material
+                    shader.SetUniform3f("uMaterial.albedo", meshMaterial.albedo);
+                    shader.SetUniform3f("uMaterial.specular", meshMaterial.specular);
+                    shader.SetUniform3f("uMaterial.reflective", meshMaterial.reflective);
+                    shader.SetUniform1f("uMaterial.shininess", meshMaterial.shininess * 256.0f);
+
+                    // Environment Map
+                    BindTexture(GL_TEXTURE0, GL_TEXTURE_CUBE_MAP, environmentMapHandle);
+
+                    // Irradiance Map
+                    BindTexture(GL_TEXTURE1, GL_TEXTURE_CUBE_MAP, irradianceMapHandle);
+                }
+                break;
+                case ShaderType::TEXTURED_ALBEDO:
+                {
+                    // Albedo Map
+                    BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, app->textures[meshMaterial.albedoTextureID].handle);
+
+                    // Material
+                    shader.SetUniform3f("uMaterial.specular", meshMaterial.specular);
+                    shader.SetUniform3f("uMaterial.reflective", meshMaterial.reflective);
+                    shader.SetUniform1f("uMaterial.shininess", meshMaterial.shininess * 256.0f);
+
+                    // Environment Map
+                    BindTexture(GL_TEXTURE1, GL_TEXTURE_CUBE_MAP, environmentMapHandle);
+
+                    // Irradiance Map
+                    BindTexture(GL_TEXTURE2, GL_TEXTURE_CUBE_MAP, irradianceMapHandle);
+                }
+                break;
+                case ShaderType::TEXTURED_ALB_SPEC:
+                {
+                    // Albedo Map
+                    BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, app->textures[meshMaterial.albedoTextureID].handle);
 
-                // Specular Map
-                glActiveTexture(GL_TEXTURE1);
-                glBindTexture(GL_TEXTURE_2D, app->textures[meshMaterial.specularTextureID].handle);
+                    // Specular Map
+                    BindTexture(GL_TEXTURE1, GL_TEXTURE_2D, app->textures[meshMaterial.specularTextureID].handle);
 
-                // Material
-                shader.SetUniform3f("uMaterial.reflective", meshMaterial.reflective);
-                shader.SetUniform1f("uMaterial.shininess", meshMaterial.shininess * 256.0f);
+                    // Material
+                    shader.SetUniform3f("uMaterial.reflective", meshMaterial.reflective);
+                    shader.SetUniform1f("uMaterial.shininess", meshMaterial.shininess * 256.0f);
 
-                // Environment Map
-                glActiveTexture(GL_TEXTURE2);
-                glBindTexture(GL_TEXTURE_CUBE_MAP, environmentMapHandle);
+                    // Environment Map
+                    BindTexture(GL_TEXTURE2, GL_TEXTURE_CUBE_MAP, environmentMapHandle);
 
-                // Irradiance Map
-                glActiveTexture(GL_TEXTURE3);
-                glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMapHandle);
+                    // Irradiance Map
+                    BindTexture(GL_TEXTURE3, GL_TEXTURE_CUBE_MAP, irradianceMapHandle);
+                }
+                break;
+                case ShaderType::LIGHT_CASTER:
+                {
+                    shader.SetUniform3f("uLightColor", GetRenderFrame(app).lights[i].color);
+                }
+                break;
+                }
 
-                shader.SetUniform1i("uRendererOptions.uActiveIrradiance", app->rendererOptions.activeIrradiance);
-                shader.SetUniform1i("uRendererOptions.uActiveReflection", app->rendererOptions.activeReflection);
-                shader.SetUniform1i("uRendererOptions.uActiveRefraction", app->rendererOptions.activeRefraction);
-            }
-            break;
-            case ShaderType::LIGHT_CASTER:
-            {
-                shader.SetUniform3f("uLightColor", app->lights[i - app->firstLightEntityID].color);
-            }
-            break;
-            }
+                glDrawElementsBaseVertex(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, (void*)(u64)(mesh.firstIndex * sizeof(u32)), mesh.baseVertex);
 
-            Mesh& mesh = model->meshes[meshIndex];
-            glDrawElements(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_INT, (void*)(u64)mesh.indexOffset);
-            glBindVertexArray(0);
+                CountDrawCall(mesh.indexCount);
+            }
+            shader.Unbind();
         }
-        shader.Unbind();
     }
+    glBindVertexArray(0);
+
+    EndGPUPass(gpuTimers, GPU_PASS_LIGHT_CASTERS);
 }
 
-void Renderer::DeferredRender(App* app)
+static RenderGraphTextureDesc TextureDesc(const glm::ivec2& size, GLenum internalFormat, GLenum dataFormat, GLenum dataType, bool linear = false, bool clamp = false)
 {
-    // DEFERRED RENDERING: GEOMETRY PASS //
-    GBuffer.Bind();
+    RenderGraphTextureDesc desc;
+    desc.size = size;
+    desc.internalFormat = internalFormat;
+    desc.dataFormat = dataFormat;
+    desc.dataType = dataType;
+    desc.linear = linear;
+    desc.clamp = clamp;
+    return desc;
+}
 
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_CULL_FACE);
-    glEnable(GL_BLEND);
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+void Renderer::BuildDeferredGraph(App* app)
+{
+    PROFILE_FUNCTION();
 
-    for (u32 i = 0; i < app->firstLightEntityID; ++i)
-    {
-        Entity& entity = app->entities[i];
-        Shader& shader = app->shaderPrograms[entity.shaderID];
-        Model* model = entity.model;
+    const RendererOptions& options = GetRenderFrame(app).rendererOptions;
+    DeferredResources& resources = deferredResources;
+    RenderGraph& graph = renderGraph;
+
+    BeginRenderGraph(graph);
 
-        glBindBufferRange(GL_UNIFORM_BUFFER, 1, app->UBO.handle, entity.localParamOffset, entity.localParamSize);
+    bool showingVelocity = screenQuad.currentRenderTarget == RENDER_TARGET_GBUFFER + GBUFFER_VELOCITY;
+    bool velocityNeeded = options.activeTemporalUpsampling || showingVelocity;
 
-        shader.Bind();
+    // GEOMETRY PASS //
+    const RenderGraphTextureDesc gBufferDescs[GBUFFER_TARGET_COUNT] =
+    {
+        TextureDesc(renderSize, GL_RGBA16F, GL_RGBA, GL_FLOAT, false, true), // Position
+        TextureDesc(renderSize, GL_RGBA16F, GL_RGBA, GL_FLOAT),              // Normal
+        TextureDesc(renderSize, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE),        // Albedo
+        TextureDesc(renderSize, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE),        // Specular
+        TextureDesc(renderSize, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE),        // Reflective + Shininess
+        TextureDesc(renderSize, GL_RG16F, GL_RG, GL_FLOAT)                   // Velocity
+    };
+    static const char* gBufferNames[GBUFFER_TARGET_COUNT] =
+    {
+        "G-Buffer Position", "G-Buffer Normal", "G-Buffer Albedo", "G-Buffer Specular", "G-Buffer Reflective + Shininess", "G-Buffer Velocity"
+    };
 
-        u32 numMeshes = model->meshes.size();
-        for (u32 meshIndex = 0; meshIndex < numMeshes; ++meshIndex)
+    u32 geometryPass = AddRenderGraphPass(graph, "Geometry", GPU_PASS_GEOMETRY, &Renderer::GeometryPass);
+    for (u32 i = 0; i < GBUFFER_TARGET_COUNT; ++i)
+    {
+        // The velocity is the last attachment, without it the shader's output is dropped
+        if (i == GBUFFER_VELOCITY && !velocityNeeded)
         {
-            u32 vao = FindVAO(model, meshIndex, shader);
-            glBindVertexArray(vao);
+            resources.gBuffer[i] = RENDER_GRAPH_NO_RESOURCE;
+            continue;
+        }
+        resources.gBuffer[i] = WriteRenderGraphColor(graph, geometryPass, CreateRenderGraphTexture(graph, gBufferNames[i], gBufferDescs[i]));
+    }
+    RenderGraphTextureDesc depthDesc = TextureDesc(renderSize, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT);
+    resources.depth = WriteRenderGraphDepth(graph, geometryPass, CreateRenderGraphTexture(graph, "G-Buffer Depth", depthDesc));
+    RenderGraphResource gBufferDepth = resources.depth;
 
-            u32 meshMaterialID = model->materialIDs[meshIndex];
-            Material& meshMaterial = app->materials[meshMaterialID];
+    // SSAO //
+    RenderGraphResource ambientOcclusion = RENDER_GRAPH_NO_RESOURCE;
+    if (options.activeSSAO)
+    {
+        RenderGraphTextureDesc ssaoDesc = TextureDesc(renderSize, GL_RED, GL_RED, GL_FLOAT, false, true);
 
-            // Uniforms
-            switch (shader.type)
-            {
-            case ShaderType::DEFAULT:
-            {
-                // Material
-                shader.SetUniform3f("uMaterial.albedo", meshMaterial.albedo);
-                shader.SetUniform3f("uMaterial.specular", meshMaterial.specular);
-                shader.SetUniform3f("uMaterial.reflective", meshMaterial.reflective);
-                shader.SetUniform1f("uMaterial.shininess", meshMaterial.shininess);
-            }
-            break;
-            case ShaderType::TEXTURED_ALBEDO:
-            {
-                // Albedo Map
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, app->textures[meshMaterial.albedoTextureID].handle);
-
-                // Material
-                shader.SetUniform3f("uMaterial.specular", meshMaterial.specular);
-                shader.SetUniform3f("uMaterial.reflective", meshMaterial.reflective);
-                shader.SetUniform1f("uMaterial.shininess", meshMaterial.shininess);
-            }
-            break;
-            case ShaderType::TEXTURED_ALB_SPEC:
-            {
-                // Albedo Map
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, app->textures[meshMaterial.albedoTextureID].handle);
+        u32 ssaoPass = AddRenderGraphPass(graph, "SSAO", GPU_PASS_SSAO, &Renderer::SSAOPass);
+        ReadRenderGraphTexture(graph, ssaoPass, resources.gBuffer[GBUFFER_POSITION]);
+        ReadRenderGraphTexture(graph, ssaoPass, resources.gBuffer[GBUFFER_NORMAL]);
+        ReadRenderGraphTexture(graph, ssaoPass, gBufferDepth);
+        resources.ssao = WriteRenderGraphColor(graph, ssaoPass, CreateRenderGraphTexture(graph, "SSAO", ssaoDesc));
+        ambientOcclusion = resources.ssao;
 
-                // Specular Map
-                glActiveTexture(GL_TEXTURE1);
-                glBindTexture(GL_TEXTURE_2D, app->textures[meshMaterial.specularTextureID].handle);
+        if (options.activeSSAOBlur)
+        {
+            u32 blurXPass = AddRenderGraphPass(graph, "SSAO Blur X", GPU_PASS_SSAO_BLUR_X, &Renderer::SSAOBlurXPass);
+            ReadRenderGraphTexture(graph, blurXPass, resources.ssao);
+            resources.ssaoBlurX = WriteRenderGraphColor(graph, blurXPass, CreateRenderGraphTexture(graph, "SSAO Blur X", ssaoDesc));
+
+            u32 blurYPass = AddRenderGraphPass(graph, "SSAO Blur Y", GPU_PASS_SSAO_BLUR_Y, &Renderer::SSAOBlurYPass);
+            ReadRenderGraphTexture(graph, blurYPass, resources.ssaoBlurX);
+            resources.ssaoBlurred = WriteRenderGraphColor(graph, blurYPass, CreateRenderGraphTexture(graph, "SSAO Blurred", ssaoDesc));
+            ambientOcclusion = resources.ssaoBlurred;
+        }
+    }
+    resources.ambientOcclusion = ambientOcclusion;
+
+    // SHADOWS //
+    // The maps persist across frames, the passes only render what UpdateShadowMaps planned and may draw nothing
+    resources.cascadeShadows = RENDER_GRAPH_NO_RESOURCE;
+    resources.pointShadows = RENDER_GRAPH_NO_RESOURCE;
+    u32 cascadeShadowsPass = RENDER_GRAPH_NO_RESOURCE;
+    u32 pointShadowsPass = RENDER_GRAPH_NO_RESOURCE;
+    if (options.activeShadows)
+    {
+        glm::ivec2 cascadeSize = glm::ivec2(SHADOW_CASCADE_SIZE);
+        glm::ivec2 pointSize = glm::ivec2(SHADOW_POINT_FACE_SIZE);
+        resources.cascadeShadows = ImportRenderGraphTexture(graph, "Cascade Shadow Maps", shadowMaps.cascadeMaps, TextureDesc(cascadeSize, GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT, true, true));
+        resources.pointShadows = ImportRenderGraphTexture(graph, "Point Shadow Maps", shadowMaps.pointMaps, TextureDesc(pointSize, GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT, true, true));
 
-                // Material
-                shader.SetUniform3f("uMaterial.reflective", meshMaterial.reflective);
-                shader.SetUniform1f("uMaterial.shininess", meshMaterial.shininess);
-            }
-            break;
-            }
+        cascadeShadowsPass = AddRenderGraphPass(graph, "Cascade Shadows", GPU_PASS_CASCADE_SHADOWS, &Renderer::CascadeShadowsPass);
+        resources.cascadeShadows = WriteRenderGraphDepth(graph, cascadeShadowsPass, resources.cascadeShadows);
 
-            Mesh& mesh = model->meshes[meshIndex];
-            glDrawElements(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_INT, (void*)(u64)mesh.indexOffset);
-            glBindVertexArray(0);
-        }
-        shader.Unbind();
+        pointShadowsPass = AddRenderGraphPass(graph, "Point Shadows", GPU_PASS_POINT_SHADOWS, &Renderer::PointShadowsPass);
+        resources.pointShadows = WriteRenderGraphDepth(graph, pointShadowsPass, resources.pointShadows);
     }
 
-    BindDefaultFramebuffer();
+    // LIGHTING PASS //
+    // The final color is stretched to the display when rendering at a lower resolution
+    RenderGraphTextureDesc sceneColorDesc = TextureDesc(renderSize, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, true);
 
-    if (app->rendererOptions.activeSSAO)
+    u32 lightingPass = AddRenderGraphPass(graph, "Lighting", GPU_PASS_LIGHTING, &Renderer::LightingPass);
+    for (u32 i = 0; i < GBUFFER_VELOCITY; ++i)
+        ReadRenderGraphTexture(graph, lightingPass, resources.gBuffer[i]);
+    if (ambientOcclusion != RENDER_GRAPH_NO_RESOURCE)
+        ReadRenderGraphTexture(graph, lightingPass, ambientOcclusion);
+    if (options.activeShadows)
     {
-        // SSAO //
-        ssaoBuffer.Bind();
-        glDisable(GL_BLEND);
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        Shader& SSAOShader = app->shaderPrograms[ssaoShaderID];
-        SSAOShader.Bind();
-
-        SSAOShader.SetUniformMat4("uProjection", app->camera.GetProjectionMatrix(app->displaySize));
-        SSAOShader.SetUniformMat4("uView", app->camera.GetViewMatrix(app->displaySize));
-        SSAOShader.SetUniform2f("uDisplaySize", glm::vec2(app->displaySize.x, app->displaySize.y));
-
-        SSAOShader.SetUniform1i("uSSAOptions.uRangeCheck", app->rendererOptions.activeRangeCheck);
-        SSAOShader.SetUniform1f("uSSAOptions.uRadius", app->rendererOptions.ssaoRadius);
-        SSAOShader.SetUniform1f("uSSAOptions.uBias", app->rendererOptions.ssaoBias);
-        SSAOShader.SetUniform1f("uSSAOptions.uPower", app->rendererOptions.ssaoPower);
-        SSAOShader.SetUniform1i("uSSAOptions.uKernelSize", app->rendererOptions.ssaoKernelSize);
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, GBuffer.colorAttachmentHandles[0]); // Position
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, GBuffer.colorAttachmentHandles[1]); // Normal
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, GBuffer.depthAttachment); // Depth
-        glActiveTexture(GL_TEXTURE3);
-        glBindTexture(GL_TEXTURE_2D, noiseTextureHandle); // SSAO Noise Texture
-
-        glBindVertexArray(screenQuad.VAO);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (void*)0);
-        glBindVertexArray(0);
-        glEnable(GL_BLEND);
-        SSAOShader.Unbind();
+        ReadRenderGraphTexture(graph, lightingPass, resources.cascadeShadows);
+        ReadRenderGraphTexture(graph, lightingPass, resources.pointShadows);
+    }
+    resources.sceneColor = WriteRenderGraphColor(graph, lightingPass, CreateRenderGraphTexture(graph, "Scene Color", sceneColorDesc));
 
-        BindDefaultFramebuffer();
+    // Light casters and the skybox are drawn into the lit color with the G-buffer depth attached, no depth blit needed
+    u32 lightCastersPass = AddRenderGraphPass(graph, "Light Casters", GPU_PASS_LIGHT_CASTERS, &Renderer::LightCastersPass);
+    resources.sceneColor = WriteRenderGraphColor(graph, lightCastersPass, resources.sceneColor);
+    resources.depth = WriteRenderGraphDepth(graph, lightCastersPass, resources.depth);
 
-        if (app->rendererOptions.activeSSAOBlur)
-        {
-            // SSAO Blur
-            ssaoBlurBuffer.Bind();
-            glDisable(GL_BLEND);
-            glClear(GL_COLOR_BUFFER_BIT);
+    if (options.activeSkybox)
+    {
+        u32 skyboxPass = AddRenderGraphPass(graph, "Skybox", GPU_PASS_SKYBOX, &Renderer::SkyboxPass);
+        resources.sceneColor = WriteRenderGraphColor(graph, skyboxPass, resources.sceneColor);
+        resources.depth = WriteRenderGraphDepth(graph, skyboxPass, resources.depth);
+    }
+
+    // TEMPORAL UPSAMPLING //
+    RenderGraphResource finalColor = resources.sceneColor;
+    u32 resolvePass = RENDER_GRAPH_NO_RESOURCE;
+    if (options.activeTemporalUpsampling)
+    {
+        RenderGraphTextureDesc historyDesc = TextureDesc(app->displaySize, GL_RGBA16F, GL_RGBA, GL_FLOAT, true, true);
+        resources.history = ImportRenderGraphTexture(graph, "Temporal History", temporalHistory[temporalHistoryIndex].colorAttachmentHandles[0], historyDesc);
+        resources.resolved = ImportRenderGraphTexture(graph, "Temporal Resolved", temporalHistory[1 - temporalHistoryIndex].colorAttachmentHandles[0], historyDesc);
+
+        resolvePass = AddRenderGraphPass(graph, "Temporal Resolve", GPU_PASS_TEMPORAL_RESOLVE, &Renderer::TemporalResolvePass);
+        ReadRenderGraphTexture(graph, resolvePass, resources.sceneColor);
+        ReadRenderGraphTexture(graph, resolvePass, resources.gBuffer[GBUFFER_VELOCITY]);
+        ReadRenderGraphTexture(graph, resolvePass, resources.depth);
+        ReadRenderGraphTexture(graph, resolvePass, resources.history);
+        resources.resolved = WriteRenderGraphColor(graph, resolvePass, resources.resolved);
+        finalColor = resources.resolved;
+    }
 
-            Shader& SSAOBlurShader = app->shaderPrograms[ssaoBlurShaderID];
-            SSAOBlurShader.Bind();
+    // PRESENT //
+    // The debug views only read their G-buffer target, the passes after the geometry pass are culled
+    if (screenQuad.currentRenderTarget == RENDER_TARGET_FINAL_COLOR)
+        resources.presentSource = finalColor;
+    else if (screenQuad.currentRenderTarget == RENDER_TARGET_DEPTH)
+        resources.presentSource = gBufferDepth;
+    else
+        resources.presentSource = resources.gBuffer[screenQuad.currentRenderTarget - RENDER_TARGET_GBUFFER];
+
+    u32 presentPass = AddRenderGraphPass(graph, "Present", GPU_PASS_SCREEN_QUAD, &Renderer::PresentPass);
+    ReadRenderGraphTexture(graph, presentPass, resources.presentSource);
+    RenderGraphResource backbuffer = WriteRenderGraphColor(graph, presentPass, ImportRenderGraphBackbuffer(graph, app->displaySize));
+    MarkRenderGraphOutput(graph, backbuffer);
+
+    CompileRenderGraph(graph);
+
+    // The history is only continuous while it's resolved every frame
+    if (resolvePass == RENDER_GRAPH_NO_RESOURCE || IsRenderGraphPassCulled(graph, resolvePass))
+        temporalHistoryValid = false;
+
+    // UpdateShadowMaps planned on the shadow passes running, the debug views cull them along with the lighting
+    if (options.activeShadows && (IsRenderGraphPassCulled(graph, cascadeShadowsPass) || IsRenderGraphPassCulled(graph, pointShadowsPass)))
+        DiscardShadowMapPlan(shadowMaps);
+}
 
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, ssaoBuffer.colorAttachmentHandles[0]); // SSAO Color Texture
+void Renderer::DeferredRender(App* app)
+{
+    PROFILE_FUNCTION();
 
-            SSAOBlurShader.SetUniform1i("uNoiseSize", app->rendererOptions.ssaoNoiseSize);
+    BuildDeferredGraph(app);
 
-            glBindVertexArray(screenQuad.VAO);
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (void*)0);
-            glBindVertexArray(0);
-            glEnable(GL_BLEND);
-            SSAOBlurShader.Unbind();
+    // Light casters have their own pass
+    GenerateDrawPackets(app, drawPackets, GetArchetype(app->entities, ENTITY_ARCHETYPE_MESH), deferredShadersID[0]);
 
-            BindDefaultFramebuffer();
-        }
-    }
+    ExecuteRenderGraph(renderGraph, app);
+}
+
+void Renderer::DrawScreenQuad()
+{
+    glBindVertexArray(screenQuad.VAO);
 
-    // DEFERRED RENDERING: LIGHTING PASS //
-    screenQuad.FBO.Bind();
+    CountRenderStat(RENDER_COUNTER_VAO_BINDS);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (void*)0);
+    CountDrawCall(6);
+    glBindVertexArray(0);
+}
 
-    glDisable(GL_DEPTH_TEST);
+void Renderer::GeometryPass(App* app)
+{
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+    glEnable(GL_BLEND);
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+    // Built before the graph ran, by the draw packet workers
+    ReplayDrawPackets(drawPackets, app->UBO.handle);
+}
+
+void Renderer::SSAOPass(App* app)
+{
+    const DeferredResources& resources = deferredResources;
+
+    glDisable(GL_BLEND);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    Shader& SSAOShader = app->shaderPrograms[ssaoShaderID];
+    SSAOShader.Bind();
+
+    // Kernel, matrices and options were written to the UBO with the rest of the frame parameters
+    glBindBufferRange(GL_UNIFORM_BUFFER, SSAO_PARAMETERS_BINDING, app->UBO.handle, app->ssaoParamOffset, app->ssaoParamSize);
+
+    BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, GetRenderGraphTexture(renderGraph, resources.gBuffer[GBUFFER_POSITION]));
+    BindTexture(GL_TEXTURE1, GL_TEXTURE_2D, GetRenderGraphTexture(renderGraph, resources.gBuffer[GBUFFER_NORMAL]));
+    BindTexture(GL_TEXTURE2, GL_TEXTURE_2D, GetRenderGraphTexture(renderGraph, resources.depth));
+    BindTexture(GL_TEXTURE3, GL_TEXTURE_2D, noiseTextureHandle); // SSAO Noise Texture
+
+    DrawScreenQuad();
+    glEnable(GL_BLEND);
+    SSAOShader.Unbind();
+}
+
+void Renderer::SSAOBlur(App* app, RenderGraphResource source, const glm::vec2& direction)
+{
+    glDisable(GL_BLEND);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    Shader& SSAOBlurShader = app->shaderPrograms[ssaoBlurShaderID];
+    SSAOBlurShader.Bind();
+
+    BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, GetRenderGraphTexture(renderGraph, source));
+
+    SSAOBlurShader.SetUniform1i("uNoiseSize", GetRenderFrame(app).rendererOptions.ssaoNoiseSize);
+    SSAOBlurShader.SetUniform2f("uDirection", direction);
+
+    DrawScreenQuad();
+    glEnable(GL_BLEND);
+    SSAOBlurShader.Unbind();
+}
+
+void Renderer::SSAOBlurXPass(App* app)
+{
+    SSAOBlur(app, deferredResources.ssao, glm::vec2(1.0f, 0.0f));
+}
+
+void Renderer::SSAOBlurYPass(App* app)
+{
+    SSAOBlur(app, deferredResources.ssaoBlurX, glm::vec2(0.0f, 1.0f));
+}
+
+void Renderer::LightingPass(App* app)
+{
+    const DeferredResources& resources = deferredResources;
+
+    glDisable(GL_DEPTH_TEST);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
     Shader& lightingPassShader = app->shaderPrograms[lightingPassShaderID];
     lightingPassShader.Bind();
 
-    // Set the uniform textures from the G-Buffer
-    for (u32 i = 0; i < GBuffer.colorAttachmentHandles.size(); ++i)
+    // Set the uniform textures from the G-Buffer, all but the velocity
+    for (u32 i = 0; i < GBUFFER_VELOCITY; ++i)
     {
-        glActiveTexture(GL_TEXTURE0 + i);
-        glBindTexture(GL_TEXTURE_2D, GBuffer.colorAttachmentHandles[i]);
+        BindTexture(GL_TEXTURE0 + i, GL_TEXTURE_2D, GetRenderGraphTexture(renderGraph, resources.gBuffer[i]));
     }
 
     // Environment Map
-    glActiveTexture(GL_TEXTURE0 + GBuffer.colorAttachmentHandles.size());
-    glBindTexture(GL_TEXTURE_CUBE_MAP, environmentMapHandle);
+    BindTexture(GL_TEXTURE0 + GBUFFER_VELOCITY, GL_TEXTURE_CUBE_MAP, environmentMapHandle);
 
     // Irradiance Map
-    glActiveTexture(GL_TEXTURE1 + GBuffer.colorAttachmentHandles.size());
-    glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMapHandle);
+    BindTexture(GL_TEXTURE1 + GBUFFER_VELOCITY, GL_TEXTURE_CUBE_MAP, irradianceMapHandle);
 
-    // SSAO Color
-    glActiveTexture(GL_TEXTURE2 + GBuffer.colorAttachmentHandles.size());
-    glBindTexture(GL_TEXTURE_2D, app->rendererOptions.activeSSAOBlur ? ssaoBlurBuffer.colorAttachmentHandles[0] : ssaoBuffer.colorAttachmentHandles[0]);
+    // SSAO Color, blurred or not. The shader variant without SSAO doesn't sample it.
+    if (resources.ambientOcclusion != RENDER_GRAPH_NO_RESOURCE)
+        BindTexture(GL_TEXTURE2 + GBUFFER_VELOCITY, GL_TEXTURE_2D, GetRenderGraphTexture(renderGraph, resources.ambientOcclusion));
 
-    lightingPassShader.SetUniform1i("uRendererOptions.uActiveIrradiance", app->rendererOptions.activeIrradiance);
-    lightingPassShader.SetUniform1i("uRendererOptions.uActiveReflection", app->rendererOptions.activeReflection);
-    lightingPassShader.SetUniform1i("uRendererOptions.uActiveRefraction", app->rendererOptions.activeRefraction);
-    lightingPassShader.SetUniform1i("uRendererOptions.uActiveSSAO", app->rendererOptions.activeSSAO);
+    // Shadow maps and their placements
+    if (resources.cascadeShadows != RENDER_GRAPH_NO_RESOURCE)
+    {
+        BindTexture(GL_TEXTURE3 + GBUFFER_VELOCITY, GL_TEXTURE_2D_ARRAY, GetRenderGraphTexture(renderGraph, resources.cascadeShadows));
+        BindTexture(GL_TEXTURE4 + GBUFFER_VELOCITY, GL_TEXTURE_CUBE_MAP_ARRAY, GetRenderGraphTexture(renderGraph, resources.pointShadows));
+        glBindBufferRange(GL_UNIFORM_BUFFER, SHADOW_PARAMETERS_BINDING, app->UBO.handle, app->shadowParamOffset, app->shadowParamSize);
+    }
 
-    glBindVertexArray(screenQuad.VAO);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (void*)0);
-    glBindVertexArray(0);
+    DrawScreenQuad();
     lightingPassShader.Unbind();
+}
 
-    // SCREEN-FILLING QUAD //
-    BindDefaultFramebuffer();
+void Renderer::CascadeShadowsPass(App* app)
+{
+    RenderCascadeShadows(app, shadowMaps);
+}
 
-    glDisable(GL_DEPTH_TEST);
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+void Renderer::PointShadowsPass(App* app)
+{
+    RenderPointShadows(app, shadowMaps);
+}
 
-    Shader& screenQuadShader = app->shaderPrograms[screenQuad.shaderID];
-    screenQuadShader.Bind();
+void Renderer::LightCastersPass(App* app)
+{
+    glEnable(GL_DEPTH_TEST);
+
+    Shader& lightCasterShader = app->shaderPrograms[lightCasterShaderID];
+    lightCasterShader.Bind();
+    GeometryBindState lightsBindState = {};
+    const EntityArchetypeStorage& lightCasters = GetArchetype(app->entities, ENTITY_ARCHETYPE_LIGHT_CASTER);
+    for (u32 i = 0; i < lightCasters.count; ++i)
+    {
+        glBindBufferRange(GL_UNIFORM_BUFFER, LOCAL_PARAMETERS_BINDING, app->UBO.handle, lightCasters.localParamOffsets[i], sizeof(LocalParameters));
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, screenQuad.currentRenderTarget);
+        Model* model = lightCasters.models[i];
 
-    glBindVertexArray(screenQuad.VAO);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (void*)0);
+        Mesh& mesh = model->meshes[0];
+        BindMeshGeometry(app->geometryArena, mesh, lightsBindState);
+
+        lightCasterShader.SetUniform3f("uLightColor", GetRenderFrame(app).lights[i].color);
+
+        glDrawElementsBaseVertex(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, (void*)(u64)(mesh.firstIndex * sizeof(u32)), mesh.baseVertex);
+
+        CountDrawCall(mesh.indexCount);
+    }
     glBindVertexArray(0);
-    screenQuadShader.Unbind();
+    lightCasterShader.Unbind();
+}
 
-    // RENDER LIGHTS USIGN FORWARD RENDERING //
+void Renderer::SkyboxPass(App* app)
+{
     glEnable(GL_DEPTH_TEST);
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, GBuffer.handle);
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-    glBlitFramebuffer(0, 0, app->displaySize.x, app->displaySize.y, 0, 0, app->displaySize.x, app->displaySize.y, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
 
-    BindDefaultFramebuffer();
+    // Drawn before the resolve, so it's jittered like the rest of the frame
+    RenderSkybox(app, GetRenderFrame(app).camera.GetJitteredProjectionMatrix());
+}
 
-    Shader& lightCasterShader = app->shaderPrograms[lightCasterShaderID];
-    lightCasterShader.Bind();
-    u32 lightID = 0;
-    for (u32 i = app->firstLightEntityID; i < app->numEntities; ++i)
-    {
-        Entity& lightEntity = app->entities[i];
+void Renderer::RenderSkybox(App* app, const glm::mat4& projection)
+{
+    glDepthFunc(GL_LEQUAL); // change depth function so depth test passes when values are equal to depth buffer's content
 
-        glBindBufferRange(GL_UNIFORM_BUFFER, 1, app->UBO.handle, lightEntity.localParamOffset, lightEntity.localParamSize);
+    Shader& skyboxShader = app->shaderPrograms[skyboxShaderID];
+    skyboxShader.Bind();
+    glm::mat4 view = glm::mat4(glm::mat3(GetRenderFrame(app).camera.GetViewMatrix(app->displaySize))); // remove translation from the view matrix
+    skyboxShader.SetUniformMat4("uView", view);
+    skyboxShader.SetUniformMat4("uProjection", projection);
+
+    // Skybox Cube
+    glBindVertexArray(skyboxCubeVAO);
+    BindTexture(GL_TEXTURE0, GL_TEXTURE_CUBE_MAP, environmentMapHandle);
+    glDrawArrays(GL_TRIANGLES, 0, 36);
+    CountRenderStat(RENDER_COUNTER_VAO_BINDS);
+    CountDrawCall(36);
+    glBindVertexArray(0);
+    glDepthFunc(GL_LESS);
+}
 
-        Model* model = lightEntity.model;
+void Renderer::TemporalResolvePass(App* app)
+{
+    const DeferredResources& resources = deferredResources;
 
-        u32 vao = FindVAO(model, 0, lightCasterShader);
-        glBindVertexArray(vao);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
 
-        lightCasterShader.SetUniform3f("uLightColor", app->lights[lightID].color);
+    Shader& temporalResolveShader = app->shaderPrograms[temporalResolveShaderID];
+    temporalResolveShader.Bind();
 
-        Mesh& mesh = model->meshes[0];
-        glDrawElements(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_INT, (void*)(u64)mesh.indexOffset);
+    BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, GetRenderGraphTexture(renderGraph, resources.sceneColor)); // Lit color
+    BindTexture(GL_TEXTURE1, GL_TEXTURE_2D, GetRenderGraphTexture(renderGraph, resources.gBuffer[GBUFFER_VELOCITY]));
+    BindTexture(GL_TEXTURE2, GL_TEXTURE_2D, GetRenderGraphTexture(renderGraph, resources.depth));
+    BindTexture(GL_TEXTURE3, GL_TEXTURE_2D, GetRenderGraphTexture(renderGraph, resources.history));
 
-        glBindVertexArray(0);
-        lightID++;
-    }
-    lightCasterShader.Unbind();
+    temporalResolveShader.SetUniform1i("uHistoryValid", temporalHistoryValid);
+
+    DrawScreenQuad();
+    glEnable(GL_BLEND);
+    temporalResolveShader.Unbind();
+
+    temporalHistoryIndex = 1 - temporalHistoryIndex;
+    temporalHistoryValid = true;
+}
+
+void Renderer::PresentPass(App* app)
+{
+    glDisable(GL_DEPTH_TEST);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    Shader& screenQuadShader = app->shaderPrograms[screenQuad.shaderID];
+    screenQuadShader.Bind();
+
+    // The debug views show the G-buffer as is, the final color is the resolved one when upsampling
+    BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, GetRenderGraphTexture(renderGraph, deferredResources.presentSource));
+
+    DrawScreenQuad();
+    screenQuadShader.Unbind();
 }
 
 float Lerp(float a, float b, float f)
@@ -434,10 +607,11 @@ float Lerp(float a, float b, float f)
     return a + f * (b - a);
 }
 
-void Renderer::GenerateKernelSamples(Shader& SSAOShader, int ssaoKernelSize)
+void Renderer::GenerateKernelSamples(int ssaoKernelSize)
 {
     std::uniform_real_distribution<GLfloat> randomFloats(0.0, 1.0);
     std::default_random_engine generator;
+    ssaoKernel.clear();
     ssaoKernel.reserve(ssaoKernelSize);
     for (int i = 0; i < ssaoKernelSize; i++)
     {
@@ -455,10 +629,6 @@ void Renderer::GenerateKernelSamples(Shader& SSAOShader, int ssaoKernelSize)
         sample *= scale;
         ssaoKernel.emplace_back(sample);
     }
-
-    SSAOShader.Bind();
-    for (int i = 0; i < ssaoKernelSize; ++i)
-        SSAOShader.SetUniform3f("uSamples[" + std::to_string(i) + "]", ssaoKernel[i]);
 }
 
 void Renderer::GenerateKernelNoise(int ssaoNoiseSize)
@@ -484,59 +654,6 @@ void Renderer::GenerateKernelNoise(int ssaoNoiseSize)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-}
-
-u32 Renderer::FindVAO(Model* model, u32 meshIndex, const Shader& shaderProgram)
-{
-    Mesh& mesh = model->meshes[meshIndex];
-
-    // Try Finding a VAO for this mesh/program
-    for (u32 i = 0; i < (u32)mesh.VAOs.size(); ++i)
-    {
-        if (mesh.VAOs[i].shaderProgramHandle == shaderProgram.handle)
-            return mesh.VAOs[i].handle;
-    }
-
-    u32 vaoHandle = 0;
-
-    // --- If a VAO wasn't found, create a new VAO for this mesh/program
-
-    glGenVertexArrays(1, &vaoHandle);
-    glBindVertexArray(vaoHandle);
-
-    glBindBuffer(GL_ARRAY_BUFFER, model->VBHandle);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, model->EBHandle);
-
-    // We have to link all vertex shader inputs attributes to attributes in the vertex buffer
-    for (u32 i = 0; i < shaderProgram.vertexLayout.attributes.size(); ++i)
-    {
-        bool attributeWasLinked = false;
-
-        const std::vector<VertexBufferAttribute>& attributes = mesh.VBLayout.attributes;
-        for (u32 j = 0; j < attributes.size(); ++j)
-        {
-            if (shaderProgram.vertexLayout.attributes[i].location == attributes[j].location)
-            {
-                const u32 index = attributes[j].location;
-                const u32 nComp = attributes[j].componentCount;
-                const u32 offset = attributes[j].offset + mesh.vertexOffset;
-                const u32 stride = mesh.VBLayout.stride;
-
-                glVertexAttribPointer(index, nComp, GL_FLOAT, GL_FALSE, stride, (void*)(u64)offset);
-                glEnableVertexAttribArray(index);
-
-                attributeWasLinked = true;
-                break;
-            }
-        }
-        assert(attributeWasLinked); // The mesh should provide an attribute for each vertex inputs
-    }
-
-    glBindVertexArray(0);
-
-    // Store the VAO handle in the list of VAOs for this mesh
-    VAO vao = { vaoHandle, shaderProgram.handle };
-    mesh.VAOs.push_back(vao);
 
-    return vaoHandle;
+    TrackGPUAllocation(GPUResourceKind::TEXTURE, noiseTextureHandle, GetTextureMemorySize(GL_RGBA16F, noiseSideSize, noiseSideSize), GPU_MEMORY_TEXTURES, "SSAO Noise");
 }
\ No newline at end of file
@@ -3,6 +3,11 @@
 #include "platform.h"
 #include "Shader.h"
 #include "Framebuffer.h"
+#include "GPUTimers.h"
+#include "RenderGraph.h"
+#include "DrawPackets.h"
+#include "RenderStats.h"
+#include "Shadows.h"
 
 #include "glad/glad.h"
 
@@ -12,12 +17,45 @@ struct App;
 class Shader;
 struct Model;
 
+// Color attachments of the G-buffer
+enum GBufferTarget
+{
+	GBUFFER_POSITION,
+	GBUFFER_NORMAL,
+	GBUFFER_ALBEDO,
+	GBUFFER_SPECULAR,
+	GBUFFER_REFLECTIVE_SHININESS,
+	GBUFFER_VELOCITY, // Only read by the temporal resolve
+	GBUFFER_TARGET_COUNT
+};
+
+// Entries of RendererOptions::renderTargets, the G-buffer targets follow the depth
+#define RENDER_TARGET_FINAL_COLOR 0
+#define RENDER_TARGET_DEPTH 1
+#define RENDER_TARGET_GBUFFER 2
+
 struct ScreenQuad
 {
-	Framebuffer FBO;
 	u32 VAO;
 	u32 shaderID;
-	u32 currentRenderTarget;
+	u32 currentRenderTarget; // Shown by the present pass, one of the RENDER_TARGET_ indices
+};
+
+// Resources of the deferred frame the passes read and write, declared again every frame
+struct DeferredResources
+{
+	RenderGraphResource gBuffer[GBUFFER_TARGET_COUNT];
+	RenderGraphResource depth;
+	RenderGraphResource ssao;
+	RenderGraphResource ssaoBlurX;
+	RenderGraphResource ssaoBlurred; // Same format as ssao, it takes its texture once the horizontal blur is done
+	RenderGraphResource ambientOcclusion; // Read by the lighting, blurred or not. RENDER_GRAPH_NO_RESOURCE without SSAO.
+	RenderGraphResource cascadeShadows; // Imported shadow maps, RENDER_GRAPH_NO_RESOURCE without shadows
+	RenderGraphResource pointShadows;
+	RenderGraphResource sceneColor;
+	RenderGraphResource history;
+	RenderGraphResource resolved;
+	RenderGraphResource presentSource;
 };
 
 class Renderer
@@ -27,15 +65,38 @@ public:
 
 	void ForwardRender(App* app);
 
+	// Declares the passes for the current options and debug view, the render graph culls and runs them
 	void DeferredRender(App* app);
 
-	void GenerateKernelSamples(Shader& SSAOShader, int ssaoKernelSize);
+	// The G-buffer, SSAO and lighting targets can be smaller than the display, the present pass scales them up.
+	// The render graph allocates them at this size.
+	inline void SetRenderSize(const glm::ivec2& size) { renderSize = size; }
+
+	void RenderSkybox(App* app, const glm::mat4& projection);
+
+	void GenerateKernelSamples(int ssaoKernelSize);
 	void GenerateKernelNoise(int ssaoNoiseSize);
 
 private:
-	inline void BindDefaultFramebuffer() { glBindFramebuffer(GL_FRAMEBUFFER, 0); }
-
-	u32 FindVAO(Model* model, u32 meshIndex, const Shader& shaderProgram);
+	void BuildDeferredGraph(App* app);
+
+	// Render graph passes
+	void GeometryPass(App* app);
+	void SSAOPass(App* app);
+	void SSAOBlurXPass(App* app);
+	void SSAOBlurYPass(App* app);
+	void SSAOBlur(App* app, RenderGraphResource source, const glm::vec2& direction);
+	void CascadeShadowsPass(App* app);
+	void PointShadowsPass(App* app);
+	void LightingPass(App* app);
+	void LightCastersPass(App* app);
+	void SkyboxPass(App* app);
+	void TemporalResolvePass(App* app);
+	void PresentPass(App* app);
+	void DrawScreenQuad();
+
+	inline void BindDefaultFramebuffer() { glBindFramebuffer(GL_FRAMEBUFFER, 0); CountRenderStat(RENDER_COUNTER_FRAMEBUFFER_SWITCHES); }
+	inline void BindTexture(GLenum unit, GLenum target, u32 handle) { glActiveTexture(unit); glBindTexture(target, handle); CountRenderStat(RENDER_COUNTER_TEXTURE_BINDS); }
 
 public:
 	u32 lightCasterShaderID;
@@ -48,7 +109,10 @@ public:
 	std::array<u32, 3> deferredShadersID;
 
 	// DEFERRED RENDERING //
-	Framebuffer GBuffer;
+	RenderGraph renderGraph;
+	DrawPacketGenerator drawPackets; // Geometry pass draws, built across threads and replayed on the main thread
+	DeferredResources deferredResources;
+	glm::ivec2 renderSize;
 	u32 lightingPassShaderID;
 
 	// SCREEN-FILLING QUAD //
@@ -60,12 +124,25 @@ public:
 	u32 environmentMapHandle;
 	u32 irradianceMapHandle;
 
+	// TEMPORAL UPSAMPLING //
+	// The output of each resolve is the history of the next one, both at display resolution
+	Framebuffer temporalHistory[2];
+	u32 temporalHistoryIndex;
+	bool temporalHistoryValid;
+	u32 temporalResolveShaderID;
+
+	// SHADOWS //
+	// Cached between frames, UpdateShadowMaps plans what the shadow passes render
+	ShadowMaps shadowMaps;
+	u32 shadowDepthShaderID;
+
 	// SSAO //
-	Framebuffer ssaoBuffer;
-	Framebuffer ssaoBlurBuffer;
 	std::vector<glm::vec3> ssaoKernel;
 	std::vector<glm::vec3> ssaoNoise;
 	u32 noiseTextureHandle;
 	u32 ssaoShaderID;
 	u32 ssaoBlurShaderID;
+
+	// PROFILING //
+	GPUTimers gpuTimers;
 };
\ No newline at end of file
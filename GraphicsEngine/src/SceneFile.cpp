@@ -0,0 +1,468 @@
+#include "SceneFile.h"
+
+#include "engine.h"
+#include "Primitives.h"
+#include "AssimpLoading.h"
+#include "Shader.h"
+#include "Profiler.h"
+#include "Timer.h"
+
+#include <unordered_map>
+
+static const u32 SceneRecordSizes[SCENE_TABLE_COUNT] =
+{
+    1,
+    sizeof(SceneTextureRecord),
+    sizeof(SceneMaterialRecord),
+    sizeof(SceneAssetRecord),
+    sizeof(SceneNodeRecord),
+    sizeof(SceneEntityRecord),
+    sizeof(SceneLightRecord)
+};
+
+// The tables of a validated file, pointing into the mapping
+struct SceneFileView
+{
+    const char* strings;
+    u32 stringsSize;
+
+    const SceneTextureRecord* textures;
+    const SceneMaterialRecord* materials;
+    const SceneAssetRecord* assets;
+    const SceneNodeRecord* nodes;
+    const SceneEntityRecord* entities;
+    const SceneLightRecord* lights;
+    u32 counts[SCENE_TABLE_COUNT];
+};
+
+// ------------------------------------------------------------------------------------------------
+// LOADING //
+// ------------------------------------------------------------------------------------------------
+
+static bool IsValidString(const SceneFileView& scene, u32 offset)
+{
+    return offset < scene.stringsSize;
+}
+
+static bool IsValidReference(u32 index, u32 count)
+{
+    return index == SCENE_FILE_NONE || index < count;
+}
+
+// Every reference is checked before anything is constructed, so a bad file never leaves a half loaded scene
+static bool ValidateSceneFile(App* app, const MappedFile& file, SceneFileView& scene)
+{
+    if (file.size < sizeof(SceneFileHeader))
+        return false;
+
+    const SceneFileHeader& header = *(const SceneFileHeader*)file.data;
+    if (header.magic != SCENE_FILE_MAGIC || header.version != SCENE_FILE_VERSION || header.size != file.size)
+        return false;
+
+    const void* tables[SCENE_TABLE_COUNT];
+    for (u32 i = 0; i < SCENE_TABLE_COUNT; ++i)
+    {
+        // The counts size the arrays built from the tables, they have to fit in the bytes after the table start
+        const SceneFileTableRange& range = header.tables[i];
+        if (range.offset % SCENE_FILE_TABLE_ALIGNMENT != 0 || range.offset > file.size)
+            return false;
+        if ((u64)range.count * SceneRecordSizes[i] > file.size - range.offset)
+            return false;
+
+        tables[i] = file.data + range.offset;
+        scene.counts[i] = range.count;
+    }
+
+    scene.strings = (const char*)tables[SCENE_TABLE_STRINGS];
+    scene.stringsSize = scene.counts[SCENE_TABLE_STRINGS];
+    scene.textures = (const SceneTextureRecord*)tables[SCENE_TABLE_TEXTURES];
+    scene.materials = (const SceneMaterialRecord*)tables[SCENE_TABLE_MATERIALS];
+    scene.assets = (const SceneAssetRecord*)tables[SCENE_TABLE_ASSETS];
+    scene.nodes = (const SceneNodeRecord*)tables[SCENE_TABLE_NODES];
+    scene.entities = (const SceneEntityRecord*)tables[SCENE_TABLE_ENTITIES];
+    scene.lights = (const SceneLightRecord*)tables[SCENE_TABLE_LIGHTS];
+
+    // Any offset into the table then reads a terminated string
+    if (scene.stringsSize > 0 && scene.strings[scene.stringsSize - 1] != '\0')
+        return false;
+
+    for (u32 i = 0; i < scene.counts[SCENE_TABLE_TEXTURES]; ++i)
+        if (!IsValidString(scene, scene.textures[i].path))
+            return false;
+
+    for (u32 i = 0; i < scene.counts[SCENE_TABLE_MATERIALS]; ++i)
+    {
+        const SceneMaterialRecord& material = scene.materials[i];
+        if (!IsValidString(scene, material.name))
+            return false;
+        for (u32 t = 0; t < ARRAY_COUNT(material.textures); ++t)
+            if (!IsValidReference(material.textures[t], scene.counts[SCENE_TABLE_TEXTURES]))
+                return false;
+    }
+
+    for (u32 i = 0; i < scene.counts[SCENE_TABLE_ASSETS]; ++i)
+    {
+        const SceneAssetRecord& asset = scene.assets[i];
+        bool isValid = asset.type == SCENE_ASSET_MODEL_FILE ? IsValidString(scene, asset.path)
+            : asset.type == SCENE_ASSET_PRIMITIVE && asset.primitiveType <= (u32)PrimitiveType::SPHERE && asset.material < scene.counts[SCENE_TABLE_MATERIALS];
+        if (!isValid)
+            return false;
+
+        // Not backed by the file, the segments size the primitive geometry on their own
+        if (asset.type == SCENE_ASSET_PRIMITIVE)
+        {
+            for (u32 s = 0; s < ARRAY_COUNT(asset.primitiveSegments); ++s)
+                if (asset.primitiveSegments[s] == 0 || asset.primitiveSegments[s] > SCENE_FILE_MAX_PRIMITIVE_SEGMENTS)
+                    return false;
+        }
+    }
+
+    for (u32 i = 0; i < scene.counts[SCENE_TABLE_NODES]; ++i)
+        if (scene.nodes[i].parent != SCENE_FILE_NONE && scene.nodes[i].parent >= i)
+            return false;
+
+    u32 lightCasterCount = 0;
+    for (u32 i = 0; i < scene.counts[SCENE_TABLE_ENTITIES]; ++i)
+    {
+        const SceneEntityRecord& entity = scene.entities[i];
+        if (entity.archetype >= ENTITY_ARCHETYPE_COUNT || entity.node >= scene.counts[SCENE_TABLE_NODES] || entity.asset >= scene.counts[SCENE_TABLE_ASSETS])
+            return false;
+        lightCasterCount += entity.archetype == ENTITY_ARCHETYPE_LIGHT_CASTER;
+    }
+    if (lightCasterCount + GetArchetype(app->entities, ENTITY_ARCHETYPE_LIGHT_CASTER).count > MAX_LIGHTS)
+        return false;
+
+    for (u32 i = 0; i < scene.counts[SCENE_TABLE_LIGHTS]; ++i)
+    {
+        u32 entity = scene.lights[i].entity;
+        if (entity >= scene.counts[SCENE_TABLE_ENTITIES] || scene.entities[entity].archetype != ENTITY_ARCHETYPE_LIGHT_CASTER)
+            return false;
+    }
+
+    return true;
+}
+
+// The entities store the program of the current rendering mode, the file only the kind of shader
+static u32 GetSceneShaderID(App* app, u32 shaderType)
+{
+    const Renderer& renderer = app->renderer;
+    const std::array<u32, 3>& shaders = app->rendererOptions.forwardRendering ? renderer.forwardShadersID : renderer.deferredShadersID;
+    switch ((ShaderType)shaderType)
+    {
+    case ShaderType::DEFAULT:           return shaders[0];
+    case ShaderType::TEXTURED_ALBEDO:   return shaders[1];
+    case ShaderType::TEXTURED_ALB_SPEC: return shaders[2];
+    default:                            return renderer.lightCasterShaderID;
+    }
+}
+
+static void ConstructScene(App* app, const SceneFileView& scene)
+{
+    // Textures and models go through the usual loaders, which skip what is already loaded
+    std::vector<u32> textureIDs(scene.counts[SCENE_TABLE_TEXTURES]);
+    for (u32 i = 0; i < textureIDs.size(); ++i)
+        textureIDs[i] = LoadTexture2D(app->textures, scene.strings + scene.textures[i].path, scene.textures[i].isFlipped != 0);
+
+    std::vector<Model*> models(scene.counts[SCENE_TABLE_ASSETS]);
+    for (u32 i = 0; i < models.size(); ++i)
+    {
+        const SceneAssetRecord& asset = scene.assets[i];
+        if (asset.type == SCENE_ASSET_MODEL_FILE)
+        {
+            models[i] = LoadModel(app, scene.strings + asset.path, asset.flipTextures != 0);
+            continue;
+        }
+
+        const SceneMaterialRecord& record = scene.materials[asset.material];
+        Material material = {};
+        material.name = scene.strings + record.name;
+        material.albedo = record.albedo;
+        material.specular = record.specular;
+        material.reflective = record.reflective;
+        material.emissive = record.emissive;
+        material.shininess = record.shininess;
+
+        u32* materialTextures[] = { &material.albedoTextureID, &material.emissiveTextureID, &material.specularTextureID, &material.normalsTextureID, &material.bumpTextureID };
+        for (u32 t = 0; t < ARRAY_COUNT(materialTextures); ++t)
+            *materialTextures[t] = record.textures[t] != SCENE_FILE_NONE ? textureIDs[record.textures[t]] : 0;
+
+        models[i] = CreatePrimitive(app, (PrimitiveType)asset.primitiveType, material, asset.primitiveSegments[0], asset.primitiveSegments[1]);
+    }
+
+    // Nodes and entities are appended to reserved arrays, straight from the records
+    SceneGraph& graph = app->sceneGraph;
+    u32 nodeCount = scene.counts[SCENE_TABLE_NODES];
+    u32 firstNode = graph.parents.size();
+    ReserveSceneNodes(graph, nodeCount);
+    for (u32 i = 0; i < nodeCount; ++i)
+    {
+        const SceneNodeRecord& node = scene.nodes[i];
+        u32 parent = node.parent != SCENE_FILE_NONE ? firstNode + node.parent : SCENE_NODE_NONE;
+        CreateSceneNode(graph, parent, node.position, node.rotation, node.scale);
+    }
+
+    u32 entityCount = scene.counts[SCENE_TABLE_ENTITIES];
+    u32 archetypeCounts[ENTITY_ARCHETYPE_COUNT] = {};
+    for (u32 i = 0; i < entityCount; ++i)
+        archetypeCounts[scene.entities[i].archetype]++;
+    for (u32 i = 0; i < ENTITY_ARCHETYPE_COUNT; ++i)
+        ReserveEntities(app->entities, EntityArchetype(i), archetypeCounts[i]);
+
+    // Entities of a model that failed to load are skipped, their handles stay null
+    std::vector<EntityHandle> handles(entityCount);
+    for (u32 i = 0; i < entityCount; ++i)
+    {
+        const SceneEntityRecord& record = scene.entities[i];
+        if (!models[record.asset])
+            continue;
+
+        EntityHandle handle = AddEntity(app->entities, EntityArchetype(record.archetype));
+        u32 row;
+        EntityArchetypeStorage& storage = GetEntityArchetype(app->entities, handle, row);
+        storage.models[row] = models[record.asset];
+        storage.shaderIDs[row] = GetSceneShaderID(app, record.shaderType);
+        storage.sceneNodes[row] = firstNode + record.node;
+        graph.entities[firstNode + record.node] = handle;
+
+        handles[i] = handle;
+    }
+
+    for (u32 i = 0; i < scene.counts[SCENE_TABLE_LIGHTS]; ++i)
+    {
+        const SceneLightRecord& record = scene.lights[i];
+        EntityHandle handle = handles[record.entity];
+        if (!IsEntityAlive(app->entities, handle))
+            continue;
+
+        u32 row;
+        Light& light = GetEntityArchetype(app->entities, handle, row).lights[row];
+        light.lightVector = record.lightVector;
+        light.color = record.color;
+        light.constant = record.constant;
+
+        // The first directional light of the file takes the place of the built-in one
+        if (light.lightVector.w == 0.0f && !IsEntityAlive(app->entities, app->directionalLight))
+            app->directionalLight = handle;
+    }
+}
+
+bool LoadSceneFile(App* app, const char* filepath)
+{
+    PROFILE_FUNCTION();
+
+    MappedFile file;
+    if (!MapFile(filepath, file))
+        return false;
+
+    f64 loadTime = 0.0;
+    SceneFileView scene = {};
+    bool isValid = ValidateSceneFile(app, file, scene);
+    if (isValid)
+    {
+        Timer timer(&loadTime);
+        ConstructScene(app, scene);
+    }
+    else
+    {
+        ELOG("%s is not a valid version %u scene file\n", filepath, SCENE_FILE_VERSION);
+    }
+
+    UnmapFile(file);
+
+    if (isValid)
+        ILOG("Loaded %s in %f ms: %u assets, %u nodes, %u entities", filepath, loadTime, scene.counts[SCENE_TABLE_ASSETS], scene.counts[SCENE_TABLE_NODES], scene.counts[SCENE_TABLE_ENTITIES]);
+
+    return isValid;
+}
+
+// ------------------------------------------------------------------------------------------------
+// WRITING //
+// ------------------------------------------------------------------------------------------------
+
+// The tables are built in memory and written with a single fwrite
+struct SceneFileBuilder
+{
+    std::vector<char> strings;
+    std::vector<SceneTextureRecord> textures;
+    std::vector<SceneMaterialRecord> materials;
+    std::vector<SceneAssetRecord> assets;
+    std::vector<SceneNodeRecord> nodes;
+    std::vector<SceneEntityRecord> entities;
+    std::vector<SceneLightRecord> lights;
+
+    std::vector<u32> textureRecords; // Per texture of the App, SCENE_FILE_NONE until it's referenced
+};
+
+static u32 AddSceneString(SceneFileBuilder& builder, const std::string& str)
+{
+    u32 offset = builder.strings.size();
+    builder.strings.insert(builder.strings.end(), str.c_str(), str.c_str() + str.size() + 1);
+    return offset;
+}
+
+// Textures without a file, like the generated ones, aren't referenced and the material falls back to the first texture
+static u32 AddSceneTexture(SceneFileBuilder& builder, App* app, u32 textureID)
+{
+    if (textureID >= app->textures.size() || app->textures[textureID].filepath.empty())
+        return SCENE_FILE_NONE;
+
+    if (builder.textureRecords[textureID] == SCENE_FILE_NONE)
+    {
+        const Texture& texture = app->textures[textureID];
+        SceneTextureRecord record = { AddSceneString(builder, texture.filepath), texture.isFlipped ? 1u : 0u };
+        builder.textureRecords[textureID] = builder.textures.size();
+        builder.textures.push_back(record);
+    }
+    return builder.textureRecords[textureID];
+}
+
+static u32 AddSceneMaterial(SceneFileBuilder& builder, App* app, const Material& material)
+{
+    SceneMaterialRecord record;
+    record.name = AddSceneString(builder, material.name);
+    record.albedo = material.albedo;
+    record.specular = material.specular;
+    record.reflective = material.reflective;
+    record.emissive = material.emissive;
+    record.shininess = material.shininess;
+    record.textures[0] = AddSceneTexture(builder, app, material.albedoTextureID);
+    record.textures[1] = AddSceneTexture(builder, app, material.emissiveTextureID);
+    record.textures[2] = AddSceneTexture(builder, app, material.specularTextureID);
+    record.textures[3] = AddSceneTexture(builder, app, material.normalsTextureID);
+    record.textures[4] = AddSceneTexture(builder, app, material.bumpTextureID);
+
+    builder.materials.push_back(record);
+    return builder.materials.size() - 1;
+}
+
+template <typename T>
+static void WriteSceneTable(FILE* file, SceneFileHeader& header, SceneFileTable table, const std::vector<T>& records)
+{
+    static const u8 padding[SCENE_FILE_TABLE_ALIGNMENT] = {};
+
+    u32 position = ftell(file);
+    u32 offset = Align(position, SCENE_FILE_TABLE_ALIGNMENT);
+    fwrite(padding, 1, offset - position, file);
+
+    header.tables[table].offset = offset;
+    header.tables[table].count = records.size();
+    if (!records.empty())
+        fwrite(records.data(), sizeof(T), records.size(), file);
+}
+
+bool WriteSceneFile(App* app, const char* filepath)
+{
+    PROFILE_FUNCTION();
+
+    SceneFileBuilder builder;
+    builder.textureRecords.assign(app->textures.size(), SCENE_FILE_NONE);
+
+    // Every model of the App, referenced by the entities through their index
+    std::unordered_map<const Model*, u32> assetIndices;
+    for (u32 i = 0; i < app->models.size(); ++i)
+    {
+        const Model* model = app->models[i].get();
+
+        SceneAssetRecord record = {};
+        if (!model->filepath.empty())
+        {
+            record.type = SCENE_ASSET_MODEL_FILE;
+            record.path = AddSceneString(builder, model->filepath);
+            record.flipTextures = model->flipTextures ? 1 : 0;
+            record.material = SCENE_FILE_NONE;
+        }
+        else
+        {
+            record.type = SCENE_ASSET_PRIMITIVE;
+            record.path = SCENE_FILE_NONE;
+            record.primitiveType = model->primitiveType;
+            record.primitiveSegments[0] = model->primitiveSegments[0];
+            record.primitiveSegments[1] = model->primitiveSegments[1];
+            record.material = AddSceneMaterial(builder, app, app->materials[model->materialIDs[0]]);
+        }
+
+        assetIndices[model] = builder.assets.size();
+        builder.assets.push_back(record);
+    }
+
+    // Nodes are created after their parents, so the graph order already puts them first
+    const SceneGraph& graph = app->sceneGraph;
+    builder.nodes.resize(graph.parents.size());
+    for (u32 i = 0; i < builder.nodes.size(); ++i)
+    {
+        SceneNodeRecord& record = builder.nodes[i];
+        record.parent = graph.parents[i] != SCENE_NODE_NONE ? graph.parents[i] : SCENE_FILE_NONE;
+        record.position = graph.localPositions[i];
+        record.rotation = graph.localRotations[i];
+        record.scale = graph.localScales[i];
+    }
+
+    u32 skippedCount = 0;
+    for (u32 a = 0; a < ENTITY_ARCHETYPE_COUNT; ++a)
+    {
+        const EntityArchetypeStorage& archetype = app->entities.archetypes[a];
+        for (u32 row = 0; row < archetype.count; ++row)
+        {
+            if (archetype.sceneNodes[row] == SCENE_NODE_NONE)
+            {
+                skippedCount++;
+                continue;
+            }
+
+            SceneEntityRecord record;
+            record.archetype = a;
+            record.node = archetype.sceneNodes[row];
+            record.asset = assetIndices[archetype.models[row]];
+            record.shaderType = (u32)app->shaderPrograms[archetype.shaderIDs[row]].type;
+
+            if (archetype.components & ENTITY_COMPONENT_LIGHT)
+            {
+                const Light& light = archetype.lights[row];
+                SceneLightRecord lightRecord = { (u32)builder.entities.size(), light.lightVector, light.color, light.constant };
+                builder.lights.push_back(lightRecord);
+            }
+            builder.entities.push_back(record);
+        }
+    }
+    if (skippedCount > 0)
+        ILOG("%u entities without a scene node were not written to %s", skippedCount, filepath);
+
+    FILE* file = fopen(filepath, "wb");
+    if (!file)
+    {
+        ELOG("fopen() failed writing file %s\n", filepath);
+        return false;
+    }
+
+    // The header is written again once the table offsets are known
+    SceneFileHeader header = {};
+    header.magic = SCENE_FILE_MAGIC;
+    header.version = SCENE_FILE_VERSION;
+    fwrite(&header, sizeof(header), 1, file);
+
+    WriteSceneTable(file, header, SCENE_TABLE_STRINGS, builder.strings);
+    WriteSceneTable(file, header, SCENE_TABLE_TEXTURES, builder.textures);
+    WriteSceneTable(file, header, SCENE_TABLE_MATERIALS, builder.materials);
+    WriteSceneTable(file, header, SCENE_TABLE_ASSETS, builder.assets);
+    WriteSceneTable(file, header, SCENE_TABLE_NODES, builder.nodes);
+    WriteSceneTable(file, header, SCENE_TABLE_ENTITIES, builder.entities);
+    WriteSceneTable(file, header, SCENE_TABLE_LIGHTS, builder.lights);
+
+    header.size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file);
+
+    bool isWritten = ferror(file) == 0;
+    fclose(file);
+
+    if (isWritten)
+    {
+        ILOG("Wrote %s: %u assets, %u nodes, %u entities", filepath, (u32)builder.assets.size(), (u32)builder.nodes.size(), (u32)builder.entities.size());
+    }
+    else
+    {
+        ELOG("Failed writing scene file %s\n", filepath);
+    }
+
+    return isWritten;
+}
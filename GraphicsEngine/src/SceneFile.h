@@ -0,0 +1,116 @@
+#pragma once
+
+#include "platform.h"
+
+#include "glm/gtc/quaternion.hpp"
+
+struct App;
+
+// Binary scene: a header followed by tables of fixed size records, read in place from the mapped file.
+// Records reference each other by index into their table, and strings by byte offset into the string table.
+#define SCENE_FILE_MAGIC 0x454E4353 // "SCNE"
+#define SCENE_FILE_VERSION 1
+#define SCENE_FILE_TABLE_ALIGNMENT 16
+#define SCENE_FILE_NONE 0xFFFFFFFF
+#define SCENE_FILE_MAX_PRIMITIVE_SEGMENTS 1024 // The sphere allocates (x + 1) * (y + 1) vertices, a corrupt count mustn't reach it
+
+#define SCENE_DIRECTORY "Assets/Scenes"
+#define DEFAULT_SCENE_PATH SCENE_DIRECTORY "/default.scene"
+
+enum SceneFileTable
+{
+    SCENE_TABLE_STRINGS,   // Null terminated, count in bytes
+    SCENE_TABLE_TEXTURES,
+    SCENE_TABLE_MATERIALS, // Of the primitives, loaded models create their own
+    SCENE_TABLE_ASSETS,
+    SCENE_TABLE_NODES,     // Parents always come before their children
+    SCENE_TABLE_ENTITIES,
+    SCENE_TABLE_LIGHTS,
+    SCENE_TABLE_COUNT
+};
+
+struct SceneFileTableRange
+{
+    u32 offset; // Bytes from the start of the file, aligned to SCENE_FILE_TABLE_ALIGNMENT
+    u32 count;
+};
+
+struct SceneFileHeader
+{
+    u32 magic;
+    u32 version;
+    u32 size; // Of the whole file
+    u32 reserved;
+    SceneFileTableRange tables[SCENE_TABLE_COUNT];
+};
+
+struct SceneTextureRecord
+{
+    u32 path;
+    u32 isFlipped;
+};
+
+struct SceneMaterialRecord
+{
+    u32 name;
+    glm::vec3 albedo;
+    glm::vec3 specular;
+    glm::vec3 reflective;
+    glm::vec3 emissive;
+    float shininess;
+    u32 textures[5]; // Albedo, emissive, specular, normals and bump, SCENE_FILE_NONE if the material doesn't reference one
+};
+
+enum SceneAssetType
+{
+    SCENE_ASSET_MODEL_FILE,
+    SCENE_ASSET_PRIMITIVE
+};
+
+struct SceneAssetRecord
+{
+    u32 type;
+
+    // Model files
+    u32 path;
+    u32 flipTextures;
+
+    // Primitives
+    u32 primitiveType;
+    u32 primitiveSegments[2];
+    u32 material;
+};
+
+struct SceneNodeRecord
+{
+    u32 parent;
+    glm::vec3 position;
+    glm::quat rotation;
+    glm::vec3 scale;
+};
+
+struct SceneEntityRecord
+{
+    u32 archetype; // EntityArchetype
+    u32 node;
+    u32 asset;
+    u32 shaderType; // ShaderType, resolved to the program of the current rendering mode when loading
+};
+
+// The light component of a light caster entity
+struct SceneLightRecord
+{
+    u32 entity;
+    glm::vec4 lightVector;
+    glm::vec3 color;
+    float constant;
+};
+
+// Maps the file and bulk constructs its assets, scene nodes, entities and lights into the App. The records are read in
+// place and the stores are reserved up front, nothing is allocated per node or entity. False, with the App untouched,
+// if the file doesn't exist or isn't a valid scene of this version.
+bool LoadSceneFile(App* app, const char* filepath);
+
+// Dumps the models, the materials of the primitives, the scene graph, the entities and their lights.
+// Entities without a scene node are skipped.
+bool WriteSceneFile(App* app, const char* filepath);
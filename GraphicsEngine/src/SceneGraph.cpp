@@ -0,0 +1,168 @@
+#include "SceneGraph.h"
+
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "Timer.h"
+
+static void MarkSceneNodeDirty(SceneGraph& graph, u32 node)
+{
+    if (graph.dirty[node])
+        return;
+
+    graph.dirty[node] = 1;
+    graph.dirtyRoots.push_back(node);
+}
+
+u32 CreateSceneNode(SceneGraph& graph, u32 parent, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale, EntityHandle entity)
+{
+    u32 node = graph.parents.size();
+
+    graph.parents.push_back(parent);
+    graph.firstChildren.push_back(SCENE_NODE_NONE);
+    graph.nextSiblings.push_back(SCENE_NODE_NONE);
+    graph.depths.push_back(0);
+    if (parent != SCENE_NODE_NONE)
+    {
+        graph.nextSiblings[node] = graph.firstChildren[parent];
+        graph.firstChildren[parent] = node;
+        graph.depths[node] = graph.depths[parent] + 1;
+    }
+
+    graph.localPositions.push_back(position);
+    graph.localRotations.push_back(rotation);
+    graph.localScales.push_back(scale);
+    graph.worldMatrices.push_back(glm::mat4(1.0f));
+    graph.entities.push_back(entity);
+
+    graph.dirty.push_back(0);
+    MarkSceneNodeDirty(graph, node);
+
+    return node;
+}
+
+void ReserveSceneNodes(SceneGraph& graph, u32 count)
+{
+    u32 capacity = graph.parents.size() + count;
+    graph.parents.reserve(capacity);
+    graph.firstChildren.reserve(capacity);
+    graph.nextSiblings.reserve(capacity);
+    graph.depths.reserve(capacity);
+    graph.localPositions.reserve(capacity);
+    graph.localRotations.reserve(capacity);
+    graph.localScales.reserve(capacity);
+    graph.worldMatrices.reserve(capacity);
+    graph.entities.reserve(capacity);
+    graph.dirty.reserve(capacity);
+    graph.dirtyRoots.reserve(graph.dirtyRoots.size() + count);
+}
+
+void SetSceneNodePosition(SceneGraph& graph, u32 node, const glm::vec3& position)
+{
+    graph.localPositions[node] = position;
+    MarkSceneNodeDirty(graph, node);
+}
+
+void SetSceneNodeRotation(SceneGraph& graph, u32 node, const glm::quat& rotation)
+{
+    graph.localRotations[node] = rotation;
+    MarkSceneNodeDirty(graph, node);
+}
+
+void SetSceneNodeScale(SceneGraph& graph, u32 node, const glm::vec3& scale)
+{
+    graph.localScales[node] = scale;
+    MarkSceneNodeDirty(graph, node);
+}
+
+struct WorldMatricesJob
+{
+    SceneGraph* graph;
+    EntityStore* entities;
+    const u32* nodes; // Of one level, their parents are already up to date
+};
+
+static void UpdateWorldMatricesJob(void* data, u32 begin, u32 end)
+{
+    PROFILE_SCOPE("Update World Matrices");
+
+    WorldMatricesJob& job = *(WorldMatricesJob*)data;
+    SceneGraph& graph = *job.graph;
+
+    for (u32 i = begin; i < end; ++i)
+    {
+        u32 node = job.nodes[i];
+
+        glm::mat4 local = glm::translate(graph.localPositions[node]) * glm::mat4_cast(graph.localRotations[node]) * glm::scale(graph.localScales[node]);
+        u32 parent = graph.parents[node];
+        glm::mat4& world = graph.worldMatrices[node];
+        world = parent == SCENE_NODE_NONE ? local : graph.worldMatrices[parent] * local;
+        graph.dirty[node] = 0;
+
+        EntityHandle entity = graph.entities[node];
+        if (!IsEntityAlive(*job.entities, entity))
+            continue;
+
+        u32 row;
+        EntityArchetypeStorage& storage = GetEntityArchetype(*job.entities, entity, row);
+        storage.modelMatrices[row] = world;
+
+        // Point lights shade from where their caster is, directional lights keep their direction
+        if ((storage.components & ENTITY_COMPONENT_LIGHT) && storage.lights[row].lightVector.w == 1.0f)
+            storage.lights[row].lightVector = glm::vec4(glm::vec3(world[3]), 1.0f);
+    }
+}
+
+void UpdateSceneGraph(SceneGraph& graph, EntityStore& entities)
+{
+    PROFILE_FUNCTION();
+
+    Timer timer(&graph.updateTime);
+    graph.updatedNodeCount = 0;
+    if (graph.dirtyRoots.empty())
+        return;
+
+    for (u32 depth = 0; depth < graph.levels.size(); ++depth)
+        graph.levels[depth].clear();
+
+    // Dirty nodes below another dirty node are reached from it, each subtree is walked once
+    for (u32 i = 0; i < graph.dirtyRoots.size(); ++i)
+    {
+        u32 root = graph.dirtyRoots[i];
+
+        bool isCovered = false;
+        for (u32 ancestor = graph.parents[root]; ancestor != SCENE_NODE_NONE && !isCovered; ancestor = graph.parents[ancestor])
+            isCovered = graph.dirty[ancestor] != 0;
+        if (isCovered)
+            continue;
+
+        u32 depth = graph.depths[root];
+        if (graph.levels.size() <= depth)
+            graph.levels.resize(depth + 1);
+        graph.levels[depth].push_back(root);
+    }
+    graph.dirtyRoots.clear();
+
+    // Breadth first: a level only starts once the one above it is finished, its nodes are independent of each other
+    WorldMatricesJob job = { &graph, &entities, nullptr };
+    for (u32 depth = 0; depth < graph.levels.size(); ++depth)
+    {
+        u32 levelSize = graph.levels[depth].size();
+        if (levelSize == 0)
+            continue;
+
+        job.nodes = graph.levels[depth].data();
+        ParallelFor(levelSize, SCENE_GRAPH_NODES_PER_JOB, UpdateWorldMatricesJob, &job);
+        graph.updatedNodeCount += levelSize;
+
+        // The whole subtree below an updated node is stale
+        for (u32 i = 0; i < levelSize; ++i)
+        {
+            for (u32 child = graph.firstChildren[graph.levels[depth][i]]; child != SCENE_NODE_NONE; child = graph.nextSiblings[child])
+            {
+                if (graph.levels.size() <= depth + 1)
+                    graph.levels.resize(depth + 2);
+                graph.levels[depth + 1].push_back(child);
+            }
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "platform.h"
+#include "EntityStore.h"
+
+#include "glm/gtc/quaternion.hpp"
+
+#define SCENE_GRAPH_NODES_PER_JOB 256
+
+// Transform hierarchy in SoA layout, indexed by node. Changing the local transform of a node marks it dirty, and the
+// next UpdateSceneGraph recomputes the world matrices of the dirty subtrees only, one depth level after the other.
+struct SceneGraph
+{
+    // Hierarchy, children as a linked list so adding one is O(1)
+    std::vector<u32> parents;
+    std::vector<u32> firstChildren;
+    std::vector<u32> nextSiblings;
+    std::vector<u32> depths; // 0 for the roots
+
+    // Local transform, applied as translation * rotation * scale
+    std::vector<glm::vec3> localPositions;
+    std::vector<glm::quat> localRotations;
+    std::vector<glm::vec3> localScales;
+
+    std::vector<glm::mat4> worldMatrices; // Valid after UpdateSceneGraph
+    std::vector<EntityHandle> entities;   // Whose model matrix is the world matrix of the node, if any
+
+    std::vector<u8> dirty;
+    std::vector<u32> dirtyRoots; // Nodes marked dirty since the last update, some may be below others
+
+    std::vector<std::vector<u32>> levels; // Nodes to update at each depth, reused every update
+
+    // Last update, shown in ImGui
+    u32 updatedNodeCount = 0;
+    f64 updateTime = 0.0; // ms
+};
+
+// The node starts dirty. The entity, if any, gets its model matrix and, for point lights, its light position from the node.
+u32 CreateSceneNode(SceneGraph& graph, u32 parent, const glm::vec3& position, const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), const glm::vec3& scale = glm::vec3(1.0f), EntityHandle entity = EntityHandle());
+
+// Makes room for count more nodes, so creating them doesn't allocate
+void ReserveSceneNodes(SceneGraph& graph, u32 count);
+
+void SetSceneNodePosition(SceneGraph& graph, u32 node, const glm::vec3& position);
+void SetSceneNodeRotation(SceneGraph& graph, u32 node, const glm::quat& rotation);
+void SetSceneNodeScale(SceneGraph& graph, u32 node, const glm::vec3& scale);
+
+// Once per frame, before the model matrices are read. Each level of the dirty subtrees is split across the job system,
+// the levels above it are always finished first. Entities removed since their node was created are skipped.
+void UpdateSceneGraph(SceneGraph& graph, EntityStore& entities);
@@ -1,8 +1,15 @@
 #include "Shader.h"
+#include "ShaderParameters.h"
+#include "Profiler.h"
+#include "RenderStats.h"
 
 void Shader::Bind()
 {
+    ASSERT(m_ActiveVariant < m_Variants.size(), "SelectVariant must be called before binding the shader");
+    FinishCompilation();
+
     glUseProgram(handle);
+    CountRenderStat(RENDER_COUNTER_PROGRAM_BINDS);
 }
 
 void Shader::Unbind()
@@ -10,77 +17,342 @@ void Shader::Unbind()
     glUseProgram(0);
 }
 
-void Shader::SetUniform1i(const std::string& name, int value)
+void Shader::SetUniform1i(const char* name, int value)
 {
     glUniform1i(GetUniformLocation(name), value);
+    CountRenderStat(RENDER_COUNTER_UNIFORM_SETS);
 }
 
-void Shader::SetUniform1ui(const std::string& name, u32 value)
+void Shader::SetUniform1ui(const char* name, u32 value)
 {
     glUniform1ui(GetUniformLocation(name), value);
+    CountRenderStat(RENDER_COUNTER_UNIFORM_SETS);
 }
 
-void Shader::SetUniform1f(const std::string& name, float value)
+void Shader::SetUniform1f(const char* name, float value)
 {
     glUniform1f(GetUniformLocation(name), value);
+    CountRenderStat(RENDER_COUNTER_UNIFORM_SETS);
 }
 
-void Shader::SetUniform2f(const std::string& name, const glm::vec2& value)
+void Shader::SetUniform2f(const char* name, const glm::vec2& value)
 {
     glUniform2fv(GetUniformLocation(name), 1, &value[0]);
+    CountRenderStat(RENDER_COUNTER_UNIFORM_SETS);
 }
 
-void Shader::SetUniform2f(const std::string& name, float v0, float v1)
+void Shader::SetUniform2f(const char* name, float v0, float v1)
 {
     glUniform2f(GetUniformLocation(name), v0, v1);
+    CountRenderStat(RENDER_COUNTER_UNIFORM_SETS);
 }
 
-void Shader::SetUniform3f(const std::string& name, const glm::vec3& value)
+void Shader::SetUniform3f(const char* name, const glm::vec3& value)
 {
     glUniform3fv(GetUniformLocation(name), 1, &value[0]);
+    CountRenderStat(RENDER_COUNTER_UNIFORM_SETS);
 }
 
-void Shader::SetUniform3f(const std::string& name, float v0, float v1, float v2)
+void Shader::SetUniform3f(const char* name, float v0, float v1, float v2)
 {
     glUniform3f(GetUniformLocation(name), v0, v1, v2);
+    CountRenderStat(RENDER_COUNTER_UNIFORM_SETS);
 }
 
-void Shader::SetUniform4f(const std::string& name, const glm::vec4& value)
+void Shader::SetUniform4f(const char* name, const glm::vec4& value)
 {
     glUniform4fv(GetUniformLocation(name), 1, &value[0]);
+    CountRenderStat(RENDER_COUNTER_UNIFORM_SETS);
 }
 
-void Shader::SetUniform4f(const std::string& name, float v0, float v1, float v2, float v3)
+void Shader::SetUniform4f(const char* name, float v0, float v1, float v2, float v3)
 {
     glUniform4f(GetUniformLocation(name), v0, v1, v2, v3);
+    CountRenderStat(RENDER_COUNTER_UNIFORM_SETS);
 }
 
-void Shader::SetUniformMat4(const std::string& name, const glm::mat4& matrix)
+void Shader::SetUniformMat4(const char* name, const glm::mat4& matrix)
 {
     glUniformMatrix4fv(GetUniformLocation(name), 1, GL_FALSE, &matrix[0][0]);
+    CountRenderStat(RENDER_COUNTER_UNIFORM_SETS);
+}
+
+void Shader::SetSamplerUnit(const std::string& name, int unit)
+{
+    for (u32 i = 0; i < m_SamplerUnits.size(); ++i)
+    {
+        if (m_SamplerUnits[i].first == name)
+        {
+            m_SamplerUnits.erase(m_SamplerUnits.begin() + i);
+            break;
+        }
+    }
+    m_SamplerUnits.emplace_back(name, unit);
+
+    // Variants still compiling get it when they finish
+    for (u32 i = 0; i < m_Variants.size(); ++i)
+    {
+        ShaderVariant& variant = m_Variants[i];
+        if (!variant.isCompiling)
+            glProgramUniform1i(variant.handle, glGetUniformLocation(variant.handle, name.c_str()), unit);
+    }
 }
 
-int Shader::GetUniformLocation(const std::string& name) const
+// FNV-1a
+static u64 HashUniformName(const char* name)
 {
-    auto locationSearch = m_UniformLocationCache.find(name);
-    if (locationSearch != m_UniformLocationCache.end())
+    u64 hash = 14695981039346656037ull;
+    while (*name)
+        hash = (hash ^ u8(*name++)) * 1099511628211ull;
+    return hash;
+}
+
+int Shader::GetUniformLocation(const char* name)
+{
+    std::unordered_map<u64, GLint>& uniformLocationCache = m_Variants[m_ActiveVariant].uniformLocationCache;
+
+    u64 key = HashUniformName(name);
+    auto locationSearch = uniformLocationCache.find(key);
+    if (locationSearch != uniformLocationCache.end())
         return locationSearch->second;
 
-    int location = glGetUniformLocation(handle, name.c_str());
+    int location = glGetUniformLocation(handle, name);
     if (location == -1)
-        ELOG("[WARNING] Shader Uniform doesn't exist: %s", name.c_str());
+        ELOG("[WARNING] Shader Uniform doesn't exist: %s", name);
 
-    m_UniformLocationCache[name] = location;
+    uniformLocationCache[key] = location;
 
     return location;
 }
 
-GLuint CreateShaderProgram(String programSource, const char* shaderName)
+// ------------------------------------------------------------------------------------------------
+// PROGRAM BINARY CACHE //
+// ------------------------------------------------------------------------------------------------
+
+#define PROGRAM_BINARY_MAGIC 0x42505247 // "GRPB"
+
+struct ProgramBinaryHeader
 {
-    GLchar infoLogBuffer[1024] = {};
-    GLsizei infoLogBufferSize = sizeof(infoLogBuffer);
-    GLsizei infoLogSize;
-    GLint success;
+    u32 magic;
+    u64 key;
+    GLenum format;
+    u32 size;
+};
+
+struct ProgramBinaryCache
+{
+    bool enabled;
+    u64 driverHash;
+};
+
+static ProgramBinaryCache GlobalProgramBinaryCache = {};
+
+// ------------------------------------------------------------------------------------------------
+// PARALLEL COMPILATION //
+// ------------------------------------------------------------------------------------------------
+
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC_)(GLuint count);
+
+static bool GlobalParallelShaderCompile = false;
+
+void InitParallelShaderCompile(const std::vector<std::string>& extensions)
+{
+    // The ARB and KHR extensions share the enums, only the function suffix differs
+    const char* functionName = nullptr;
+    for (u32 i = 0; i < extensions.size(); ++i)
+    {
+        if (extensions[i] == "GL_KHR_parallel_shader_compile")
+            functionName = "glMaxShaderCompilerThreadsKHR";
+        else if (extensions[i] == "GL_ARB_parallel_shader_compile" && !functionName)
+            functionName = "glMaxShaderCompilerThreadsARB";
+    }
+
+    if (!functionName)
+        return;
+
+    PFNGLMAXSHADERCOMPILERTHREADSKHRPROC_ maxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC_)GetOpenGLProcAddress(functionName);
+    if (!maxShaderCompilerThreads)
+        return;
+
+    maxShaderCompilerThreads(0xFFFFFFFF); // Let the driver pick the number of threads
+    GlobalParallelShaderCompile = true;
+    ILOG("Parallel shader compilation enabled (%s)\n", functionName);
+}
+
+// FNV-1a, chained through the seed so several strings can be hashed together
+static u64 HashBytes(const void* data, u32 size, u64 seed = 14695981039346656037ull)
+{
+    const u8* bytes = (const u8*)data;
+    u64 hash = seed;
+    for (u32 i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static u64 HashString(const std::string& string, u64 seed)
+{
+    return HashBytes(string.data(), string.size(), seed);
+}
+
+void InitProgramBinaryCache(const std::string& vendor, const std::string& renderer, const std::string& version)
+{
+    GLint numBinaryFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numBinaryFormats);
+    if (numBinaryFormats == 0)
+    {
+        ILOG("The driver doesn't support program binaries, shaders will always be compiled\n");
+        return;
+    }
+
+    if (!MakeDirectory(PROGRAM_BINARY_CACHE_DIRECTORY))
+    {
+        ELOG("Could not create the program binary cache directory %s\n", PROGRAM_BINARY_CACHE_DIRECTORY);
+        return;
+    }
+
+    u64 hash = HashString(vendor, HashBytes(nullptr, 0));
+    hash = HashString(renderer, hash);
+    hash = HashString(version, hash);
+
+    GlobalProgramBinaryCache.driverHash = hash;
+    GlobalProgramBinaryCache.enabled = true;
+}
+
+// Named after the program and its variant, every binary of a variant but the newest one is stale
+static std::string ProgramBinaryPrefix(const char* shaderName, u32 features)
+{
+    char prefix[160];
+    sprintf(prefix, "%s_%02x_", shaderName, features);
+    return prefix;
+}
+
+static std::string ProgramBinaryPath(const char* shaderName, u32 features, u64 key)
+{
+    char filename[32];
+    sprintf(filename, "%016llx.bin", key);
+    return PROGRAM_BINARY_CACHE_DIRECTORY "/" + ProgramBinaryPrefix(shaderName, features) + filename;
+}
+
+// Binaries of the variant from older sources or drivers, their keys can never match again
+static void PruneProgramBinaries(const char* shaderName, u32 features, u64 key)
+{
+    std::string prefix = ProgramBinaryPrefix(shaderName, features);
+    std::string current = ProgramBinaryPath(shaderName, features, key);
+    const u32 keyLength = 16 + 4; // Hex key and ".bin"
+
+    std::vector<std::string> filenames;
+    ListDirectoryFiles(PROGRAM_BINARY_CACHE_DIRECTORY, filenames);
+    for (u32 i = 0; i < filenames.size(); ++i)
+    {
+        const std::string& filename = filenames[i];
+        if (filename.size() != prefix.size() + keyLength || filename.compare(0, prefix.size(), prefix) != 0)
+            continue;
+
+        std::string filepath = PROGRAM_BINARY_CACHE_DIRECTORY "/" + filename;
+        if (filepath != current)
+            remove(filepath.c_str());
+    }
+}
+
+// Returns 0 if there is no binary for the key or the driver rejects it
+static GLuint LoadProgramBinary(const char* shaderName, u32 features, u64 key)
+{
+    std::string filepath = ProgramBinaryPath(shaderName, features, key);
+    FILE* file = fopen(filepath.c_str(), "rb");
+    if (!file)
+        return 0;
+
+    ProgramBinaryHeader header = {};
+    std::vector<u8> binary;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 && header.magic == PROGRAM_BINARY_MAGIC && header.key == key;
+    if (valid)
+    {
+        binary.resize(header.size);
+        valid = fread(binary.data(), 1, header.size, file) == header.size;
+    }
+    fclose(file);
+
+    GLuint programHandle = 0;
+    if (valid)
+    {
+        programHandle = glCreateProgram();
+        glProgramBinary(programHandle, header.format, binary.data(), header.size);
+
+        // Drivers reject binaries after an update even if the version string didn't change
+        GLint success;
+        glGetProgramiv(programHandle, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            glDeleteProgram(programHandle);
+            programHandle = 0;
+        }
+    }
+
+    if (!programHandle)
+    {
+        ILOG("Program binary of %s rejected, compiling it from source\n", shaderName);
+        remove(filepath.c_str());
+    }
+
+    return programHandle;
+}
+
+static void SaveProgramBinary(GLuint programHandle, const char* shaderName, u32 features, u64 key)
+{
+    GLint binarySize = 0;
+    glGetProgramiv(programHandle, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+    if (binarySize <= 0)
+        return;
+
+    ProgramBinaryHeader header = {};
+    header.magic = PROGRAM_BINARY_MAGIC;
+    header.key = key;
+    header.size = (u32)binarySize;
+
+    std::vector<u8> binary(binarySize);
+    glGetProgramBinary(programHandle, binarySize, NULL, &header.format, binary.data());
+
+    std::string filepath = ProgramBinaryPath(shaderName, features, key);
+    FILE* file = fopen(filepath.c_str(), "wb");
+    if (!file)
+    {
+        ELOG("Could not write program binary %s\n", filepath.c_str());
+        return;
+    }
+
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(binary.data(), 1, binary.size(), file);
+    fclose(file);
+
+    PruneProgramBinaries(shaderName, features, key);
+}
+
+// ------------------------------------------------------------------------------------------------
+// SHADER PROGRAM //
+// ------------------------------------------------------------------------------------------------
+
+static const char* ShaderFeatureNames[SHADER_FEATURE_COUNT] =
+{
+    "ALBEDO_MAP",
+    "SPECULAR_MAP",
+    "IRRADIANCE",
+    "REFLECTION",
+    "REFRACTION",
+    "SSAO",
+    "RANGE_CHECK",
+    "SHADOWS"
+};
+
+ShaderProgramBuild BeginShaderProgram(String programSource, const char* shaderName, u32 features)
+{
+    PROFILE_FUNCTION();
+
+    ShaderProgramBuild build = {};
+    strncpy(build.shaderName, shaderName, sizeof(build.shaderName) - 1);
+    build.features = features;
 
     char versionString[] = "#version 430\n";
     char shaderNameDefine[128];
@@ -88,72 +360,158 @@ GLuint CreateShaderProgram(String programSource, const char* shaderName)
     char vertexShaderDefine[] = "#define VERTEX\n";
     char fragmentShaderDefine[] = "#define FRAGMENT\n";
 
+    char featureDefines[512] = {};
+    for (u32 i = 0; i < SHADER_FEATURE_COUNT; ++i)
+    {
+        if (features & (1 << i))
+        {
+            strcat(featureDefines, "#define ");
+            strcat(featureDefines, ShaderFeatureNames[i]);
+            strcat(featureDefines, "\n");
+        }
+    }
+
+    // Parameter blocks are generated from their C++ structs, so both sides always agree on the layout
+    static const std::string blockDeclarations = GenerateShaderParameterDeclarations();
+
+    // The key covers everything the driver sees: prologue, source and the driver itself
+    if (GlobalProgramBinaryCache.enabled)
+    {
+        u64 cacheKey = HashBytes(versionString, strlen(versionString), GlobalProgramBinaryCache.driverHash);
+        cacheKey = HashBytes(shaderNameDefine, strlen(shaderNameDefine), cacheKey);
+        cacheKey = HashBytes(featureDefines, strlen(featureDefines), cacheKey);
+        cacheKey = HashBytes(blockDeclarations.c_str(), blockDeclarations.size(), cacheKey);
+        cacheKey = HashBytes(vertexShaderDefine, strlen(vertexShaderDefine), cacheKey);
+        cacheKey = HashBytes(fragmentShaderDefine, strlen(fragmentShaderDefine), cacheKey);
+        cacheKey = HashBytes(programSource.str, programSource.len, cacheKey);
+        build.cacheKey = cacheKey;
+
+        build.programHandle = LoadProgramBinary(shaderName, features, cacheKey);
+        if (build.programHandle)
+            return build;
+    }
+
     const GLchar* vertexShaderSource[] = {
         versionString,
         shaderNameDefine,
+        featureDefines,
+        blockDeclarations.c_str(),
         vertexShaderDefine,
         programSource.str
     };
     const GLint vertexShaderLengths[] = {
         (GLint)strlen(versionString),
         (GLint)strlen(shaderNameDefine),
+        (GLint)strlen(featureDefines),
+        (GLint)blockDeclarations.size(),
         (GLint)strlen(vertexShaderDefine),
         (GLint)programSource.len
     };
     const GLchar* fragmentShaderSource[] = {
         versionString,
         shaderNameDefine,
+        featureDefines,
+        blockDeclarations.c_str(),
         fragmentShaderDefine,
         programSource.str
     };
     const GLint fragmentShaderLengths[] = {
         (GLint)strlen(versionString),
         (GLint)strlen(shaderNameDefine),
+        (GLint)strlen(featureDefines),
+        (GLint)blockDeclarations.size(),
         (GLint)strlen(fragmentShaderDefine),
         (GLint)programSource.len
     };
 
-    GLuint vshader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vshader, ARRAY_COUNT(vertexShaderSource), vertexShaderSource, vertexShaderLengths);
-    glCompileShader(vshader);
-    glGetShaderiv(vshader, GL_COMPILE_STATUS, &success);
+    // No status is queried here, so the driver is free to compile and link in the background
+    build.vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(build.vertexShader, ARRAY_COUNT(vertexShaderSource), vertexShaderSource, vertexShaderLengths);
+    glCompileShader(build.vertexShader);
+
+    build.fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(build.fragmentShader, ARRAY_COUNT(fragmentShaderSource), fragmentShaderSource, fragmentShaderLengths);
+    glCompileShader(build.fragmentShader);
+
+    build.programHandle = glCreateProgram();
+    glAttachShader(build.programHandle, build.vertexShader);
+    glAttachShader(build.programHandle, build.fragmentShader);
+    if (GlobalProgramBinaryCache.enabled)
+        glProgramParameteri(build.programHandle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(build.programHandle);
+
+    return build;
+}
+
+bool IsShaderProgramBuildComplete(const ShaderProgramBuild& build)
+{
+    if (!build.vertexShader || !GlobalParallelShaderCompile)
+        return true;
+
+    GLint completed = GL_FALSE;
+    glGetProgramiv(build.programHandle, GL_COMPLETION_STATUS_KHR, &completed);
+    return completed == GL_TRUE;
+}
+
+GLuint FinishShaderProgram(ShaderProgramBuild& build)
+{
+    PROFILE_FUNCTION();
+
+    // Programs loaded from the binary cache were already validated
+    if (!build.vertexShader)
+        return build.programHandle;
+
+    GLchar infoLogBuffer[1024] = {};
+    GLsizei infoLogBufferSize = sizeof(infoLogBuffer);
+    GLsizei infoLogSize;
+    GLint success;
+
+    const char* shaderName = build.shaderName;
+
+    glGetShaderiv(build.vertexShader, GL_COMPILE_STATUS, &success);
     if (!success)
     {
-        glGetShaderInfoLog(vshader, infoLogBufferSize, &infoLogSize, infoLogBuffer);
+        glGetShaderInfoLog(build.vertexShader, infoLogBufferSize, &infoLogSize, infoLogBuffer);
         ELOG("glCompileShader() failed with vertex shader %s\nReported message:\n%s\n", shaderName, infoLogBuffer);
     }
 
-    GLuint fshader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fshader, ARRAY_COUNT(fragmentShaderSource), fragmentShaderSource, fragmentShaderLengths);
-    glCompileShader(fshader);
-    glGetShaderiv(fshader, GL_COMPILE_STATUS, &success);
+    glGetShaderiv(build.fragmentShader, GL_COMPILE_STATUS, &success);
     if (!success)
     {
-        glGetShaderInfoLog(fshader, infoLogBufferSize, &infoLogSize, infoLogBuffer);
+        glGetShaderInfoLog(build.fragmentShader, infoLogBufferSize, &infoLogSize, infoLogBuffer);
         ELOG("glCompileShader() failed with fragment shader %s\nReported message:\n%s\n", shaderName, infoLogBuffer);
     }
 
-    GLuint programHandle = glCreateProgram();
-    glAttachShader(programHandle, vshader);
-    glAttachShader(programHandle, fshader);
-    glLinkProgram(programHandle);
+    GLuint programHandle = build.programHandle;
     glGetProgramiv(programHandle, GL_LINK_STATUS, &success);
     if (!success)
     {
         glGetProgramInfoLog(programHandle, infoLogBufferSize, &infoLogSize, infoLogBuffer);
         ELOG("glLinkProgram() failed with program %s\nReported message:\n%s\n", shaderName, infoLogBuffer);
     }
+    else if (GlobalProgramBinaryCache.enabled)
+    {
+        SaveProgramBinary(programHandle, shaderName, build.features, build.cacheKey);
+    }
 
-    glUseProgram(0);
-
-    glDetachShader(programHandle, vshader);
-    glDetachShader(programHandle, fshader);
-    glDeleteShader(vshader);
-    glDeleteShader(fshader);
+    glDetachShader(programHandle, build.vertexShader);
+    glDetachShader(programHandle, build.fragmentShader);
+    glDeleteShader(build.vertexShader);
+    glDeleteShader(build.fragmentShader);
+    build.vertexShader = 0;
+    build.fragmentShader = 0;
 
     return programHandle;
 }
 
+GLuint CreateShaderProgram(String programSource, const char* shaderName, u32 features)
+{
+    PROFILE_FUNCTION();
+
+    ShaderProgramBuild build = BeginShaderProgram(programSource, shaderName, features);
+    return FinishShaderProgram(build);
+}
+
 void InputShaderLayout(Shader& shaderProgram)
 {
     char* attributeName;
@@ -187,20 +545,159 @@ void InputShaderLayout(Shader& shaderProgram)
     delete[] attributeName;
 }
 
-u32 LoadShaderProgram(std::vector<Shader>& shaderPrograms, ShaderType type, const char* filepath, const char* programName)
+// ------------------------------------------------------------------------------------------------
+// VARIANTS //
+// ------------------------------------------------------------------------------------------------
+
+u32 Shader::BeginVariant(u32 features)
+{
+    String programSource = { &source[0], (u32)source.size() };
+
+    ShaderVariant variant = {};
+    variant.features = features;
+    variant.build = BeginShaderProgram(programSource, programName.c_str(), features);
+    variant.handle = variant.build.programHandle;
+    variant.isCompiling = true;
+    m_Variants.push_back(variant);
+
+    return m_Variants.size() - 1;
+}
+
+void Shader::FinishVariant(ShaderVariant& variant)
+{
+    if (!variant.isCompiling)
+        return;
+
+    FinishShaderProgram(variant.build);
+    variant.isCompiling = false;
+
+    ApplySamplerUnits(variant.handle);
+}
+
+void Shader::ApplySamplerUnits(u32 programHandle) const
+{
+    for (u32 i = 0; i < m_SamplerUnits.size(); ++i)
+        glProgramUniform1i(programHandle, glGetUniformLocation(programHandle, m_SamplerUnits[i].first.c_str()), m_SamplerUnits[i].second);
+}
+
+void Shader::SelectVariant(u32 features)
+{
+    features = (features & optionalFeatures) | baseFeatures;
+
+    bool hasActiveVariant = m_ActiveVariant < m_Variants.size();
+    if (hasActiveVariant && m_Variants[m_ActiveVariant].features == features)
+        return;
+
+    u32 variantIndex = 0;
+    while (variantIndex < m_Variants.size() && m_Variants[variantIndex].features != features)
+        ++variantIndex;
+
+    if (variantIndex == m_Variants.size())
+        variantIndex = BeginVariant(features);
+
+    // Keep drawing with the current variant while the new one compiles
+    ShaderVariant& variant = m_Variants[variantIndex];
+    if (hasActiveVariant && variant.isCompiling)
+    {
+        if (!IsShaderProgramBuildComplete(variant.build))
+            return;
+        FinishVariant(variant);
+    }
+
+    m_ActiveVariant = variantIndex;
+    handle = variant.handle;
+}
+
+bool Shader::IsReady()
+{
+    ShaderVariant& variant = m_Variants[m_ActiveVariant];
+    if (!variant.isCompiling)
+        return true;
+
+    if (!IsShaderProgramBuildComplete(variant.build))
+        return false;
+
+    FinishCompilation();
+    return true;
+}
+
+void Shader::FinishCompilation()
+{
+    ShaderVariant& variant = m_Variants[m_ActiveVariant];
+    if (!variant.isCompiling)
+        return;
+
+    FinishVariant(variant);
+
+    if (vertexLayout.attributes.empty())
+        InputShaderLayout(*this);
+}
+
+void Shader::Reload(const std::string& newSource, const std::vector<u32>& variantFeatures, const std::vector<u32>& variantHandles)
+{
+    source = newSource;
+
+    for (u32 i = 0; i < m_Variants.size(); ++i)
+    {
+        ShaderVariant& variant = m_Variants[i];
+        FinishVariant(variant);
+        glDeleteProgram(variant.handle);
+
+        u32 rebuiltIndex = 0;
+        while (rebuiltIndex < variantFeatures.size() && variantFeatures[rebuiltIndex] != variant.features)
+            ++rebuiltIndex;
+
+        if (rebuiltIndex < variantFeatures.size())
+        {
+            variant.handle = variantHandles[rebuiltIndex];
+        }
+        else
+        {
+            // Created after the reload started, so it still has to be compiled from the new source
+            String programSource = { &source[0], (u32)source.size() };
+            variant.build = BeginShaderProgram(programSource, programName.c_str(), variant.features);
+            variant.handle = variant.build.programHandle;
+            variant.isCompiling = true;
+        }
+        variant.uniformLocationCache.clear();
+
+        if (!variant.isCompiling)
+            ApplySamplerUnits(variant.handle);
+    }
+
+    handle = m_Variants[m_ActiveVariant].handle;
+}
+
+void Shader::GetVariantFeatures(std::vector<u32>& variantFeatures) const
+{
+    variantFeatures.clear();
+    for (u32 i = 0; i < m_Variants.size(); ++i)
+        variantFeatures.push_back(m_Variants[i].features);
+}
+
+static u32 GetShaderTypeFeatures(ShaderType type)
+{
+    switch (type)
+    {
+    case ShaderType::TEXTURED_ALBEDO:   return SHADER_FEATURE_ALBEDO_MAP;
+    case ShaderType::TEXTURED_ALB_SPEC: return SHADER_FEATURE_ALBEDO_MAP | SHADER_FEATURE_SPECULAR_MAP;
+    default:                            return 0;
+    }
+}
+
+u32 LoadShaderProgram(std::vector<Shader>& shaderPrograms, ShaderType type, const char* filepath, const char* programName, u32 optionalFeatures)
 {
     String programSource = ReadTextFile(filepath);
 
     Shader program = {};
-    program.handle = CreateShaderProgram(programSource, programName);
     program.filepath = filepath;
     program.programName = programName;
-    program.lastWriteTimestamp = GetFileLastWriteTimestamp(filepath);
+    program.source.assign(programSource.str, programSource.len);
     program.type = type;
-
-    InputShaderLayout(program);
+    program.baseFeatures = GetShaderTypeFeatures(type);
+    program.optionalFeatures = optionalFeatures;
 
     shaderPrograms.push_back(program);
 
     return shaderPrograms.size() - 1;
-}
\ No newline at end of file
+}
@@ -5,6 +5,11 @@
 
 #include <unordered_map>
 
+// GL_KHR_parallel_shader_compile is not part of the generated loader
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
 enum class ShaderType
 {
     DEFAULT,
@@ -16,41 +21,122 @@ enum class ShaderType
     OTHER
 };
 
+// Feature #defines a program can be compiled with. Each combination is a separate variant of the program.
+enum ShaderFeature
+{
+    SHADER_FEATURE_ALBEDO_MAP   = 1 << 0,
+    SHADER_FEATURE_SPECULAR_MAP = 1 << 1,
+    SHADER_FEATURE_IRRADIANCE   = 1 << 2,
+    SHADER_FEATURE_REFLECTION   = 1 << 3,
+    SHADER_FEATURE_REFRACTION   = 1 << 4,
+    SHADER_FEATURE_SSAO         = 1 << 5,
+    SHADER_FEATURE_RANGE_CHECK  = 1 << 6,
+    SHADER_FEATURE_SHADOWS      = 1 << 7,
+    SHADER_FEATURE_COUNT        = 8
+};
+
+// Program submitted to the driver whose compile and link status haven't been queried yet
+struct ShaderProgramBuild
+{
+    GLuint programHandle;
+    GLuint vertexShader; // 0 once finished or if the program was loaded from the binary cache
+    GLuint fragmentShader;
+    u64 cacheKey;
+    u32 features;
+    char shaderName[128];
+};
+
+struct ShaderVariant
+{
+    u32 features;
+    u32 handle;
+
+    ShaderProgramBuild build;
+    bool isCompiling;
+
+    // Caching for uniforms, keyed by the hash of the name so looking one up doesn't allocate
+    std::unordered_map<u64, GLint> uniformLocationCache;
+};
+
 class Shader
 {
 public:
     void Bind();
     void Unbind();
 
-    void SetUniform1i(const std::string& name, int value);
-    void SetUniform1ui(const std::string& name, u32 value);
-    void SetUniform1f(const std::string& name, float value);
-    void SetUniform2f(const std::string& name, const glm::vec2& value);
-    void SetUniform2f(const std::string& name, float v0, float v1);
-    void SetUniform3f(const std::string& name, const glm::vec3& value);
-    void SetUniform3f(const std::string& name, float v0, float v1, float v2);
-    void SetUniform4f(const std::string& name, const glm::vec4& value);
-    void SetUniform4f(const std::string& name, float v0, float v1, float v2, float v3);
-    void SetUniformMat4(const std::string& name, const glm::mat4& matrix);
+    void SetUniform1i(const char* name, int value);
+    void SetUniform1ui(const char* name, u32 value);
+    void SetUniform1f(const char* name, float value);
+    void SetUniform2f(const char* name, const glm::vec2& value);
+    void SetUniform2f(const char* name, float v0, float v1);
+    void SetUniform3f(const char* name, const glm::vec3& value);
+    void SetUniform3f(const char* name, float v0, float v1, float v2);
+    void SetUniform4f(const char* name, const glm::vec4& value);
+    void SetUniform4f(const char* name, float v0, float v1, float v2, float v3);
+    void SetUniformMat4(const char* name, const glm::mat4& matrix);
+
+    // Location in the active variant, cached. Lets the draw packets set uniforms without the name lookup.
+    // Takes the name as a C string so the per frame calls with literals don't build a std::string.
+    int GetUniformLocation(const char* name);
+
+    // Applied to every variant, including the ones compiled later. Doesn't need the program bound.
+    void SetSamplerUnit(const std::string& name, int unit);
+
+    // Makes the variant with the given features active, compiling it if needed. Features the program
+    // doesn't use are ignored. The current variant stays active until the new one finishes compiling.
+    void SelectVariant(u32 features);
+
+    // Polls the driver without blocking. Returns false while the active variant is still being compiled.
+    bool IsReady();
+    // Blocks until the active variant is compiled and linked. Bind calls it on variants still compiling.
+    void FinishCompilation();
+
+    // Replaces the source and the variants rebuilt by the hot reload thread. Variants without a
+    // rebuilt program are compiled again from the new source.
+    void Reload(const std::string& newSource, const std::vector<u32>& variantFeatures, const std::vector<u32>& variantHandles);
+    void GetVariantFeatures(std::vector<u32>& variantFeatures) const;
+    u32 GetVariantCount() const { return m_Variants.size(); }
 
 public:
-    u32 handle;
+    u32 handle; // Program of the active variant
     std::string filepath;
     std::string programName;
-    u64 lastWriteTimestamp;
+    std::string source;
 
     VertexShaderLayout vertexLayout;
 
     ShaderType type;
+    u32 baseFeatures;     // Always defined, given by the shader type
+    u32 optionalFeatures; // Features the program can be selected with
 
 private:
-    int GetUniformLocation(const std::string& name) const;
+    u32 BeginVariant(u32 features);
+    void FinishVariant(ShaderVariant& variant);
+    void ApplySamplerUnits(u32 programHandle) const;
 
 private:
-    // Caching for uniforms
-    mutable std::unordered_map<std::string, GLint> m_UniformLocationCache;
+    std::vector<ShaderVariant> m_Variants;
+    u32 m_ActiveVariant = 0;
+
+    std::vector<std::pair<std::string, int>> m_SamplerUnits;
 };
 
-GLuint CreateShaderProgram(String programSource, const char* shaderName);
+#define PROGRAM_BINARY_CACHE_DIRECTORY "ShaderCache"
+
+// Enables the program binary cache. Binaries are only valid for the driver that produced them,
+// so the driver strings are part of every cache key.
+void InitProgramBinaryCache(const std::string& vendor, const std::string& renderer, const std::string& version);
+
+// Uses GL_KHR_parallel_shader_compile when available so the program status can be polled without blocking
+void InitParallelShaderCompile(const std::vector<std::string>& extensions);
+
+// Loads the program from the binary cache when possible, otherwise submits its compilation and link
+ShaderProgramBuild BeginShaderProgram(String programSource, const char* shaderName, u32 features = 0);
+bool IsShaderProgramBuildComplete(const ShaderProgramBuild& build);
+// Checks the compile and link status, logging any error, and stores the binary in the cache
+GLuint FinishShaderProgram(ShaderProgramBuild& build);
+
+GLuint CreateShaderProgram(String programSource, const char* shaderName, u32 features = 0);
 
-u32 LoadShaderProgram(std::vector<Shader>& shaderPrograms, ShaderType type, const char* filepath, const char* programName);
\ No newline at end of file
+// No variant is compiled until SelectVariant is called
+u32 LoadShaderProgram(std::vector<Shader>& shaderPrograms, ShaderType type, const char* filepath, const char* programName, u32 optionalFeatures = 0);
\ No newline at end of file
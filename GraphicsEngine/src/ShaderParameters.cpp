@@ -0,0 +1,12 @@
+#include "ShaderParameters.h"
+
+std::string GenerateShaderParameterDeclarations()
+{
+    std::string glsl;
+    glsl += GenerateGLSLStruct<Light>();
+    glsl += GenerateGLSLBlock<GlobalParameters>(GLOBAL_PARAMETERS_BINDING);
+    glsl += GenerateGLSLBlock<LocalParameters>(LOCAL_PARAMETERS_BINDING);
+    glsl += GenerateGLSLBlock<SSAOParameters>(SSAO_PARAMETERS_BINDING, false, "uSSAOptions");
+    glsl += GenerateGLSLBlock<ShadowParameters>(SHADOW_PARAMETERS_BINDING, false, "uShadows");
+    return glsl;
+}
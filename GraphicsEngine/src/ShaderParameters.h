@@ -0,0 +1,75 @@
+#pragma once
+
+#include "ParameterBlocks.h"
+
+// Binding points of the blocks every shader program gets declared in its prologue
+#define GLOBAL_PARAMETERS_BINDING 0
+#define LOCAL_PARAMETERS_BINDING 1
+#define SSAO_PARAMETERS_BINDING 2
+#define SHADOW_PARAMETERS_BINDING 3
+
+#define MAX_LIGHTS 16
+#define SSAO_MAX_KERNEL_SIZE 64
+#define SHADOW_CASCADE_COUNT 3 // At most 4, their texel sizes share a vec4
+#define SHADOW_MAX_POINT_LIGHTS 8
+
+// 3 components of lightVector for position/direction and last for the type of the light
+// 0.0 is Directional light and 1.0 is Point light
+#define LIGHT_FIELDS(FIELD, ARRAY) \
+    FIELD(glm::vec4, lightVector)  \
+    FIELD(glm::vec3, color)        \
+    FIELD(float, constant)
+
+DECLARE_PARAMETER_BLOCK(Light, LIGHT_FIELDS, BlockLayout::STD140)
+
+// Per frame. uLODBias is added to the mip level of the material textures.
+// uJitter is the sub-pixel offset of the projection in NDC, zero without temporal upsampling.
+#define GLOBAL_PARAMETERS_FIELDS(FIELD, ARRAY) \
+    FIELD(glm::vec3, uViewPos)                 \
+    FIELD(u32, uNumLights)                     \
+    ARRAY(Light, uLights, MAX_LIGHTS)          \
+    FIELD(float, uLODBias)                     \
+    FIELD(glm::vec2, uJitter)
+
+DECLARE_PARAMETER_BLOCK(GlobalParameters, GLOBAL_PARAMETERS_FIELDS, BlockLayout::STD140)
+
+// Per entity. uPrevMVP is the previous frame's without jitter, for the motion vectors.
+#define LOCAL_PARAMETERS_FIELDS(FIELD, ARRAY) \
+    FIELD(glm::mat4, uModel)                  \
+    FIELD(glm::mat4, uMVP)                    \
+    FIELD(glm::mat4, uPrevMVP)
+
+DECLARE_PARAMETER_BLOCK(LocalParameters, LOCAL_PARAMETERS_FIELDS, BlockLayout::STD140)
+
+// SSAO pass, accessed through the uSSAOptions instance in the shader. Only the XYZ of the samples are used.
+#define SSAO_PARAMETERS_FIELDS(FIELD, ARRAY)          \
+    ARRAY(glm::vec4, uSamples, SSAO_MAX_KERNEL_SIZE)  \
+    FIELD(glm::mat4, uProjection)                     \
+    FIELD(glm::mat4, uInverseProjection)              \
+    FIELD(glm::mat4, uView)                           \
+    FIELD(glm::vec2, uDisplaySize)                    \
+    FIELD(float, uRadius)                             \
+    FIELD(float, uBias)                               \
+    FIELD(float, uPower)                              \
+    FIELD(int, uKernelSize)
+
+DECLARE_PARAMETER_BLOCK(SSAOParameters, SSAO_PARAMETERS_FIELDS, BlockLayout::STD140)
+
+// Shadow maps of the lighting pass, accessed through the uShadows instance. The cascades are the ones of the light in row
+// uCascadeLight, -1 without a directional light. uCascadeTexelSizes is the world size of a texel of each cascade, 0 until
+// it's rendered.
+// uPointShadows is the position each cube was rendered from and its far plane, 0 until it's rendered.
+// uPointShadowSlots.x is the cube of each light, -1 without one.
+#define SHADOW_PARAMETERS_FIELDS(FIELD, ARRAY)                  \
+    ARRAY(glm::mat4, uCascadeMatrices, SHADOW_CASCADE_COUNT)    \
+    ARRAY(glm::vec4, uPointShadows, SHADOW_MAX_POINT_LIGHTS)    \
+    ARRAY(glm::ivec4, uPointShadowSlots, MAX_LIGHTS)            \
+    FIELD(glm::vec4, uCascadeTexelSizes)                        \
+    FIELD(int, uCascadeLight)                                   \
+    FIELD(float, uCascadeBias)                                  \
+    FIELD(float, uPointBias)
+
+DECLARE_PARAMETER_BLOCK(ShadowParameters, SHADOW_PARAMETERS_FIELDS, BlockLayout::STD140)
+
+// GLSL declarations of all the blocks above, inserted in the prologue of every shader program
+std::string GenerateShaderParameterDeclarations();
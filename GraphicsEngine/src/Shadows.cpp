@@ -0,0 +1,740 @@
+#include "Shadows.h"
+
+#include "engine.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+#include "GPUMemory.h"
+
+#include "glad/glad.h"
+#include "imgui-docking/imgui.h"
+
+#define SHADOW_ALL_FACES 0x3F
+
+// Face order of GL_TEXTURE_CUBE_MAP_POSITIVE_X onwards, with the up vectors the cube map lookup expects
+static const glm::vec3 CubeFaceDirections[6] =
+{
+    glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+    glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+    glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)
+};
+
+static const glm::vec3 CubeFaceUps[6] =
+{
+    glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+    glm::vec3(0.0f, 0.0f, 1.0f),  glm::vec3(0.0f, 0.0f, -1.0f),
+    glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)
+};
+
+// What a map covers: the light space box of a cascade, or the sphere around a point light
+struct ShadowVolume
+{
+    glm::mat4 lightMatrix;
+    float radius;
+    glm::vec3 position;
+    float farPlane; // 0 for a cascade
+};
+
+static u32 CreateShadowTexture(GLenum target, u32 size, u32 layers, bool comparison, const char* name)
+{
+    u32 handle;
+    glGenTextures(1, &handle);
+    glBindTexture(target, handle);
+
+    glTexStorage3D(target, 1, GL_DEPTH_COMPONENT32F, size, size, layers);
+
+    // Linear filtering of a comparison sampler is a 2x2 PCF for free
+    GLenum filter = comparison ? GL_LINEAR : GL_NEAREST;
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    if (comparison)
+    {
+        glTexParameteri(target, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(target, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    }
+
+    glBindTexture(target, 0);
+
+    TrackGPUAllocation(GPUResourceKind::TEXTURE, handle, GetTextureMemorySize(GL_DEPTH_COMPONENT32F, size, size, layers), GPU_MEMORY_RENDER_TARGETS, name);
+
+    return handle;
+}
+
+static void DeleteShadowTexture(u32& handle)
+{
+    UntrackGPUAllocation(GPUResourceKind::TEXTURE, handle);
+    glDeleteTextures(1, &handle);
+    handle = 0;
+}
+
+void InitShadowMaps(ShadowMaps& shadows, u32 shaderID)
+{
+    shadows.shaderID = shaderID;
+
+    shadows.cascadeCache = CreateShadowTexture(GL_TEXTURE_2D_ARRAY, SHADOW_CASCADE_SIZE, SHADOW_CASCADE_COUNT, false, "Cascade Shadow Cache");
+    shadows.cascadeMaps = CreateShadowTexture(GL_TEXTURE_2D_ARRAY, SHADOW_CASCADE_SIZE, SHADOW_CASCADE_COUNT, true, "Cascade Shadow Maps");
+    shadows.pointCache = CreateShadowTexture(GL_TEXTURE_CUBE_MAP_ARRAY, SHADOW_POINT_FACE_SIZE, SHADOW_MAX_POINT_LIGHTS * 6, false, "Point Shadow Cache");
+    shadows.pointMaps = CreateShadowTexture(GL_TEXTURE_CUBE_MAP_ARRAY, SHADOW_POINT_FACE_SIZE, SHADOW_MAX_POINT_LIGHTS * 6, true, "Point Shadow Maps");
+
+    // Depth only, a layer of one of the textures is attached for every map rendered
+    glGenFramebuffers(1, &shadows.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, shadows.framebuffer);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    for (u32 c = 0; c < SHADOW_CASCADE_COUNT; ++c)
+    {
+        shadows.cascades[c] = {};
+        shadows.cascades[c].staticDirty = true;
+    }
+    shadows.lightDirection = glm::vec3(0.0f);
+    shadows.directionalLight = ENTITY_ROW_NONE;
+
+    for (u32 p = 0; p < SHADOW_MAX_POINT_LIGHTS; ++p)
+    {
+        shadows.points[p] = {};
+        shadows.points[p].lightIndex = SHADOW_NO_LIGHT;
+    }
+    shadows.nextPointFace = 0;
+
+    // No version of the entity store yet, the first update builds the caster rows
+    shadows.entityVersion = 0xFFFFFFFF;
+    shadows.frameIndex = 0;
+
+    shadows.staticRenders = 0;
+    shadows.composites = 0;
+    shadows.staticCasters = 0;
+    shadows.dynamicCasters = 0;
+    shadows.shadowDrawCalls = 0;
+}
+
+void DestroyShadowMaps(ShadowMaps& shadows)
+{
+    DeleteShadowTexture(shadows.cascadeCache);
+    DeleteShadowTexture(shadows.cascadeMaps);
+    DeleteShadowTexture(shadows.pointCache);
+    DeleteShadowTexture(shadows.pointMaps);
+    glDeleteFramebuffers(1, &shadows.framebuffer);
+}
+
+// ------------------------------------------------------------------------------------------------
+// VOLUMES //
+// ------------------------------------------------------------------------------------------------
+
+// The caster's bounding sphere grows with the largest scale of its model matrix, as in the culling
+static glm::vec4 GetCasterBounds(const Model* model, const glm::mat4& modelMatrix)
+{
+    const glm::vec4& bounds = model->boundingSphere;
+    glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(glm::vec3(bounds), 1.0f));
+    float scale = glm::max(glm::length(glm::vec3(modelMatrix[0])), glm::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+    return glm::vec4(center, bounds.w * scale);
+}
+
+static bool ShadowVolumeOverlaps(const ShadowVolume& volume, const glm::vec4& bounds)
+{
+    if (volume.farPlane > 0.0f)
+        return glm::distance(volume.position, glm::vec3(bounds)) <= volume.farPlane + bounds.w;
+
+    // In the cascade's clip space, the orthographic projection scales the sphere the same in x and y
+    glm::vec3 center = glm::vec3(volume.lightMatrix * glm::vec4(glm::vec3(bounds), 1.0f));
+    float extent = bounds.w / volume.radius;
+    float depthExtent = bounds.w / (volume.radius + SHADOW_CASCADE_DEPTH_EXTENT);
+    return glm::abs(center.x) <= 1.0f + extent && glm::abs(center.y) <= 1.0f + extent && glm::abs(center.z) <= 1.0f + depthExtent;
+}
+
+static ShadowVolume GetCascadeVolume(const ShadowCascade& cascade)
+{
+    ShadowVolume volume = {};
+    volume.lightMatrix = cascade.lightMatrix;
+    volume.radius = cascade.radius;
+    return volume;
+}
+
+static ShadowVolume GetPointVolume(const glm::vec3& position, float farPlane)
+{
+    ShadowVolume volume = {};
+    volume.position = position;
+    volume.farPlane = farPlane;
+    return volume;
+}
+
+static glm::vec3 GetCascadeUp(const glm::vec3& direction)
+{
+    return glm::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+}
+
+// Orthographic, looking along the light from SHADOW_CASCADE_DEPTH_EXTENT behind the sphere of the cascade
+static glm::mat4 GetCascadeMatrix(const glm::vec3& center, float radius, const glm::vec3& direction)
+{
+    float depth = radius + SHADOW_CASCADE_DEPTH_EXTENT;
+    glm::mat4 view = glm::lookAt(center - direction * depth, center, GetCascadeUp(direction));
+    glm::mat4 projection = glm::ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * depth);
+    return projection * view;
+}
+
+// Bounding sphere of the part of the view frustum between two distances from the camera
+static glm::vec4 GetFrustumSliceBounds(const glm::mat4& inverseView, float tanHalfX, float tanHalfY, float nearDistance, float farDistance)
+{
+    glm::vec3 corners[8];
+    glm::vec3 center = glm::vec3(0.0f);
+    for (u32 i = 0; i < 8; ++i)
+    {
+        float distance = (i & 4) ? farDistance : nearDistance;
+        float x = ((i & 1) ? 1.0f : -1.0f) * tanHalfX * distance;
+        float y = ((i & 2) ? 1.0f : -1.0f) * tanHalfY * distance;
+        corners[i] = glm::vec3(inverseView * glm::vec4(x, y, -distance, 1.0f));
+        center += corners[i];
+    }
+    center /= 8.0f;
+
+    float radius = 0.0f;
+    for (u32 i = 0; i < 8; ++i)
+        radius = glm::max(radius, glm::distance(center, corners[i]));
+
+    return glm::vec4(center, radius);
+}
+
+// Where the attenuation of the lighting pass takes the light under 1/256 of its color
+static float GetPointShadowRange(const Light& light)
+{
+    float intensity = glm::max(light.color.r, glm::max(light.color.g, light.color.b));
+    float c = light.constant - 256.0f * intensity;
+    float range = (-0.09f + glm::sqrt(glm::max(0.09f * 0.09f - 4.0f * 0.032f * c, 0.0f))) / (2.0f * 0.032f);
+    return glm::max(range, 1.0f);
+}
+
+// ------------------------------------------------------------------------------------------------
+// UPDATE //
+// ------------------------------------------------------------------------------------------------
+
+static void InvalidatePointShadow(PointShadow& point)
+{
+    // Never rendered, its first re-render takes every caster anyway
+    if (point.dirtyFaces == 0 && point.farPlane == 0.0f)
+        return;
+
+    // A re-render already in progress starts over from where it was going to be rendered
+    if (point.dirtyFaces == 0)
+    {
+        point.pendingPosition = point.position;
+        point.pendingFarPlane = point.farPlane;
+    }
+    point.dirtyFaces = SHADOW_ALL_FACES;
+}
+
+// The caches a caster at these bounds was, or is about to be, baked into
+static void InvalidateShadowCaches(ShadowMaps& shadows, const glm::vec4& bounds)
+{
+    for (u32 c = 0; c < SHADOW_CASCADE_COUNT; ++c)
+    {
+        ShadowCascade& cascade = shadows.cascades[c];
+        if (cascade.radius > 0.0f && ShadowVolumeOverlaps(GetCascadeVolume(cascade), bounds))
+            cascade.staticDirty = true;
+    }
+
+    for (u32 p = 0; p < SHADOW_MAX_POINT_LIGHTS; ++p)
+    {
+        PointShadow& point = shadows.points[p];
+        bool isPending = point.dirtyFaces != 0;
+        ShadowVolume volume = isPending ? GetPointVolume(point.pendingPosition, point.pendingFarPlane) : GetPointVolume(point.position, point.farPlane);
+
+        if (point.lightIndex != SHADOW_NO_LIGHT && volume.farPlane > 0.0f && ShadowVolumeOverlaps(volume, bounds))
+            InvalidatePointShadow(point);
+    }
+}
+
+// New, removed or moved rows: every cache is rendered again and the point lights take the cubes in order
+static void ResetShadowCasters(App* app, ShadowMaps& shadows)
+{
+    const FrameSnapshot& frame = GetRenderFrame(app);
+    const EntityArchetypeStorage& meshes = GetArchetype(app->entities, ENTITY_ARCHETYPE_MESH);
+
+    // Arrays only allocate when the entity count grows
+    shadows.casterMatrices = frame.modelMatrices[ENTITY_ARCHETYPE_MESH];
+    shadows.casterBounds.resize(meshes.count);
+    shadows.casterStillFrames.assign(meshes.count, SHADOW_SETTLE_FRAMES);
+    shadows.casterResident.resize(meshes.count);
+    for (u32 i = 0; i < meshes.count; ++i)
+        shadows.casterResident[i] = meshes.models[i]->isResident;
+
+    for (u32 c = 0; c < SHADOW_CASCADE_COUNT; ++c)
+        shadows.cascades[c].staticDirty = true;
+
+    u32 slot = 0;
+    for (u32 i = 0; i < frame.lights.size() && slot < SHADOW_MAX_POINT_LIGHTS; ++i)
+    {
+        if (frame.lights[i].lightVector.w != 1.0f)
+            continue;
+
+        // A cube handed to another light can't be sampled until it's rendered for it
+        PointShadow& point = shadows.points[slot++];
+        if (point.lightIndex != i)
+        {
+            point = {};
+            point.lightIndex = i;
+        }
+        InvalidatePointShadow(point);
+    }
+    for (; slot < SHADOW_MAX_POINT_LIGHTS; ++slot)
+    {
+        shadows.points[slot] = {};
+        shadows.points[slot].lightIndex = SHADOW_NO_LIGHT;
+    }
+
+    shadows.entityVersion = frame.entityVersion;
+}
+
+// A caster is baked into the caches while it's still. Starting or stopping to move, or being streamed in or out,
+// invalidates the caches around it.
+static void UpdateShadowCasters(App* app, ShadowMaps& shadows)
+{
+    PROFILE_FUNCTION();
+
+    const FrameSnapshot& frame = GetRenderFrame(app);
+    const EntityArchetypeStorage& meshes = GetArchetype(app->entities, ENTITY_ARCHETYPE_MESH);
+    const glm::mat4* modelMatrices = frame.modelMatrices[ENTITY_ARCHETYPE_MESH].data();
+
+    if (shadows.entityVersion != frame.entityVersion)
+        ResetShadowCasters(app, shadows);
+
+    for (u32 i = 0; i < meshes.count; ++i)
+    {
+        const Model* model = meshes.models[i];
+        bool wasStatic = shadows.casterStillFrames[i] >= SHADOW_SETTLE_FRAMES;
+
+        if (memcmp(&modelMatrices[i], &shadows.casterMatrices[i], sizeof(glm::mat4)) != 0)
+        {
+            // Where it was baked
+            if (wasStatic && shadows.casterResident[i])
+                InvalidateShadowCaches(shadows, GetCasterBounds(model, shadows.casterMatrices[i]));
+
+            shadows.casterMatrices[i] = modelMatrices[i];
+            shadows.casterStillFrames[i] = 0;
+        }
+        else if (!wasStatic && ++shadows.casterStillFrames[i] == SHADOW_SETTLE_FRAMES && model->isResident)
+            InvalidateShadowCaches(shadows, GetCasterBounds(model, modelMatrices[i]));
+
+        shadows.casterBounds[i] = GetCasterBounds(model, modelMatrices[i]);
+
+        bool isStatic = shadows.casterStillFrames[i] >= SHADOW_SETTLE_FRAMES;
+        if (model->isResident != bool(shadows.casterResident[i]))
+        {
+            if (isStatic)
+                InvalidateShadowCaches(shadows, shadows.casterBounds[i]);
+            shadows.casterResident[i] = model->isResident;
+        }
+
+        if (model->isResident)
+        {
+            shadows.staticCasters += isStatic;
+            shadows.dynamicCasters += !isStatic;
+        }
+    }
+}
+
+static bool HasDynamicCasters(const ShadowMaps& shadows, const ShadowVolume& volume)
+{
+    for (u32 i = 0; i < shadows.casterBounds.size(); ++i)
+    {
+        bool isDynamic = shadows.casterStillFrames[i] < SHADOW_SETTLE_FRAMES;
+        if (isDynamic && shadows.casterResident[i] && ShadowVolumeOverlaps(volume, shadows.casterBounds[i]))
+            return true;
+    }
+    return false;
+}
+
+static void PlanCascades(App* app, ShadowMaps& shadows, u32& budget)
+{
+    const FrameSnapshot& frame = GetRenderFrame(app);
+
+    shadows.directionalLight = frame.directionalLight;
+    if (shadows.directionalLight == ENTITY_ROW_NONE)
+    {
+        for (u32 c = 0; c < SHADOW_CASCADE_COUNT; ++c)
+            shadows.cascades[c].renderStatic = shadows.cascades[c].composite = false;
+        return;
+    }
+
+    // Turning the light moves every cascade
+    glm::vec3 direction = glm::normalize(glm::vec3(frame.lights[shadows.directionalLight].lightVector));
+    if (direction != shadows.lightDirection)
+    {
+        for (u32 c = 0; c < SHADOW_CASCADE_COUNT; ++c)
+            shadows.cascades[c].staticDirty = true;
+        shadows.lightDirection = direction;
+    }
+
+    const Camera& camera = frame.camera;
+    const glm::mat4& projection = camera.GetProjectionMatrix(app->displaySize);
+    glm::mat4 inverseView = glm::inverse(camera.GetViewMatrix(app->displaySize));
+    float tanHalfX = 1.0f / projection[0][0];
+    float tanHalfY = 1.0f / projection[1][1];
+
+    float nearPlane = camera.GetNearPlane();
+    float farPlane = glm::min(camera.GetFarPlane(), SHADOW_CASCADE_DISTANCE);
+    float splitNear = nearPlane;
+
+    for (u32 c = 0; c < SHADOW_CASCADE_COUNT; ++c)
+    {
+        ShadowCascade& cascade = shadows.cascades[c];
+
+        float t = float(c + 1) / float(SHADOW_CASCADE_COUNT);
+        float logSplit = nearPlane * glm::pow(farPlane / nearPlane, t);
+        float uniformSplit = nearPlane + (farPlane - nearPlane) * t;
+        float splitFar = glm::mix(uniformSplit, logSplit, SHADOW_CASCADE_SPLIT_LAMBDA);
+
+        glm::vec4 slice = GetFrustumSliceBounds(inverseView, tanHalfX, tanHalfY, splitNear, splitFar);
+        splitNear = splitFar;
+
+        bool contains = cascade.radius > 0.0f && glm::distance(glm::vec3(slice), cascade.center) + slice.w <= cascade.radius;
+        if (!contains || !shadows.cacheStatic)
+            cascade.staticDirty = true;
+
+        // Nearest cascades take the budget first, a far one waits with the placement it has
+        cascade.renderStatic = cascade.staticDirty && (budget > 0 || !shadows.cacheStatic);
+        if (cascade.renderStatic)
+        {
+            if (!contains)
+            {
+                // Snapped to whole texels across the light, so placing it again doesn't make the edges crawl
+                cascade.radius = slice.w * SHADOW_CASCADE_MARGIN;
+                float texelSize = 2.0f * cascade.radius / SHADOW_CASCADE_SIZE;
+                glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.0f), direction, GetCascadeUp(direction));
+                glm::vec3 center = glm::vec3(lightRotation * glm::vec4(glm::vec3(slice), 1.0f));
+                center.x = glm::floor(center.x / texelSize) * texelSize;
+                center.y = glm::floor(center.y / texelSize) * texelSize;
+                cascade.center = glm::vec3(glm::inverse(lightRotation) * glm::vec4(center, 1.0f));
+            }
+            cascade.lightMatrix = GetCascadeMatrix(cascade.center, cascade.radius, direction);
+            cascade.staticDirty = false;
+            if (budget > 0)
+                budget--;
+        }
+
+        // Dynamic casters go into the nearest cascade every frame, and half as often into each one further away
+        bool isDynamicTurn = (shadows.frameIndex + c) % (1u << c) == 0;
+        cascade.composite = cascade.renderStatic ||
+            (cascade.radius > 0.0f && isDynamicTurn && (cascade.hasDynamic || HasDynamicCasters(shadows, GetCascadeVolume(cascade))));
+    }
+}
+
+static void PlanPointShadows(App* app, ShadowMaps& shadows, u32& budget)
+{
+    const FrameSnapshot& frame = GetRenderFrame(app);
+
+    for (u32 p = 0; p < SHADOW_MAX_POINT_LIGHTS; ++p)
+    {
+        PointShadow& point = shadows.points[p];
+        point.renderFaces = 0;
+        point.composite = false;
+        if (point.lightIndex == SHADOW_NO_LIGHT)
+            continue;
+
+        // A re-render in progress finishes where it started, the light is checked again once it's swapped in
+        const Light& light = frame.lights[point.lightIndex];
+        glm::vec3 position = glm::vec3(light.lightVector);
+        bool hasMoved = point.farPlane == 0.0f || glm::distance(position, point.position) > SHADOW_POINT_MOVE_THRESHOLD;
+        if (point.dirtyFaces == 0 && (hasMoved || !shadows.cacheStatic))
+        {
+            point.pendingPosition = position;
+            point.pendingFarPlane = GetPointShadowRange(light);
+            point.dirtyFaces = SHADOW_ALL_FACES;
+        }
+    }
+
+    // Faces of all the cubes in turn, starting after the last one rendered
+    const u32 faceCount = SHADOW_MAX_POINT_LIGHTS * 6;
+    for (u32 n = 0; n < faceCount && (budget > 0 || !shadows.cacheStatic); ++n)
+    {
+        u32 face = (shadows.nextPointFace + n) % faceCount;
+        PointShadow& point = shadows.points[face / 6];
+        u8 faceBit = u8(1 << (face % 6));
+        if (!(point.dirtyFaces & faceBit))
+            continue;
+
+        point.renderFaces |= faceBit;
+        point.dirtyFaces &= ~faceBit;
+        shadows.nextPointFace = (face + 1) % faceCount;
+        if (budget > 0)
+            budget--;
+    }
+
+    for (u32 p = 0; p < SHADOW_MAX_POINT_LIGHTS; ++p)
+    {
+        PointShadow& point = shadows.points[p];
+        if (point.lightIndex == SHADOW_NO_LIGHT || point.dirtyFaces != 0)
+            continue; // The cache is halfway through a re-render, the sampled cube stays as it is
+
+        // Its last faces are rendered this frame
+        if (point.renderFaces)
+        {
+            point.position = point.pendingPosition;
+            point.farPlane = point.pendingFarPlane;
+            point.composite = true;
+            continue;
+        }
+
+        bool isDynamicTurn = (shadows.frameIndex + p) % SHADOW_POINT_DYNAMIC_INTERVAL == 0;
+        point.composite = point.farPlane > 0.0f && isDynamicTurn &&
+            (point.hasDynamic || HasDynamicCasters(shadows, GetPointVolume(point.position, point.farPlane)));
+    }
+}
+
+void UpdateShadowMaps(App* app, ShadowMaps& shadows)
+{
+    PROFILE_FUNCTION();
+
+    shadows.frameIndex++;
+    shadows.staticRenders = 0;
+    shadows.composites = 0;
+    shadows.staticCasters = 0;
+    shadows.dynamicCasters = 0;
+    shadows.shadowDrawCalls = 0;
+
+    UpdateShadowCasters(app, shadows);
+
+    u32 budget = SHADOW_STATIC_RENDER_BUDGET;
+    PlanCascades(app, shadows, budget);
+    PlanPointShadows(app, shadows, budget);
+}
+
+void DiscardShadowMapPlan(ShadowMaps& shadows)
+{
+    for (u32 c = 0; c < SHADOW_CASCADE_COUNT; ++c)
+    {
+        ShadowCascade& cascade = shadows.cascades[c];
+        cascade.radius = 0.0f;
+        cascade.staticDirty = true;
+        cascade.hasDynamic = false;
+        cascade.renderStatic = cascade.composite = false;
+    }
+
+    // The next plan starts a re-render of every cube, they're sampled again once all their faces are done
+    for (u32 p = 0; p < SHADOW_MAX_POINT_LIGHTS; ++p)
+    {
+        PointShadow& point = shadows.points[p];
+        point.farPlane = 0.0f;
+        point.dirtyFaces = 0;
+        point.hasDynamic = false;
+        point.renderFaces = 0;
+        point.composite = false;
+    }
+}
+
+void WriteShadowParameters(const ShadowMaps& shadows, ShadowParameters& params)
+{
+    static_assert(SHADOW_CASCADE_COUNT <= 4, "The cascade texel sizes are packed in a vec4");
+
+    params.uCascadeTexelSizes = glm::vec4(0.0f);
+    for (u32 c = 0; c < SHADOW_CASCADE_COUNT; ++c)
+    {
+        const ShadowCascade& cascade = shadows.cascades[c];
+        params.uCascadeMatrices[c] = cascade.lightMatrix;
+        if (shadows.directionalLight != ENTITY_ROW_NONE)
+            params.uCascadeTexelSizes[c] = 2.0f * cascade.radius / SHADOW_CASCADE_SIZE;
+    }
+
+    for (u32 i = 0; i < MAX_LIGHTS; ++i)
+        params.uPointShadowSlots[i] = glm::ivec4(-1);
+
+    for (u32 p = 0; p < SHADOW_MAX_POINT_LIGHTS; ++p)
+    {
+        const PointShadow& point = shadows.points[p];
+        params.uPointShadows[p] = glm::vec4(point.position, point.farPlane);
+        if (point.lightIndex != SHADOW_NO_LIGHT && point.farPlane > 0.0f)
+            params.uPointShadowSlots[point.lightIndex].x = p;
+    }
+
+    params.uCascadeLight = shadows.directionalLight != ENTITY_ROW_NONE ? int(shadows.directionalLight) : -1;
+    params.uCascadeBias = shadows.cascadeBias;
+    params.uPointBias = shadows.pointBias;
+}
+
+// ------------------------------------------------------------------------------------------------
+// RENDER //
+// ------------------------------------------------------------------------------------------------
+
+static void BeginShadowRendering(App* app, ShadowMaps& shadows, u32 size)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, shadows.framebuffer);
+    CountRenderStat(RENDER_COUNTER_FRAMEBUFFER_SWITCHES);
+    glViewport(0, 0, size, size);
+
+    // Both faces cast, thin and open meshes included. The lighting offsets the receivers instead.
+    glEnable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_BLEND);
+    glDepthMask(GL_TRUE);
+
+    app->shaderPrograms[shadows.shaderID].Bind();
+}
+
+static void EndShadowRendering(App* app, ShadowMaps& shadows)
+{
+    app->shaderPrograms[shadows.shaderID].Unbind();
+    glBindVertexArray(0);
+    glEnable(GL_CULL_FACE);
+    glEnable(GL_BLEND);
+}
+
+// pointLight is the position and far plane of a point light, zero for a cascade
+static void BindShadowLayer(App* app, ShadowMaps& shadows, u32 texture, u32 layer, const glm::mat4& lightMatrix, const glm::vec4& pointLight)
+{
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, layer);
+
+    Shader& shader = app->shaderPrograms[shadows.shaderID];
+    shader.SetUniformMat4("uLightMatrix", lightMatrix);
+    shader.SetUniform4f("uPointLight", pointLight);
+}
+
+// Draws the static or the dynamic casters inside the volume, returns how many
+static u32 DrawShadowCasters(App* app, ShadowMaps& shadows, const ShadowVolume& volume, bool dynamic)
+{
+    const EntityArchetypeStorage& meshes = GetArchetype(app->entities, ENTITY_ARCHETYPE_MESH);
+
+    u32 casterCount = 0;
+    GeometryBindState bindState = {};
+    for (u32 i = 0; i < meshes.count; ++i)
+    {
+        bool isDynamic = shadows.casterStillFrames[i] < SHADOW_SETTLE_FRAMES;
+        if (isDynamic != dynamic || !shadows.casterResident[i] || !ShadowVolumeOverlaps(volume, shadows.casterBounds[i]))
+            continue;
+
+        glBindBufferRange(GL_UNIFORM_BUFFER, LOCAL_PARAMETERS_BINDING, app->UBO.handle, meshes.localParamOffsets[i], sizeof(LocalParameters));
+
+        Model* model = meshes.models[i];
+        for (u32 meshIndex = 0; meshIndex < model->meshes.size(); ++meshIndex)
+        {
+            Mesh& mesh = model->meshes[meshIndex];
+            BindMeshGeometry(app->geometryArena, mesh, bindState);
+
+            glDrawElementsBaseVertex(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, (void*)(u64)(mesh.firstIndex * sizeof(u32)), mesh.baseVertex);
+
+            CountDrawCall(mesh.indexCount);
+            shadows.shadowDrawCalls++;
+        }
+        casterCount++;
+    }
+    return casterCount;
+}
+
+void RenderCascadeShadows(App* app, ShadowMaps& shadows)
+{
+    BeginShadowRendering(app, shadows, SHADOW_CASCADE_SIZE);
+
+    for (u32 c = 0; c < SHADOW_CASCADE_COUNT; ++c)
+    {
+        ShadowCascade& cascade = shadows.cascades[c];
+        ShadowVolume volume = GetCascadeVolume(cascade);
+
+        if (cascade.renderStatic)
+        {
+            BindShadowLayer(app, shadows, shadows.cascadeCache, c, cascade.lightMatrix, glm::vec4(0.0f));
+            glClear(GL_DEPTH_BUFFER_BIT);
+            DrawShadowCasters(app, shadows, volume, false);
+            shadows.staticRenders++;
+        }
+
+        if (cascade.composite)
+        {
+            glCopyImageSubData(shadows.cascadeCache, GL_TEXTURE_2D_ARRAY, 0, 0, 0, c,
+                               shadows.cascadeMaps, GL_TEXTURE_2D_ARRAY, 0, 0, 0, c,
+                               SHADOW_CASCADE_SIZE, SHADOW_CASCADE_SIZE, 1);
+
+            BindShadowLayer(app, shadows, shadows.cascadeMaps, c, cascade.lightMatrix, glm::vec4(0.0f));
+            cascade.hasDynamic = DrawShadowCasters(app, shadows, volume, true) > 0;
+            shadows.composites++;
+        }
+    }
+
+    EndShadowRendering(app, shadows);
+}
+
+static glm::mat4 GetPointFaceMatrix(const glm::vec3& position, float farPlane, u32 face)
+{
+    glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, SHADOW_POINT_NEAR_PLANE, farPlane);
+    return projection * glm::lookAt(position, position + CubeFaceDirections[face], CubeFaceUps[face]);
+}
+
+void RenderPointShadows(App* app, ShadowMaps& shadows)
+{
+    BeginShadowRendering(app, shadows, SHADOW_POINT_FACE_SIZE);
+
+    for (u32 p = 0; p < SHADOW_MAX_POINT_LIGHTS; ++p)
+    {
+        PointShadow& point = shadows.points[p];
+        if (!point.renderFaces && !point.composite)
+            continue;
+
+        // Layer-faces of the cube map array, 6 per cube
+        u32 firstLayer = p * 6;
+
+        ShadowVolume pendingVolume = GetPointVolume(point.pendingPosition, point.pendingFarPlane);
+        for (u32 face = 0; face < 6; ++face)
+        {
+            if (!(point.renderFaces & (1 << face)))
+                continue;
+
+            glm::mat4 faceMatrix = GetPointFaceMatrix(point.pendingPosition, point.pendingFarPlane, face);
+            BindShadowLayer(app, shadows, shadows.pointCache, firstLayer + face, faceMatrix, glm::vec4(point.pendingPosition, point.pendingFarPlane));
+            glClear(GL_DEPTH_BUFFER_BIT);
+            DrawShadowCasters(app, shadows, pendingVolume, false);
+            shadows.staticRenders++;
+        }
+
+        if (point.composite)
+        {
+            glCopyImageSubData(shadows.pointCache, GL_TEXTURE_CUBE_MAP_ARRAY, 0, 0, 0, firstLayer,
+                               shadows.pointMaps, GL_TEXTURE_CUBE_MAP_ARRAY, 0, 0, 0, firstLayer,
+                               SHADOW_POINT_FACE_SIZE, SHADOW_POINT_FACE_SIZE, 6);
+
+            ShadowVolume volume = GetPointVolume(point.position, point.farPlane);
+            u32 dynamicCount = 0;
+            for (u32 face = 0; face < 6; ++face)
+            {
+                glm::mat4 faceMatrix = GetPointFaceMatrix(point.position, point.farPlane, face);
+                BindShadowLayer(app, shadows, shadows.pointMaps, firstLayer + face, faceMatrix, glm::vec4(point.position, point.farPlane));
+                dynamicCount += DrawShadowCasters(app, shadows, volume, true);
+            }
+            point.hasDynamic = dynamicCount > 0;
+            shadows.composites++;
+        }
+    }
+
+    EndShadowRendering(app, shadows);
+}
+
+// ------------------------------------------------------------------------------------------------
+// IMGUI //
+// ------------------------------------------------------------------------------------------------
+
+void DrawShadowMapsImGui(ShadowMaps& shadows)
+{
+    ImGui::Checkbox("Cache Static Casters", &shadows.cacheStatic);
+    ImGui::DragFloat("Cascade Bias", &shadows.cascadeBias, 0.1f, 0.0f, 8.0f, "%.1f texels");
+    ImGui::DragFloat("Point Bias", &shadows.pointBias, 0.005f, 0.0f, 0.5f, "%.3f");
+
+    ImGui::Text("Casters: %u static, %u dynamic", shadows.staticCasters, shadows.dynamicCasters);
+    ImGui::Text("Last Frame: %u static renders, %u composites, %u draw calls", shadows.staticRenders, shadows.composites, shadows.shadowDrawCalls);
+
+    for (u32 c = 0; c < SHADOW_CASCADE_COUNT; ++c)
+    {
+        const ShadowCascade& cascade = shadows.cascades[c];
+        ImGui::Text("Cascade %u: radius %.1f%s", c, cascade.radius, cascade.staticDirty ? " (waiting)" : "");
+    }
+
+    u32 readyCount = 0;
+    u32 pendingCount = 0;
+    for (u32 p = 0; p < SHADOW_MAX_POINT_LIGHTS; ++p)
+    {
+        const PointShadow& point = shadows.points[p];
+        if (point.lightIndex == SHADOW_NO_LIGHT)
+            continue;
+        readyCount += point.farPlane > 0.0f;
+        pendingCount += point.dirtyFaces != 0;
+    }
+    ImGui::Text("Point Light Cubes: %u ready, %u being rendered", readyCount, pendingCount);
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "platform.h"
+#include "ShaderParameters.h"
+
+struct App;
+
+// Every shadow map is kept twice: a cache with the static casters only, re-rendered when it's invalidated, and the map
+// the lighting samples, which is the cache copied over with the dynamic casters drawn on top. A scene where nothing
+// moves renders no shadow geometry at all. Casters are classified on their own: an entity is dynamic while its model
+// matrix keeps changing, and goes back into the caches once it has been still for SHADOW_SETTLE_FRAMES.
+
+#define SHADOW_CASCADE_SIZE 1024
+#define SHADOW_CASCADE_DISTANCE 60.0f     // Camera distance the cascades cover, past it the directional light is unshadowed
+#define SHADOW_CASCADE_SPLIT_LAMBDA 0.75f // Blend between logarithmic (1) and uniform (0) split distances
+#define SHADOW_CASCADE_MARGIN 1.25f       // A cascade is placed this much bigger than its slice, so the camera can move before it's re-rendered
+#define SHADOW_CASCADE_DEPTH_EXTENT 50.0f // Casters this far towards the light from a cascade still cast into it
+
+#define SHADOW_POINT_FACE_SIZE 256
+#define SHADOW_POINT_NEAR_PLANE 0.05f
+#define SHADOW_POINT_MOVE_THRESHOLD 0.05f // Distance a point light moves before its cube is re-rendered
+#define SHADOW_POINT_DYNAMIC_INTERVAL 2   // Frames between the dynamic updates of a cube, staggered across the cubes
+
+#define SHADOW_STATIC_RENDER_BUDGET 8 // Cascades and cube faces re-rendered into the caches per frame, the nearest cascades first
+#define SHADOW_SETTLE_FRAMES 30       // Frames an entity has to be still before it's baked into the caches again
+
+#define SHADOW_NO_LIGHT 0xFFFFFFFF
+
+struct ShadowCascade
+{
+    // Placement of the cached map, the lighting samples with it until the cascade is placed again
+    glm::mat4 lightMatrix;
+    glm::vec3 center;
+    float radius; // 0 until it's rendered the first time
+
+    bool staticDirty; // The cache has to be rendered again, at a new placement if the slice left the current one
+    bool hasDynamic;  // The sampled map has dynamic casters in it, compositing the cache again removes them
+
+    // Plan of the current frame
+    bool renderStatic;
+    bool composite;
+};
+
+struct PointShadow
+{
+    u32 lightIndex; // Row of the light caster archetype, SHADOW_NO_LIGHT if the cube is free
+
+    // Where the sampled cube was rendered from
+    glm::vec3 position;
+    float farPlane; // 0 until all the faces were rendered once
+
+    // A re-render of the cache in progress, the faces are spread across frames and swapped in once all are done
+    glm::vec3 pendingPosition;
+    float pendingFarPlane;
+    u8 dirtyFaces; // Bit per face still to render into the cache
+
+    bool hasDynamic;
+
+    // Plan of the current frame
+    u8 renderFaces;
+    bool composite;
+};
+
+struct ShadowMaps
+{
+    bool cacheStatic = true;    // Disabled re-renders every map from scratch every frame, to compare
+    float cascadeBias = 1.5f;   // Texels the receivers are pushed along their normal
+    float pointBias = 0.05f;    // Same for the point lights, in world units
+
+    // Depth, GL_TEXTURE_2D_ARRAY with a layer per cascade and GL_TEXTURE_CUBE_MAP_ARRAY with a cube per point light
+    u32 cascadeCache;
+    u32 cascadeMaps; // Sampled with comparison
+    u32 pointCache;
+    u32 pointMaps;   // Sampled with comparison, the depth is the distance to the light over the far plane
+    u32 framebuffer;
+    u32 shaderID;
+
+    ShadowCascade cascades[SHADOW_CASCADE_COUNT];
+    glm::vec3 lightDirection; // Of the directional light when the cascades were invalidated last
+    u32 directionalLight;     // Light row the cascades are of this frame, ENTITY_ROW_NONE without a directional light
+
+    PointShadow points[SHADOW_MAX_POINT_LIGHTS];
+    u32 nextPointFace; // Where the static budget starts next frame, so every cube gets its turn
+
+    // Per mesh row, reset when the entity rows change
+    std::vector<glm::mat4> casterMatrices; // Model matrix when the row was last seen
+    std::vector<glm::vec4> casterBounds;   // World bounding sphere
+    std::vector<u32> casterStillFrames;    // Since it last moved, static from SHADOW_SETTLE_FRAMES
+    std::vector<u8> casterResident;
+    u32 entityVersion;                     // Of the rows above
+
+    u32 frameIndex;
+
+    // Last frame, shown in ImGui
+    u32 staticRenders; // Cascades and cube faces
+    u32 composites;    // Maps the cache was copied into
+    u32 staticCasters;
+    u32 dynamicCasters;
+    u32 shadowDrawCalls;
+};
+
+void InitShadowMaps(ShadowMaps& shadows, u32 shaderID);
+void DestroyShadowMaps(ShadowMaps& shadows);
+
+// Classifies the casters, invalidates the caches they touch and decides which maps are rendered this frame.
+// Before the uniform buffer is written, the sampled placements of the maps can change.
+void UpdateShadowMaps(App* app, ShadowMaps& shadows);
+
+// The shadow passes were culled, so the plan of UpdateShadowMaps was never rendered. Every map goes back to never
+// rendered, the lighting doesn't sample it until it's rendered again.
+void DiscardShadowMapPlan(ShadowMaps& shadows);
+
+// Placements of the sampled maps for the lighting pass
+void WriteShadowParameters(const ShadowMaps& shadows, ShadowParameters& params);
+
+// Run the plan of UpdateShadowMaps, called by the render graph passes
+void RenderCascadeShadows(App* app, ShadowMaps& shadows);
+void RenderPointShadows(App* app, ShadowMaps& shadows);
+
+void DrawShadowMapsImGui(ShadowMaps& shadows);
@@ -0,0 +1,157 @@
+#include "SphericalHarmonics.h"
+
+#include "Texture.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#define SH_PROJECTION_ROWS_PER_JOB 32
+#define SH_IRRADIANCE_ROWS_PER_JOB 4
+
+static void EvaluateSH9Basis(const glm::vec3& d, float basis[SH_COEFFICIENT_COUNT])
+{
+    basis[0] = 0.282095f;
+    basis[1] = 0.488603f * d.y;
+    basis[2] = 0.488603f * d.z;
+    basis[3] = 0.488603f * d.x;
+    basis[4] = 1.092548f * d.x * d.y;
+    basis[5] = 1.092548f * d.y * d.z;
+    basis[6] = 0.315392f * (3.0f * d.z * d.z - 1.0f);
+    basis[7] = 1.092548f * d.x * d.z;
+    basis[8] = 0.546274f * (d.x * d.x - d.y * d.y);
+}
+
+// --- Projection
+
+struct SHProjectionJob
+{
+    const Image* image;
+    std::vector<SH9Color> partials; // One per job, added in order so the result doesn't depend on the threads
+};
+
+static void ProjectRowsJob(void* data, u32 begin, u32 end)
+{
+    PROFILE_SCOPE("Project SH Rows");
+
+    SHProjectionJob& job = *(SHProjectionJob*)data;
+    const Image& image = *job.image;
+    const float* pixels = (const float*)image.pixels;
+
+    SH9Color& sh = job.partials[begin / SH_PROJECTION_ROWS_PER_JOB];
+    for (u32 i = 0; i < SH_COEFFICIENT_COUNT; ++i)
+        sh.coefficients[i] = glm::vec3(0.0f);
+
+    // Same mapping as SampleSphericalMap in EquirectToCubemap.glsl
+    float phiStep = 2.0f * PI / image.size.x;
+    float thetaStep = PI / image.size.y;
+    for (u32 y = begin; y < end; ++y)
+    {
+        float latitude = (float(y) + 0.5f) * thetaStep - 0.5f * PI;
+        float solidAngle = phiStep * thetaStep * glm::cos(latitude);
+
+        for (int x = 0; x < image.size.x; ++x)
+        {
+            float phi = (float(x) + 0.5f) * phiStep - PI;
+            glm::vec3 direction = glm::vec3(glm::cos(phi) * glm::cos(latitude), glm::sin(latitude), glm::sin(phi) * glm::cos(latitude));
+
+            // The environment cubemap stores the tone mapped color, the irradiance has to match it
+            const float* pixel = pixels + y * image.stride + x * image.nchannels;
+            glm::vec3 color = glm::min(glm::vec3(pixel[0], pixel[1], pixel[2]), glm::vec3(1000.0f));
+            color = color / (color + glm::vec3(1.0f));
+            color = glm::pow(color, glm::vec3(1.0f / 2.2f));
+
+            float basis[SH_COEFFICIENT_COUNT];
+            EvaluateSH9Basis(direction, basis);
+            for (u32 i = 0; i < SH_COEFFICIENT_COUNT; ++i)
+                sh.coefficients[i] += color * (basis[i] * solidAngle);
+        }
+    }
+}
+
+SH9Color ProjectEquirectangularToSH9(const Image& image)
+{
+    PROFILE_FUNCTION();
+
+    ASSERT(image.isHDR && image.nchannels >= 3, "The SH projection expects an RGB float image");
+
+    SHProjectionJob job;
+    job.image = &image;
+    job.partials.resize((image.size.y + SH_PROJECTION_ROWS_PER_JOB - 1) / SH_PROJECTION_ROWS_PER_JOB);
+
+    ParallelFor(image.size.y, SH_PROJECTION_ROWS_PER_JOB, ProjectRowsJob, &job);
+
+    SH9Color sh = {};
+    for (u32 p = 0; p < job.partials.size(); ++p)
+        for (u32 i = 0; i < SH_COEFFICIENT_COUNT; ++i)
+            sh.coefficients[i] += job.partials[p].coefficients[i];
+
+    return sh;
+}
+
+// --- Irradiance
+
+glm::vec3 EvaluateSH9Irradiance(const SH9Color& sh, const glm::vec3& normal)
+{
+    // Clamped cosine convolution per band, divided by PI
+    static const float bandFactors[SH_COEFFICIENT_COUNT] = { 1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f };
+
+    float basis[SH_COEFFICIENT_COUNT];
+    EvaluateSH9Basis(normal, basis);
+
+    glm::vec3 irradiance = glm::vec3(0.0f);
+    for (u32 i = 0; i < SH_COEFFICIENT_COUNT; ++i)
+        irradiance += sh.coefficients[i] * (basis[i] * bandFactors[i]);
+
+    return glm::max(irradiance, glm::vec3(0.0f));
+}
+
+// Direction through the texel center (s, t) in [-1, 1] of a GL cubemap face
+static glm::vec3 GetCubemapDirection(u32 face, float s, float t)
+{
+    switch (face)
+    {
+    case 0:  return glm::vec3(1.0f, -t, -s);
+    case 1:  return glm::vec3(-1.0f, -t, s);
+    case 2:  return glm::vec3(s, 1.0f, t);
+    case 3:  return glm::vec3(s, -1.0f, -t);
+    case 4:  return glm::vec3(s, -t, 1.0f);
+    default: return glm::vec3(-s, -t, -1.0f);
+    }
+}
+
+struct IrradianceCubemapJob
+{
+    const SH9Color* sh;
+    u32 size;
+    float* pixels;
+};
+
+// The rows of the 6 faces are numbered one after the other
+static void IrradianceRowsJob(void* data, u32 begin, u32 end)
+{
+    IrradianceCubemapJob& job = *(IrradianceCubemapJob*)data;
+
+    for (u32 row = begin; row < end; ++row)
+    {
+        u32 face = row / job.size;
+        u32 y = row % job.size;
+        float t = 2.0f * (float(y) + 0.5f) / job.size - 1.0f;
+
+        float* pixel = job.pixels + row * job.size * 3;
+        for (u32 x = 0; x < job.size; ++x, pixel += 3)
+        {
+            float s = 2.0f * (float(x) + 0.5f) / job.size - 1.0f;
+            glm::vec3 irradiance = EvaluateSH9Irradiance(*job.sh, glm::normalize(GetCubemapDirection(face, s, t)));
+            pixel[0] = irradiance.r;
+            pixel[1] = irradiance.g;
+            pixel[2] = irradiance.b;
+        }
+    }
+}
+
+void ComputeIrradianceCubemap(const SH9Color& sh, u32 size, float* pixels)
+{
+    PROFILE_FUNCTION();
+
+    IrradianceCubemapJob job = { &sh, size, pixels };
+    ParallelFor(6 * size, SH_IRRADIANCE_ROWS_PER_JOB, IrradianceRowsJob, &job);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "platform.h"
+
+struct Image;
+
+#define SH_COEFFICIENT_COUNT 9 // Bands 0 to 2, enough for the irradiance of a distant environment
+
+// Radiance of an environment projected onto the SH basis, one RGB coefficient per basis function
+struct SH9Color
+{
+    glm::vec3 coefficients[SH_COEFFICIENT_COUNT];
+};
+
+// Projects an equirectangular HDR image, loaded flipped, onto the SH basis. The rows are split across the job system.
+SH9Color ProjectEquirectangularToSH9(const Image& image);
+
+// Diffuse lighting of a white surface facing normal, the irradiance divided by PI (Ramamoorthi and Hanrahan, 2001)
+glm::vec3 EvaluateSH9Irradiance(const SH9Color& sh, const glm::vec3& normal);
+
+// Fills the 6 faces, in GL order, of a size x size RGB float cubemap with the irradiance. The rows are split across the job system.
+void ComputeIrradianceCubemap(const SH9Color& sh, u32 size, float* pixels);
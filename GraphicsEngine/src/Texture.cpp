@@ -1,6 +1,10 @@
 #include "Texture.h"
 
 #include "Shader.h"
+#include "Profiler.h"
+#include "GPUMemory.h"
+#include "JobSystem.h"
+#include "SphericalHarmonics.h"
 
 #include "glad/glad.h"
 #include "stb/stb_image.h"
@@ -9,7 +13,7 @@
 Image LoadImage(const char* filename, bool isFlipped)
 {
     Image img = {};
-    stbi_set_flip_vertically_on_load(isFlipped);
+    stbi_set_flip_vertically_on_load_thread(isFlipped); // Images can also be loaded from the hot reload thread
 
     if (stbi_is_hdr(filename))
     {
@@ -35,6 +39,33 @@ void FreeImage(Image image)
     stbi_image_free(image.pixels);
 }
 
+struct DecodeImagesJob
+{
+    const std::vector<std::string>* filepaths;
+    bool isFlipped;
+    Image* images;
+};
+
+static void DecodeImagesRange(void* data, u32 begin, u32 end)
+{
+    PROFILE_SCOPE("Decode Image");
+
+    DecodeImagesJob& job = *(DecodeImagesJob*)data;
+    for (u32 i = begin; i < end; ++i)
+        job.images[i] = LoadImage((*job.filepaths)[i].c_str(), job.isFlipped);
+}
+
+void DecodeImages(const std::vector<std::string>& filepaths, bool isFlipped, std::vector<Image>& images)
+{
+    PROFILE_FUNCTION();
+
+    images.resize(filepaths.size());
+
+    // One image per job, their sizes are too different to batch them
+    DecodeImagesJob job = { &filepaths, isFlipped, images.data() };
+    ParallelFor(filepaths.size(), 1, DecodeImagesRange, &job);
+}
+
 u32 CreateTexture2DFromImage(Image image)
 {
     GLenum internalFormat = GL_RGB8;
@@ -75,11 +106,18 @@ u32 CreateTexture2DFromImage(Image image)
 
     glBindTexture(GL_TEXTURE_2D, 0);
 
+    if (image.isHDR)
+        TrackGPUAllocation(GPUResourceKind::TEXTURE, texHandle, GetTextureMemorySize(GL_RGB16F, image.size.x, image.size.y), GPU_MEMORY_TEXTURES, "HDR Texture");
+    else
+        TrackGPUAllocation(GPUResourceKind::TEXTURE, texHandle, GetTextureMemorySize(internalFormat, image.size.x, image.size.y, 1, true), GPU_MEMORY_TEXTURES, "Texture");
+
     return texHandle;
 }
 
 u32 LoadTexture2D(std::vector<Texture>& textures, const char* filepath, bool isFlipped)
 {
+    PROFILE_FUNCTION();
+
     for (u32 texIdx = 0; texIdx < textures.size(); ++texIdx)
         if (textures[texIdx].filepath == filepath)
             return texIdx;
@@ -88,13 +126,7 @@ u32 LoadTexture2D(std::vector<Texture>& textures, const char* filepath, bool isF
 
     if (image.pixels)
     {
-        Texture tex = {};
-        tex.handle = CreateTexture2DFromImage(image);
-        tex.filepath = filepath;
-
-        u32 texIdx = textures.size();
-        textures.push_back(tex);
-
+        u32 texIdx = AddTexture2D(textures, filepath, isFlipped, image);
         FreeImage(image);
         return texIdx;
     }
@@ -102,9 +134,38 @@ u32 LoadTexture2D(std::vector<Texture>& textures, const char* filepath, bool isF
         return UINT32_MAX;
 }
 
+u32 AddTexture2D(std::vector<Texture>& textures, const char* filepath, bool isFlipped, Image image)
+{
+    Texture tex = {};
+    tex.handle = CreateTexture2DFromImage(image);
+    tex.filepath = filepath;
+    tex.isFlipped = isFlipped;
+
+    textures.push_back(tex);
+    return textures.size() - 1;
+}
+
+u32 CreateTexture2DFromFile(const char* filepath, bool isFlipped)
+{
+    Image image = LoadImage(filepath, isFlipped);
+    if (!image.pixels)
+        return 0;
+
+    u32 texHandle = CreateTexture2DFromImage(image);
+    FreeImage(image);
+    return texHandle;
+}
+
 // Load equirectangular image and create a cubemap
-glm::uvec2 LoadCubemap(std::vector<Texture>& textures, const char* filepath, Shader& equirectToCubemapShader, Shader& irradianceConvShader, u32 skyboxCubeVAO)
+glm::uvec2 LoadCubemap(std::vector<Texture>& textures, const char* filepath, Shader& equirectToCubemapShader, u32 skyboxCubeVAO)
 {
+    PROFILE_FUNCTION();
+
+    // The pixels are kept for the spherical harmonics of the irradiance
+    Image hdrImage = LoadImage(filepath, true);
+    if (!hdrImage.pixels)
+        return glm::uvec2(0);
+
     // Matrices needed to generate cubemap faces
     glm::mat4 captureProj = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
     glm::mat4 captureViews[] =
@@ -128,7 +189,7 @@ glm::uvec2 LoadCubemap(std::vector<Texture>& textures, const char* filepath, Sha
     glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 512, 512);
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, cubemapRBO);
 
-    Texture& hdrTexture = textures[LoadTexture2D(textures, filepath, true)];
+    Texture& hdrTexture = textures[AddTexture2D(textures, filepath, true, hdrImage)];
 
     u32 environmentMapHandle;
     glGenTextures(1, &environmentMapHandle);
@@ -165,13 +226,24 @@ glm::uvec2 LoadCubemap(std::vector<Texture>& textures, const char* filepath, Sha
     equirectToCubemapShader.Unbind();
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+    // The capture targets are only needed while the faces are rendered
+    glDeleteRenderbuffers(1, &cubemapRBO);
+    glDeleteFramebuffers(1, &cubemapFBO);
+
     // IRRADIANCE CUBEMAP TEXTURE //
+    // Low frequency enough for 9 SH coefficients, projected and evaluated across the job system
+    SH9Color environmentSH = ProjectEquirectangularToSH9(hdrImage);
+    FreeImage(hdrImage);
+
+    std::vector<float> irradiancePixels(6 * 32 * 32 * 3);
+    ComputeIrradianceCubemap(environmentSH, 32, irradiancePixels.data());
+
     u32 irradianceMapHandle;
     glGenTextures(1, &irradianceMapHandle);
     glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMapHandle);
     for (u32 i = 0; i < 6; i++)
     {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 32, 32, 0, GL_RGB, GL_FLOAT, nullptr);
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 32, 32, 0, GL_RGB, GL_FLOAT, &irradiancePixels[i * 32 * 32 * 3]);
     }
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -179,31 +251,8 @@ glm::uvec2 LoadCubemap(std::vector<Texture>& textures, const char* filepath, Sha
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, cubemapFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, cubemapRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 32, 32);
-
-    irradianceConvShader.Bind();
-    irradianceConvShader.SetUniform1i("uEnvironmentMap", 0);
-    irradianceConvShader.SetUniformMat4("uProjection", captureProj);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, environmentMapHandle);
-
-    // Configure viewport to the dimensions of each face we want to capture
-    glViewport(0, 0, 32, 32);
-    glBindFramebuffer(GL_FRAMEBUFFER, cubemapFBO);
-    for (u32 i = 0; i < 6; ++i)
-    {
-        irradianceConvShader.SetUniformMat4("uView", captureViews[i]);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, irradianceMapHandle, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        glBindVertexArray(skyboxCubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-    }
-    irradianceConvShader.Unbind();
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    TrackGPUAllocation(GPUResourceKind::TEXTURE, environmentMapHandle, GetTextureMemorySize(GL_RGB16F, 512, 512, 6), GPU_MEMORY_CUBEMAPS, "Environment Map");
+    TrackGPUAllocation(GPUResourceKind::TEXTURE, irradianceMapHandle, GetTextureMemorySize(GL_RGB16F, 32, 32, 6), GPU_MEMORY_CUBEMAPS, "Irradiance Map");
 
     return glm::uvec2(environmentMapHandle, irradianceMapHandle);
 }
@@ -211,16 +260,20 @@ glm::uvec2 LoadCubemap(std::vector<Texture>& textures, const char* filepath, Sha
 // Load 6 images and create its respective cubemap
 u32 LoadCubemap(std::vector<std::string>& faces)
 {
+    PROFILE_FUNCTION();
+
     u32 cubemapTexHandle;
     glGenTextures(1, &cubemapTexHandle);
     glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexHandle);
 
+    u64 cubemapSize = 0;
     for (unsigned int i = 0; i < faces.size(); i++)
     {
         Image image = LoadImage(faces[i].c_str(), false);
         if (image.pixels)
         {
             glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, image.size.x, image.size.y, 0, GL_RGB, GL_UNSIGNED_BYTE, image.pixels);
+            cubemapSize += GetTextureMemorySize(GL_RGB, image.size.x, image.size.y);
             FreeImage(image);
         }
         else
@@ -236,5 +289,7 @@ u32 LoadCubemap(std::vector<std::string>& faces)
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
+    TrackGPUAllocation(GPUResourceKind::TEXTURE, cubemapTexHandle, cubemapSize, GPU_MEMORY_CUBEMAPS, "Skybox Cubemap");
+
     return cubemapTexHandle;
 }
@@ -17,9 +17,23 @@ struct Texture
 {
     u32 handle;
     std::string filepath;
+    bool isFlipped;
 };
 
+Image LoadImage(const char* filename, bool isFlipped);
+void FreeImage(Image image);
+
+// Decodes the images across the job system. The ones that couldn't be loaded have no pixels.
+void DecodeImages(const std::vector<std::string>& filepaths, bool isFlipped, std::vector<Image>& images);
+
 u32 LoadTexture2D(std::vector<Texture>& textures, const char* filepath, bool isFlipped = true);
 
-glm::uvec2 LoadCubemap(std::vector<Texture>& textures, const char* filepath, Shader& equirectToCubemapShader, Shader& irradianceConvShader, u32 skyboxCubeVAO);
+// Registers an image already decoded, LoadTexture2D finds it by its filepath from then on
+u32 AddTexture2D(std::vector<Texture>& textures, const char* filepath, bool isFlipped, Image image);
+
+// Creates a texture without registering it, returns 0 if the image could not be loaded
+u32 CreateTexture2DFromFile(const char* filepath, bool isFlipped);
+
+// The irradiance map is computed on the CPU from the spherical harmonics of the environment
+glm::uvec2 LoadCubemap(std::vector<Texture>& textures, const char* filepath, Shader& equirectToCubemapShader, u32 skyboxCubeVAO);
 u32 LoadCubemap(std::vector<std::string>& faces);
\ No newline at end of file
@@ -0,0 +1,383 @@
+#include "WorldStreaming.h"
+
+#include "engine.h"
+#include "AssimpLoading.h"
+#include "Profiler.h"
+#include "AllocationTracker.h"
+
+#include "imgui-docking/imgui.h"
+
+#include <unordered_map>
+#include <algorithm>
+
+static u64 GetMeshGeometrySize(const Mesh& mesh)
+{
+    return mesh.vertices.size() * sizeof(float) + mesh.indices.size() * sizeof(u32);
+}
+
+static u64 GetModelGeometrySize(const Model& model)
+{
+    u64 size = 0;
+    for (u32 i = 0; i < model.meshes.size(); ++i)
+        size += GetMeshGeometrySize(model.meshes[i]);
+    return size;
+}
+
+// ------------------------------------------------------------------------------------------------
+// LOADER THREADS //
+// ------------------------------------------------------------------------------------------------
+
+static void WorldStreamingThread(WorldStreamer* streamer)
+{
+    SetProfilerThreadName("World Streaming");
+    AllocationScope allocationScope(ALLOCATION_SUBSYSTEM_LOADING);
+
+    while (true)
+    {
+        WorldStreamingRequest request;
+        {
+            std::unique_lock<std::mutex> lock(streamer->mutex);
+            while (!streamer->quit && streamer->requests.empty())
+                streamer->wakeUp.wait(lock);
+            if (streamer->quit)
+                return;
+
+            // The camera may have moved since the requests were made, the nearest cell is the one it needs first
+            u32 nearest = 0;
+            for (u32 i = 1; i < streamer->requests.size(); ++i)
+                if (streamer->requests[i].distance < streamer->requests[nearest].distance)
+                    nearest = i;
+
+            request = streamer->requests[nearest];
+            streamer->requests.erase(streamer->requests.begin() + nearest);
+        }
+
+        PROFILE_SCOPE("Import Streamed Model");
+
+        // Only the geometry: the materials and textures of the model stay loaded while it's evicted
+        WorldStreamingResult result = {};
+        result.streamedModel = request.streamedModel;
+        result.importedModel = std::make_unique<Model>();
+        if (!ImportModelGeometry(request.filepath.c_str(), *result.importedModel, request.baseMaterialIndex))
+        {
+            ELOG("World streaming: could not import %s\n", request.filepath.c_str());
+            result.importedModel.reset();
+        }
+
+        std::lock_guard<std::mutex> lock(streamer->mutex);
+        streamer->completed.push_back(std::move(result));
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+// MAIN THREAD //
+// ------------------------------------------------------------------------------------------------
+
+static glm::ivec2 GetWorldCellCoords(const glm::vec3& position)
+{
+    return glm::ivec2((int)glm::floor(position.x / WORLD_CELL_SIZE), (int)glm::floor(position.z / WORLD_CELL_SIZE));
+}
+
+static u64 GetWorldCellKey(const glm::ivec2& coords)
+{
+    return (u64(u32(coords.x)) << 32) | u64(u32(coords.y));
+}
+
+void InitWorldStreaming(App* app)
+{
+    WorldStreamer& streamer = app->worldStreamer;
+
+    std::unordered_map<Model*, u32> streamedModels;
+    for (u32 i = 0; i < app->models.size(); ++i)
+    {
+        Model* model = app->models[i].get();
+        if (model->filepath.empty())
+            continue;
+
+        StreamedModel streamedModel = { model, ModelResidency::RESIDENT, 0, 0 };
+        streamedModels[model] = streamer.models.size();
+        streamer.models.push_back(streamedModel);
+    }
+
+    // A model belongs to the cell the center of its bounds falls in, once per cell however many entities place it there
+    std::unordered_map<u64, u32> cellIndices;
+    for (u32 a = 0; a < ENTITY_ARCHETYPE_COUNT; ++a)
+    {
+        const EntityArchetypeStorage& archetype = app->entities.archetypes[a];
+        if (!(archetype.components & ENTITY_COMPONENT_RENDERABLE))
+            continue;
+
+        for (u32 row = 0; row < archetype.count; ++row)
+        {
+            std::unordered_map<Model*, u32>::iterator streamedModel = streamedModels.find(archetype.models[row]);
+            if (streamedModel == streamedModels.end())
+                continue;
+
+            glm::vec3 center = glm::vec3(archetype.modelMatrices[row] * glm::vec4(glm::vec3(archetype.models[row]->boundingSphere), 1.0f));
+            glm::ivec2 coords = GetWorldCellCoords(center);
+
+            u64 key = GetWorldCellKey(coords);
+            std::unordered_map<u64, u32>::iterator cellIndex = cellIndices.find(key);
+            if (cellIndex == cellIndices.end())
+            {
+                WorldCell cell = { coords, {}, 0, false };
+                cellIndex = cellIndices.insert(std::make_pair(key, (u32)streamer.cells.size())).first;
+                streamer.cells.push_back(cell);
+            }
+
+            WorldCell& cell = streamer.cells[cellIndex->second];
+            cell.entityCount++;
+            if (std::find(cell.manifest.begin(), cell.manifest.end(), streamedModel->second) == cell.manifest.end())
+                cell.manifest.push_back(streamedModel->second);
+        }
+    }
+
+    streamer.previousCameraPosition = app->camera.position;
+    streamer.cameraVelocity = glm::vec3(0.0f);
+    streamer.frameIndex = 0;
+    streamer.quit = false;
+    streamer.activeCellCount = 0;
+    streamer.residentBytes = 0;
+    streamer.uploadedBytes = 0;
+    streamer.evictionCount = 0;
+
+    ILOG("World streaming: %u models in %u cells\n", (u32)streamer.models.size(), (u32)streamer.cells.size());
+
+    for (u32 i = 0; i < WORLD_STREAMING_THREAD_COUNT; ++i)
+        streamer.workers[i] = std::thread(WorldStreamingThread, &streamer);
+}
+
+static float GetWorldCellDistance(const WorldCell& cell, const glm::vec3& position)
+{
+    glm::vec2 center = (glm::vec2(cell.coords) + 0.5f) * WORLD_CELL_SIZE;
+    return glm::length(center - glm::vec2(position.x, position.z));
+}
+
+static void ActivateWorldCell(WorldStreamer& streamer, WorldCell& cell, float distance)
+{
+    cell.isActive = true;
+    streamer.activeCellCount++;
+
+    for (u32 i = 0; i < cell.manifest.size(); ++i)
+    {
+        StreamedModel& streamedModel = streamer.models[cell.manifest[i]];
+        streamedModel.cellRefs++;
+        if (streamedModel.residency != ModelResidency::EVICTED)
+            continue;
+
+        WorldStreamingRequest request;
+        request.streamedModel = cell.manifest[i];
+        request.filepath = streamedModel.model->filepath;
+        request.baseMaterialIndex = streamedModel.model->baseMaterialIndex;
+        request.distance = distance;
+        streamedModel.residency = ModelResidency::LOADING;
+
+        std::lock_guard<std::mutex> lock(streamer.mutex);
+        streamer.requests.push_back(request);
+        streamer.wakeUp.notify_one();
+    }
+}
+
+static void ReleaseWorldCell(WorldStreamer& streamer, WorldCell& cell)
+{
+    cell.isActive = false;
+    streamer.activeCellCount--;
+
+    // Released models stay resident until the memory cap needs the space
+    for (u32 i = 0; i < cell.manifest.size(); ++i)
+    {
+        StreamedModel& streamedModel = streamer.models[cell.manifest[i]];
+        streamedModel.cellRefs--;
+        if (streamedModel.cellRefs == 0)
+            streamedModel.lastUsedFrame = streamer.frameIndex;
+    }
+}
+
+static void UpdateActiveCells(App* app)
+{
+    WorldStreamer& streamer = app->worldStreamer;
+
+    // Smoothed, a single frame of camera jitter shouldn't prefetch the other side of the world
+    glm::vec3 cameraPosition = app->camera.position;
+    if (app->deltaTime > 0.0f)
+        streamer.cameraVelocity = glm::mix(streamer.cameraVelocity, (cameraPosition - streamer.previousCameraPosition) / app->deltaTime, 0.2f);
+    streamer.previousCameraPosition = cameraPosition;
+    glm::vec3 predictedPosition = cameraPosition + streamer.cameraVelocity * streamer.lookahead;
+
+    for (u32 i = 0; i < streamer.cells.size(); ++i)
+    {
+        WorldCell& cell = streamer.cells[i];
+        float distance = glm::min(GetWorldCellDistance(cell, cameraPosition), GetWorldCellDistance(cell, predictedPosition));
+        if (!streamer.enabled)
+            distance = 0.0f;
+
+        if (!cell.isActive && distance < streamer.loadRadius)
+            ActivateWorldCell(streamer, cell, distance);
+        else if (cell.isActive && distance > streamer.loadRadius + streamer.hysteresis)
+            ReleaseWorldCell(streamer, cell);
+    }
+}
+
+// Moves the imported meshes into the geometry arena a few at a time, a model is only drawn once all of them are in
+static void UploadStreamedModels(App* app)
+{
+    PROFILE_FUNCTION();
+
+    WorldStreamer& streamer = app->worldStreamer;
+    {
+        std::lock_guard<std::mutex> lock(streamer.mutex);
+        for (u32 i = 0; i < streamer.completed.size(); ++i)
+            streamer.uploads.push_back(std::move(streamer.completed[i]));
+        streamer.completed.clear();
+    }
+
+    streamer.uploadedBytes = 0;
+    u32 finishedCount = 0;
+    for (u32 i = 0; i < streamer.uploads.size(); ++i)
+    {
+        WorldStreamingResult& upload = streamer.uploads[i];
+        StreamedModel& streamedModel = streamer.models[upload.streamedModel];
+
+        // A failed import leaves the model evicted, it's requested again the next time one of its cells activates
+        if (!upload.importedModel)
+        {
+            streamedModel.residency = ModelResidency::EVICTED;
+            finishedCount++;
+            continue;
+        }
+
+        streamedModel.residency = ModelResidency::UPLOADING;
+        std::vector<Mesh>& meshes = upload.importedModel->meshes;
+        while (upload.uploadedMeshes < meshes.size())
+        {
+            // At least one mesh per frame, or a mesh bigger than the budget would never go in
+            u64 size = GetMeshGeometrySize(meshes[upload.uploadedMeshes]);
+            if (streamer.uploadedBytes > 0 && streamer.uploadedBytes + size > streamer.uploadBudget)
+                break;
+
+            AllocateMesh(app->geometryArena, meshes[upload.uploadedMeshes++]);
+            streamer.uploadedBytes += size;
+        }
+        if (upload.uploadedMeshes < meshes.size())
+            break;
+
+        // Moving the vector keeps the meshes where they are, the arena points to them for the defragmentation
+        Model& model = *streamedModel.model;
+        for (u32 j = 0; j < model.meshes.size(); ++j)
+            FreeMesh(app->geometryArena, model.meshes[j]);
+        model.meshes = std::move(meshes);
+        model.materialIDs = std::move(upload.importedModel->materialIDs);
+        ComputeModelBounds(model);
+        model.isResident = true;
+
+        streamedModel.residency = ModelResidency::RESIDENT;
+        finishedCount++;
+    }
+    streamer.uploads.erase(streamer.uploads.begin(), streamer.uploads.begin() + finishedCount);
+}
+
+static void EvictStreamedModel(App* app, StreamedModel& streamedModel)
+{
+    Model& model = *streamedModel.model;
+    for (u32 i = 0; i < model.meshes.size(); ++i)
+        FreeMesh(app->geometryArena, model.meshes[i]);
+
+    // The CPU copy of the vertices goes too, the model is imported again from disk
+    std::vector<Mesh>().swap(model.meshes);
+    model.isResident = false;
+
+    streamedModel.residency = ModelResidency::EVICTED;
+    app->worldStreamer.evictionCount++;
+}
+
+static void EvictLeastRecentlyUsed(App* app)
+{
+    PROFILE_FUNCTION();
+
+    WorldStreamer& streamer = app->worldStreamer;
+
+    streamer.residentBytes = 0;
+    for (u32 i = 0; i < streamer.models.size(); ++i)
+        if (streamer.models[i].residency == ModelResidency::RESIDENT)
+            streamer.residentBytes += GetModelGeometrySize(*streamer.models[i].model);
+
+    // Models of active cells are never evicted, the cap can be exceeded if they alone don't fit
+    while (streamer.residentBytes > streamer.memoryCap)
+    {
+        StreamedModel* leastRecentlyUsed = nullptr;
+        for (u32 i = 0; i < streamer.models.size(); ++i)
+        {
+            StreamedModel& streamedModel = streamer.models[i];
+            if (streamedModel.residency != ModelResidency::RESIDENT || streamedModel.cellRefs > 0)
+                continue;
+            if (!leastRecentlyUsed || streamedModel.lastUsedFrame < leastRecentlyUsed->lastUsedFrame)
+                leastRecentlyUsed = &streamedModel;
+        }
+        if (!leastRecentlyUsed)
+            break;
+
+        streamer.residentBytes -= GetModelGeometrySize(*leastRecentlyUsed->model);
+        EvictStreamedModel(app, *leastRecentlyUsed);
+    }
+}
+
+void UpdateWorldStreaming(App* app)
+{
+    PROFILE_FUNCTION();
+
+    UpdateActiveCells(app);
+    UploadStreamedModels(app);
+    EvictLeastRecentlyUsed(app);
+
+    app->worldStreamer.frameIndex++;
+}
+
+void ShutdownWorldStreaming(App* app)
+{
+    WorldStreamer& streamer = app->worldStreamer;
+    {
+        std::lock_guard<std::mutex> lock(streamer.mutex);
+        streamer.quit = true;
+    }
+    streamer.wakeUp.notify_all();
+
+    for (u32 i = 0; i < WORLD_STREAMING_THREAD_COUNT; ++i)
+        if (streamer.workers[i].joinable())
+            streamer.workers[i].join();
+
+    // Half uploaded models already hold space in the arena
+    for (u32 i = 0; i < streamer.uploads.size(); ++i)
+        for (u32 j = 0; j < streamer.uploads[i].uploadedMeshes; ++j)
+            FreeMesh(app->geometryArena, streamer.uploads[i].importedModel->meshes[j]);
+    streamer.uploads.clear();
+}
+
+// ------------------------------------------------------------------------------------------------
+// IMGUI //
+// ------------------------------------------------------------------------------------------------
+
+void DrawWorldStreamingImGui(App* app)
+{
+    WorldStreamer& streamer = app->worldStreamer;
+
+    ImGui::Checkbox("Stream Cells", &streamer.enabled);
+    ImGui::DragFloat("Load Radius", &streamer.loadRadius, 1.0f, WORLD_CELL_SIZE, 1024.0f);
+    ImGui::DragFloat("Hysteresis", &streamer.hysteresis, 1.0f, 0.0f, 256.0f);
+    ImGui::DragFloat("Lookahead (s)", &streamer.lookahead, 0.05f, 0.0f, 5.0f);
+
+    int memoryCap = int(streamer.memoryCap / MB(1));
+    if (ImGui::DragInt("Memory Cap (MB)", &memoryCap, 1.0f, 1, 4096))
+        streamer.memoryCap = u64(memoryCap) * MB(1);
+    int uploadBudget = int(streamer.uploadBudget / KB(1));
+    if (ImGui::DragInt("Upload Budget (KB)", &uploadBudget, 16.0f, 16, 65536))
+        streamer.uploadBudget = u64(uploadBudget) * KB(1);
+
+    u32 residencyCounts[4] = {};
+    for (u32 i = 0; i < streamer.models.size(); ++i)
+        residencyCounts[(u32)streamer.models[i].residency]++;
+
+    ImGui::Text("Cells: %u / %u active", streamer.activeCellCount, (u32)streamer.cells.size());
+    ImGui::Text("Models: %u resident, %u loading, %u uploading, %u evicted", residencyCounts[0], residencyCounts[1], residencyCounts[2], residencyCounts[3]);
+    ImGui::Text("Resident: %.2f / %.2f MB", streamer.residentBytes / float(MB(1)), streamer.memoryCap / float(MB(1)));
+    ImGui::Text("Uploaded: %.1f KB last frame, %u evictions", streamer.uploadedBytes / float(KB(1)), streamer.evictionCount);
+}
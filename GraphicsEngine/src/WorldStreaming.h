@@ -0,0 +1,102 @@
+#pragma once
+
+#include "platform.h"
+
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+struct App;
+struct Model;
+
+#define WORLD_CELL_SIZE 32.0f // Side of the square cells on the XZ plane
+#define WORLD_STREAMING_THREAD_COUNT 2
+
+#define WORLD_STREAMING_DEFAULT_MEMORY_CAP MB(256)
+#define WORLD_STREAMING_DEFAULT_UPLOAD_BUDGET KB(512)
+
+enum class ModelResidency
+{
+    RESIDENT,
+    LOADING,   // Imported by a loader thread
+    UPLOADING, // Imported, its meshes are going into the geometry arena a few at a time
+    EVICTED
+};
+
+// A loaded model whose geometry comes and goes with the cells that place it. Primitives are never streamed.
+struct StreamedModel
+{
+    Model* model;
+    ModelResidency residency;
+    u32 cellRefs;       // Active cells with the model in their manifest
+    u64 lastUsedFrame;  // When the last of them was released, the least recently used models are evicted first
+};
+
+struct WorldCell
+{
+    glm::ivec2 coords;
+    std::vector<u32> manifest; // Streamed models placed in the cell, each once
+    u32 entityCount;
+    bool isActive;
+};
+
+struct WorldStreamingRequest
+{
+    u32 streamedModel;
+    std::string filepath;
+    u32 baseMaterialIndex;
+    float distance; // Of its cell to the camera, the loader threads take the nearest first
+};
+
+struct WorldStreamingResult
+{
+    u32 streamedModel;
+    std::unique_ptr<Model> importedModel;
+    u32 uploadedMeshes;
+};
+
+struct WorldStreamer
+{
+    bool enabled = true;         // Disabled keeps every cell active
+    float loadRadius = 64.0f;    // Cells closer than this to the camera, or to where it's heading, are streamed in
+    float hysteresis = 32.0f;    // Extra distance before an active cell is released, so the border doesn't thrash
+    float lookahead = 1.0f;      // Seconds of camera velocity ahead of the camera that are prefetched
+    u64 memoryCap = WORLD_STREAMING_DEFAULT_MEMORY_CAP;         // Geometry of the streamed models kept resident
+    u64 uploadBudget = WORLD_STREAMING_DEFAULT_UPLOAD_BUDGET;   // Bytes put into the geometry arena per frame
+
+    std::vector<WorldCell> cells;
+    std::vector<StreamedModel> models;
+
+    glm::vec3 previousCameraPosition;
+    glm::vec3 cameraVelocity;
+    u64 frameIndex;
+
+    // Shared with the loader threads
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::vector<WorldStreamingRequest> requests;
+    std::vector<WorldStreamingResult> completed;
+    bool quit;
+    std::thread workers[WORLD_STREAMING_THREAD_COUNT];
+
+    std::vector<WorldStreamingResult> uploads; // Main thread only, in the order they were imported
+
+    // Stats
+    u32 activeCellCount;
+    u64 residentBytes;
+    u64 uploadedBytes; // In the last frame
+    u32 evictionCount; // Since the start
+};
+
+// Splits the entities placing loaded models into cells and starts the loader threads. The world is taken as static,
+// the cells are built once from the model matrices of the scene as it was loaded.
+void InitWorldStreaming(App* app);
+
+// Activates and releases cells around the camera, uploads imported models within the budget and evicts the least
+// recently used ones over the memory cap. Called once per frame from the main thread, while the simulation isn't running.
+void UpdateWorldStreaming(App* app);
+
+void ShutdownWorldStreaming(App* app);
+
+void DrawWorldStreamingImGui(App* app);
@@ -9,12 +9,134 @@
 #include "Shader.h"
 #include "AssimpLoading.h"
 #include "Primitives.h"
+#include "SceneFile.h"
 
 #include "Timer.h"
+#include "RenderStats.h"
+#include "Profiler.h"
+#include "GPUMemory.h"
+#include "JobSystem.h"
+#include "JobBenchmark.h"
+#include "Allocators.h"
+#include "AllocationTracker.h"
 
 #include "glad/glad.h"
 #include "imgui-docking/imgui.h"
 
+#include <thread>
+
+// The scene built by code, used when there is no scene file to load
+static void CreateDefaultScene(App* app)
+{
+    // MATERIALS //
+    Material greyMaterial = {};
+    greyMaterial.name = "Grey Material";
+    greyMaterial.albedo = glm::vec3(0.4f, 0.4f, 0.4f);
+    greyMaterial.reflective = glm::vec3(0.8f);
+
+    Material orangeMaterial = {};
+    orangeMaterial.name = "Orange Material";
+    orangeMaterial.albedo = glm::vec3(1.0f, 0.5f, 0.31f);
+    orangeMaterial.reflective = glm::vec3(0.5f);
+
+    Material blueMaterial = {};
+    blueMaterial.name = "Blue Material";
+    blueMaterial.albedo = glm::vec3(0.0f, 0.0f, 0.6f);
+    blueMaterial.reflective = glm::vec3(0.5f);
+
+    Material blackMaterial = {};
+    blackMaterial.name = "Black Material";
+    blackMaterial.albedo = glm::vec3(0.1f, 0.1f, 0.1f);
+    blackMaterial.reflective = glm::vec3(0.5f);
+
+    Material containerMat = {};
+    containerMat.name = "Container Material";
+    containerMat.albedoTextureID = LoadTexture2D(app->textures, "Assets/container_albedo.png");;
+    containerMat.specularTextureID = LoadTexture2D(app->textures, "Assets/container_specular.png");
+
+    // MODELS //
+
+    Model* planePrimitive = CreatePrimitive(app, PrimitiveType::PLANE, greyMaterial);
+
+    Model* spherePrimitive1 = CreatePrimitive(app, PrimitiveType::SPHERE, orangeMaterial);
+    Model* spherePrimitive2 = CreatePrimitive(app, PrimitiveType::SPHERE, blueMaterial);
+    Model* sphereLowPrimitive = CreatePrimitive(app, PrimitiveType::SPHERE, blackMaterial, 16, 16);
+
+    Model* containerPrimitive = CreatePrimitive(app, PrimitiveType::CUBE, containerMat);
+    Model* cubePrimitive = CreatePrimitive(app, PrimitiveType::CUBE, blackMaterial);
+
+    Model* bunnyModel = LoadModel(app, "Assets/Models/Bunny/bunny.obj");
+    Model* patrickModel = LoadModel(app, "Assets/Models/Patrick/patrick.obj");
+    Model* backpackModel = LoadModel(app, "Assets/Models/Backpack/backpack.obj", false);
+
+    // ENTITIES //
+    // Primitives
+    EntityHandle planeEntity = CreateEntity(app, app->renderer.deferredShadersID[0], glm::vec3(0.0f, -3.4f, 0.0f), planePrimitive);
+    u32 planeNode = GetEntitySceneNode(app->entities, planeEntity);
+    SetSceneNodeRotation(app->sceneGraph, planeNode, glm::angleAxis(glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f)));
+    SetSceneNodeScale(app->sceneGraph, planeNode, glm::vec3(35.0f));
+
+    CreateEntity(app, app->renderer.deferredShadersID[0], glm::vec3(10.0f, 1.0f, -4.0f), spherePrimitive1);
+    CreateEntity(app, app->renderer.deferredShadersID[0], glm::vec3(-10.0f, 1.0f, -4.0f), spherePrimitive2);
+    CreateEntity(app, app->renderer.deferredShadersID[2], glm::vec3(-7.0f, 0.0f, 7.0f), containerPrimitive);
+    CreateEntity(app, app->renderer.deferredShadersID[0], glm::vec3(-11.0f, 0.0f, 7.0f), cubePrimitive);
+
+    // 3D Models
+    EntityHandle bunnyEntity = CreateEntity(app, app->renderer.deferredShadersID[0], glm::vec3(7.0f, -3.5f, 7.0f), bunnyModel);
+    SetSceneNodeScale(app->sceneGraph, GetEntitySceneNode(app->entities, bunnyEntity), glm::vec3(1.5f));
+
+    CreateEntity(app, app->renderer.deferredShadersID[2], glm::vec3(0.0f, 1.0f, 7.0f), backpackModel);
+
+    CreateEntity(app, app->renderer.deferredShadersID[1], glm::vec3(-6.0f, 0.0f, 0.0f), patrickModel);
+    CreateEntity(app, app->renderer.deferredShadersID[1], glm::vec3(0.0f, 0.0f, 0.0f), patrickModel);
+    CreateEntity(app, app->renderer.deferredShadersID[1], glm::vec3(6.0f, 0.0f, 0.0f), patrickModel);
+
+    CreateEntity(app, app->renderer.deferredShadersID[1], glm::vec3(-6.0f, 0.0f, -4.0f), patrickModel);
+    CreateEntity(app, app->renderer.deferredShadersID[1], glm::vec3(0.0f, 0.0f, -4.0f), patrickModel);
+    CreateEntity(app, app->renderer.deferredShadersID[1], glm::vec3(6.0f, 0.0f, -4.0f), patrickModel);
+
+    CreateEntity(app, app->renderer.deferredShadersID[1], glm::vec3(-6.0f, 0.0f, -8.0f), patrickModel);
+    CreateEntity(app, app->renderer.deferredShadersID[1], glm::vec3(0.0f, 0.0f, -8.0f), patrickModel);
+    CreateEntity(app, app->renderer.deferredShadersID[1], glm::vec3(6.0f, 0.0f, -8.0f), patrickModel);
+
+    // LIGHTS //
+    CreateDirectionalLight(app, glm::vec3(0.0f, -2.0f, 15.0f), glm::vec3(-0.2f, -1.0f, -0.3f), glm::vec3(0.0f), cubePrimitive, 0.5f);
+
+    // The point lights hang from a node at the center of the scene
+    u32 pointLightsNode = CreateSceneNode(app->sceneGraph, SCENE_NODE_NONE, glm::vec3(0.0f));
+
+    srand(14);
+    for (unsigned int i = 0; i <= 8; i++)
+    {
+        // Random Position
+        float xPos = static_cast<float>(((rand() % 100) / 70.0f) * 9.0f - 3.0f);
+        float yPos = static_cast<float>(((rand() % 100) / 80.0f) * 6.0f + 6.0f);
+        float zPos = static_cast<float>(((rand() % 100) / 25.0f) * 6.0f - 16.0f);
+
+        // Random Color
+        float rColor = static_cast<float>(((rand() % 100) / 200.0f) + 0.5); // between 0.5 and 1.0
+        float gColor = static_cast<float>(((rand() % 100) / 200.0f) + 0.5); // between 0.5 and 1.0
+        float bColor = static_cast<float>(((rand() % 100) / 200.0f) + 0.5); // between 0.5 and 1.0
+        glm::vec3 color = glm::vec3(rColor, gColor, bColor);
+
+        CreatePointLight(app, glm::vec3(xPos, yPos, zPos), color, sphereLowPrimitive, 1.0f, 0.1f, pointLightsNode);
+    }
+
+    CreatePointLight(app, glm::vec3(-6.0f, 1.0f, 14.0f), glm::vec3(0.9f, 0.0f, 0.0f), sphereLowPrimitive, 0.5f, 0.1f, pointLightsNode);
+    CreatePointLight(app, glm::vec3(6.0f, 1.0f, 14.0f), glm::vec3(0.0f, 0.9f, 0.0f), sphereLowPrimitive, 1.0f, 0.1f, pointLightsNode);
+}
+
+// The common parent of the point lights, rotating it orbits all of them
+static u32 FindPointLightsNode(App* app)
+{
+    const EntityArchetypeStorage& lightCasters = GetArchetype(app->entities, ENTITY_ARCHETYPE_LIGHT_CASTER);
+    for (u32 i = 0; i < lightCasters.count; ++i)
+        if (lightCasters.lights[i].lightVector.w == 1.0f && lightCasters.sceneNodes[i] != SCENE_NODE_NONE)
+            return app->sceneGraph.parents[lightCasters.sceneNodes[i]];
+
+    return SCENE_NODE_NONE;
+}
+
 void Init(App* app)
 {
     // RENDERING MODE //
@@ -34,6 +156,16 @@ void Init(App* app)
         app->openGLGui.extensions.emplace_back((const char*)glGetStringi(GL_EXTENSIONS, GLuint(i)));
     }
 
+    InitParallelShaderCompile(app->openGLGui.extensions);
+    InitRenderStats(app->openGLGui.extensions);
+    InitGPUMemoryTracker(app->openGLGui.extensions);
+
+    InitProgramBinaryCache(app->openGLGui.vendor, app->openGLGui.renderer, app->openGLGui.version);
+
+    // JOB SYSTEM //
+    // Started before the assets, their decoding is split across the workers. One worker per core, the main thread included.
+    InitJobSystem(std::thread::hardware_concurrency());
+
     // ImGui Render Target Selection Combo
     app->rendererOptions.renderTargets.push_back("FINAL COLOR");
     app->rendererOptions.renderTargets.push_back("DEPTH");
@@ -42,6 +174,7 @@ void Init(App* app)
     app->rendererOptions.renderTargets.push_back("ALBEDO");
     app->rendererOptions.renderTargets.push_back("SPECULAR");
     app->rendererOptions.renderTargets.push_back("REFLECTIVE + SHININESS");
+    app->rendererOptions.renderTargets.push_back("VELOCITY");
 
     // ImGui Skybox Options
     app->rendererOptions.activeSkybox = true;
@@ -59,6 +192,18 @@ void Init(App* app)
     app->rendererOptions.ssaoKernelSize = 64;
     app->rendererOptions.ssaoNoiseSize = 16;
 
+    // ImGui Shadow Options
+    app->rendererOptions.activeShadows = true;
+
+    // Scalability Options
+    app->rendererOptions.renderScale = 1.0f;
+    app->rendererOptions.lodBias = 0.0f;
+
+    // Temporal Upsampling Options
+    app->rendererOptions.activeTemporalUpsampling = true;
+    app->rendererOptions.temporalUpsamplingScale = 0.775f; // 60% of the display pixels
+    InitQualityGovernor(app->qualityGovernor);
+
     // CAMERA //
     app->camera = Camera(glm::vec3(0.0f, 3.0f, 20.0f), 45.0f, 1.0f, 100.0f);
 
@@ -68,57 +213,69 @@ void Init(App* app)
     glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &app->uniformBufferOffsetAlignment);
     app->UBO = CreateConstantBuffer(maxUniformBlockSize);
 
-    // SCREEN-FILLING QUAD //
-    app->renderer.screenQuad.VAO = CreateQuad();
+    // SHADERS //
+    // Every program is submitted before any status is queried, so the driver can compile them in parallel
     app->renderer.screenQuad.shaderID = LoadShaderProgram(app->shaderPrograms, ShaderType::SCREEN_QUAD, "Assets/Shaders/Quad_Deferred.glsl", "SCREEN_QUAD");
-
     app->renderer.lightCasterShaderID = LoadShaderProgram(app->shaderPrograms, ShaderType::LIGHT_CASTER, "Assets/Shaders/LightCaster.glsl", "LIGHT_CASTER");
+    u32 lightingFeatures = SHADER_FEATURE_IRRADIANCE | SHADER_FEATURE_REFLECTION | SHADER_FEATURE_REFRACTION;
+    app->renderer.lightingPassShaderID = LoadShaderProgram(app->shaderPrograms, ShaderType::LIGHTING_PASS, "Assets/Shaders/LightingPass_Deferred.glsl", "DEFERRED_LIGHTING_PASS", lightingFeatures | SHADER_FEATURE_SSAO | SHADER_FEATURE_SHADOWS);
+
+    // The material textures of each shader type are base features of the same source
+    app->renderer.forwardShadersID[0] = LoadShaderProgram(app->shaderPrograms, ShaderType::DEFAULT, "Assets/Shaders/Forward/Forward.glsl", "FORWARD", lightingFeatures);
+    app->renderer.forwardShadersID[1] = LoadShaderProgram(app->shaderPrograms, ShaderType::TEXTURED_ALBEDO, "Assets/Shaders/Forward/Forward.glsl", "FORWARD", lightingFeatures);
+    app->renderer.forwardShadersID[2] = LoadShaderProgram(app->shaderPrograms, ShaderType::TEXTURED_ALB_SPEC, "Assets/Shaders/Forward/Forward.glsl", "FORWARD", lightingFeatures);
+
+    app->renderer.deferredShadersID[0] = LoadShaderProgram(app->shaderPrograms, ShaderType::DEFAULT, "Assets/Shaders/GeometryPass_Deferred.glsl", "DEFERRED_GEOMETRY");
+    app->renderer.deferredShadersID[1] = LoadShaderProgram(app->shaderPrograms, ShaderType::TEXTURED_ALBEDO, "Assets/Shaders/GeometryPass_Deferred.glsl", "DEFERRED_GEOMETRY");
+    app->renderer.deferredShadersID[2] = LoadShaderProgram(app->shaderPrograms, ShaderType::TEXTURED_ALB_SPEC, "Assets/Shaders/GeometryPass_Deferred.glsl", "DEFERRED_GEOMETRY");
+
+    app->renderer.skyboxShaderID = LoadShaderProgram(app->shaderPrograms, ShaderType::OTHER, "Assets/Shaders/Skybox.glsl", "SKYBOX");
+    u32 equirectToCubemapShaderID = LoadShaderProgram(app->shaderPrograms, ShaderType::OTHER, "Assets/Shaders/EquirectToCubemap.glsl", "EQUIRECT_TO_CUBEMAP");
+
+    app->renderer.ssaoShaderID = LoadShaderProgram(app->shaderPrograms, ShaderType::OTHER, "Assets/Shaders/SSAO.glsl", "SSAO", SHADER_FEATURE_RANGE_CHECK);
+    app->renderer.ssaoBlurShaderID = LoadShaderProgram(app->shaderPrograms, ShaderType::OTHER, "Assets/Shaders/SSAO_Blur.glsl", "SSAO_BLUR");
+    app->renderer.temporalResolveShaderID = LoadShaderProgram(app->shaderPrograms, ShaderType::OTHER, "Assets/Shaders/TemporalResolve.glsl", "TEMPORAL_RESOLVE");
+    app->renderer.shadowDepthShaderID = LoadShaderProgram(app->shaderPrograms, ShaderType::OTHER, "Assets/Shaders/ShadowDepth.glsl", "SHADOW_DEPTH");
 
-    // DEFERRED RENDERING: Lighting Pass //
-    app->renderer.lightingPassShaderID = LoadShaderProgram(app->shaderPrograms, ShaderType::LIGHTING_PASS, "Assets/Shaders/LightingPass_Deferred.glsl", "DEFERRED_LIGHTING_PASS");
+    // Only the variants for the current options are built now, the rest when an option changes
+    SelectShaderVariants(app);
+
+    // SCREEN-FILLING QUAD //
+    app->renderer.screenQuad.VAO = CreateQuad();
 
     // SHADERS FORWARD //
-    app->renderer.forwardShadersID[0] = LoadShaderProgram(app->shaderPrograms, ShaderType::DEFAULT, "Assets/Shaders/Forward/Default_Forward.glsl", "FORWARD_DEFAULT");
+    // The default shaders are the fallback of the textured ones while they compile, so they are waited for here.
+    // Sampler units of the textured ones are applied whenever they finish.
     Shader& defaultShaderF = app->shaderPrograms[app->renderer.forwardShadersID[0]];
-    defaultShaderF.Bind();
-    defaultShaderF.SetUniform1i("uEnvironmentMap", 0);
-    defaultShaderF.SetUniform1i("uIrradianceMap", 1);
+    defaultShaderF.FinishCompilation();
+    defaultShaderF.SetSamplerUnit("uEnvironmentMap", 0);
+    defaultShaderF.SetSamplerUnit("uIrradianceMap", 1);
 
-    app->renderer.forwardShadersID[1] = LoadShaderProgram(app->shaderPrograms, ShaderType::TEXTURED_ALBEDO, "Assets/Shaders/Forward/Albedo_Forward.glsl", "FORWARD_ALBEDO");
     Shader& texturedAlbShaderF = app->shaderPrograms[app->renderer.forwardShadersID[1]];
-    texturedAlbShaderF.Bind();
-    texturedAlbShaderF.SetUniform1i("uMaterial.albedo", 0);
-    texturedAlbShaderF.SetUniform1i("uEnvironmentMap", 1);
-    texturedAlbShaderF.SetUniform1i("uIrradianceMap", 2);
+    texturedAlbShaderF.SetSamplerUnit("uMaterial.albedo", 0);
+    texturedAlbShaderF.SetSamplerUnit("uEnvironmentMap", 1);
+    texturedAlbShaderF.SetSamplerUnit("uIrradianceMap", 2);
 
-    app->renderer.forwardShadersID[2] = LoadShaderProgram(app->shaderPrograms, ShaderType::TEXTURED_ALB_SPEC, "Assets/Shaders/Forward/AlbedoSpecular_Forward.glsl", "FORWARD_ALBEDO_SPECULAR");
     Shader& texturedAlbSpecShaderF = app->shaderPrograms[app->renderer.forwardShadersID[2]];
-    texturedAlbSpecShaderF.Bind();
-    texturedAlbSpecShaderF.SetUniform1i("uMaterial.albedo", 0);
-    texturedAlbSpecShaderF.SetUniform1i("uMaterial.specular", 1);
-    texturedAlbSpecShaderF.SetUniform1i("uEnvironmentMap", 2);
-    texturedAlbSpecShaderF.SetUniform1i("uIrradianceMap", 3);
+    texturedAlbSpecShaderF.SetSamplerUnit("uMaterial.albedo", 0);
+    texturedAlbSpecShaderF.SetSamplerUnit("uMaterial.specular", 1);
+    texturedAlbSpecShaderF.SetSamplerUnit("uEnvironmentMap", 2);
+    texturedAlbSpecShaderF.SetSamplerUnit("uIrradianceMap", 3);
 
     // SHADERS DEFERRED //
-    app->renderer.deferredShadersID[0] = LoadShaderProgram(app->shaderPrograms, ShaderType::DEFAULT, "Assets/Shaders/Default_Deferred.glsl", "DEFERRED_GEOMETRY_DEFAULT");
+    app->shaderPrograms[app->renderer.deferredShadersID[0]].FinishCompilation();
 
-    app->renderer.deferredShadersID[1] = LoadShaderProgram(app->shaderPrograms, ShaderType::TEXTURED_ALBEDO, "Assets/Shaders/GeometryPassAlb_Deferred.glsl", "DEFERRED_GEOMETRY_ALBEDO");
     Shader& texturedAlbShaderD = app->shaderPrograms[app->renderer.deferredShadersID[1]];
-    texturedAlbShaderD.Bind();
-    texturedAlbShaderD.SetUniform1i("uMaterial.albedo", 0);
+    texturedAlbShaderD.SetSamplerUnit("uMaterial.albedo", 0);
 
-    app->renderer.deferredShadersID[2] = LoadShaderProgram(app->shaderPrograms, ShaderType::TEXTURED_ALB_SPEC, "Assets/Shaders/GeometryPassAlbSpec_Deferred.glsl", "DEFERRED_GEOMETRY_ALBEDO_SPECULAR");
     Shader& texturedAlbSpecShaderD = app->shaderPrograms[app->renderer.deferredShadersID[2]];
-    texturedAlbSpecShaderD.Bind();
-    texturedAlbSpecShaderD.SetUniform1i("uMaterial.albedo", 0);
-    texturedAlbSpecShaderD.SetUniform1i("uMaterial.specular", 1);
+    texturedAlbSpecShaderD.SetSamplerUnit("uMaterial.albedo", 0);
+    texturedAlbSpecShaderD.SetSamplerUnit("uMaterial.specular", 1);
 
     // SKYBOX //
     app->renderer.skyboxCubeVAO = CreateSkyboxCube();
-    app->renderer.skyboxShaderID = LoadShaderProgram(app->shaderPrograms, ShaderType::OTHER, "Assets/Shaders/Skybox.glsl", "SKYBOX");
 
-    Shader& equirectToCubemapShader = app->shaderPrograms[LoadShaderProgram(app->shaderPrograms, ShaderType::OTHER, "Assets/Shaders/EquirectToCubemap.glsl", "EQUIRECT_TO_CUBEMAP")];
-    Shader& irradianceConvShader = app->shaderPrograms[LoadShaderProgram(app->shaderPrograms, ShaderType::OTHER, "Assets/Shaders/Irradiance_Convolution.glsl", "IRRADIANCE_CONVOLUTION")];
+    Shader& equirectToCubemapShader = app->shaderPrograms[equirectToCubemapShaderID];
 
     /*
     std::vector<std::string> cubemapFaces
@@ -132,112 +289,19 @@ void Init(App* app)
     };
     app->cubemapTextureID = LoadCubemap(cubemapFaces);
     */
-    glm::uvec2 cubemapTextures = LoadCubemap(app->textures, "Assets/Skybox/lilienstein_4k.hdr", equirectToCubemapShader, irradianceConvShader, app->renderer.skyboxCubeVAO);
+    glm::uvec2 cubemapTextures = LoadCubemap(app->textures, "Assets/Skybox/lilienstein_4k.hdr", equirectToCubemapShader, app->renderer.skyboxCubeVAO);
 
     app->renderer.environmentMapHandle = cubemapTextures.x;
     app->renderer.irradianceMapHandle = cubemapTextures.y;
 
-    // SSAO //
-    app->renderer.ssaoShaderID = LoadShaderProgram(app->shaderPrograms, ShaderType::OTHER, "Assets/Shaders/SSAO.glsl", "SSAO");
-    app->renderer.ssaoBlurShaderID = LoadShaderProgram(app->shaderPrograms, ShaderType::OTHER, "Assets/Shaders/SSAO_Blur.glsl", "SSAO_BLUR");
-
-    // MATERIALS //
-    Material greyMaterial = {};
-    greyMaterial.name = "Grey Material";
-    greyMaterial.albedo = glm::vec3(0.4f, 0.4f, 0.4f);
-    greyMaterial.reflective = glm::vec3(0.8f);
-
-    Material orangeMaterial = {};
-    orangeMaterial.name = "Orange Material";
-    orangeMaterial.albedo = glm::vec3(1.0f, 0.5f, 0.31f);
-    orangeMaterial.reflective = glm::vec3(0.5f);
-
-    Material blueMaterial = {};
-    blueMaterial.name = "Blue Material";
-    blueMaterial.albedo = glm::vec3(0.0f, 0.0f, 0.6f);
-    blueMaterial.reflective = glm::vec3(0.5f);
-
-    Material blackMaterial = {};
-    blackMaterial.name = "Black Material";
-    blackMaterial.albedo = glm::vec3(0.1f, 0.1f, 0.1f);
-    blackMaterial.reflective = glm::vec3(0.5f);
-
-    Material containerMat = {};
-    containerMat.name = "Container Material";
-    containerMat.albedoTextureID = LoadTexture2D(app->textures, "Assets/container_albedo.png");;
-    containerMat.specularTextureID = LoadTexture2D(app->textures, "Assets/container_specular.png");
-
-    // MODELS //
-    Model* planePrimitive = CreatePrimitive(app, PrimitiveType::PLANE, greyMaterial);
-
-    Model* spherePrimitive1 = CreatePrimitive(app, PrimitiveType::SPHERE, orangeMaterial);
-    Model* spherePrimitive2 = CreatePrimitive(app, PrimitiveType::SPHERE, blueMaterial);
-    Model* sphereLowPrimitive = CreatePrimitive(app, PrimitiveType::SPHERE, blackMaterial, 16, 16);
-
-    Model* containerPrimitive = CreatePrimitive(app, PrimitiveType::CUBE, containerMat);
-    Model* cubePrimitive = CreatePrimitive(app, PrimitiveType::CUBE, blackMaterial);
+    // SCENE //
+    InitGeometryArena(app->geometryArena);
 
-    Model* bunnyModel = LoadModel(app, "Assets/Models/Bunny/bunny.obj");
-    Model* patrickModel = LoadModel(app, "Assets/Models/Patrick/patrick.obj");
-    Model* backpackModel = LoadModel(app, "Assets/Models/Backpack/backpack.obj", false);
-
-    // ENTITIES //
-    // Primitives
-    Entity* planeEntity = CreateEntity(app, app->renderer.deferredShadersID[0], glm::vec3(0.0f, -3.4f, 0.0f), planePrimitive);
-    planeEntity->Rotate(-90.0f, glm::vec3(1.0f, 0.0f, 0.0f));
-    planeEntity->Scale(35.0f);
-
-    Entity* sphereEntity1 = CreateEntity(app, app->renderer.deferredShadersID[0], glm::vec3(10.0f, 1.0f, -4.0f), spherePrimitive1);
-    Entity* sphereEntity2 = CreateEntity(app, app->renderer.deferredShadersID[0], glm::vec3(-10.0f, 1.0f, -4.0f), spherePrimitive2);
-    Entity* containerEntity = CreateEntity(app, app->renderer.deferredShadersID[2], glm::vec3(-7.0f, 0.0f, 7.0f), containerPrimitive);
-    Entity* cubeEntity = CreateEntity(app, app->renderer.deferredShadersID[0], glm::vec3(-11.0f, 0.0f, 7.0f), cubePrimitive);
-
-    // 3D Models
-    Entity* bunnyEntity = CreateEntity(app, app->renderer.deferredShadersID[0], glm::vec3(7.0f, -3.5f, 7.0f), bunnyModel);
-    bunnyEntity->Scale(1.5f);
-
-    Entity* backpackEntity = CreateEntity(app, app->renderer.deferredShadersID[2], glm::vec3(0.0f, 1.0f, 7.0f), backpackModel);
-
-    CreateEntity(app, app->renderer.deferredShadersID[1], glm::vec3(-6.0f, 0.0f, 0.0f), patrickModel);
-    CreateEntity(app, app->renderer.deferredShadersID[1], glm::vec3(0.0f, 0.0f, 0.0f), patrickModel);
-    CreateEntity(app, app->renderer.deferredShadersID[1], glm::vec3(6.0f, 0.0f, 0.0f), patrickModel);
-
-    CreateEntity(app, app->renderer.deferredShadersID[1], glm::vec3(-6.0f, 0.0f, -4.0f), patrickModel);
-    CreateEntity(app, app->renderer.deferredShadersID[1], glm::vec3(0.0f, 0.0f, -4.0f), patrickModel);
-    CreateEntity(app, app->renderer.deferredShadersID[1], glm::vec3(6.0f, 0.0f, -4.0f), patrickModel);
-
-    CreateEntity(app, app->renderer.deferredShadersID[1], glm::vec3(-6.0f, 0.0f, -8.0f), patrickModel);
-    CreateEntity(app, app->renderer.deferredShadersID[1], glm::vec3(0.0f, 0.0f, -8.0f), patrickModel);
-    CreateEntity(app, app->renderer.deferredShadersID[1], glm::vec3(6.0f, 0.0f, -8.0f), patrickModel);
-
-    app->firstLightEntityID = app->entities.size();
-
-    // LIGHTS //
-    CreateDirectionalLight(app, glm::vec3(0.0f, -2.0f, 15.0f), glm::vec3(-0.2f, -1.0f, -0.3f), glm::vec3(0.0f), cubePrimitive, 0.5f);
-
-    srand(14);
-    for (unsigned int i = 0; i <= 8; i++)
-    {
-        // Random Position
-        float xPos = static_cast<float>(((rand() % 100) / 70.0f) * 9.0f - 3.0f);
-        float yPos = static_cast<float>(((rand() % 100) / 80.0f) * 6.0f + 6.0f);
-        float zPos = static_cast<float>(((rand() % 100) / 25.0f) * 6.0f - 16.0f);
-
-        // Random Color
-        float rColor = static_cast<float>(((rand() % 100) / 200.0f) + 0.5); // between 0.5 and 1.0
-        float gColor = static_cast<float>(((rand() % 100) / 200.0f) + 0.5); // between 0.5 and 1.0
-        float bColor = static_cast<float>(((rand() % 100) / 200.0f) + 0.5); // between 0.5 and 1.0
-        glm::vec3 color = glm::vec3(rColor, gColor, bColor);
-
-        CreatePointLight(app, glm::vec3(xPos, yPos, zPos), color, sphereLowPrimitive, 1.0f, 0.1f);
-    }
-
-    CreatePointLight(app, glm::vec3(-6.0f, 1.0f, 14.0f), glm::vec3(0.9f, 0.0f, 0.0f), sphereLowPrimitive, 0.5f, 0.1f);
-    CreatePointLight(app, glm::vec3(6.0f, 1.0f, 14.0f), glm::vec3(0.0f, 0.9f, 0.0f), sphereLowPrimitive, 1.0f, 0.1f);
-
-    // ENGINE COUNT OF ENTITIES & LIGHTS //
-    app->numEntities = app->entities.size();
-    app->numLights = app->lights.size();
+    // The scene saved from the Scene window, or the built-in one the first time
+    if (!LoadSceneFile(app, DEFAULT_SCENE_PATH))
+        CreateDefaultScene(app);
+    app->pointLightsNode = FindPointLightsNode(app);
+    app->pointLightsOrbitSpeed = 0.0f;
 
     // RENDERER INIT //
     app->renderer.Init(app);
@@ -245,10 +309,30 @@ void Init(App* app)
     // OPENGL GLOBAL STATE //
     glViewport(0, 0, app->displaySize.x, app->displaySize.y);
     glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+    // HOT RELOAD //
+    InitHotReload(app);
+
+    // FRAME PIPELINE //
+    // The first frame renders the scene as it was loaded, the simulation writes the other snapshot
+    app->framePipeline.latency = FrameLatency::ONE_FRAME;
+    app->framePipeline.renderIndex = 0;
+    app->framePipeline.isSimulating = false;
+    app->framePipeline.frameIndex = 0;
+    UpdateSceneGraph(app->sceneGraph, app->entities);
+    for (u32 i = 0; i < ENTITY_ARCHETYPE_COUNT; ++i)
+        app->entities.archetypes[i].previousModelMatrices = app->entities.archetypes[i].modelMatrices;
+    CaptureFrameSnapshot(app, app->framePipeline.snapshots[0]);
+
+    // WORLD STREAMING //
+    // The cells are placed from the world matrices, after the first scene graph update
+    InitWorldStreaming(app);
 }
 
 void ImGuiRender(App* app)
 {
+    PROFILE_FUNCTION();
+
     static bool oGLStatusWindow = false;
     static bool rendererWindow = true;
     static bool sceneWindow = true;
@@ -310,19 +394,20 @@ void ImGuiRender(App* app)
                     preview = options[i];
                     app->rendererOptions.forwardRendering = i == 0;
 
-                    for (u32 i = 0; i < app->numEntities; ++i)
+                    std::vector<u32>& shaderIDs = GetArchetype(app->entities, ENTITY_ARCHETYPE_MESH).shaderIDs;
+                    for (u32 i = 0; i < shaderIDs.size(); ++i)
                     {
-                        Entity& entity = app->entities[i];
-                        switch (app->shaderPrograms[entity.shaderID].type)
+                        u32& shaderID = shaderIDs[i];
+                        switch (app->shaderPrograms[shaderID].type)
                         {
                         case ShaderType::DEFAULT:
-                            entity.shaderID = app->rendererOptions.forwardRendering ? app->renderer.forwardShadersID[0] : app->renderer.deferredShadersID[0];
+                            shaderID = app->rendererOptions.forwardRendering ? app->renderer.forwardShadersID[0] : app->renderer.deferredShadersID[0];
                             break;
                         case ShaderType::TEXTURED_ALBEDO:
-                            entity.shaderID = app->rendererOptions.forwardRendering ? app->renderer.forwardShadersID[1] : app->renderer.deferredShadersID[1];
+                            shaderID = app->rendererOptions.forwardRendering ? app->renderer.forwardShadersID[1] : app->renderer.deferredShadersID[1];
                             break;
                         case ShaderType::TEXTURED_ALB_SPEC:
-                            entity.shaderID = app->rendererOptions.forwardRendering ? app->renderer.forwardShadersID[2] : app->renderer.deferredShadersID[2];
+                            shaderID = app->rendererOptions.forwardRendering ? app->renderer.forwardShadersID[2] : app->renderer.deferredShadersID[2];
                             break;
                         default:
                             break;
@@ -367,10 +452,9 @@ void ImGuiRender(App* app)
                 ImGui::DragFloat("Bias", &app->rendererOptions.ssaoBias, 0.001f, 0.01f, 0.1f);
                 ImGui::DragFloat("Power", &app->rendererOptions.ssaoPower, 0.1f, 1.0f, 10.0f);
 
-                if (ImGui::DragInt("Kernel Size", &app->rendererOptions.ssaoKernelSize, 4.0f, 4, 64))
+                if (ImGui::DragInt("Kernel Size", &app->rendererOptions.ssaoKernelSize, 4.0f, 4, SSAO_MAX_KERNEL_SIZE))
                 {
-                    app->renderer.ssaoKernel.clear();
-                    app->renderer.GenerateKernelSamples(app->shaderPrograms[app->renderer.ssaoShaderID], app->rendererOptions.ssaoKernelSize);
+                    app->renderer.GenerateKernelSamples(app->rendererOptions.ssaoKernelSize);
                 }
                 
                 static int increment = 2;
@@ -378,6 +462,7 @@ void ImGuiRender(App* app)
                 {
                     app->rendererOptions.ssaoNoiseSize = (int)glm::pow(2 * increment, 2);
                     
+                    UntrackGPUAllocation(GPUResourceKind::TEXTURE, app->renderer.noiseTextureHandle);
                     glDeleteTextures(1, &app->renderer.noiseTextureHandle);
                     app->renderer.ssaoNoise.clear();
                     app->renderer.GenerateKernelNoise(app->rendererOptions.ssaoNoiseSize);
@@ -388,6 +473,27 @@ void ImGuiRender(App* app)
             ImGui::Separator();
             ImGui::Spacing();
 
+            ImGui::Text("Shadow Options");
+            ImGui::Checkbox("Shadows", &app->rendererOptions.activeShadows);
+            if (app->rendererOptions.activeShadows)
+                DrawShadowMapsImGui(app->renderer.shadowMaps);
+
+            ImGui::Spacing();
+            ImGui::Separator();
+            ImGui::Spacing();
+
+            ImGui::Text("Temporal Upsampling Options");
+            ImGui::Checkbox("Temporal Upsampling", &app->rendererOptions.activeTemporalUpsampling);
+            if (app->rendererOptions.activeTemporalUpsampling)
+            {
+                ImGui::SliderFloat("Upsampling Scale", &app->rendererOptions.temporalUpsamplingScale, 0.5f, 1.0f, "%.3f");
+                ImGui::Text("Internal Resolution: %dx%d", app->renderer.renderSize.x, app->renderer.renderSize.y);
+            }
+
+            ImGui::Spacing();
+            ImGui::Separator();
+            ImGui::Spacing();
+
             ImGui::Text("G-Buffer Render Target");
             static const char* preview = "FINAL COLOR";
             if (ImGui::BeginCombo("##2", preview))
@@ -398,18 +504,19 @@ void ImGuiRender(App* app)
                     if (ImGui::Selectable(app->rendererOptions.renderTargets[i], isSelected))
                     {
                         preview = app->rendererOptions.renderTargets[i];
-                        if (i == 0)
-                            app->renderer.screenQuad.currentRenderTarget = app->renderer.screenQuad.FBO.colorAttachmentHandles[0];
-                        else if (i == 1)
-                            app->renderer.screenQuad.currentRenderTarget = app->renderer.GBuffer.depthAttachment;
-                        else
-                            app->renderer.screenQuad.currentRenderTarget = app->renderer.GBuffer.colorAttachmentHandles[i64(i) - 2];
+                        app->renderer.screenQuad.currentRenderTarget = i;
                     }
                 }
                 ImGui::EndCombo();
             }
         }
 
+        ImGui::Spacing();
+        ImGui::Separator();
+        ImGui::Spacing();
+
+        DrawQualityGovernorImGui(app);
+
         ImGui::End();
     }
 
@@ -434,27 +541,50 @@ void ImGuiRender(App* app)
         ImGui::Separator();
         ImGui::Spacing();
 
+        std::vector<Light>& lights = GetArchetype(app->entities, ENTITY_ARCHETYPE_LIGHT_CASTER).lights;
+        u32 directionalLight = FindEntityRow(app->entities, app->directionalLight, ENTITY_ARCHETYPE_LIGHT_CASTER);
+
         ImGui::Text("Lights");
         ImGui::Spacing();
-        ImGui::Text("Directional Light");
-        ImGui::SameLine();
-        ImGui::ColorEdit3("##3", &app->lights[0].color[0]);
-        ImGui::Spacing();
+        if (directionalLight != ENTITY_ROW_NONE)
+        {
+            ImGui::Text("Directional Light");
+            ImGui::SameLine();
+            ImGui::ColorEdit3("##3", &lights[directionalLight].color[0]);
+            ImGui::Spacing();
+        }
 
         ImGui::Text("Point Lights");
         ImGui::Spacing();
+        ImGui::SliderFloat("Orbit Speed", &app->pointLightsOrbitSpeed, -90.0f, 90.0f, "%.0f deg/s");
         if (ImGui::Button("Turn Off All Point Lights"))
         {
-            for (u32 i = 1; i < app->numLights; i++)
-                app->lights[i].color = glm::vec3(0.0f, 0.0f, 0.0f);
+            for (u32 i = 0; i < lights.size(); i++)
+            {
+                if (lights[i].lightVector.w == 1.0f)
+                    lights[i].color = glm::vec3(0.0f, 0.0f, 0.0f);
+            }
         }
         ImGui::Spacing();
-        for (u32 i = 1; i < app->numLights; ++i)
+        u32 pointLightNumber = 0;
+        for (u32 i = 0; i < lights.size(); ++i)
         {
-            ImGui::Text(std::string("Light " + std::to_string(i)).c_str());
+            if (lights[i].lightVector.w != 1.0f)
+                continue;
+
+            ImGui::Text("Light %u", ++pointLightNumber);
             ImGui::SameLine();
-            ImGui::ColorEdit3(std::string("##" + std::to_string(i + 3)).c_str(), &app->lights[i].color[0]);
+            ImGui::ColorEdit3(FormatString("##%u", i + 4).str, &lights[i].color[0]);
         }
+
+        ImGui::Spacing();
+        ImGui::Separator();
+        ImGui::Spacing();
+
+        if (ImGui::Button("Save Scene") && MakeDirectory(SCENE_DIRECTORY))
+            WriteSceneFile(app, DEFAULT_SCENE_PATH);
+        ImGui::SameLine();
+        ImGui::TextDisabled("Loaded instead of the built-in scene on the next run");
         ImGui::End();
     }
 
@@ -464,135 +594,484 @@ void ImGuiRender(App* app)
         ImGui::Text("FPS: %f", 1.0f / app->deltaTime);
         ImGui::Text("Frametime (s): %f", app->deltaTime);
         ImGui::Text("Render Loop (ms): %f", app->renderTime);
+        ImGui::Text("Simulation (ms): %f, waited for %f", app->framePipeline.simulationTime, app->framePipeline.waitTime);
+
+        const char* latencies[] = { "Serial", "One Frame" };
+        int latency = (int)app->framePipeline.latency;
+        if (ImGui::Combo("Frame Latency", &latency, latencies, ARRAY_COUNT(latencies)))
+            app->framePipeline.latency = FrameLatency(latency);
+        ImGui::Text("Visible Entities: %u / %u", app->numVisibleEntities, GetEntityCount(app->entities));
+        ImGui::Text("Scene Graph: %u / %u nodes updated in %f ms", app->sceneGraph.updatedNodeCount, (u32)app->sceneGraph.parents.size(), app->sceneGraph.updateTime);
         ImGui::Text("Time (s): %f", app->currentTime);
+
+        if (ImGui::CollapsingHeader("GPU Passes", ImGuiTreeNodeFlags_DefaultOpen))
+            DrawGPUTimersImGui(app->renderer.gpuTimers);
+
+        if (ImGui::CollapsingHeader("Renderer Counters"))
+            DrawRenderStatsImGui();
+
+        if (ImGui::CollapsingHeader("GPU Memory"))
+            DrawGPUMemoryImGui();
+
+        if (!app->rendererOptions.forwardRendering && ImGui::CollapsingHeader("Render Graph"))
+            DrawRenderGraphImGui(app->renderer.renderGraph);
+
+        if (!app->rendererOptions.forwardRendering && ImGui::CollapsingHeader("Draw Packets"))
+            DrawDrawPacketsImGui(app->renderer.drawPackets);
+
+        if (ImGui::CollapsingHeader("Allocators"))
+        {
+            DrawAllocatorsImGui();
+            ImGui::Spacing();
+            DrawAllocationTrackerImGui();
+        }
+
+        if (ImGui::CollapsingHeader("World Streaming"))
+            DrawWorldStreamingImGui(app);
+
+        if (ImGui::CollapsingHeader("Job System"))
+        {
+            DrawJobSystemImGui();
+            ImGui::Spacing();
+            DrawJobBenchmarkImGui(app);
+        }
+
+        if (ImGui::CollapsingHeader("CPU Profiler"))
+            DrawProfilerImGui();
         ImGui::End();
     }
 }
 
 void Update(App* app)
 {
+    PROFILE_FUNCTION();
+
     // You can handle input keyboard/mouse here
     if (app->input.keys[K_ESCAPE] == BUTTON_PRESS)
         app->isRunning = false;
-    
-    app->camera.Update(app->input, app->displaySize, app->deltaTime, float(app->currentTime));
 
-    for (u32 i = 0; i < app->shaderPrograms.size(); ++i)
+    DefragmentGeometryArena(app->geometryArena);
+
+    // Shaders, textures and models modified on disk are rebuilt by the hot reload thread
+    ApplyHotReloads(app);
+
+    // Cells around the camera are streamed in, the least recently used models evicted over the memory cap
+    UpdateWorldStreaming(app);
+
+    CheckGPUMemoryBudget();
+
+    UpdateQualityGovernor(app);
+}
+
+void Simulate(App* app, const SimulationInput& input, FrameSnapshot& snapshot)
+{
+    PROFILE_FUNCTION();
+
+    app->camera.Update(input.input, input.displaySize, input.deltaTime, float(input.currentTime));
+
+    if (app->pointLightsOrbitSpeed != 0.0f && app->pointLightsNode != SCENE_NODE_NONE)
     {
-        Shader& shaderProgram = app->shaderPrograms[i];
-        u64 currentTimestamp = GetFileLastWriteTimestamp(shaderProgram.filepath.c_str());
-        if (currentTimestamp > shaderProgram.lastWriteTimestamp)
-        {
-            glDeleteProgram(shaderProgram.handle);
-            String shaderProgramSrc = ReadTextFile(shaderProgram.filepath.c_str());
-            const char* shaderProgramName = shaderProgram.programName.c_str();
-            shaderProgram.handle = CreateShaderProgram(shaderProgramSrc, shaderProgramName);
-            shaderProgram.lastWriteTimestamp = currentTimestamp;
-        }
+        glm::quat orbit = glm::angleAxis(glm::radians(app->pointLightsOrbitSpeed * input.deltaTime), glm::vec3(0.0f, 1.0f, 0.0f));
+        SetSceneNodeRotation(app->sceneGraph, app->pointLightsNode, orbit * app->sceneGraph.localRotations[app->pointLightsNode]);
+    }
+
+    // Only the subtrees whose transforms changed since the last frame
+    UpdateSceneGraph(app->sceneGraph, app->entities);
+
+    CaptureFrameSnapshot(app, snapshot);
+}
+
+void CaptureFrameSnapshot(const App* app, FrameSnapshot& snapshot)
+{
+    snapshot.camera = app->camera;
+    CaptureEntitySnapshot(app, snapshot);
+    snapshot.rendererOptions = app->rendererOptions;
+}
+
+void CaptureEntitySnapshot(const App* app, FrameSnapshot& snapshot)
+{
+    // The arrays are copied whole, and only allocate when the entity count grows
+    for (u32 i = 0; i < ENTITY_ARCHETYPE_COUNT; ++i)
+        snapshot.modelMatrices[i] = app->entities.archetypes[i].modelMatrices;
+
+    snapshot.lights = app->entities.archetypes[ENTITY_ARCHETYPE_LIGHT_CASTER].lights;
+    snapshot.directionalLight = FindEntityRow(app->entities, app->directionalLight, ENTITY_ARCHETYPE_LIGHT_CASTER);
+    snapshot.entityVersion = app->entities.version;
+}
+
+static void SimulateJob(void* data, u32, u32)
+{
+    App* app = (App*)data;
+    FramePipeline& pipeline = app->framePipeline;
+
+    Timer timer(&pipeline.simulationTime);
+    AllocationScope allocationScope(ALLOCATION_SUBSYSTEM_SIMULATION);
+    Simulate(app, pipeline.simulationInput, pipeline.snapshots[1 - pipeline.renderIndex]);
+}
+
+void FinishSimulation(App* app)
+{
+    FramePipeline& pipeline = app->framePipeline;
+    if (!pipeline.isSimulating)
+    {
+        pipeline.waitTime = 0.0;
+        return;
+    }
+
+    {
+        PROFILE_SCOPE("Wait For Simulation");
+        Timer timer(&pipeline.waitTime);
+        WaitForCounter(pipeline.simulationCounter);
+    }
+
+    pipeline.isSimulating = false;
+    pipeline.renderIndex = 1 - pipeline.renderIndex;
+}
+
+void StartSimulation(App* app)
+{
+    FramePipeline& pipeline = app->framePipeline;
+    ASSERT(!pipeline.isSimulating, "FinishSimulation must be called before the next simulation starts");
+
+    pipeline.simulationInput.input = app->input;
+    pipeline.simulationInput.displaySize = app->displaySize;
+    pipeline.simulationInput.deltaTime = app->deltaTime;
+    pipeline.simulationInput.currentTime = app->currentTime;
+
+    // Entities were added or removed after the rendered snapshot was captured, its rows no longer match the store.
+    // Captured again before the simulation starts writing the transforms.
+    FrameSnapshot& renderFrame = GetRenderFrame(app);
+    if (renderFrame.entityVersion != app->entities.version)
+        CaptureEntitySnapshot(app, renderFrame);
+
+    // Without a worker to run it, the simulation would only run once the main thread waits for it
+    if (pipeline.latency == FrameLatency::SERIAL || GetJobWorkerCount() == 1)
+    {
+        SimulateJob(app, 0, 1);
+        pipeline.renderIndex = 1 - pipeline.renderIndex;
+        return;
     }
+
+    pipeline.isSimulating = true;
+    RunJob(SimulateJob, app, 0, 1, &pipeline.simulationCounter);
 }
 
 void Render(App* app)
 {
+    PROFILE_FUNCTION();
+
+    SelectShaderVariants(app);
+
+    FrameSnapshot& frame = GetRenderFrame(app);
+    const RendererOptions& options = frame.rendererOptions;
+    if (!options.forwardRendering)
+    {
+        float renderScale = options.renderScale * (options.activeTemporalUpsampling ? options.temporalUpsamplingScale : 1.0f);
+        glm::ivec2 renderSize = glm::ivec2(glm::vec2(app->displaySize) * renderScale);
+        app->renderer.SetRenderSize(glm::max(renderSize, glm::ivec2(1)));
+    }
+    else
+        app->renderer.temporalHistoryValid = false;
+
+    // Only the deferred path resolves the jittered frames
+    frame.camera.UpdateJitter(options.activeTemporalUpsampling && !options.forwardRendering, app->renderer.renderSize, app->framePipeline.frameIndex++);
+
+    BeginGPUFrame(app->renderer.gpuTimers);
+
+    // Moves the cascades before their matrices are written
+    if (!options.forwardRendering && options.activeShadows)
+        UpdateShadowMaps(app, app->renderer.shadowMaps);
+
     UpdateUniformBuffer(app);
 
-    glBindBufferRange(GL_UNIFORM_BUFFER, 0, app->UBO.handle, app->globalParamOffset, app->globalParamSize);
+    glBindBufferRange(GL_UNIFORM_BUFFER, GLOBAL_PARAMETERS_BINDING, app->UBO.handle, app->globalParamOffset, app->globalParamSize);
 
     Timer timer(&app->renderTime);
 
-    if (app->rendererOptions.forwardRendering)
+    if (options.forwardRendering)
+    {
         app->renderer.ForwardRender(app);
+
+        // SKYBOX //
+        // The deferred path draws it in its render graph
+        if (options.activeSkybox)
+        {
+            GPUPassScope skyboxPass(app->renderer.gpuTimers, GPU_PASS_SKYBOX);
+            app->renderer.RenderSkybox(app, frame.camera.GetProjectionMatrix(app->displaySize));
+        }
+    }
     else
         app->renderer.DeferredRender(app);
 
-    // SKYBOX //
-    if (app->rendererOptions.activeSkybox)
-    {
-        glDepthFunc(GL_LEQUAL); // change depth function so depth test passes when values are equal to depth buffer's content
-
-        Shader& skyboxShader = app->shaderPrograms[app->renderer.skyboxShaderID];
-        skyboxShader.Bind();
-        glm::mat4 view = glm::mat4(glm::mat3(app->camera.GetViewMatrix(app->displaySize))); // remove translation from the view matrix
-        skyboxShader.SetUniformMat4("uView", view);
-        skyboxShader.SetUniformMat4("uProjection", app->camera.GetProjectionMatrix(app->displaySize));
-
-        // Skybox Cube
-        glBindVertexArray(app->renderer.skyboxCubeVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, app->renderer.environmentMapHandle);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-        glDepthFunc(GL_LESS);
-    }
+    EndGPUFrame(app->renderer.gpuTimers);
+}
+
+u32 GetShaderFeatures(const RendererOptions& options)
+{
+    u32 features = 0;
+    if (options.activeIrradiance) features |= SHADER_FEATURE_IRRADIANCE;
+    if (options.activeReflection) features |= SHADER_FEATURE_REFLECTION;
+    if (options.activeRefraction) features |= SHADER_FEATURE_REFRACTION;
+    if (options.activeSSAO)       features |= SHADER_FEATURE_SSAO;
+    if (options.activeRangeCheck) features |= SHADER_FEATURE_RANGE_CHECK;
+    if (options.activeShadows)    features |= SHADER_FEATURE_SHADOWS;
+    return features;
+}
+
+void SelectShaderVariants(App* app)
+{
+    u32 features = GetShaderFeatures(app->rendererOptions);
+    for (u32 i = 0; i < app->shaderPrograms.size(); ++i)
+        app->shaderPrograms[i].SelectVariant(features);
+}
+
+void CleanUp(App* app)
+{
+    FinishSimulation(app);
+    ShutdownHotReload(app);
+    ShutdownWorldStreaming(app);
+    DestroyGPUTimers(app->renderer.gpuTimers);
+    DestroyShadowMaps(app->renderer.shadowMaps);
+    DestroyRenderGraph(app->renderer.renderGraph);
+    DestroyRenderStats();
+    ShutdownJobSystem();
 }
 
 void UpdateUniformBuffer(App* app)
 {
+    PROFILE_FUNCTION();
+
+    const FrameSnapshot& frame = GetRenderFrame(app);
+    const RendererOptions& options = frame.rendererOptions;
+
     MapBuffer(app->UBO, GL_WRITE_ONLY);
 
-    // Global Parameters //
-    app->globalParamOffset = app->UBO.head;
+    glm::mat4 projection = frame.camera.GetJitteredProjectionMatrix();
+    glm::mat4 view = frame.camera.GetViewMatrix(app->displaySize);
+    glm::mat4 previousVPMatrix = frame.camera.GetPreviousViewProjectionMatrix();
 
-    // Camera Position
-    PushVec3(app->UBO, app->camera.position);
+    // Global Parameters //
+    GlobalParameters* globalParams = PushParameterBlock<GlobalParameters>(app->UBO, app->uniformBufferOffsetAlignment);
+    app->globalParamOffset = app->UBO.head - sizeof(GlobalParameters);
+    app->globalParamSize = sizeof(GlobalParameters);
+
+    ASSERT(frame.lights.size() <= MAX_LIGHTS, "Too many lights for the GlobalParameters block");
+    globalParams->uViewPos = frame.camera.position;
+    globalParams->uNumLights = frame.lights.size();
+    for (u32 i = 0; i < frame.lights.size(); ++i)
+        globalParams->uLights[i] = frame.lights[i];
+    globalParams->uLODBias = options.lodBias;
+    globalParams->uJitter = frame.camera.GetJitter();
+
+    // SSAO Parameters //
+    if (options.activeSSAO && !options.forwardRendering)
+    {
+        SSAOParameters* ssaoParams = PushParameterBlock<SSAOParameters>(app->UBO, app->uniformBufferOffsetAlignment);
+        app->ssaoParamOffset = app->UBO.head - sizeof(SSAOParameters);
+        app->ssaoParamSize = sizeof(SSAOParameters);
+
+        const std::vector<glm::vec3>& kernel = app->renderer.ssaoKernel;
+        for (u32 i = 0; i < kernel.size(); ++i)
+            ssaoParams->uSamples[i] = glm::vec4(kernel[i], 0.0f);
+        ssaoParams->uProjection = projection;
+        ssaoParams->uInverseProjection = glm::inverse(projection);
+        ssaoParams->uView = view;
+        ssaoParams->uDisplaySize = glm::vec2(app->renderer.renderSize.x, app->renderer.renderSize.y);
+        ssaoParams->uRadius = options.ssaoRadius;
+        ssaoParams->uBias = options.ssaoBias;
+        ssaoParams->uPower = options.ssaoPower;
+        ssaoParams->uKernelSize = glm::min((int)kernel.size(), options.ssaoKernelSize);
+    }
 
-    // Lights
-    PushUInt(app->UBO, app->numLights);
-    for (u32 i = 0; i < app->numLights; ++i)
+    // Shadow Parameters //
+    if (options.activeShadows && !options.forwardRendering)
     {
-        AlignHead(app->UBO, sizeof(glm::vec4));
+        ShadowParameters* shadowParams = PushParameterBlock<ShadowParameters>(app->UBO, app->uniformBufferOffsetAlignment);
+        app->shadowParamOffset = app->UBO.head - sizeof(ShadowParameters);
+        app->shadowParamSize = sizeof(ShadowParameters);
 
-        Light& light = app->lights[i];
-        PushVec4(app->UBO, light.lightVector);
-        PushVec3(app->UBO, light.color);
-        PushFloat(app->UBO, light.constant);
+        WriteShadowParameters(app->renderer.shadowMaps, *shadowParams);
     }
-    app->globalParamSize = app->UBO.head - app->globalParamOffset;
 
-    glm::mat4 VPMatrix = app->camera.GetProjectionMatrix(app->displaySize) * app->camera.GetViewMatrix(app->displaySize);
+    glm::mat4 VPMatrix = projection * view;
+
     // Local Parameters //
-    for (u32 i = 0; i < app->numEntities; ++i)
+    // Every row of an archetype gets a block of the same stride, so the jobs know where to write without a shared head.
+    // Entities outside the frustum keep their blocks, the draws just skip them.
+    app->numVisibleEntities = 0;
+    for (u32 i = 0; i < ENTITY_ARCHETYPE_COUNT; ++i)
+    {
+        EntityArchetypeStorage& archetype = app->entities.archetypes[i];
+        if (archetype.count == 0)
+            continue;
+
+        const glm::mat4* modelMatrices = frame.modelMatrices[i].data();
+        app->numVisibleEntities += CullEntities(archetype, modelMatrices, VPMatrix);
+
+        u32 blockStride;
+        LocalParameters* localParams = PushParameterBlocks<LocalParameters>(app->UBO, archetype.count, app->uniformBufferOffsetAlignment, blockStride);
+        u32 firstBlockOffset = (u8*)localParams - (u8*)app->UBO.data;
+        WriteLocalParameters(archetype, modelMatrices, (u8*)localParams, blockStride, firstBlockOffset, VPMatrix, previousVPMatrix);
+    }
+    UnmapBuffer(app->UBO);
+}
+
+// ------------------------------------------------------------------------------------------------
+// ENTITY JOBS //
+// ------------------------------------------------------------------------------------------------
+
+struct LocalParametersJob
+{
+    glm::mat4* previousModelMatrices;
+    u32* localParamOffsets;
+    const glm::mat4* modelMatrices;
+    u8* blocks;
+    u32 blockStride;
+    u32 firstBlockOffset;
+    glm::mat4 VPMatrix;
+    glm::mat4 previousVPMatrix;
+};
+
+static void WriteLocalParametersRange(void* data, u32 begin, u32 end)
+{
+    PROFILE_SCOPE("Write Local Parameters");
+
+    LocalParametersJob& job = *(LocalParametersJob*)data;
+    for (u32 i = begin; i < end; ++i)
     {
-        AlignHead(app->UBO, app->uniformBufferOffsetAlignment);
+        LocalParameters* localParams = (LocalParameters*)(job.blocks + i * job.blockStride);
+        job.localParamOffsets[i] = job.firstBlockOffset + i * job.blockStride;
+
+        localParams->uModel = job.modelMatrices[i];
+        localParams->uMVP = job.VPMatrix * localParams->uModel;
+        localParams->uPrevMVP = job.previousVPMatrix * job.previousModelMatrices[i];
+        job.previousModelMatrices[i] = localParams->uModel;
+    }
+}
+
+void WriteLocalParameters(EntityArchetypeStorage& archetype, const glm::mat4* modelMatrices, u8* blocks, u32 blockStride, u32 firstBlockOffset, const glm::mat4& VPMatrix, const glm::mat4& previousVPMatrix)
+{
+    PROFILE_FUNCTION();
+
+    ASSERT(archetype.components & ENTITY_COMPONENT_RENDERABLE, "Only renderable entities have local parameters");
+
+    LocalParametersJob job = { archetype.previousModelMatrices.data(), archetype.localParamOffsets.data(), modelMatrices, blocks, blockStride, firstBlockOffset, VPMatrix, previousVPMatrix };
+    ParallelFor(archetype.count, ENTITY_JOB_GRANULARITY, WriteLocalParametersRange, &job);
+}
+
+struct CullingJob
+{
+    Model* const* models;
+    u8* visibility;
+    const glm::mat4* modelMatrices;
+    glm::vec4 planes[6];
+    std::atomic<u32> visibleCount;
+};
+
+static void CullEntitiesRange(void* data, u32 begin, u32 end)
+{
+    PROFILE_SCOPE("Cull Entities");
+
+    CullingJob& job = *(CullingJob*)data;
+    u32 visibleCount = 0;
+    for (u32 i = begin; i < end; ++i)
+    {
+        // Evicted by the world streamer, there's no geometry to draw
+        if (!job.models[i]->isResident)
+        {
+            job.visibility[i] = 0;
+            continue;
+        }
 
-        Entity& entity = app->entities[i];
-        entity.localParamOffset = app->UBO.head;
+        const glm::mat4& modelMatrix = job.modelMatrices[i];
+        const glm::vec4& bounds = job.models[i]->boundingSphere;
 
-        glm::mat4 modelMatrix = entity.GetModelMatrix();
-        PushMat4(app->UBO, modelMatrix);
+        // The sphere grows with the largest scale of the model matrix
+        glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(glm::vec3(bounds), 1.0f));
+        float scale = glm::max(glm::length(glm::vec3(modelMatrix[0])), glm::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+        float radius = bounds.w * scale;
 
-        glm::mat4 MVP = VPMatrix * modelMatrix;
-        PushMat4(app->UBO, MVP);
+        bool isVisible = true;
+        for (u32 p = 0; p < 6 && isVisible; ++p)
+            isVisible = glm::dot(glm::vec3(job.planes[p]), center) + job.planes[p].w >= -radius;
 
-        entity.localParamSize = app->UBO.head - entity.localParamOffset;
+        job.visibility[i] = isVisible;
+        visibleCount += isVisible;
     }
-    UnmapBuffer(app->UBO);
+    job.visibleCount += visibleCount;
 }
 
-Entity* CreateEntity(App* app, u32 shaderID, glm::vec3 position, Model* model)
+u32 CullEntities(EntityArchetypeStorage& archetype, const glm::mat4* modelMatrices, const glm::mat4& VPMatrix)
 {
-    Entity entity = Entity(shaderID, position, model);
-    app->entities.push_back(entity);
+    PROFILE_FUNCTION();
+
+    ASSERT(archetype.components & ENTITY_COMPONENT_RENDERABLE, "Only renderable entities are culled");
+
+    CullingJob job;
+    job.models = archetype.models.data();
+    job.visibility = archetype.visibility.data();
+    job.modelMatrices = modelMatrices;
+    job.visibleCount = 0;
+
+    // Planes of the frustum from the rows of the view projection, pointing inside (Gribb and Hartmann)
+    glm::vec4 rows[4];
+    for (u32 i = 0; i < 4; ++i)
+        rows[i] = glm::vec4(VPMatrix[0][i], VPMatrix[1][i], VPMatrix[2][i], VPMatrix[3][i]);
+    for (u32 i = 0; i < 3; ++i)
+    {
+        job.planes[i * 2] = rows[3] + rows[i];
+        job.planes[i * 2 + 1] = rows[3] - rows[i];
+    }
+    for (u32 p = 0; p < 6; ++p)
+        job.planes[p] /= glm::length(glm::vec3(job.planes[p]));
 
-    return &app->entities[app->entities.size() - 1u];
+    ParallelFor(archetype.count, ENTITY_JOB_GRANULARITY, CullEntitiesRange, &job);
+
+    return job.visibleCount;
 }
 
-void CreatePointLight(App* app, glm::vec3 position, glm::vec3 color, Model* model, float constant, float scale)
+// The renderable components of a new row, shared by the mesh and light caster archetypes.
+// The model matrix is written by a new scene node on the next UpdateSceneGraph.
+static EntityHandle AddRenderableEntity(App* app, EntityArchetype archetype, u32 shaderID, const glm::vec3& position, Model* model, float scale, u32 parentNode)
 {
-    Entity lightEntity = Entity(app->renderer.lightCasterShaderID, position, model);
-    lightEntity.Scale(scale);
-    app->entities.push_back(lightEntity);
+    EntityHandle handle = AddEntity(app->entities, archetype);
 
-    Light light = { glm::vec4(position, 1.0f), color, constant };
-    app->lights.push_back(light);
+    u32 row;
+    EntityArchetypeStorage& storage = GetEntityArchetype(app->entities, handle, row);
+    storage.models[row] = model;
+    storage.shaderIDs[row] = shaderID;
+    storage.sceneNodes[row] = CreateSceneNode(app->sceneGraph, parentNode, position, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(scale), handle);
+
+    return handle;
+}
+
+EntityHandle CreateEntity(App* app, u32 shaderID, glm::vec3 position, Model* model, u32 parentNode)
+{
+    return AddRenderableEntity(app, ENTITY_ARCHETYPE_MESH, shaderID, position, model, 1.0f, parentNode);
 }
 
-void CreateDirectionalLight(App* app, glm::vec3 entityPosition, glm::vec3 direction, glm::vec3 color, Model* model, float scale)
+static EntityHandle CreateLightCaster(App* app, const glm::vec3& entityPosition, const Light& light, Model* model, float scale, u32 parentNode)
 {
-    Entity lightEntity = Entity(app->renderer.lightCasterShaderID, entityPosition, model);
-    lightEntity.Scale(scale);
-    app->entities.push_back(lightEntity);
+    ASSERT(GetArchetype(app->entities, ENTITY_ARCHETYPE_LIGHT_CASTER).count < MAX_LIGHTS, "Too many lights for the GlobalParameters block");
+
+    EntityHandle handle = AddRenderableEntity(app, ENTITY_ARCHETYPE_LIGHT_CASTER, app->renderer.lightCasterShaderID, entityPosition, model, scale, parentNode);
+
+    u32 row;
+    EntityArchetypeStorage& storage = GetEntityArchetype(app->entities, handle, row);
+    storage.lights[row] = light;
 
+    return handle;
+}
+
+EntityHandle CreatePointLight(App* app, glm::vec3 position, glm::vec3 color, Model* model, float constant, float scale, u32 parentNode)
+{
+    Light light = { glm::vec4(position, 1.0f), color, constant };
+    return CreateLightCaster(app, position, light, model, scale, parentNode);
+}
+
+EntityHandle CreateDirectionalLight(App* app, glm::vec3 entityPosition, glm::vec3 direction, glm::vec3 color, Model* model, float scale)
+{
     Light light = { glm::vec4(direction, 0.0f), color, 1.0f };
-    app->lights.push_back(light);
-}
\ No newline at end of file
+    app->directionalLight = CreateLightCaster(app, entityPosition, light, model, scale, SCENE_NODE_NONE);
+    return app->directionalLight;
+}
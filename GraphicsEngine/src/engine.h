@@ -7,8 +7,16 @@
 #include "platform.h"
 #include "Texture.h"
 #include "Entity.h"
+#include "EntityStore.h"
+#include "SceneGraph.h"
 #include "Camera.h"
 #include "BufferManagement.h"
+#include "GeometryArena.h"
+#include "HotReload.h"
+#include "WorldStreaming.h"
+#include "ShaderParameters.h"
+#include "QualityGovernor.h"
+#include "JobSystem.h"
 
 #include "Renderer.h"
 
@@ -48,16 +56,61 @@ struct RendererOptions
     float ssaoPower;
     int ssaoKernelSize;
     int ssaoNoiseSize;
+
+    // Shadow Options
+    bool activeShadows;
+
+    // Scalability, driven by the quality governor when it's enabled
+    float renderScale;
+    float lodBias;
+
+    // Temporal Upsampling Options
+    bool activeTemporalUpsampling;
+    float temporalUpsamplingScale; // Multiplies renderScale
+};
+
+// Everything Render reads that the simulation writes, captured at the end of Simulate. Render only reads
+// the snapshot, so the simulation of the next frame can run on a worker while it submits.
+struct FrameSnapshot
+{
+    Camera camera;
+    std::vector<glm::mat4> modelMatrices[ENTITY_ARCHETYPE_COUNT]; // One per row of each archetype
+    std::vector<Light> lights;                                    // The lights of the light caster rows
+    u32 directionalLight;                                         // Row of the directional light in lights, ENTITY_ROW_NONE without one
+    u32 entityVersion;                                            // Of the entity store when the rows were captured
+    RendererOptions rendererOptions;
+};
+
+// Copied for Simulate before it starts, the main thread keeps handling events while it runs
+struct SimulationInput
+{
+    Input input;
+    glm::ivec2 displaySize;
+    float deltaTime;
+    f64 currentTime;
 };
 
-struct Light
+enum class FrameLatency
 {
-    // 3 components for position/direction and last for the type of the light
-    // 0.0 is Directional light and 1.0 is Point light
-    glm::vec4 lightVector;
+    SERIAL,   // The simulation of a frame runs right before it's rendered
+    ONE_FRAME // The simulation of frame N+1 runs on a worker while frame N is rendered
+};
+
+struct FramePipeline
+{
+    FrameLatency latency;
+    FrameSnapshot snapshots[2];
+    u32 renderIndex; // Snapshot read by Render, the simulation writes the other one
+
+    SimulationInput simulationInput;
+    JobCounter simulationCounter;
+    bool isSimulating;
 
-    glm::vec3 color;
-    float constant;
+    u32 frameIndex; // Frames rendered, drives the jitter sequence
+
+    // Last frame, shown in ImGui
+    f64 simulationTime; // ms
+    f64 waitTime;       // ms the main thread waited for the simulation to finish
 };
 
 struct App
@@ -66,6 +119,7 @@ struct App
     float deltaTime;
     f64 currentTime;
     f64 renderTime;
+    f64 cpuFrameTime; // ms, the whole frame except waiting for the swap
     bool isRunning;
     glm::ivec2 displaySize;
 
@@ -79,45 +133,91 @@ struct App
     // CAMERA //
     Camera camera;
 
+    // FRAME PIPELINE //
+    FramePipeline framePipeline;
+
     // Renderer
     Renderer renderer;
+    QualityGovernor qualityGovernor;
 
     // UNIFORM BUFFER (CONSTANT BUFFER) //
     int uniformBufferOffsetAlignment;
     Buffer UBO;
     u32 globalParamOffset;
     u32 globalParamSize;
+    u32 ssaoParamOffset;
+    u32 ssaoParamSize;
+    u32 shadowParamOffset;
+    u32 shadowParamSize;
 
     // ENTITIES //
-    std::vector<Entity> entities;
-    u32 numEntities;
-
-    // LIGHTS //
-    u32 firstLightEntityID;
-    std::vector<Light> lights;
-    u32 numLights;
+    // Lights are the light component of the light caster archetype
+    EntityStore entities;
+    EntityHandle directionalLight; // The one the ImGui edits and the cascades shadow, the rows move when lights are removed
+    u32 numVisibleEntities; // Inside the camera frustum in the last frame
+
+    // SCENE GRAPH //
+    // Owned by the simulation, it writes the model matrices of the entities
+    SceneGraph sceneGraph;
+    u32 pointLightsNode;
+    float pointLightsOrbitSpeed; // Degrees per second
     
     // RESOURCES //
+    GeometryArena geometryArena;
     std::vector<std::unique_ptr<Model>> models;
     std::vector<Texture> textures;
     std::vector<Material> materials;
     std::vector<Shader> shaderPrograms;
+
+    // HOT RELOAD //
+    HotReloader hotReloader;
+
+    // WORLD STREAMING //
+    WorldStreamer worldStreamer;
 };
 
 void Init(App* app);
 
 void ImGuiRender(App* app);
 
+// Work of the main thread between the ImGui windows and Render: the GL side of the update
 void Update(App* app);
 
+// The simulation of the next frame: the camera, the scene graph and anything else Render reads through the snapshot
+void Simulate(App* app, const SimulationInput& input, FrameSnapshot& snapshot);
+
+// Called by the platform loop, FinishSimulation before anything touches the App and StartSimulation after Update.
+// The snapshot of the finished simulation is the one rendered next.
+void FinishSimulation(App* app);
+void StartSimulation(App* app);
+
+void CaptureFrameSnapshot(const App* app, FrameSnapshot& snapshot);
+// Only the model matrices and lights, for a snapshot whose rows moved since it was captured
+void CaptureEntitySnapshot(const App* app, FrameSnapshot& snapshot);
+inline FrameSnapshot& GetRenderFrame(App* app) { return app->framePipeline.snapshots[app->framePipeline.renderIndex]; }
+
 void Render(App* app);
 
-//void CleanUp(App* app);
+void CleanUp(App* app);
 
 // Engine Additional Functions
 void UpdateUniformBuffer(App* app);
 
-Entity* CreateEntity(App* app, u32 shaderID, glm::vec3 position, Model* model);
+#define ENTITY_JOB_GRANULARITY 256 // Entities per job of the per entity work
+
+// Per entity work of every frame over the rows of a renderable archetype, split across the job system.
+// The job benchmark also runs them on copies of the entities. modelMatrices has one matrix per row.
+// Fills the LocalParameters block of each row, blockStride bytes apart, at firstBlockOffset of the uniform buffer
+void WriteLocalParameters(EntityArchetypeStorage& archetype, const glm::mat4* modelMatrices, u8* blocks, u32 blockStride, u32 firstBlockOffset, const glm::mat4& VPMatrix, const glm::mat4& previousVPMatrix);
+// Flags the rows whose bounding sphere is inside the frustum, returns how many are
+u32 CullEntities(EntityArchetypeStorage& archetype, const glm::mat4* modelMatrices, const glm::mat4& VPMatrix);
+
+// Options that are constant for the whole frame are compiled into the shaders as feature #defines
+u32 GetShaderFeatures(const RendererOptions& options);
+void SelectShaderVariants(App* app);
+
+// The position, relative to the parent node, is the one of the scene node created for the entity
+EntityHandle CreateEntity(App* app, u32 shaderID, glm::vec3 position, Model* model, u32 parentNode = SCENE_NODE_NONE);
 
-void CreatePointLight(App* app, glm::vec3 position, glm::vec3 color, Model* model, float constant = 1.0f, float scale = 1.0f);
-void CreateDirectionalLight(App* app, glm::vec3 entityPosition, glm::vec3 direction, glm::vec3 color, Model* model, float scale = 1.0f);
\ No newline at end of file
+EntityHandle CreatePointLight(App* app, glm::vec3 position, glm::vec3 color, Model* model, float constant = 1.0f, float scale = 1.0f, u32 parentNode = SCENE_NODE_NONE);
+EntityHandle CreateDirectionalLight(App* app, glm::vec3 entityPosition, glm::vec3 direction, glm::vec3 color, Model* model, float scale = 1.0f);
\ No newline at end of file
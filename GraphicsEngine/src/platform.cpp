@@ -12,14 +12,28 @@
 #else
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
+#include <errno.h>
+#include <dirent.h>
 #endif
 
 #include "engine.h"
 #include "GLDebugger.h"
+#include "Profiler.h"
+#include "Allocators.h"
+#include "AllocationTracker.h"
+#include "MeshOptimizer.h"
 
 #include "GLFW/glfw3.h"
 #include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mutex>
 #include "imgui-docking/imgui.h"
 #include "imgui-docking/imgui_impl_glfw.h"
 #include "imgui-docking/imgui_impl_opengl3.h"
@@ -28,9 +42,30 @@
 #define WINDOW_WIDTH  1920
 #define WINDOW_HEIGHT 1080
 
-#define GLOBAL_FRAME_ARENA_SIZE MB(16)
-u8* GlobalFrameArenaMemory = NULL;
-u32 GlobalFrameArenaHead = 0;
+GLFWwindow* GlobalLoaderContext = NULL;
+
+struct FileWatcher
+{
+    std::mutex mutex;
+    bool initialized;
+    bool stopped;
+
+    std::vector<std::string> files;
+    std::vector<std::string> pendingChanges;
+    std::vector<std::string> directories;
+
+#ifdef _WIN32
+    std::vector<HANDLE> directoryHandles;
+    std::vector<u64> fileTimestamps;
+    HANDLE stopEvent;
+#else
+    std::vector<int> watchDescriptors;
+    int inotifyFd;
+    int stopPipe[2];
+#endif
+};
+
+FileWatcher GlobalFileWatcher;
 
 void OnGlfwError(int errorCode, const char* errorMessage)
 {
@@ -144,8 +179,26 @@ void OnGlfwCloseWindow(GLFWwindow* window)
     app->isRunning = false;
 }
 
-int main()
+int main(int argc, char** argv)
 {
+    InitAllocationTracker();
+
+    // --allocation-test <frames>: fails, with exit code 1, if any frame after the warm-up allocates from the heap
+    for (int i = 1; i + 1 < argc; ++i)
+        if (strcmp(argv[i], "--allocation-test") == 0)
+            BeginAllocationTest((u32)atoi(argv[i + 1]));
+
+    // --mesh-optimizer-test: runs without a window and exits, with exit code 1 if the optimization didn't improve a bundled model
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--mesh-optimizer-test") == 0)
+        {
+            InitAllocators();
+            return RunMeshOptimizerTest() ? 0 : 1;
+        }
+    }
+    int exitCode = 0;
+
     App app = {};
     app.deltaTime = 1.0f / 60.0f;
     app.currentTime = 0.0;
@@ -177,6 +230,12 @@ int main()
         return -1;
     }
 
+    // Hidden context sharing objects with the main one, used by background loading threads
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GlobalLoaderContext = glfwCreateWindow(1, 1, WINDOW_TITLE, NULL, window);
+    if (!GlobalLoaderContext)
+        ELOG("glfwCreateWindow() failed creating the loader context\n");
+
     glfwMakeContextCurrent(window);
 
     glfwSetWindowUserPointer(window, &app);
@@ -245,12 +304,20 @@ int main()
 
     f64 lastFrameTime = glfwGetTime();
 
-    GlobalFrameArenaMemory = (u8*)malloc(GLOBAL_FRAME_ARENA_SIZE);
+    InitAllocators();
+
+    SetProfilerThreadName("Main");
 
     Init(&app);
 
     while (app.isRunning)
     {
+        ProfilerBeginFrame();
+        f64 frameStartTime = glfwGetTime();
+
+        // The simulation started last frame may still be running on a worker, nothing below can touch the App before it ends
+        FinishSimulation(&app);
+
         // Tell GLFW to call platform callbacks
         glfwPollEvents();
 
@@ -259,11 +326,15 @@ int main()
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
-        ImGui::DockSpaceOverViewport(ImGui::GetMainViewport(), ImGuiDockNodeFlags_PassthruCentralNode);
+        {
+            AllocationScope allocationScope(ALLOCATION_SUBSYSTEM_IMGUI);
 
-        ImGuiRender(&app);
+            ImGui::DockSpaceOverViewport(ImGui::GetMainViewport(), ImGuiDockNodeFlags_PassthruCentralNode);
 
-        ImGui::Render();
+            ImGuiRender(&app);
+
+            ImGui::Render();
+        }
 
         // Clear input state if required by ImGui
         if (ImGui::GetIO().WantCaptureKeyboard)
@@ -275,7 +346,13 @@ int main()
                 app.input.mouseButtons[i] = BUTTON_IDLE;
 
         // Update
-        Update(&app);
+        {
+            AllocationScope allocationScope(ALLOCATION_SUBSYSTEM_UPDATE);
+            Update(&app);
+        }
+
+        // Takes a copy of the input, so it can run on a worker while this frame is rendered
+        StartSimulation(&app);
 
         // Transition input key/button states
         if (!ImGui::GetIO().WantCaptureKeyboard)
@@ -303,40 +380,63 @@ int main()
         app.input.mouseDelta = glm::vec2(0.0f, 0.0f);
 
         // Render
-        Render(&app);
+        {
+            AllocationScope allocationScope(ALLOCATION_SUBSYSTEM_RENDER);
+            Render(&app);
+        }
 
         // ImGui Render
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-        if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
         {
-            GLFWwindow* backup_current_context = glfwGetCurrentContext();
-            ImGui::UpdatePlatformWindows();
-            ImGui::RenderPlatformWindowsDefault();
-            glfwMakeContextCurrent(backup_current_context);
+            PROFILE_SCOPE("ImGui Render");
+            AllocationScope allocationScope(ALLOCATION_SUBSYSTEM_IMGUI);
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
+            {
+                GLFWwindow* backup_current_context = glfwGetCurrentContext();
+                ImGui::UpdatePlatformWindows();
+                ImGui::RenderPlatformWindowsDefault();
+                glfwMakeContextCurrent(backup_current_context);
+            }
         }
 
+        app.cpuFrameTime = (glfwGetTime() - frameStartTime) * 1000.0;
+
         // Present image on screen
-        glfwSwapBuffers(window);
+        {
+            PROFILE_SCOPE("SwapBuffers");
+            glfwSwapBuffers(window);
+        }
 
         // Frame time
         app.currentTime = glfwGetTime();
         app.deltaTime = (float)(app.currentTime - lastFrameTime);
         lastFrameTime = app.currentTime;
 
-        // Reset frame allocator
-        GlobalFrameArenaHead = 0;
+        // The frame arenas of every thread flip to their other buffer
+        UpdateAllocatorStats();
+        AdvanceFrameArenas();
+
+        EndAllocationFrame();
+        bool passed;
+        if (IsAllocationTestRunning() && !UpdateAllocationTest(passed))
+        {
+            exitCode = passed ? 0 : 1;
+            app.isRunning = false;
+        }
     }
 
-    free(GlobalFrameArenaMemory);
+    CleanUp(&app);
 
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
 
+    if (GlobalLoaderContext)
+        glfwDestroyWindow(GlobalLoaderContext);
     glfwDestroyWindow(window);
 
     glfwTerminate();
 
-    return 0;
+    return exitCode;
 }
 
 u32 Strlen(const char* string)
@@ -346,39 +446,46 @@ u32 Strlen(const char* string)
     return len;
 }
 
+// Unaligned, so the strings built from consecutive pushes stay contiguous
 void* PushSize(u32 byteCount)
 {
-    ASSERT(GlobalFrameArenaHead + byteCount <= GLOBAL_FRAME_ARENA_SIZE, "Trying to allocate more temp memory than available");
-
-    u8* curPtr = GlobalFrameArenaMemory + GlobalFrameArenaHead;
-    GlobalFrameArenaHead += byteCount;
-    return curPtr;
+    void* ptr = PushLinear(GetFrameArena(), byteCount, 1);
+    ASSERT(ptr, "Trying to allocate more temp memory than available");
+    return ptr;
 }
 
 void* PushBytes(const void* bytes, u32 byteCount)
 {
-    ASSERT(GlobalFrameArenaHead + byteCount <= GLOBAL_FRAME_ARENA_SIZE, "Trying to allocate more temp memory than available");
-
-    u8* srcPtr = (u8*)bytes;
-    u8* curPtr = GlobalFrameArenaMemory + GlobalFrameArenaHead;
-    u8* dstPtr = GlobalFrameArenaMemory + GlobalFrameArenaHead;
-    GlobalFrameArenaHead += byteCount;
-
-    while (byteCount--)
-        *dstPtr++ = *srcPtr++;
-
-    return curPtr;
+    // memcpy copies whole vector registers at a time
+    void* ptr = PushSize(byteCount);
+    memcpy(ptr, bytes, byteCount);
+    return ptr;
 }
 
 u8* PushChar(u8 c)
 {
-    ASSERT(GlobalFrameArenaHead + 1 <= GLOBAL_FRAME_ARENA_SIZE, "Trying to allocate more temp memory than available");
-    u8* ptr = GlobalFrameArenaMemory + GlobalFrameArenaHead;
-    GlobalFrameArenaHead++;
+    u8* ptr = (u8*)PushSize(1);
     *ptr = c;
     return ptr;
 }
 
+String FormatString(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(nullptr, 0, format, args);
+    va_end(args);
+
+    String str = {};
+    str.len = (u32)len;
+    str.str = (char*)PushSize(str.len + 1);
+
+    va_start(args, format);
+    vsnprintf(str.str, str.len + 1, format, args);
+    va_end(args);
+    return str;
+}
+
 String MakeString(const char* cstr)
 {
     String str = {};
@@ -466,6 +573,321 @@ u64 GetFileLastWriteTimestamp(const char* filepath)
     return 0;
 }
 
+bool MakeDirectory(const char* path)
+{
+#ifdef _WIN32
+    return CreateDirectoryA(path, NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+void ListDirectoryFiles(const char* path, std::vector<std::string>& filenames)
+{
+    filenames.clear();
+
+#ifdef _WIN32
+    std::string pattern = std::string(path) + "/*";
+    WIN32_FIND_DATAA findData;
+    HANDLE findHandle = FindFirstFileA(pattern.c_str(), &findData);
+    if (findHandle == INVALID_HANDLE_VALUE)
+        return;
+
+    do
+    {
+        if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+            filenames.push_back(findData.cFileName);
+    } while (FindNextFileA(findHandle, &findData));
+    FindClose(findHandle);
+#else
+    DIR* directory = opendir(path);
+    if (!directory)
+        return;
+
+    while (dirent* entry = readdir(directory))
+    {
+        std::string filepath = std::string(path) + "/" + entry->d_name;
+        struct stat attrib;
+        if (stat(filepath.c_str(), &attrib) == 0 && S_ISREG(attrib.st_mode))
+            filenames.push_back(entry->d_name);
+    }
+    closedir(directory);
+#endif
+}
+
+bool MapFile(const char* filepath, MappedFile& file)
+{
+    file = {};
+
+#ifdef _WIN32
+    HANDLE fileHandle = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    HANDLE mappingHandle = NULL;
+    if (GetFileSizeEx(fileHandle, &size) && size.QuadPart > 0)
+        mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+
+    void* data = mappingHandle ? MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!data)
+    {
+        if (mappingHandle)
+            CloseHandle(mappingHandle);
+        CloseHandle(fileHandle);
+        return false;
+    }
+
+    file.data = (const u8*)data;
+    file.size = (u64)size.QuadPart;
+    file.fileHandle = fileHandle;
+    file.mappingHandle = mappingHandle;
+#else
+    int fd = open(filepath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    // The mapping keeps the file alive, the descriptor isn't needed anymore
+    struct stat attrib;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &attrib) == 0 && attrib.st_size > 0)
+        data = mmap(NULL, attrib.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+        return false;
+
+    file.data = (const u8*)data;
+    file.size = (u64)attrib.st_size;
+#endif
+    return true;
+}
+
+void UnmapFile(MappedFile& file)
+{
+    if (!file.data)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(file.data);
+    CloseHandle(file.mappingHandle);
+    CloseHandle(file.fileHandle);
+#else
+    munmap((void*)file.data, file.size);
+#endif
+    file = {};
+}
+
+static void SplitPath(const char* filepath, std::string& path, std::string& directory, std::string& filename)
+{
+    path = filepath;
+    for (u32 i = 0; i < path.size(); ++i)
+        if (path[i] == '\\')
+            path[i] = '/';
+
+    size_t separator = path.find_last_of('/');
+    directory = separator == std::string::npos ? "." : path.substr(0, separator);
+    filename = separator == std::string::npos ? path : path.substr(separator + 1);
+}
+
+static std::string JoinPath(const std::string& directory, const std::string& filename)
+{
+    return directory == "." ? filename : directory + "/" + filename;
+}
+
+// Must be called with the watcher mutex locked
+static void InitFileWatcher(FileWatcher& watcher)
+{
+    if (watcher.initialized)
+        return;
+
+#ifdef _WIN32
+    watcher.stopEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+#else
+    watcher.inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watcher.inotifyFd < 0 || pipe(watcher.stopPipe) != 0)
+        ELOG("Failed to initialize the file watcher\n");
+#endif
+    watcher.initialized = true;
+}
+
+void WatchFile(const char* filepath)
+{
+    FileWatcher& watcher = GlobalFileWatcher;
+    std::lock_guard<std::mutex> lock(watcher.mutex);
+    InitFileWatcher(watcher);
+
+    std::string path, directory, filename;
+    SplitPath(filepath, path, directory, filename);
+
+    for (u32 i = 0; i < watcher.files.size(); ++i)
+        if (watcher.files[i] == path)
+            return;
+
+    watcher.files.push_back(path);
+#ifdef _WIN32
+    watcher.fileTimestamps.push_back(GetFileLastWriteTimestamp(path.c_str()));
+#endif
+
+    for (u32 i = 0; i < watcher.directories.size(); ++i)
+        if (watcher.directories[i] == directory)
+            return;
+
+    // Directories are watched instead of files because most editors save by replacing the file
+#ifdef _WIN32
+    // NOTE: A directory added while WaitForFileChange is blocked is only picked up on its next wake up
+    HANDLE handle = FindFirstChangeNotificationA(directory.c_str(), FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE);
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        ELOG("FindFirstChangeNotification() failed watching directory %s\n", directory.c_str());
+        return;
+    }
+    watcher.directoryHandles.push_back(handle);
+#else
+    int watchDescriptor = inotify_add_watch(watcher.inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (watchDescriptor < 0)
+    {
+        ELOG("inotify_add_watch() failed watching directory %s\n", directory.c_str());
+        return;
+    }
+    watcher.watchDescriptors.push_back(watchDescriptor);
+#endif
+    watcher.directories.push_back(directory);
+}
+
+// Must be called with the watcher mutex locked
+static void QueueFileChange(FileWatcher& watcher, const std::string& path)
+{
+    for (u32 i = 0; i < watcher.pendingChanges.size(); ++i)
+        if (watcher.pendingChanges[i] == path)
+            return;
+
+    watcher.pendingChanges.push_back(path);
+}
+
+bool WaitForFileChange(std::string& filepath)
+{
+    FileWatcher& watcher = GlobalFileWatcher;
+
+    for (;;)
+    {
+        {
+            std::lock_guard<std::mutex> lock(watcher.mutex);
+            InitFileWatcher(watcher);
+
+            if (watcher.stopped)
+                return false;
+
+            if (!watcher.pendingChanges.empty())
+            {
+                filepath = watcher.pendingChanges.front();
+                watcher.pendingChanges.erase(watcher.pendingChanges.begin());
+                return true;
+            }
+        }
+
+#ifdef _WIN32
+        std::vector<HANDLE> handles;
+        {
+            std::lock_guard<std::mutex> lock(watcher.mutex);
+            handles.push_back(watcher.stopEvent);
+            handles.insert(handles.end(), watcher.directoryHandles.begin(), watcher.directoryHandles.end());
+        }
+
+        DWORD result = WaitForMultipleObjects((DWORD)handles.size(), handles.data(), FALSE, INFINITE);
+        if (result <= WAIT_OBJECT_0 || result >= WAIT_OBJECT_0 + handles.size())
+            continue;
+
+        u32 directoryIndex = result - WAIT_OBJECT_0 - 1;
+        FindNextChangeNotification(handles[directoryIndex + 1]);
+
+        // The notification does not say which file changed, so only the files of that directory are checked
+        std::lock_guard<std::mutex> lock(watcher.mutex);
+        const std::string& directory = watcher.directories[directoryIndex];
+        for (u32 i = 0; i < watcher.files.size(); ++i)
+        {
+            const std::string& path = watcher.files[i];
+            size_t separator = path.find_last_of('/');
+            if (JoinPath(directory, path.substr(separator == std::string::npos ? 0 : separator + 1)) != path)
+                continue;
+
+            u64 timestamp = GetFileLastWriteTimestamp(path.c_str());
+            if (timestamp > watcher.fileTimestamps[i])
+            {
+                watcher.fileTimestamps[i] = timestamp;
+                QueueFileChange(watcher, path);
+            }
+        }
+#else
+        pollfd fds[2] = {};
+        fds[0].fd = watcher.inotifyFd;
+        fds[0].events = POLLIN;
+        fds[1].fd = watcher.stopPipe[0];
+        fds[1].events = POLLIN;
+
+        if (poll(fds, 2, -1) <= 0 || !(fds[0].revents & POLLIN))
+            continue;
+
+        alignas(inotify_event) char buffer[4096];
+        ssize_t length = read(watcher.inotifyFd, buffer, sizeof(buffer));
+
+        std::lock_guard<std::mutex> lock(watcher.mutex);
+        for (ssize_t offset = 0; offset < length;)
+        {
+            const inotify_event* event = (const inotify_event*)(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            if (event->len == 0)
+                continue;
+
+            for (u32 i = 0; i < watcher.watchDescriptors.size(); ++i)
+            {
+                if (watcher.watchDescriptors[i] != event->wd)
+                    continue;
+
+                std::string path = JoinPath(watcher.directories[i], event->name);
+                for (u32 j = 0; j < watcher.files.size(); ++j)
+                    if (watcher.files[j] == path)
+                        QueueFileChange(watcher, path);
+                break;
+            }
+        }
+#endif
+    }
+}
+
+void StopFileWatcher()
+{
+    FileWatcher& watcher = GlobalFileWatcher;
+    std::lock_guard<std::mutex> lock(watcher.mutex);
+    if (!watcher.initialized || watcher.stopped)
+        return;
+
+    watcher.stopped = true;
+
+#ifdef _WIN32
+    SetEvent(watcher.stopEvent);
+#else
+    char wakeUp = 0;
+    write(watcher.stopPipe[1], &wakeUp, 1);
+#endif
+}
+
+void* GetOpenGLProcAddress(const char* name)
+{
+    return (void*)glfwGetProcAddress(name);
+}
+
+void MakeLoaderContextCurrent()
+{
+    glfwMakeContextCurrent(GlobalLoaderContext);
+}
+
+void ReleaseLoaderContext()
+{
+    glfwMakeContextCurrent(NULL);
+}
+
 void LogString(const char* str)
 {
 #ifdef _WIN32
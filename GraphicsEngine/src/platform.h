@@ -70,6 +70,9 @@ struct String
 
 String MakeString(const char* cstr);
 
+// printf into the frame arena of the calling thread
+String FormatString(const char* format, ...);
+
 String MakePath(String dir, String filename);
 
 String GetDirectoryPart(String path);
@@ -86,6 +89,59 @@ String ReadTextFile(const char* filepath);
  */
 u64 GetFileLastWriteTimestamp(const char* filepath);
 
+/**
+ * Creates a directory if it doesn't exist yet. Returns false if it couldn't be created.
+ */
+bool MakeDirectory(const char* path);
+
+/**
+ * Names of the regular files in a directory, without the path. Empty if the directory doesn't exist.
+ */
+void ListDirectoryFiles(const char* path, std::vector<std::string>& filenames);
+
+/**
+ * A whole file mapped read-only into the address space, the pages are loaded by the OS as they are touched.
+ */
+struct MappedFile
+{
+    const u8* data;
+    u64       size;
+    void*     fileHandle;
+    void*     mappingHandle; // Only used on Windows
+};
+
+/**
+ * Maps a file read-only. Returns false, without logging, if it doesn't exist or is empty.
+ */
+bool MapFile(const char* filepath, MappedFile& file);
+void UnmapFile(MappedFile& file);
+
+/**
+ * Registers a file to be watched for modifications. The directory of the file is watched
+ * by the OS (inotify or directory change notifications), so no polling is needed.
+ */
+void WatchFile(const char* filepath);
+
+/**
+ * Blocks the calling thread until a watched file is modified. Returns false once the watcher
+ * has been stopped with StopFileWatcher. Meant to be called from a background thread.
+ */
+bool WaitForFileChange(std::string& filepath);
+
+void StopFileWatcher();
+
+/**
+ * Makes current in the calling thread a hidden OpenGL context that shares objects with the
+ * main context, so background threads can create programs and textures.
+ */
+void MakeLoaderContextCurrent();
+void ReleaseLoaderContext();
+
+/**
+ * Returns the address of an OpenGL function not loaded by glad, e.g. from an extension.
+ */
+void* GetOpenGLProcAddress(const char* name);
+
 /**
  * It logs a string to whichever outputs are configured in the platform layer.
  * By default, the string is printed in the output console of VisualStudio.